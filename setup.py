@@ -2,7 +2,11 @@
 
 """The setup script."""
 
+import os
+import subprocess
+
 from setuptools import setup, find_packages
+from setuptools.command.build_py import build_py
 
 with open("README.rst", encoding="utf-8") as readme_file:
     readme = readme_file.read()
@@ -26,6 +30,38 @@ test_requirements = ["pytest>=3"]
 
 version = __version__
 
+CUSTOM_OPS = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                          "snntorch", "custom_ops")
+
+
+def _build_cpu_ops():
+    """Whether to build the CPU kernels, which need torch at build time.
+
+    SNNTORCH_BUILD_CPU_OPS=0 skips them and =1 requires them; by default
+    they are built when torch can be imported. Without them snntorch.cpu
+    reports the missing library when first used."""
+    setting = os.environ.get("SNNTORCH_BUILD_CPU_OPS")
+    if setting is not None:
+        return setting != "0"
+    try:
+        import torch  # noqa: F401
+    except ImportError:
+        return False
+    return True
+
+
+class BuildPyWithCustomOps(build_py):
+    """Build the custom op library and codelets before collecting package
+    data, so that wheels ship them prebuilt and import never compiles."""
+
+    def run(self):
+        targets = ["all"]
+        if _build_cpu_ops():
+            targets.append("cpu_ops")
+        subprocess.check_call(["make", "-C", CUSTOM_OPS] + targets)
+        build_py.run(self)
+
+
 setup(
     author="Jason K. Eshraghian & Vincent Sun",
     author_email="jasonesh@umich.edu",
@@ -59,12 +95,16 @@ setup(
     keywords="snntorch",
     name="snntorch-ipu",
     packages=find_packages(include=["snntorch-ipu", "snntorch", "snntorch.*"]),
-    #package_data = { 'so_file' : ['custom_ops.so','fast_sigmoid_custom_ops.so', 
-    #                'heaviside_custom_ops.so', 'straight_through_estimator_custom_ops.so'],
-    #                 'custom_ops' : ['Makefile', 'fast_sigmoid.cpp', 'heaviside_custom_op.cpp',
-    #                     'straight_through_estimator.cpp']},
-    package_data = {'custom_ops' : ['Makefile', 'fast_sigmoid.cpp', 'heaviside_custom_op.cpp',
-                                    'straight_through_estimator.cpp']},
+    package_data={"snntorch": ["so_file/libsnntorch_ipu_ops.so",
+                               "so_file/spike_codelets.gp",
+                               "so_file/libsnntorch_cpu_ops.so",
+                               "custom_ops/Makefile",
+                               "custom_ops/*.cpp",
+                               "custom_ops/*.hpp",
+                               "custom_ops/cpu/*.cpp",
+                               "custom_ops/cpu/*.hpp",
+                               "custom_ops/codelets/*.cpp"]},
+    cmdclass={"build_py": BuildPyWithCustomOps},
     test_suite="tests",
     tests_require=test_requirements,
     url="https://github.com/vinniesun/snntorch-ipu",
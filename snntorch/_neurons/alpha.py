@@ -2,6 +2,8 @@ import torch
 import torch.nn as nn
 
 from .neurons import *
+import poptorch
+from .. import cpu
 
 
 class Alpha(LIF):
@@ -125,9 +127,13 @@ class Alpha(LIF):
             self.syn_exc, self.syn_inh, self.mem = _SpikeTorchConv(
                 self.syn_exc, self.syn_inh, self.mem, input_=input_
             )
+            self.reset = None  # the fresh states have not fired yet
 
         # if hidden states are passed externally
         if not self.init_hidden:
+            if self._fused:
+                return self.alpha_step(input_, syn_exc, syn_inh, mem)
+
             self.reset = self.mem_reset(mem)
             syn_exc, syn_inh, mem = self.state_fn(input_, syn_exc, syn_inh, mem)
 
@@ -136,11 +142,7 @@ class Alpha(LIF):
             #     syn_inh = self.state_quant(syn_inh)
             #     mem = self.state_quant(mem)
 
-            if self.inhibition:
-                spk = self.fire_inhibition(mem.size(0), mem)
-
-            else:
-                spk = self.fire(mem)
+            spk, _ = self._fire_and_reset(mem)
 
             return spk, syn_exc, syn_inh, mem
 
@@ -148,25 +150,60 @@ class Alpha(LIF):
         if self.init_hidden:
             self._alpha_forward_cases(mem, syn_exc, syn_inh)
 
-            self.reset = self.mem_reset(self.mem)
-            self.syn_exc, self.syn_inh, self.mem = self.state_fn(input_)
+            if not self._fused:
+                # self.reset is that of self.mem, from the fire of the last
+                # step, unless the states have just been initialised
+                if self.reset is None:
+                    self.reset = self.mem_reset(self.mem)
+                self.syn_exc, self.syn_inh, self.mem = self.state_fn(input_)
 
-            # if self.state_quant:
-            #     self.syn_exc = self.state_quant(self.syn_exc)
-            #     self.syn_inh = self.state_quant(self.syn_inh)
-            #     self.mem = self.state_quant(self.mem)
+                # if self.state_quant:
+                #     self.syn_exc = self.state_quant(self.syn_exc)
+                #     self.syn_inh = self.state_quant(self.syn_inh)
+                #     self.mem = self.state_quant(self.mem)
 
-            if self.inhibition:
-                self.spk = self.fire_inhibition(self.mem.size(0), self.mem)
+                self.spk, self.reset = self._fire_and_reset(self.mem)
 
             else:
-                self.spk = self.fire(self.mem)
+                self.spk, self.syn_exc, self.syn_inh, self.mem = self.alpha_step(
+                    input_, self.syn_exc, self.syn_inh, self.mem
+                )
 
             if self.output:
                 return self.spk, self.syn_exc, self.syn_inh, self.mem
             else:
                 return self.spk
 
+    def alpha_step(self, input_, syn_exc, syn_inh, mem, spike_dtype=None):
+        """Updates all three states, resets and fires for one time step as a single fused `AlphaStep` op.
+        ``spike_dtype`` (torch.bool or torch.uint8) emits compact spikes, which carry no gradient, while the states keep their type.
+        Returns spk, syn_exc, syn_inh, mem."""
+        self._check_fused_surrogate()
+        spike_attributes, spk_example = self._spike_output(spike_dtype, input_)
+        if cpu.use_cpu():
+            spk, syn_exc, syn_inh, mem = cpu.alpha_step(
+                input_, syn_exc, syn_inh, mem, self.alpha, self.beta,
+                self.threshold, SpikingNeuron.reset_dict[self.reset_mechanism],
+                **cpu.surrogate_arguments(self.surrogate, self.surrogate_attributes),
+            )
+            if spike_dtype is not None:
+                spk = spk.to(spike_dtype)
+            return spk, syn_exc, syn_inh, mem
+        spk, syn_exc, syn_inh, mem = poptorch.custom_op(
+            [input_, syn_exc, syn_inh, mem, self.alpha, self.beta, self.threshold],
+            "AlphaStep",
+            "custom.ops",
+            1,
+            example_outputs=[spk_example, input_, input_, input_],
+            attributes={
+                "reset_mechanism": SpikingNeuron.reset_dict[self.reset_mechanism],
+                "surrogate": self.surrogate,
+                **self.surrogate_attributes,
+                **spike_attributes,
+            },
+        )
+        return spk, syn_exc, syn_inh, mem
+
     def _base_state_function(self, input_, syn_exc, syn_inh, mem):
         base_fn_syn_exc = self.alpha.clamp(0, 1) * syn_exc + input_
         base_fn_syn_inh = self.beta.clamp(0, 1) * syn_inh - input_
@@ -1,5 +1,7 @@
 import torch
 from .neurons import *
+import poptorch
+from .. import cpu
 
 
 class Lapicque(LIF):
@@ -169,6 +171,13 @@ class Lapicque(LIF):
 
         self._lapicque_cases(time_step, beta, R, C)
 
+        # The time step, and R and C when they hold a single value, are
+        # folded into the LapicqueStep op as attributes
+        self.circuit_attributes = {"time_step": float(self.time_step)}
+        if self.R.numel() == 1 and self.C.numel() == 1:
+            self.circuit_attributes["R"] = float(self.R)
+            self.circuit_attributes["C"] = float(self.C)
+
         if self.init_hidden:
             self.mem = self.init_lapicque()
             self.state_fn = self._build_state_function_hidden
@@ -181,40 +190,83 @@ class Lapicque(LIF):
             mem = _SpikeTorchConv(mem, input_=input_)
         elif mem is False and hasattr(self.mem, "init_flag"):  # init_hidden case
             self.mem = _SpikeTorchConv(self.mem, input_=input_)
+            self.reset = None  # the fresh states have not fired yet
 
         if not self.init_hidden:
+            if self._fused:
+                spk, mem = self.lapicque_step(input_, mem)
+                return spk, mem
+
             self.reset = self.mem_reset(mem)
             mem = self.state_fn(input_, mem)
 
             # if self.state_quant:
             #     mem = self.state_quant(mem)
 
-            if self.inhibition:
-                spk = self.fire_inhibition(mem.size(0), mem)
-            else:
-                spk = self.fire(mem)
+            spk, _ = self._fire_and_reset(mem)
 
             return spk, mem
 
         # intended for truncated-BPTT where instance variables are hidden states
         if self.init_hidden:
             self._lapicque_forward_cases(mem)
-            self.reset = self.mem_reset(self.mem)
-            self.mem = self.state_fn(input_)
 
-            # if self.state_quant:
-            #     self.mem = self.state_quant(self.mem)
+            if not self._fused:
+                # self.reset is that of self.mem, from the fire of the last
+                # step, unless the states have just been initialised
+                if self.reset is None:
+                    self.reset = self.mem_reset(self.mem)
+                self.mem = self.state_fn(input_)
+
+                # if self.state_quant:
+                #     self.mem = self.state_quant(self.mem)
 
-            if self.inhibition:
-                self.spk = self.fire_inhibition(self.mem.size(0), self.mem)
+                self.spk, self.reset = self._fire_and_reset(self.mem)
             else:
-                self.spk = self.fire(self.mem)
+                self.spk, self.mem = self.lapicque_step(input_, self.mem)
 
             if self.output:
                 return self.spk, self.mem
             else:
                 return self.spk
 
+    def lapicque_step(self, input_, mem, spike_dtype=None):
+        """Runs integration, reset, threshold and spike for one time step as a single fused `LapicqueStep` op.
+        Single-valued R and C are folded into the op as constants, so the decay is only computed once when the graph is compiled;
+        per-neuron R and C are passed to the op as tensors.
+        ``spike_dtype`` (torch.bool or torch.uint8) emits compact spikes, which carry no gradient, while the states keep their type.
+        Returns spk, mem."""
+        self._check_fused_surrogate()
+        spike_attributes, spk_example = self._spike_output(spike_dtype, input_)
+        if cpu.use_cpu():
+            spk, mem = cpu.lapicque_step(
+                input_, mem, self.threshold, self.R, self.C,
+                self.circuit_attributes["time_step"],
+                SpikingNeuron.reset_dict[self.reset_mechanism],
+                **cpu.surrogate_arguments(self.surrogate, self.surrogate_attributes),
+            )
+            if spike_dtype is not None:
+                spk = spk.to(spike_dtype)
+            return spk, mem
+        inputs = [input_, mem, self.threshold]
+        if "R" not in self.circuit_attributes:
+            inputs += [self.R.to(input_.dtype), self.C.to(input_.dtype)]
+        spk, mem = poptorch.custom_op(
+            inputs,
+            "LapicqueStep",
+            "custom.ops",
+            1,
+            example_outputs=[spk_example, input_],
+            attributes={
+                "reset_mechanism": SpikingNeuron.reset_dict[self.reset_mechanism],
+                "surrogate": self.surrogate,
+                **self.surrogate_attributes,
+                **self.circuit_attributes,
+                **spike_attributes,
+            },
+        )
+        return spk, mem
+
     def _base_state_function(self, input_, mem):
         base_fn = (
             input_ * self.R * (1 / (self.R * self.C)) * self.time_step
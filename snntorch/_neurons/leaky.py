@@ -1,4 +1,7 @@
+import torch
 from .neurons import *
+import poptorch
+from .. import cpu
 
 
 class Leaky(LIF):
@@ -136,44 +139,161 @@ class Leaky(LIF):
             mem = _SpikeTorchConv(mem, input_=input_)
         elif mem is False and hasattr(self.mem, "init_flag"):  # init_hidden case
             self.mem = _SpikeTorchConv(self.mem, input_=input_)
+            self.reset = None  # the fresh states have not fired yet
 
         # TO-DO: alternatively, we could do torch.exp(-1 / self.beta.clamp_min(0)),
         # giving actual time constants instead of values in [0, 1] as initial beta
         # beta = self.beta.clamp(0, 1)
 
         if not self.init_hidden:
+            if self._fused:
+                spk, mem = self.leaky_step(input_, mem)
+                return spk, mem
+
             self.reset = self.mem_reset(mem)
             mem = self.state_fn(input_, mem)
 
             # if self.state_quant:
             #     mem = self.state_quant(mem)
 
-            if self.inhibition:
-                spk = self.fire_inhibition(mem.size(0), mem)  # batch_size
-            else:
-                spk = self.fire(mem)
+            spk, _ = self._fire_and_reset(mem)
 
             return spk, mem
 
         # intended for truncated-BPTT where instance variables are hidden states
         if self.init_hidden:
             self._leaky_forward_cases(mem)
-            self.reset = self.mem_reset(self.mem)
-            self.mem = self.state_fn(input_)
+            if not self._fused:
+                # self.reset is that of self.mem, from the fire of the last
+                # step, unless the states have just been initialised
+                if self.reset is None:
+                    self.reset = self.mem_reset(self.mem)
+                self.mem = self.state_fn(input_)
 
-            # if self.state_quant:
-            #     self.mem = self.state_quant(self.mem)
+                # if self.state_quant:
+                #     self.mem = self.state_quant(self.mem)
 
-            if self.inhibition:
-                self.spk = self.fire_inhibition(self.mem.size(0), self.mem)
+                self.spk, self.reset = self._fire_and_reset(self.mem)
             else:
-                self.spk = self.fire(self.mem)
+                self.spk, self.mem = self.leaky_step(input_, self.mem)
 
             if self.output:  # read-out layer returns output+states
                 return self.spk, self.mem
             else:  # hidden layer e.g., in nn.Sequential, only returns output
                 return self.spk
 
+    def leaky_step(self, input_, mem, spike_dtype=None):
+        """Runs decay, reset, threshold and spike for one time step as a single fused `LeakyStep` op.
+        ``spike_dtype`` (torch.bool or torch.uint8) emits compact spikes, which carry no gradient, while the states keep their type.
+        Returns spk, mem."""
+        self._check_fused_surrogate()
+        spike_attributes, spk_example = self._spike_output(spike_dtype, input_)
+        if cpu.use_cpu():
+            spk, mem = cpu.leaky_step(
+                input_, mem, self.beta, self.threshold,
+                SpikingNeuron.reset_dict[self.reset_mechanism],
+                **cpu.surrogate_arguments(self.surrogate, self.surrogate_attributes),
+            )
+            if spike_dtype is not None:
+                spk = spk.to(spike_dtype)
+            return spk, mem
+        spk, mem = poptorch.custom_op(
+            [input_, mem, self.beta, self.threshold],
+            "LeakyStep",
+            "custom.ops",
+            1,
+            example_outputs=[spk_example, input_],
+            attributes={
+                "reset_mechanism": SpikingNeuron.reset_dict[self.reset_mechanism],
+                "surrogate": self.surrogate,
+                **self.surrogate_attributes,
+                **spike_attributes,
+            },
+        )
+        return spk, mem
+
+    def leaky_sequence(self, input_, mem, spike_dtype=None):
+        """Runs all time steps of ``input_`` (of shape `(num_steps, batch, input_size)`) in a single fused `LeakySequence` op,
+        keeping the membrane potential on-tile for the whole sequence instead of unrolling one graph per step.
+        Returns the recorded spk_rec and mem_rec, both of shape `(num_steps, batch, input_size)`.
+        ``spike_dtype`` (torch.bool or torch.uint8) records compact spikes, which carry no gradient, while mem_rec keeps its type.
+
+        Example::
+
+            mem = torch.zeros_like(x[0])
+            spk_rec, mem_rec = lif.leaky_sequence(x, mem)
+        """
+        self._check_fused_surrogate()
+        spike_attributes, spk_example = self._spike_output(spike_dtype, input_)
+        if cpu.use_cpu():
+            spk_rec, mem_rec = cpu.leaky_sequence(
+                input_, mem, self.beta, self.threshold,
+                reset_mechanism=SpikingNeuron.reset_dict[self.reset_mechanism],
+                **cpu.surrogate_arguments(self.surrogate, self.surrogate_attributes),
+            )
+            if spike_dtype is not None:
+                spk_rec = spk_rec.to(spike_dtype)
+            return spk_rec, mem_rec
+        spk_rec, mem_rec = poptorch.custom_op(
+            [input_, mem, self.beta, self.threshold],
+            "LeakySequence",
+            "custom.ops",
+            1,
+            example_outputs=[spk_example, input_],
+            attributes={
+                "reset_mechanism": SpikingNeuron.reset_dict[self.reset_mechanism],
+                "surrogate": self.surrogate,
+                **self.surrogate_attributes,
+                **spike_attributes,
+            },
+        )
+        return spk_rec, mem_rec
+
+    def adaptive_leaky_step(self, input_, mem, a, rho, beta_a, spike_dtype=None):
+        """Runs one time step of an adaptive-threshold (ALIF) neuron as a single fused `AdaptiveLeakyStep` op.
+        The neuron keeps an adaptation state ``a`` next to ``mem``, which decays with rate ``rho`` and grows by one on each spike,
+        and fires once ``mem`` reaches ``threshold + beta_a * a``: ``threshold`` is the baseline, and ``beta`` and ``reset_mechanism`` apply as for `leaky_step`.
+        ``rho`` (clipped between 0 and 1) and ``beta_a`` may be floats or tensors of one value or one per neuron, learnable or not.
+        ``spike_dtype`` (torch.bool or torch.uint8) emits compact spikes, which carry no gradient, while the states keep their type.
+        Returns spk, mem, a.
+
+        Example::
+
+            mem = torch.zeros_like(x[0])
+            a = torch.zeros_like(x[0])
+            for step in x:
+                spk, mem, a = lif.adaptive_leaky_step(step, mem, a, rho=0.95, beta_a=1.8)
+        """
+        self._check_fused_surrogate()
+        spike_attributes, spk_example = self._spike_output(spike_dtype, input_)
+        if cpu.use_cpu():
+            spk, mem, a = cpu.adaptive_leaky_step(
+                input_, mem, a, self.beta, rho, self.threshold, beta_a,
+                SpikingNeuron.reset_dict[self.reset_mechanism],
+                **cpu.surrogate_arguments(self.surrogate, self.surrogate_attributes),
+            )
+            if spike_dtype is not None:
+                spk = spk.to(spike_dtype)
+            return spk, mem, a
+        if not isinstance(rho, torch.Tensor):
+            rho = torch.as_tensor(rho, dtype=input_.dtype)
+        if not isinstance(beta_a, torch.Tensor):
+            beta_a = torch.as_tensor(beta_a, dtype=input_.dtype)
+        spk, mem, a = poptorch.custom_op(
+            [input_, mem, a, self.beta, rho, self.threshold, beta_a],
+            "AdaptiveLeakyStep",
+            "custom.ops",
+            1,
+            example_outputs=[spk_example, input_, input_],
+            attributes={
+                "reset_mechanism": SpikingNeuron.reset_dict[self.reset_mechanism],
+                "surrogate": self.surrogate,
+                **self.surrogate_attributes,
+                **spike_attributes,
+            },
+        )
+        return spk, mem, a
+
     def _base_state_function(self, input_, mem):
         base_fn = self.beta.clamp(0, 1) * mem + input_
         return base_fn
@@ -1,8 +1,8 @@
 from warnings import warn
 import torch
 import torch.nn as nn
-import ctypes
-import os
+from ..so_file import load_custom_ops
+from .. import cpu
 import popart
 import poptorch
 
@@ -29,6 +29,12 @@ class SpikingNeuron(nn.Module):
         "none": 2,
     }
 
+    spike_dtypes = {
+        torch.bool: "bool",
+        torch.uint8: "uint8",
+    }
+    """Compact spike types the fused neuron ops can emit through their `spike_dtype` argument."""
+
     def __init__(
         self,
         threshold=1.0,
@@ -51,18 +57,8 @@ class SpikingNeuron(nn.Module):
         self._snn_register_buffer(threshold, learn_threshold, reset_mechanism)
         self._reset_mechanism = reset_mechanism
 
-        cwd = os.path.dirname(__file__)
-        cwd = cwd[:-8]
-        so_path_heaviside = os.path.join(cwd, "so_file/heaviside_custom_ops.so")
-        #so_path_heaviside = "./so_file/heaviside_custom_ops.so"
-        if not os.path.isfile(so_path_heaviside):
-            print("Missing Heaviside Custom Operation File")
-            print(so_path_heaviside)
-            exit(1)
-        ctypes.cdll.LoadLibrary(so_path_heaviside)
-
-     
-        # TO-DO: Heaviside --> STE; needs a tutorial change too?
+        load_custom_ops()
+
         if spike_grad is None:
             self.spike_grad = self.Heaviside
         else:
@@ -73,6 +69,8 @@ class SpikingNeuron(nn.Module):
 
 
     def Heaviside(self, input_data, run_on_ipu=True):
+        if cpu.use_cpu(run_on_ipu):
+            return cpu.spike(input_data, surrogate="heaviside")
         y = poptorch.custom_op(
                 [input_data],
                 "Heaviside",
@@ -90,33 +88,107 @@ class SpikingNeuron(nn.Module):
         # if self.state_quant:
         #     mem = self.state_quant(mem)
 
-        mem_shift = mem - self.threshold
-        spk = self.spike_grad(mem_shift)
+        spk, _ = self._spike_and_reset(mem)
 
         return spk
 
     def fire_inhibition(self, batch_size, mem):
         """Generates spike if mem > threshold, only for the largest membrane. All others neurons will be inhibited for that time step.
         Returns spk."""
+        spk, _ = self._fire_inhibition_and_reset(batch_size, mem)
+
+        return spk
+
+    def _fire_inhibition_and_reset(self, batch_size, mem):
+        """`fire_inhibition` that also returns the detached reset of every neuron above threshold, which is `mem_reset(mem)`.
+        Neurons keeping their states as instance variables carry it to the next step in ``self.reset``.
+        Returns spk, reset."""
+        surrogate = getattr(self, "surrogate", None)
+        if surrogate is not None:
+            return self._inhibited_fire(mem, surrogate)
+
         mem_shift = mem - self.threshold
         index = torch.argmax(mem_shift, dim=1)
-        spk_tmp = self.spike_grad(mem_shift)
+        spk_tmp, reset = self._spike_and_reset(mem)
 
         mask_spk1 = torch.zeros_like(spk_tmp)
         mask_spk1[torch.arange(batch_size), index] = 1
         spk = spk_tmp * mask_spk1
-        # reset = spk.clone().detach()
 
-        return spk
+        return spk, reset
+
+    def _inhibited_fire(self, mem, surrogate):
+        """`fire_inhibition` as a single `InhibitedFire` op, which finds the winner of each row, fires it and gives the matching
+        surrogate gradient without the argmax, mask and scatter. The op also emits the detached reset of every neuron above threshold.
+        Returns spk, reset."""
+        if cpu.use_cpu():
+            spk, reset = cpu.inhibited_fire(
+                mem, self.threshold,
+                **cpu.surrogate_arguments(surrogate, self.surrogate_attributes),
+            )
+        else:
+            spk, reset = poptorch.custom_op(
+                [mem, self.threshold],
+                "InhibitedFire",
+                "custom.ops",
+                1,
+                example_outputs=[mem, mem],
+                attributes={"surrogate": surrogate, **self.surrogate_attributes},
+            )
+        return spk, reset.detach()
+
+    def _check_fused_surrogate(self):
+        """Raises a ValueError unless the fused step ops can compute the gradient of ``spike_grad``."""
+        if getattr(self, "surrogate", None) is None:
+            raise ValueError(
+                "The fused step ops compute the gradient of the surrogates in "
+                "snntorch.surrogate only; call forward to run another "
+                "spike_grad."
+            )
+
+    def _spike_output(self, spike_dtype, like):
+        """The `spike_dtype` attribute of a fused op and an example of its spike output, for spikes of ``spike_dtype``
+        (one of `spike_dtypes`, or None to keep the type of ``like``). Compact spikes carry no gradient.
+        Returns attributes, example."""
+        if spike_dtype is None:
+            return {}, like
+        if spike_dtype not in SpikingNeuron.spike_dtypes:
+            raise ValueError(
+                "spike_dtype must be one of {} or None, got {}".format(
+                    list(SpikingNeuron.spike_dtypes), spike_dtype
+                )
+            )
+        return (
+            {"spike_dtype": SpikingNeuron.spike_dtypes[spike_dtype]},
+            torch.zeros_like(like, dtype=spike_dtype),
+        )
 
     def mem_reset(self, mem):
         """Generates detached reset signal if mem > threshold.
         Returns reset."""
+        spike_grad_with_reset = getattr(self.spike_grad, "with_reset", None)
+        if spike_grad_with_reset is not None:
+            _, reset = spike_grad_with_reset(mem, threshold=self.threshold)
+            return reset.detach()
+
         mem_shift = mem - self.threshold
         reset = self.spike_grad(mem_shift).clone().detach()
 
         return reset
 
+    def _spike_and_reset(self, mem):
+        """Runs the spiking function on mem - threshold and returns the detached reset, `mem_reset(mem)`, along with the spikes. If
+        the function can also take the threshold and emit the reset in the same op (``spike_grad.with_reset``), mem - threshold is
+        never materialised.
+        Returns spk, reset."""
+        spike_grad_with_reset = getattr(self.spike_grad, "with_reset", None)
+        if spike_grad_with_reset is None:
+            spk = self.spike_grad(mem - self.threshold)
+            return spk, spk.detach()
+
+        spk, reset = spike_grad_with_reset(mem, threshold=self.threshold)
+        return spk, reset.detach()
+
     def _snn_cases(self, reset_mechanism, inhibition):
         self._reset_cases(reset_mechanism)
 
@@ -275,39 +347,11 @@ class LIF(SpikingNeuron):
         )
         self._reset_mechanism = reset_mechanism
 
-        cwd = os.path.dirname(__file__)
-        cwd = cwd[:-8]
-        so_path_ste = os.path.join(cwd, "so_file/straight_through_estimator_custom_ops.so")
-        #so_path_ste = "./so_file/straight_through_estimator_custom_ops.so"
-        if not os.path.isfile(so_path_ste):
-            print("Missing Straight Through Estimator Custom Operation file!")
-            print(so_path_ste)
-            exit(1)
-        ctypes.cdll.LoadLibrary(so_path_ste)
-
-        so_path_heaviside = os.path.join(cwd, "so_file/heaviside_custom_ops.so")
-        #so_path_heaviside = "./so_file/heaviside_custom_ops.so"
-        if not os.path.isfile(so_path_heaviside):
-            print("Missing Heaviside Custom Operation File")
-            print(so_path_heaviside)
-            exit(1)
-        ctypes.cdll.LoadLibrary(so_path_heaviside)
-
-        so_path_fast_sigmoid = os.path.join(cwd, "so_file/fast_sigmoid_custom_ops.so")
-        #so_path_fast_sigmoid = "./so_file/fast_sigmoid_custom_ops.so"
-        if not os.path.isfile(so_path_fast_sigmoid):
-            print("Missing Fast Sigmoid  Custom Operation File")
-            print(so_path_fast_sigmoid)
-            exit(1)
-        ctypes.cdll.LoadLibrary(so_path_fast_sigmoid)
-
-        #so_path_sigmoid = "./so_file/sigmoid_custom_ops.so"
-        #if not os.path.isfile(so_path_sigmoid):
-        #    print("Missing Sigmoid Custom Operation File")
-        #    exit(1)
-        #ctypes.cdll.LoadLibrary(so_path_sigmoid)
+        load_custom_ops()
 
         def build_and_run_ste(input_data, run_on_ipu=True):
+            if cpu.use_cpu(run_on_ipu):
+                return cpu.spike(input_data, surrogate="straight_through_estimator")
             y = poptorch.custom_op(
                     [input_data],
                     "StraightThroughEstimator",
@@ -317,17 +361,25 @@ class LIF(SpikingNeuron):
             )
             return y[0]
 
-        def build_and_run_heaviside(input_data, run_on_ipu=True):
+        def build_and_run_ste_with_reset(input_data, run_on_ipu=True, threshold=None):
+            if cpu.use_cpu(run_on_ipu):
+                return cpu.spike(input_data, threshold, "straight_through_estimator", with_reset=True)
+            # input_data is compared against threshold inside the op when given
+            inputs = [input_data] if threshold is None else [input_data, threshold]
             y = poptorch.custom_op(
-                    [input_data],
-                    "Heaviside",
+                    inputs,
+                    "StraightThroughEstimator",
                     "custom.ops",
                     1,
-                    example_outputs=[input_data],
+                    example_outputs=[input_data, input_data],
             )
-            return y[0]
+            return y[0], y[1]
+
+        build_and_run_ste.with_reset = build_and_run_ste_with_reset
 
         def build_and_run_fast_sigmoid(input_data, run_on_ipu=True):
+            if cpu.use_cpu(run_on_ipu):
+                return cpu.spike(input_data, surrogate="fast_sigmoid")
             y = poptorch.custom_op(
                     [input_data],
                     "FastSigmoid",
@@ -337,21 +389,48 @@ class LIF(SpikingNeuron):
             )
             return y[0]
 
-        #def build_and_run_sigmoid(input_data, run_on_ipu=True):
-        #    y = poptorch.custom_op(
-        #            [input_data],
-        #            "Sigmoid",
-        #            "custom.ops",
-        #            1,
-        #            example_outputs=[input_data],
-        #    )
-        #    return y[0]
-
-        # TO-DO: Heaviside --> STE; needs a tutorial change too?
+        def build_and_run_fast_sigmoid_with_reset(input_data, run_on_ipu=True, threshold=None):
+            if cpu.use_cpu(run_on_ipu):
+                return cpu.spike(input_data, threshold, "fast_sigmoid", with_reset=True)
+            # input_data is compared against threshold inside the op when given
+            inputs = [input_data] if threshold is None else [input_data, threshold]
+            y = poptorch.custom_op(
+                    inputs,
+                    "FastSigmoid",
+                    "custom.ops",
+                    1,
+                    example_outputs=[input_data, input_data],
+            )
+            return y[0], y[1]
+
+        build_and_run_fast_sigmoid.with_reset = build_and_run_fast_sigmoid_with_reset
+
+        # The fused neuron ops take the surrogate (and its slope) as
+        # attributes, see snntorch.surrogate; other spike_grad functions,
+        # such as a user-defined autograd function, keep the unfused states
+        # and fire
+        self.surrogate_attributes = {}
         if spike_grad is None:
             self.spike_grad = build_and_run_fast_sigmoid
+            self.surrogate = "fast_sigmoid"
         else:
-            self.spike_grad = build_and_run_heaviside
+            self.spike_grad = spike_grad
+            self.surrogate = getattr(spike_grad, "surrogate", None)
+            if self.surrogate is not None:
+                self.surrogate_attributes = spike_grad.surrogate_attributes
+
+    @property
+    def _fused(self):
+        """Whether forward runs the fused step op, which needs a surrogate the ops implement and no inhibition."""
+        return self.surrogate is not None and not self.inhibition
+
+    def _fire_and_reset(self, mem):
+        """`fire`, or `fire_inhibition` with inhibition, for the unfused forward, along with the detached reset of every neuron
+        above threshold, which is `mem_reset(mem)`.
+        Returns spk, reset."""
+        if self.inhibition:
+            return self._fire_inhibition_and_reset(mem.size(0), mem)
+        return self._spike_and_reset(mem)
 
     def _lif_register_buffer(
         self,
@@ -1,6 +1,8 @@
 import torch
 import torch.nn as nn
 from .neurons import *
+import poptorch
+from .. import cpu
 
 
 class RLeaky(LIF):
@@ -65,7 +67,7 @@ class RLeaky(LIF):
     :param beta: membrane potential decay rate. Clipped between 0 and 1 during the forward-pass. May be a single-valued tensor (i.e., equal decay rate for all neurons in a layer), or multi-valued (one weight per neuron).
     :type beta: float or torch.tensor
 
-    :param V: Recurrent weights to scale output spikes.
+    :param V: Recurrent weights to scale output spikes. A square `(input_size, input_size)` V connects every neuron to every other, as :math:`spk @ V^T`.
     :type V: float or torch.tensor
 
     :param threshold: Threshold for :math:`mem` to reach in order to generate a spike `S=1`. Defaults to 1
@@ -110,7 +112,7 @@ class RLeaky(LIF):
 
     Learnable Parameters:
         - **RLeaky.beta** (torch.Tensor) - optional learnable weights must be manually passed in, of shape `1` or (input_size).
-        - **RLeaky.V** (torch.Tensor) - optional learnable weights must be manually passed in, of shape `1` or (input_size).
+        - **RLeaky.V** (torch.Tensor) - optional learnable weights must be manually passed in, of shape `1`, (input_size) or (input_size, input_size).
         - **RLeaky.threshold** (torch.Tensor) - optional learnable thresholds must be manually passed in, of shape `1` or`` (input_size).
 
     """
@@ -158,46 +160,87 @@ class RLeaky(LIF):
             spk, mem = _SpikeTorchConv(spk, mem, input_=input_)
         elif mem is False and hasattr(self.mem, "init_flag"):  # init_hidden case
             self.spk, self.mem = _SpikeTorchConv(self.spk, self.mem, input_=input_)
+            self.reset = None  # the fresh states have not fired yet
 
         # TO-DO: alternatively, we could do torch.exp(-1 / self.beta.clamp_min(0)),
         # giving actual time constants instead of values in [0, 1] as initial beta
         # beta = self.beta.clamp(0, 1)
 
         if not self.init_hidden:
+            if self._fused:
+                spk, mem = self.rleaky_step(input_, spk, mem)
+                return spk, mem
+
             self.reset = self.mem_reset(mem)
             mem = self.state_fn(input_, spk, mem)
 
             # if self.state_quant:
             #     mem = self.state_quant(mem)
 
-            if self.inhibition:
-                spk = self.fire_inhibition(mem.size(0), mem)  # batch_size
-            else:
-                spk = self.fire(mem)
+            spk, _ = self._fire_and_reset(mem)
 
             return spk, mem
 
         # intended for truncated-BPTT where instance variables are hidden states
         if self.init_hidden:
             self._rleaky_forward_cases(spk, mem)
-            self.reset = self.mem_reset(self.mem)
-            self.mem = self.state_fn(input_)
+            if not self._fused:
+                # self.reset is that of self.mem, from the fire of the last
+                # step, unless the states have just been initialised
+                if self.reset is None:
+                    self.reset = self.mem_reset(self.mem)
+                self.mem = self.state_fn(input_)
 
-            # if self.state_quant:
-            #     self.mem = self.state_quant(self.mem)
+                # if self.state_quant:
+                #     self.mem = self.state_quant(self.mem)
 
-            if self.inhibition:
-                self.spk = self.fire_inhibition(self.mem.size(0), self.mem)
+                self.spk, self.reset = self._fire_and_reset(self.mem)
             else:
-                self.spk = self.fire(self.mem)
+                self.spk, self.mem = self.rleaky_step(input_, self.spk, self.mem)
 
             if self.output:  # read-out layer returns output+states
                 return self.spk, self.mem
             else:  # hidden layer e.g., in nn.Sequential, only returns output
                 return self.spk
 
+    def rleaky_step(self, input_, spk, mem, spike_dtype=None):
+        """Weights the spikes of the last step by `V` and runs decay, reset, threshold and spike for one time step as a
+        single fused `RLeakyStep` op. ``spike_dtype`` (torch.bool or torch.uint8) emits compact spikes, which carry no
+        gradient, while the states keep their type.
+        Returns spk, mem."""
+        self._check_fused_surrogate()
+        spike_attributes, spk_example = self._spike_output(spike_dtype, input_)
+        if not spk.is_floating_point():  # compact spikes of the last step
+            spk = spk.to(input_.dtype)
+        if cpu.use_cpu():
+            spk, mem = cpu.rleaky_step(
+                input_, spk, mem, self.V, self.beta, self.threshold,
+                reset_mechanism=SpikingNeuron.reset_dict[self.reset_mechanism],
+                **cpu.surrogate_arguments(self.surrogate, self.surrogate_attributes),
+            )
+            if spike_dtype is not None:
+                spk = spk.to(spike_dtype)
+            return spk, mem
+        spk, mem = poptorch.custom_op(
+            [input_, spk, mem, self.V, self.beta, self.threshold],
+            "RLeakyStep",
+            "custom.ops",
+            1,
+            example_outputs=[spk_example, input_],
+            attributes={
+                "reset_mechanism": SpikingNeuron.reset_dict[self.reset_mechanism],
+                "surrogate": self.surrogate,
+                **self.surrogate_attributes,
+                **spike_attributes,
+            },
+        )
+        return spk, mem
+
+    def _recurrent(self, spk):
+        return cpu.recurrent_current(spk, self.V)
+
     def _base_state_function(self, input_, spk, mem):
-        base_fn = self.beta.clamp(0, 1) * mem + input_ + self.V * spk
+        base_fn = self.beta.clamp(0, 1) * mem + input_ + self._recurrent(spk)
         return base_fn
 
     def _build_state_function(self, input_, spk, mem):
@@ -214,7 +257,7 @@ class RLeaky(LIF):
         return state_fn
 
     def _base_state_function_hidden(self, input_):
-        base_fn = self.beta.clamp(0, 1) * self.mem + input_ + self.V * self.spk
+        base_fn = self.beta.clamp(0, 1) * self.mem + input_ + self._recurrent(self.spk)
         return base_fn
 
     def _build_state_function_hidden(self, input_):
@@ -1,6 +1,8 @@
 import torch
 import torch.nn as nn
 from .neurons import *
+import poptorch
+from .. import cpu
 
 
 class RSynaptic(LIF):
@@ -74,7 +76,7 @@ class RSynaptic(LIF):
     :param beta: membrane potential decay rate. Clipped between 0 and 1 during the forward-pass. May be a single-valued tensor (i.e., equal decay rate for all neurons in a layer), or multi-valued (one weight per neuron).
     :type beta: float or torch.tensor
 
-    :param V: Recurrent weights to scale output spikes.
+    :param V: Recurrent weights to scale output spikes. A square `(input_size, input_size)` V connects every neuron to every other, as :math:`spk @ V^T`.
     :type V: float or torch.tensor
 
     :param threshold: Threshold for :math:`mem` to reach in order to generate a spike `S=1`. Defaults to 1
@@ -125,7 +127,7 @@ class RSynaptic(LIF):
     Learnable Parameters:
         - **RSynaptic.alpha** (torch.Tensor) - optional learnable weights must be manually passed in, of shape `1` or (input_size).
         - **RSynaptic.beta** (torch.Tensor) - optional learnable weights must be manually passed in, of shape `1` or (input_size).
-        - **RSynaptic.V** (torch.Tensor) - optional learnable weights must be manually passed in, of shape `1` or (input_size).
+        - **RSynaptic.V** (torch.Tensor) - optional learnable weights must be manually passed in, of shape `1`, (input_size) or (input_size, input_size).
         - **RSynaptic.threshold** (torch.Tensor) - optional learnable thresholds must be manually passed in, of shape `1` or`` (input_size).
 
 """
@@ -181,8 +183,13 @@ class RSynaptic(LIF):
             self.spk, self.syn, self.mem = _SpikeTorchConv(
                 self.spk, self.syn, self.mem, input_=input_
             )
+            self.reset = None  # the fresh states have not fired yet
 
         if not self.init_hidden:
+            if self._fused:
+                spk, syn, mem = self.rsynaptic_step(input_, spk, syn, mem)
+                return spk, syn, mem
+
             self.reset = self.mem_reset(mem)
             syn, mem = self.state_fn(input_, spk, syn, mem)
 
@@ -190,40 +197,80 @@ class RSynaptic(LIF):
             #     syn = self.state_quant(syn)
             #     mem = self.state_quant(mem)
 
-            if self.inhibition:
-                spk = self.fire_inhibition(mem.size(0), mem)
-            else:
-                spk = self.fire(mem)
+            spk, _ = self._fire_and_reset(mem)
 
             return spk, syn, mem
 
         # intended for truncated-BPTT where instance variables are hidden states
         if self.init_hidden:
             self._rsynaptic_forward_cases(spk, mem, syn)
-            self.reset = self.mem_reset(self.mem)
-            self.syn, self.mem = self.state_fn(input_)
-
-            # if self.state_quant:
-            #     self.syn = self.state_quant(self.syn)
-            #     self.mem = self.state_quant(self.mem)
-
-            if self.inhibition:
-                self.spk = self.fire_inhibition(self.mem.size(0), self.mem)
+            if not self._fused:
+                # self.reset is that of self.mem, from the fire of the last
+                # step, unless the states have just been initialised
+                if self.reset is None:
+                    self.reset = self.mem_reset(self.mem)
+                self.syn, self.mem = self.state_fn(input_)
+
+                # if self.state_quant:
+                #     self.syn = self.state_quant(self.syn)
+                #     self.mem = self.state_quant(self.mem)
+
+                self.spk, self.reset = self._fire_and_reset(self.mem)
             else:
-                self.spk = self.fire(self.mem)
+                self.spk, self.syn, self.mem = self.rsynaptic_step(
+                    input_, self.spk, self.syn, self.mem
+                )
 
             if self.output:
                 return self.spk, self.syn, self.mem
             else:
                 return self.spk
 
+    def rsynaptic_step(self, input_, spk, syn, mem, spike_dtype=None):
+        """Weights the spikes of the last step by `V` and updates both states, resets and fires for one time step as a
+        single fused `RSynapticStep` op. ``spike_dtype`` (torch.bool or torch.uint8) emits compact spikes, which carry no
+        gradient, while the states keep their type.
+        Returns spk, syn, mem."""
+        self._check_fused_surrogate()
+        spike_attributes, spk_example = self._spike_output(spike_dtype, input_)
+        if not spk.is_floating_point():  # compact spikes of the last step
+            spk = spk.to(input_.dtype)
+        if cpu.use_cpu():
+            spk, syn, mem = cpu.rsynaptic_step(
+                input_, spk, syn, mem, self.V, self.alpha, self.beta,
+                self.threshold,
+                reset_mechanism=SpikingNeuron.reset_dict[self.reset_mechanism],
+                **cpu.surrogate_arguments(self.surrogate, self.surrogate_attributes),
+            )
+            if spike_dtype is not None:
+                spk = spk.to(spike_dtype)
+            return spk, syn, mem
+        spk, syn, mem = poptorch.custom_op(
+            [input_, spk, syn, mem, self.V, self.alpha, self.beta,
+             self.threshold],
+            "RSynapticStep",
+            "custom.ops",
+            1,
+            example_outputs=[spk_example, input_, input_],
+            attributes={
+                "reset_mechanism": SpikingNeuron.reset_dict[self.reset_mechanism],
+                "surrogate": self.surrogate,
+                **self.surrogate_attributes,
+                **spike_attributes,
+            },
+        )
+        return spk, syn, mem
+
+    def _recurrent(self, spk):
+        return cpu.recurrent_current(spk, self.V)
+
     def _base_state_function(self, input_, spk, syn, mem):
-        base_fn_syn = self.alpha.clamp(0, 1) * syn + input_ + self.V * spk
+        base_fn_syn = self.alpha.clamp(0, 1) * syn + input_ + self._recurrent(spk)
         base_fn_mem = self.beta.clamp(0, 1) * mem + base_fn_syn
         return base_fn_syn, base_fn_mem
 
     def _base_state_reset_zero(self, input_, spk, syn, mem):
-        base_fn_syn = self.alpha.clamp(0, 1) * syn + input_ + self.V * spk
+        base_fn_syn = self.alpha.clamp(0, 1) * syn + input_ + self._recurrent(spk)
         base_fn_mem = self.beta.clamp(0, 1) * mem + base_fn_syn
         return 0, base_fn_mem
 
@@ -249,12 +296,12 @@ class RSynaptic(LIF):
         return state_fn
 
     def _base_state_function_hidden(self, input_):
-        base_fn_syn = self.alpha.clamp(0, 1) * self.syn + input_ + self.V * self.spk
+        base_fn_syn = self.alpha.clamp(0, 1) * self.syn + input_ + self._recurrent(self.spk)
         base_fn_mem = self.beta.clamp(0, 1) * self.mem + base_fn_syn
         return base_fn_syn, base_fn_mem
 
     def _base_state_reset_zero_hidden(self, input_):
-        base_fn_syn = self.alpha.clamp(0, 1) * self.syn + input_ + self.V * self.spk
+        base_fn_syn = self.alpha.clamp(0, 1) * self.syn + input_ + self._recurrent(self.spk)
         base_fn_mem = self.beta.clamp(0, 1) * self.mem + base_fn_syn
         return 0, base_fn_mem
 
@@ -5,7 +5,9 @@ import torch.nn.functional as F
 from .neurons import *
 import popart
 import poptorch
-import ctypes
+from ..so_file import load_custom_ops
+from .. import cpu
+from ..surrogate import straight_through_estimator
 import os
 
 
@@ -184,25 +186,18 @@ class SConv2dLSTM(SpikingNeuron):
         else:
             self.state_fn = self._build_state_function
 
-        so_path_ste = "./so_file/straight_through_estimator_custom_ops.so"
-        if not os.path.isfile(so_path_ste):
-            print("Missing Straight Through Estimator Custom Operation file!")
-        ctypes.cdll.LoadLibrary(so_path_ste)
-
-        def build_and_run_ste(input_data, run_on_ipu=True):
-            y = poptorch.custom_op(
-                    [input_data],
-                    "StraightThroughEstimator",
-                    "custom.ops",
-                    1,
-                    example_outputs=[input_data],
-            )
-            return y[0]
+        load_custom_ops()
 
+        # The fused SConv2dLSTMStep op takes the surrogate as an attribute,
+        # see snntorch.surrogate; other spike_grad functions keep the
+        # unfused cell
+        self.surrogate_attributes = {}
         if spike_grad is None:
-            self.spike_grad = build_and_run_ste
-        else:
-            self.spike_grad = spike_grad
+            spike_grad = straight_through_estimator()
+        self.spike_grad = spike_grad
+        self.surrogate = getattr(spike_grad, "surrogate", None)
+        if self.surrogate is not None:
+            self.surrogate_attributes = spike_grad.surrogate_attributes
 
         self.in_channels = in_channels
         self.out_channels = out_channels
@@ -241,8 +236,14 @@ class SConv2dLSTM(SpikingNeuron):
             )
 
         if not self.init_hidden:
-            self.reset = self.mem_reset(mem)
-            syn, mem = self.state_fn(input_, syn, mem)
+            if self.surrogate is not None:
+                # The spikes of the op are those of the unpooled mem
+                spk, syn, mem = self.sconv2dlstm_step(input_, syn, mem)
+                if not (self.max_pool or self.avg_pool):
+                    return spk, syn, mem
+            else:
+                self.reset = self.mem_reset(mem)
+                syn, mem = self.state_fn(input_, syn, mem)
 
             # if self.state_quant:
             #     syn = self.state_quant(syn)
@@ -258,8 +259,13 @@ class SConv2dLSTM(SpikingNeuron):
 
         if self.init_hidden:
             # self._sconv2dlstm_forward_cases(mem, c)
-            self.reset = self.mem_reset(self.mem)
-            self.syn, self.mem = self.state_fn(input_)
+            if self.surrogate is not None:
+                self.spk, self.syn, self.mem = self.sconv2dlstm_step(
+                    input_, self.syn, self.mem
+                )
+            else:
+                self.reset = self.mem_reset(self.mem)
+                self.syn, self.mem = self.state_fn(input_)
 
             # if self.state_quant:
             #     self.syn = self.state_quant(self.syn)
@@ -269,7 +275,7 @@ class SConv2dLSTM(SpikingNeuron):
                 self.spk = self.fire(F.max_pool2d(self.mem, self.max_pool))
             elif self.avg_pool:
                 self.spk = self.fire(F.avg_pool2d(self.mem, self.avg_pool))
-            else:
+            elif self.surrogate is None:
                 self.spk = self.fire(self.mem)
 
             if self.output:
@@ -277,6 +283,38 @@ class SConv2dLSTM(SpikingNeuron):
             else:
                 return self.spk
 
+    def sconv2dlstm_step(self, input_, syn, mem, spike_dtype=None):
+        """Runs the convolutional LSTM cell, resets and fires for one time step as a single fused `SConv2dLSTMStep` op, with
+        all four gates from one convolution and the gate activations folded into the cell update. ``spike_dtype`` (torch.bool
+        or torch.uint8) emits compact spikes, which carry no gradient, while the states keep their type.
+        Returns spk, syn, mem."""
+        self._check_fused_surrogate()
+        spike_attributes, spk_example = self._spike_output(spike_dtype, mem)
+        biases = [self.conv.bias] if self.bias else []
+        if cpu.use_cpu():
+            spk, syn, mem = cpu.sconv2dlstm_step(
+                input_, syn, mem, self.conv.weight, self.threshold, *biases,
+                reset_mechanism=SpikingNeuron.reset_dict[self.reset_mechanism],
+                **cpu.surrogate_arguments(self.surrogate, self.surrogate_attributes),
+            )
+            if spike_dtype is not None:
+                spk = spk.to(spike_dtype)
+            return spk, syn, mem
+        spk, syn, mem = poptorch.custom_op(
+            [input_, syn, mem, self.conv.weight, self.threshold, *biases],
+            "SConv2dLSTMStep",
+            "custom.ops",
+            1,
+            example_outputs=[spk_example, syn, mem],
+            attributes={
+                "reset_mechanism": SpikingNeuron.reset_dict[self.reset_mechanism],
+                "surrogate": self.surrogate,
+                **self.surrogate_attributes,
+                **spike_attributes,
+            },
+        )
+        return spk, syn, mem
+
     def _base_state_function(self, input_, syn, mem):
 
         combined = torch.cat(
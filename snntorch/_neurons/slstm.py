@@ -5,7 +5,9 @@ import torch.nn.functional as F
 from .neurons import *
 import popart
 import poptorch
-import ctypes
+from ..so_file import load_custom_ops
+from .. import cpu
+from ..surrogate import straight_through_estimator
 import os
 
 class SLSTM(SpikingNeuron):
@@ -157,28 +159,17 @@ class SLSTM(SpikingNeuron):
         else:
             self.state_fn = self._build_state_function
 
-        cwd = os.path.dirname(__file__)
-        cwd = cwd[:-8]
-        so_path_ste = os.path.join(cwd, "so_file/straight_through_estimator_custom_ops.so")
-        #so_path_ste = "./so_file/straight_through_estimator_custom_ops.so"
-        if not os.path.isfile(so_path_ste):
-            print("Missing Straight Through Estimator Custom Operation file!")
-        ctypes.cdll.LoadLibrary(so_path_ste)
-
-        def build_and_run_ste(input_data, run_on_ipu=True):
-            y = poptorch.custom_op(
-                    [input_data],
-                    "StraightThroughEstimator",
-                    "custom.ops",
-                    1,
-                    example_outputs=[input_data],
-            )
-            return y[0]
+        load_custom_ops()
 
+        # The fused SLSTMStep op takes the surrogate as an attribute, see
+        # snntorch.surrogate; other spike_grad functions keep the unfused cell
+        self.surrogate_attributes = {}
         if spike_grad is None:
-            self.spike_grad = build_and_run_ste
-        else:
-            self.spike_grad = spike_grad
+            spike_grad = straight_through_estimator()
+        self.spike_grad = spike_grad
+        self.surrogate = getattr(spike_grad, "surrogate", None)
+        if self.surrogate is not None:
+            self.surrogate_attributes = spike_grad.surrogate_attributes
 
         self.input_size = input_size
         self.hidden_size = hidden_size
@@ -198,6 +189,10 @@ class SLSTM(SpikingNeuron):
             )
 
         if not self.init_hidden:
+            if self.surrogate is not None:
+                spk, syn, mem = self.slstm_step(input_, syn, mem)
+                return spk, syn, mem
+
             self.reset = self.mem_reset(mem)
             syn, mem = self.state_fn(input_, syn, mem)
 
@@ -210,20 +205,60 @@ class SLSTM(SpikingNeuron):
 
         if self.init_hidden:
             # self._slstm_forward_cases(mem, syn)
-            self.reset = self.mem_reset(self.mem)
-            self.syn, self.mem = self.state_fn(input_)
+            if self.surrogate is not None:
+                self.spk, self.syn, self.mem = self.slstm_step(
+                    input_, self.syn, self.mem
+                )
+            else:
+                self.reset = self.mem_reset(self.mem)
+                self.syn, self.mem = self.state_fn(input_)
 
-            # if self.state_quant:
-            #     self.syn = self.state_quant(self.syn)
-            #     self.mem = self.state_quant(self.mem)
+                # if self.state_quant:
+                #     self.syn = self.state_quant(self.syn)
+                #     self.mem = self.state_quant(self.mem)
 
-            self.spk = self.fire(self.mem)
+                self.spk = self.fire(self.mem)
 
             if self.output:
                 return self.spk, self.syn, self.mem
             else:
                 return self.spk
 
+    def slstm_step(self, input_, syn, mem, spike_dtype=None):
+        """Runs the LSTM cell, resets and fires for one time step as a single fused `SLSTMStep` op, with all four gates
+        from one matmul. ``spike_dtype`` (torch.bool or torch.uint8) emits compact spikes, which carry no gradient, while the
+        states keep their type.
+        Returns spk, syn, mem."""
+        self._check_fused_surrogate()
+        spike_attributes, spk_example = self._spike_output(spike_dtype, mem)
+        cell = self.lstm_cell
+        biases = [cell.bias_ih, cell.bias_hh] if self.bias else []
+        if cpu.use_cpu():
+            spk, syn, mem = cpu.slstm_step(
+                input_, syn, mem, cell.weight_ih, cell.weight_hh,
+                self.threshold, *biases,
+                reset_mechanism=SpikingNeuron.reset_dict[self.reset_mechanism],
+                **cpu.surrogate_arguments(self.surrogate, self.surrogate_attributes),
+            )
+            if spike_dtype is not None:
+                spk = spk.to(spike_dtype)
+            return spk, syn, mem
+        spk, syn, mem = poptorch.custom_op(
+            [input_, syn, mem, cell.weight_ih, cell.weight_hh, self.threshold,
+             *biases],
+            "SLSTMStep",
+            "custom.ops",
+            1,
+            example_outputs=[spk_example, syn, mem],
+            attributes={
+                "reset_mechanism": SpikingNeuron.reset_dict[self.reset_mechanism],
+                "surrogate": self.surrogate,
+                **self.surrogate_attributes,
+                **spike_attributes,
+            },
+        )
+        return spk, syn, mem
+
     def _base_state_function(self, input_, syn, mem):
         base_fn_mem, base_fn_syn = self.lstm_cell(input_, (mem, syn))
         return base_fn_syn, base_fn_mem
@@ -1,6 +1,8 @@
 import torch
 import torch.nn as nn
 from .neurons import *
+import poptorch
+from .. import cpu
 
 
 class Synaptic(LIF):
@@ -159,8 +161,13 @@ class Synaptic(LIF):
             syn, mem = _SpikeTorchConv(syn, mem, input_=input_)
         elif mem is False and hasattr(self.mem, "init_flag"):  # init_hidden case
             self.syn, self.mem = _SpikeTorchConv(self.syn, self.mem, input_=input_)
+            self.reset = None  # the fresh states have not fired yet
 
         if not self.init_hidden:
+            if self._fused:
+                spk, syn, mem = self.synaptic_step(input_, syn, mem)
+                return spk, syn, mem
+
             self.reset = self.mem_reset(mem)
             syn, mem = self.state_fn(input_, syn, mem)
 
@@ -168,33 +175,65 @@ class Synaptic(LIF):
             #     syn = self.state_quant(syn)
             #     mem = self.state_quant(mem)
 
-            if self.inhibition:
-                spk = self.fire_inhibition(mem.size(0), mem)
-            else:
-                spk = self.fire(mem)
+            spk, _ = self._fire_and_reset(mem)
 
             return spk, syn, mem
 
         # intended for truncated-BPTT where instance variables are hidden states
         if self.init_hidden:
             self._synaptic_forward_cases(mem, syn)
-            self.reset = self.mem_reset(self.mem)
-            self.syn, self.mem = self.state_fn(input_)
-
-            # if self.state_quant:
-            #     self.syn = self.state_quant(self.syn)
-            #     self.mem = self.state_quant(self.mem)
-
-            if self.inhibition:
-                self.spk = self.fire_inhibition(self.mem.size(0), self.mem)
+            if not self._fused:
+                # self.reset is that of self.mem, from the fire of the last
+                # step, unless the states have just been initialised
+                if self.reset is None:
+                    self.reset = self.mem_reset(self.mem)
+                self.syn, self.mem = self.state_fn(input_)
+
+                # if self.state_quant:
+                #     self.syn = self.state_quant(self.syn)
+                #     self.mem = self.state_quant(self.mem)
+
+                self.spk, self.reset = self._fire_and_reset(self.mem)
             else:
-                self.spk = self.fire(self.mem)
+                self.spk, self.syn, self.mem = self.synaptic_step(
+                    input_, self.syn, self.mem
+                )
 
             if self.output:
                 return self.spk, self.syn, self.mem
             else:
                 return self.spk
 
+    def synaptic_step(self, input_, syn, mem, spike_dtype=None):
+        """Updates both states, resets and fires for one time step as a single fused `SynapticStep` op.
+        ``spike_dtype`` (torch.bool or torch.uint8) emits compact spikes, which carry no gradient, while the states keep their type.
+        Returns spk, syn, mem."""
+        self._check_fused_surrogate()
+        spike_attributes, spk_example = self._spike_output(spike_dtype, input_)
+        if cpu.use_cpu():
+            spk, syn, mem = cpu.synaptic_step(
+                input_, syn, mem, self.alpha, self.beta, self.threshold,
+                reset_mechanism=SpikingNeuron.reset_dict[self.reset_mechanism],
+                **cpu.surrogate_arguments(self.surrogate, self.surrogate_attributes),
+            )
+            if spike_dtype is not None:
+                spk = spk.to(spike_dtype)
+            return spk, syn, mem
+        spk, syn, mem = poptorch.custom_op(
+            [input_, syn, mem, self.alpha, self.beta, self.threshold],
+            "SynapticStep",
+            "custom.ops",
+            1,
+            example_outputs=[spk_example, input_, input_],
+            attributes={
+                "reset_mechanism": SpikingNeuron.reset_dict[self.reset_mechanism],
+                "surrogate": self.surrogate,
+                **self.surrogate_attributes,
+                **spike_attributes,
+            },
+        )
+        return spk, syn, mem
+
     def _base_state_function(self, input_, syn, mem):
         base_fn_syn = self.alpha.clamp(0, 1) * syn + input_
         base_fn_mem = self.beta.clamp(0, 1) * mem + base_fn_syn
@@ -0,0 +1,385 @@
+import os
+import torch
+
+# CPU implementations of the spike ops, for running models off the IPU.
+#
+# The kernels live in `libsnntorch_cpu_ops.so`, built by
+# `make -C snntorch/custom_ops cpu_ops`, which registers them as
+# torch.ops.snntorch_cpu.*. They compute the same expressions as the PopART
+# custom ops, so a float32 model trained on one device gives the same spikes
+# and gradients on the other. Half tensors are computed in float32 and
+# rounded once, so they can differ from the IPU in the last bit.
+#
+# `set_backend` picks where the neurons and surrogates of snntorch run:
+#
+#   "auto"  the custom ops inside a poptorch model, the CPU kernels otherwise
+#   "ipu"   always the custom ops
+#   "cpu"   always the CPU kernels
+#
+# The initial backend is read from the SNNTORCH_BACKEND environment variable.
+
+LIBRARY = os.path.join(
+    os.path.dirname(__file__), "so_file", "libsnntorch_cpu_ops.so"
+)
+
+BACKENDS = ("auto", "ipu", "cpu")
+
+# SpikingNeuron.reset_dict
+_RESET_SUBTRACT = 0
+_RESET_ZERO = 1
+_RESET_NONE = 2
+
+# neuron_step::defaultSlope
+_DEFAULT_SLOPES = {"sigmoid": 25.0, "spike_rate_escape": 25.0, "atan": 2.0}
+
+_backend = None
+_loaded = False
+
+
+def set_backend(backend):
+    """Select where the spike ops run: ``"auto"``, ``"ipu"`` or ``"cpu"``.
+
+    :param backend: ``"auto"`` runs the custom ops while tracing a poptorch
+        model and the CPU kernels otherwise; ``"ipu"`` and ``"cpu"`` force
+        one of them
+    :type backend: str
+    """
+    global _backend
+    if backend not in BACKENDS:
+        raise ValueError(
+            "backend must be one of {}, got '{}'".format(BACKENDS, backend)
+        )
+    _backend = backend
+
+
+def get_backend():
+    """Return the backend chosen by :func:`set_backend`."""
+    if _backend is None:
+        set_backend(os.environ.get("SNNTORCH_BACKEND", "auto"))
+    return _backend
+
+
+def use_cpu(run_on_ipu=True):
+    """Return whether a spike op called with ``run_on_ipu`` should run on the
+    CPU kernels rather than as a PopART custom op."""
+    backend = get_backend()
+    if backend != "auto":
+        return backend == "cpu"
+    if not run_on_ipu:
+        return True
+    import poptorch
+
+    return not poptorch.isRunningOnIpu()
+
+
+def load_cpu_ops():
+    """Load the CPU kernels, registering torch.ops.snntorch_cpu.
+
+    Only the first call in a process opens the library.
+    """
+    global _loaded
+    if not _loaded:
+        if not os.path.isfile(LIBRARY):
+            raise RuntimeError(
+                "Missing snntorch-ipu CPU op library {}; build it with "
+                "`make -C snntorch/custom_ops cpu_ops`".format(LIBRARY)
+            )
+        torch.ops.load_library(LIBRARY)
+        _loaded = True
+    return torch.ops.snntorch_cpu
+
+
+def _as_param(value, like):
+    """`value` as a tensor on the device of `like`, for threshold/beta."""
+    if value is None:
+        value = 0.0
+    if not isinstance(value, torch.Tensor):
+        value = torch.as_tensor(value, dtype=like.dtype)
+    return value.to(like.device)
+
+
+def _reduce(grad, like):
+    """Sum a gradient broadcast against the input back to the shape and
+    type of the parameter `like`."""
+    if like.dim() == 0:
+        grad = grad.sum()
+    else:
+        grad = grad.sum_to_size(like.shape)
+    return grad.to(like.dtype)
+
+
+class _Spike(torch.autograd.Function):
+    @staticmethod
+    def forward(ctx, input_, threshold, surrogate, slope, beta):
+        ctx.save_for_backward(input_, threshold)
+        ctx.surrogate = (surrogate, slope, beta)
+        return load_cpu_ops().spike(input_, threshold)
+
+    @staticmethod
+    def backward(ctx, grad_output):
+        input_, threshold = ctx.saved_tensors
+        grad_input = load_cpu_ops().surrogate_grad(
+            grad_output, input_, threshold, *ctx.surrogate
+        )
+        grad_threshold = None
+        if ctx.needs_input_grad[1]:
+            grad_threshold = _reduce(-grad_input, threshold)
+        return grad_input, grad_threshold, None, None, None
+
+
+class _LeakyStep(torch.autograd.Function):
+    @staticmethod
+    def forward(ctx, input_, mem, beta, threshold, reset_mechanism,
+                surrogate, slope, surrogate_beta):
+        spk, mem_next = load_cpu_ops().leaky_step(
+            input_, mem, beta, threshold, reset_mechanism
+        )
+        ctx.save_for_backward(mem, beta, threshold, mem_next)
+        ctx.attributes = (reset_mechanism, surrogate, slope, surrogate_beta)
+        return spk, mem_next
+
+    @staticmethod
+    def backward(ctx, grad_spk, grad_mem_next):
+        mem, beta, threshold, mem_next = ctx.saved_tensors
+        if grad_spk is None:
+            grad_spk = torch.zeros_like(mem_next)
+        grad_input, grad_mem, grad_beta, grad_threshold = (
+            load_cpu_ops().leaky_step_backward(
+                grad_spk, grad_mem_next, mem, beta, threshold, mem_next,
+                *ctx.attributes
+            )
+        )
+        # dmem_next/dbeta = mem, only where beta is not clamped
+        grad_beta = _reduce(grad_beta, beta)
+        grad_beta = grad_beta * ((beta >= 0) & (beta <= 1)).to(grad_beta.dtype)
+        return (
+            grad_input,
+            _reduce(grad_mem, mem),
+            grad_beta,
+            _reduce(grad_threshold, threshold),
+            None,
+            None,
+            None,
+            None,
+        )
+
+
+def spike(input_, threshold=None, surrogate="fast_sigmoid", slope=None,
+          beta=1.0, with_reset=False):
+    """Heaviside spike of ``input_ - threshold`` on the CPU, with the
+    gradient of ``surrogate`` in the backward pass.
+
+    :param surrogate: one of the surrogates of the ``SurrogateSpike`` op
+    :param slope: defaults to the slope of the custom op for ``surrogate``
+    :param with_reset: also return the spikes detached, as the reset
+    :return: spk, or (spk, reset) when ``with_reset`` is set
+    """
+    if slope is None:
+        slope = _DEFAULT_SLOPES.get(surrogate, 1.0)
+    spk = _Spike.apply(
+        input_, _as_param(threshold, input_), surrogate, float(slope),
+        float(beta)
+    )
+    if with_reset:
+        return spk, spk.detach()
+    return spk
+
+
+def inhibited_fire(mem, threshold=None, surrogate="fast_sigmoid", slope=None,
+                   surrogate_beta=1.0):
+    """``InhibitedFire`` on the CPU: :func:`spike`, kept only for the neuron
+    with the largest ``mem - threshold`` of each row. Returns spk, reset."""
+    spk, reset = spike(mem, threshold, surrogate, slope, surrogate_beta,
+                       with_reset=True)
+    index = torch.argmax(mem - _as_param(threshold, mem), dim=1)
+    winner = torch.nn.functional.one_hot(index, mem.size(1)).to(spk.dtype)
+    return spk * winner, reset
+
+
+def leaky_step(input_, mem, beta, threshold, reset_mechanism=_RESET_SUBTRACT,
+               surrogate="fast_sigmoid", slope=None, surrogate_beta=1.0):
+    """One time step of ``LeakyStep`` on the CPU. Returns spk, mem."""
+    if slope is None:
+        slope = _DEFAULT_SLOPES.get(surrogate, 1.0)
+    return _LeakyStep.apply(
+        input_, mem, _as_param(beta, input_), _as_param(threshold, input_),
+        int(reset_mechanism), surrogate, float(slope), float(surrogate_beta)
+    )
+
+
+def leaky_sequence(input_, mem, beta, threshold, **attributes):
+    """``LeakySequence`` on the CPU: :func:`leaky_step` over the leading
+    time dimension of ``input_``. Returns spk_rec, mem_rec."""
+    spk_rec = []
+    mem_rec = []
+    for step in input_:
+        spk, mem = leaky_step(step, mem, beta, threshold, **attributes)
+        spk_rec.append(spk)
+        mem_rec.append(mem)
+    return torch.stack(spk_rec), torch.stack(mem_rec)
+
+
+def synaptic_step(input_, syn, mem, alpha, beta, threshold, **attributes):
+    """One time step of ``SynapticStep`` on the CPU: the synaptic current
+    feeds :func:`leaky_step`. Returns spk, syn, mem."""
+    syn = _as_param(alpha, input_).clamp(0, 1) * syn + input_
+    spk, mem = leaky_step(syn, mem, beta, threshold, **attributes)
+    return spk, syn, mem
+
+
+def recurrent_current(spk, V):
+    """The recurrent current of ``RLeakyStep`` / ``RSynapticStep``:
+    ``spk @ V^T`` for a square ``[N, N]`` V, else ``V * spk``."""
+    V = _as_param(V, spk)
+    n = spk.size(-1)
+    if V.dim() == 2 and V.size(0) == n and V.size(1) == n:
+        return spk @ V.t()
+    return V * spk
+
+
+def rleaky_step(input_, spk, mem, V, beta, threshold, **attributes):
+    """One time step of ``RLeakyStep`` on the CPU: the weighted spikes of
+    the last step feed :func:`leaky_step`. Returns spk, mem."""
+    return leaky_step(input_ + recurrent_current(spk, V), mem, beta,
+                      threshold, **attributes)
+
+
+def rsynaptic_step(input_, spk, syn, mem, V, alpha, beta, threshold,
+                   **attributes):
+    """One time step of ``RSynapticStep`` on the CPU: the weighted spikes
+    of the last step feed :func:`synaptic_step`. Returns spk, syn, mem."""
+    return synaptic_step(input_ + recurrent_current(spk, V), syn, mem,
+                         alpha, beta, threshold, **attributes)
+
+
+def alpha_step(input_, syn_exc, syn_inh, mem, alpha, beta, threshold,
+               reset_mechanism=_RESET_SUBTRACT, surrogate="fast_sigmoid",
+               slope=None, surrogate_beta=1.0):
+    """One time step of ``AlphaStep`` on the CPU. Returns spk, syn_exc,
+    syn_inh, mem."""
+    alpha = _as_param(alpha, input_).clamp(0, 1)
+    beta = _as_param(beta, input_).clamp(0, 1)
+    threshold = _as_param(threshold, input_)
+    tau_alpha = torch.log(alpha) / (torch.log(beta) - torch.log(alpha)) + 1
+
+    syn_exc = alpha * syn_exc + input_
+    syn_inh = beta * syn_inh - input_
+    mem_next = tau_alpha * (syn_exc + syn_inh)
+
+    # Subtraction only moves syn_exc and clears syn_inh; mem_next is taken
+    # from the pre-reset currents (see alpha_step.cpp)
+    fired = mem >= threshold
+    zero = torch.zeros_like(mem_next)
+    if reset_mechanism == _RESET_SUBTRACT:
+        syn_exc = torch.where(fired, syn_exc - threshold, syn_exc)
+        syn_inh = torch.where(fired, zero, syn_inh)
+    elif reset_mechanism == _RESET_ZERO:
+        syn_exc = torch.where(fired, zero, syn_exc)
+        syn_inh = torch.where(fired, zero, syn_inh)
+        mem_next = torch.where(fired, zero, mem_next)
+
+    spk = spike(mem_next, threshold, surrogate, slope, surrogate_beta)
+    return spk, syn_exc, syn_inh, mem_next
+
+
+def slstm_step(input_, syn, mem, weight_ih, weight_hh, threshold,
+               bias_ih=None, bias_hh=None, reset_mechanism=_RESET_NONE,
+               surrogate="straight_through_estimator", slope=None,
+               surrogate_beta=1.0):
+    """One time step of ``SLSTMStep`` on the CPU. Returns spk, syn, mem."""
+    threshold = _as_param(threshold, input_)
+    gates = torch.nn.functional.linear(input_, weight_ih, bias_ih)
+    gates = gates + torch.nn.functional.linear(mem, weight_hh, bias_hh)
+    i, f, g, o = gates.chunk(4, dim=1)
+    syn_next = torch.sigmoid(f) * syn + torch.sigmoid(i) * torch.tanh(g)
+    mem_next = torch.sigmoid(o) * torch.tanh(syn_next)
+
+    fired = (mem >= threshold).to(mem_next.dtype)
+    if reset_mechanism == _RESET_SUBTRACT:
+        mem_next = mem_next - fired * threshold
+    elif reset_mechanism == _RESET_ZERO:
+        mem_next = mem_next - fired * mem_next
+
+    spk = spike(mem_next, threshold, surrogate, slope, surrogate_beta)
+    return spk, syn_next, mem_next
+
+
+def sconv2dlstm_step(input_, syn, mem, weight, threshold, bias=None,
+                     reset_mechanism=_RESET_NONE,
+                     surrogate="straight_through_estimator", slope=None,
+                     surrogate_beta=1.0):
+    """One time step of ``SConv2dLSTMStep`` on the CPU. Returns spk, syn,
+    mem."""
+    threshold = _as_param(threshold, input_)
+    padding = (weight.size(2) // 2, weight.size(3) // 2)
+    gates = torch.nn.functional.conv2d(
+        torch.cat([input_, mem], dim=1), weight, bias, padding=padding
+    )
+    i, f, o, g = gates.chunk(4, dim=1)
+    syn_next = torch.sigmoid(f) * syn + torch.sigmoid(i) * torch.tanh(g)
+    mem_next = torch.sigmoid(o) * torch.tanh(syn_next)
+
+    fired = (mem >= threshold).to(mem_next.dtype)
+    if reset_mechanism == _RESET_SUBTRACT:
+        mem_next = mem_next - fired * threshold
+    elif reset_mechanism == _RESET_ZERO:
+        mem_next = mem_next - fired * mem_next
+
+    spk = spike(mem_next, threshold, surrogate, slope, surrogate_beta)
+    return spk, syn_next, mem_next
+
+
+def adaptive_leaky_step(input_, mem, a, beta, rho, threshold, beta_a,
+                        reset_mechanism=_RESET_SUBTRACT,
+                        surrogate="fast_sigmoid", slope=None,
+                        surrogate_beta=1.0):
+    """One time step of ``AdaptiveLeakyStep`` on the CPU. Returns spk, mem,
+    a."""
+    beta = _as_param(beta, input_).clamp(0, 1)
+    rho = _as_param(rho, input_).clamp(0, 1)
+    threshold = _as_param(threshold, input_)
+    beta_a = _as_param(beta_a, input_)
+
+    # The reset is the spike of the last step, under its adaptive threshold
+    thr = threshold + beta_a * a
+    fired = (mem >= thr).to(mem.dtype)
+    mem_next = beta * mem + input_
+    if reset_mechanism == _RESET_SUBTRACT:
+        mem_next = mem_next - fired * thr
+    elif reset_mechanism == _RESET_ZERO:
+        mem_next = mem_next - fired * mem_next
+    a_next = rho * a + fired
+
+    spk = spike(mem_next, threshold + beta_a * a_next, surrogate, slope,
+                surrogate_beta)
+    return spk, mem_next, a_next
+
+
+def lapicque_step(input_, mem, threshold, R=1.0, C=1.0, time_step=1.0,
+                  reset_mechanism=_RESET_SUBTRACT, surrogate="fast_sigmoid",
+                  slope=None, surrogate_beta=1.0):
+    """One time step of ``LapicqueStep`` on the CPU. Returns spk, mem."""
+    R = _as_param(R, input_)
+    C = _as_param(C, input_)
+    threshold = _as_param(threshold, input_)
+    decay = 1 - time_step / (R * C)
+    mem_next = decay * mem + time_step / C * input_
+
+    fired = (mem >= threshold).to(mem_next.dtype)
+    if reset_mechanism == _RESET_SUBTRACT:
+        mem_next = mem_next - fired * threshold
+    elif reset_mechanism == _RESET_ZERO:
+        mem_next = mem_next - fired * mem_next
+
+    spk = spike(mem_next, threshold, surrogate, slope, surrogate_beta)
+    return spk, mem_next
+
+
+def surrogate_arguments(surrogate, attributes):
+    """The surrogate keyword arguments of the fused CPU steps, from the
+    ``surrogate`` and ``surrogate_attributes`` of a neuron."""
+    return {
+        "surrogate": surrogate,
+        "slope": attributes.get("slope"),
+        "surrogate_beta": attributes.get("beta", 1.0),
+    }
@@ -0,0 +1,507 @@
+// Fused single-timestep adaptive-threshold Leaky integrate-and-fire (ALIF)
+// neuron.
+//
+// Takes (input, mem, a, beta, rho, threshold, beta_a), a being the
+// per-neuron adaptation state carried next to mem, and returns
+// (spk, mem_next, a_next), where
+//
+//   thr      = threshold + beta_a * a
+//   reset    = mem >= thr                              (detached)
+//   mem_next = clamp(beta, 0, 1) * mem + input - reset * thr
+//   a_next   = clamp(rho, 0, 1) * a + reset
+//   spk      = mem_next >= threshold + beta_a * a_next
+//
+// for the default reset-by-subtraction. reset is the spike of the previous
+// step, so a is driven by the neuron's own spikes and the threshold rises
+// with its recent activity. The forward pass is one AdaptiveLeakyStep
+// vertex per region writing all three outputs (codelets/spike_codelets.cpp);
+// without the codelets, or with compact spikes, it is three maps, and the
+// adaptive threshold is recomputed inside each of them. threshold (the baseline
+// b0), beta_a and the decay rates hold one value for the layer or one per
+// neuron. `reset_mechanism` follows `SpikingNeuron.reset_dict`
+// (0: subtract, 1: zero, 2: none) and `surrogate` selects the gradient used
+// for dS/dU in the backward pass, which also reaches a_next through the
+// threshold, so gradients run through both states over time.
+// `spike_dtype` = "bool" / "uint8" emits spk at one byte per neuron while
+// the states keep the type of the input; the op then has no grad op.
+#include <popart/opmanager.hpp>
+#include <popart/opserialiser.hpp>
+#include <popart/popx/opx.hpp>
+#include <popart/popx/opxmanager.hpp>
+
+#include <popops/ElementWise.hpp>
+
+#include "neuron_step.hpp"
+#include "spike_codelets.hpp"
+
+namespace CustomOperators {
+const popart::OperatorIdentifier AdaptiveLeakyStepId = {
+    "custom.ops", "AdaptiveLeakyStep", 1};
+} // namespace CustomOperators
+namespace CustomGradOperators {
+const popart::OperatorIdentifier AdaptiveLeakyStepGradId = {
+    "custom.ops", "AdaptiveLeakyStepGrad", 1};
+} // namespace CustomGradOperators
+
+class AdaptiveLeakyStepOp;
+class AdaptiveLeakyStepOpx;
+class AdaptiveLeakyStepGradOpx;
+
+class AdaptiveLeakyStepGradOp : public popart::Op {
+public:
+  AdaptiveLeakyStepGradOp(const AdaptiveLeakyStepOp &fwdOp);
+
+  std::unique_ptr<popart::Op> clone() const final {
+    return std::make_unique<AdaptiveLeakyStepGradOp>(*this);
+  }
+
+  // One gradient per forward input: input, mem, a, beta, rho, threshold
+  // and beta_a
+  void setup() final {
+    for (int i = 0; i < static_cast<int>(fwdInInfo.size()); ++i) {
+      outInfo(i) = fwdInInfo[i];
+    }
+  };
+
+  const std::vector<popart::GradInOutMapper> &gradInputInfo() const;
+
+  const std::map<int, int> &gradOutToNonGradIn() const;
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // an estimate of how valuable sub-graph matching will be
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  int64_t getResetMechanism() const { return resetMechanism; }
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+
+  // Implementation defined below
+  void appendAttributes(popart::OpSerialiserBase &os) const override;
+
+  // Implementation defined below
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override;
+
+private:
+  int64_t resetMechanism;
+  neuron_step::Surrogate surrogate;
+  std::vector<popart::TensorInfo> fwdInInfo;
+};
+
+class AdaptiveLeakyStepOp : public popart::Op {
+public:
+  AdaptiveLeakyStepOp(const popart::OperatorIdentifier &_opid,
+                      int64_t _resetMechanism,
+                      const neuron_step::Surrogate &_surrogate,
+                      const std::string &_spikeDtype,
+                      const popart::Op::Settings &settings_)
+      : popart::Op(_opid, settings_), resetMechanism(_resetMechanism),
+        surrogate(_surrogate), spikeDtype(_spikeDtype) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<AdaptiveLeakyStepOp>(*this);
+  }
+
+  // spk, mem_next and a_next take the shape and type of the input current,
+  // unless spk is emitted as a compact spike_dtype
+  void setup() final {
+    outInfo(0) = neuron_step::spikeInfo(inInfo(0), getSpikeDtype());
+    outInfo(1) = inInfo(0);
+    outInfo(2) = inInfo(0);
+  }
+
+  void appendAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendAttributes(os);
+    os.appendAttribute("reset_mechanism", getResetMechanism());
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendOutlineAttributes(os);
+    os.appendAttribute("reset_mechanism", getResetMechanism());
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  // Compact spikes carry no gradient
+  std::vector<std::unique_ptr<popart::Op>> getGradOps() {
+    std::vector<std::unique_ptr<Op>> upops;
+    if (neuron_step::compactSpikes(getSpikeDtype())) {
+      return upops;
+    }
+    upops.emplace_back(new AdaptiveLeakyStepGradOp(*this));
+    return upops;
+  }
+
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // Attributes
+  int64_t getResetMechanism() const { return resetMechanism; }
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+  const std::string &getSpikeDtype() const { return spikeDtype; }
+
+private:
+  int64_t resetMechanism;
+  neuron_step::Surrogate surrogate;
+  std::string spikeDtype;
+};
+
+namespace {
+using popart::DataType;
+using popart::OpDefinition;
+
+static OpDefinition::DataTypes T = {DataType::FLOAT16, DataType::FLOAT};
+static OpDefinition::DataTypes Spikes = {DataType::FLOAT16, DataType::FLOAT,
+                                         DataType::BOOL, DataType::UINT8};
+
+static OpDefinition AdaptiveLeakyStepOpDef(
+    {OpDefinition::Inputs({{"input", T},
+                           {"mem", T},
+                           {"a", T},
+                           {"beta", T},
+                           {"rho", T},
+                           {"threshold", T},
+                           {"beta_a", T}}),
+     OpDefinition::Outputs({{"spk", Spikes}, {"mem_next", T}, {"a_next", T}}),
+     OpDefinition::Attributes({{"reset_mechanism", {"*"}},
+                               {"surrogate", {"*"}},
+                               {"slope", {"*"}},
+                               {"beta", {"*"}},
+                               {"spike_dtype", {"*"}}})});
+
+static popart::OpCreator<AdaptiveLeakyStepOp> AdaptiveLeakyStepOpCreator(
+    popart::OpDefinitions({{CustomOperators::AdaptiveLeakyStepId,
+                            AdaptiveLeakyStepOpDef}}),
+    [](const popart::OpCreatorInfo &info) {
+      // default reset mechanism is subtraction, see SpikingNeuron.reset_dict
+      int64_t resetMechanism =
+          info.attributes.getAttribute<popart::Attributes::Int>(
+              "reset_mechanism", 0);
+      neuron_step::checkResetMechanism("AdaptiveLeakyStep", resetMechanism);
+      neuron_step::Surrogate surrogate = neuron_step::surrogateAttributes(
+          "AdaptiveLeakyStep", info.attributes, "fast_sigmoid");
+      std::string spikeDtype = neuron_step::spikeDtypeAttribute(
+          "AdaptiveLeakyStep", info.attributes);
+      return std::make_unique<AdaptiveLeakyStepOp>(
+          info.opid, resetMechanism, surrogate, spikeDtype, info.settings);
+    },
+    true);
+} // namespace
+
+namespace pe = popops::expr;
+namespace ns = neuron_step;
+
+namespace {
+// threshold + beta_a * a
+pe::Add adaptiveThreshold(const pe::Expr &threshold, const pe::Expr &betaA,
+                          const pe::Expr &a) {
+  return pe::Add(threshold, pe::Mul(betaA, a));
+}
+} // namespace
+
+class AdaptiveLeakyStepOpx : public popart::popx::Opx {
+public:
+  AdaptiveLeakyStepOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<AdaptiveLeakyStepOp>(op, {CustomOperators::AdaptiveLeakyStepId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+
+    auto op = getOp<AdaptiveLeakyStepOp>();
+
+    poplar::Tensor input = getInTensor(0);
+    poplar::Tensor mem = getInTensor(1);
+    poplar::Tensor a = getInTensor(2);
+    auto type = input.elementType();
+    auto shape = input.shape();
+
+    if (!ns::compactSpikes(op.getSpikeDtype()) &&
+        spike_codelets::addCodelets(graph())) {
+      std::vector<poplar::Tensor> params;
+      const char *names[] = {"beta", "rho", "threshold", "beta_a"};
+      for (int i = 0; i < 4; ++i) {
+        params.push_back(spike_codelets::prepareThreshold(
+            graph(), getInTensor(3 + i), type, shape, prog,
+            debugContext(names[i])));
+      }
+      auto outs = spike_codelets::adaptiveLeakyStep(
+          graph(), input, mem, a, params[0], params[1], params[2], params[3],
+          op.getResetMechanism(), prog, debugContext("AdaptiveLeakyStep"));
+      for (int i = 0; i < 3; ++i) {
+        setOutTensor(i, outs[i]);
+      }
+      return;
+    }
+
+    poplar::Tensor beta = ns::broadcastParam(graph(), getInTensor(3), type,
+                                             shape, prog, debugContext("beta"));
+    poplar::Tensor rho = ns::broadcastParam(graph(), getInTensor(4), type,
+                                            shape, prog, debugContext("rho"));
+    poplar::Tensor threshold =
+        ns::broadcastParam(graph(), getInTensor(5), type, shape, prog,
+                           debugContext("threshold"));
+    poplar::Tensor betaA = ns::broadcastParam(
+        graph(), getInTensor(6), type, shape, prog, debugContext("beta_a"));
+
+    // _1: input, _2: mem, _3: a, _4: beta, _5: threshold, _6: beta_a
+    auto memNextExpr =
+        ns::leakyMemNext(op.getResetMechanism(), pe::_1, pe::_2, pe::_4,
+                         adaptiveThreshold(pe::_5, pe::_6, pe::_3));
+    auto memNext = popops::map(graph(), *memNextExpr,
+                               {input, mem, a, beta, threshold, betaA}, prog,
+                               debugContext("AdaptiveLeakyStepMem"));
+
+    // _1: a, _2: mem, _3: rho, _4: threshold, _5: beta_a
+    auto aNext = popops::map(
+        graph(),
+        pe::Add(pe::Mul(ns::clampUnit(pe::_3), pe::_1),
+                ns::spike(pe::_2, adaptiveThreshold(pe::_4, pe::_5, pe::_1))),
+        {a, mem, rho, threshold, betaA}, prog,
+        debugContext("AdaptiveLeakyStepAdaptation"));
+
+    // _1: mem_next, _2: a_next, _3: threshold, _4: beta_a
+    auto spkExpr = ns::spikeOutput(
+        ns::spike(pe::_1, adaptiveThreshold(pe::_3, pe::_4, pe::_2)),
+        op.getSpikeDtype());
+    auto spk = popops::map(graph(), *spkExpr,
+                           {memNext, aNext, threshold, betaA}, prog,
+                           debugContext("AdaptiveLeakyStepSpike"));
+
+    setOutTensor(0, spk);
+    setOutTensor(1, memNext);
+    setOutTensor(2, aNext);
+  }
+};
+
+class AdaptiveLeakyStepGradOpx : public popart::popx::Opx {
+public:
+  AdaptiveLeakyStepGradOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<AdaptiveLeakyStepGradOp>(
+        op, {CustomGradOperators::AdaptiveLeakyStepGradId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+
+    auto op = getOp<AdaptiveLeakyStepGradOp>();
+
+    poplar::Tensor mem = getInTensor(3);
+    poplar::Tensor a = getInTensor(4);
+    poplar::Tensor betaIn = getInTensor(5);
+    poplar::Tensor rhoIn = getInTensor(6);
+    poplar::Tensor thresholdIn = getInTensor(7);
+    poplar::Tensor betaAIn = getInTensor(8);
+    poplar::Tensor memNext = getInTensor(9);
+    // A loss on the states alone leaves no gradient for spk
+    poplar::Tensor gradSpk =
+        hasInput(0) ? getInTensor(0)
+                    : ns::zerosLike(graph(), memNext, prog,
+                                    debugContext("gradSpk"));
+    poplar::Tensor aNext = getInTensor(10);
+
+    auto type = gradSpk.elementType();
+    auto shape = gradSpk.shape();
+    poplar::Tensor beta = ns::broadcastParam(graph(), betaIn, type, shape, prog,
+                                             debugContext("beta"));
+    poplar::Tensor rho = ns::broadcastParam(graph(), rhoIn, type, shape, prog,
+                                            debugContext("rho"));
+    poplar::Tensor threshold = ns::broadcastParam(
+        graph(), thresholdIn, type, shape, prog, debugContext("threshold"));
+    poplar::Tensor betaA = ns::broadcastParam(graph(), betaAIn, type, shape,
+                                              prog, debugContext("beta_a"));
+
+    // Gradient reaching mem_next through the spike: gradSpk * dS/dU. The
+    // threshold of the spike sees the negation of it.
+    // _1: gradSpk, _2: mem_next, _3: a_next, _4: threshold, _5: beta_a
+    auto surrogate = ns::surrogateGrad(
+        op.getSurrogate(),
+        pe::Sub(pe::_2, adaptiveThreshold(pe::_4, pe::_5, pe::_3)));
+    auto gradSpkU =
+        popops::map(graph(), pe::Mul(pe::_1, *surrogate),
+                    {gradSpk, memNext, aNext, threshold, betaA}, prog,
+                    debugContext("AdaptiveLeakyStepGradSurrogate"));
+
+    // Total gradient w.r.t. mem_next
+    poplar::Tensor gradU = gradSpkU;
+    if (hasInput(1)) {
+      gradU = popops::map(graph(), pe::Add(pe::_1, pe::_2),
+                          {getInTensor(1), gradSpkU}, prog,
+                          debugContext("AdaptiveLeakyStepGradMemNext"));
+    }
+
+    // Total gradient w.r.t. a_next, which also feeds the spike threshold
+    poplar::Tensor gradANext;
+    if (hasInput(2)) {
+      // _1: gradANext, _2: beta_a, _3: gradSpkU
+      gradANext = popops::map(graph(),
+                              pe::Sub(pe::_1, pe::Mul(pe::_2, pe::_3)),
+                              {getInTensor(2), betaA, gradSpkU}, prog,
+                              debugContext("AdaptiveLeakyStepGradANext"));
+    } else {
+      gradANext = popops::map(graph(), pe::Neg(pe::Mul(pe::_1, pe::_2)),
+                              {betaA, gradSpkU}, prog,
+                              debugContext("AdaptiveLeakyStepGradANext"));
+    }
+
+    // The reset of the step, for _1: mem, _2: a, _3: threshold, _4: beta_a
+    auto fired = pe::Gte(pe::_1, adaptiveThreshold(pe::_3, pe::_4, pe::_2));
+    std::vector<poplar::Tensor> firedIns = {mem, a, threshold, betaA};
+
+    // Reset-to-zero masks every path through the integration
+    poplar::Tensor gradInput = gradU;
+    if (op.getResetMechanism() == ns::Zero) {
+      auto ins = firedIns;
+      ins.push_back(gradU);
+      gradInput = popops::map(graph(),
+                              pe::Select(pe::Const(0.0f), pe::_5, fired), ins,
+                              prog, debugContext("AdaptiveLeakyStepGradInput"));
+    }
+
+    // Reset-by-subtraction passes -gradU to the threshold of the step, and
+    // from there to a, threshold and beta_a
+    const bool subtract = op.getResetMechanism() == ns::Subtract;
+    poplar::Tensor gradThr;
+    if (subtract) {
+      auto ins = firedIns;
+      ins.push_back(gradU);
+      gradThr = popops::map(graph(),
+                            pe::Select(pe::Neg(pe::_5), pe::Const(0.0f), fired),
+                            ins, prog,
+                            debugContext("AdaptiveLeakyStepGradThr"));
+    }
+
+    // _1: gradInput, _2: beta
+    auto gradMem = popops::map(graph(), pe::Mul(pe::_1, ns::clampUnit(pe::_2)),
+                               {gradInput, beta}, prog,
+                               debugContext("AdaptiveLeakyStepGradMem"));
+
+    // dmem_next/dbeta = mem, only where beta is not clamped
+    auto gradBeta = popops::map(graph(), pe::Mul(pe::_1, pe::_2),
+                                {gradInput, mem}, prog,
+                                debugContext("AdaptiveLeakyStepGradBeta"));
+    gradBeta = ns::reduceToShape(graph(), gradBeta, betaIn.shape(),
+                                 betaIn.elementType(), prog,
+                                 debugContext("AdaptiveLeakyStepGradBeta"));
+    ns::maskClampedGrad(graph(), gradBeta, betaIn, prog,
+                        debugContext("AdaptiveLeakyStepGradBetaClamp"));
+
+    // da_next/da = clamp(rho, 0, 1), plus the path through the threshold
+    poplar::Tensor gradA;
+    if (subtract) {
+      // _1: gradANext, _2: rho, _3: beta_a, _4: gradThr
+      gradA = popops::map(graph(),
+                          pe::Add(pe::Mul(pe::_1, ns::clampUnit(pe::_2)),
+                                  pe::Mul(pe::_3, pe::_4)),
+                          {gradANext, rho, betaA, gradThr}, prog,
+                          debugContext("AdaptiveLeakyStepGradA"));
+    } else {
+      gradA = popops::map(graph(), pe::Mul(pe::_1, ns::clampUnit(pe::_2)),
+                          {gradANext, rho}, prog,
+                          debugContext("AdaptiveLeakyStepGradA"));
+    }
+
+    // da_next/drho = a, only where rho is not clamped
+    auto gradRho = popops::map(graph(), pe::Mul(pe::_1, pe::_2),
+                               {gradANext, a}, prog,
+                               debugContext("AdaptiveLeakyStepGradRho"));
+    gradRho = ns::reduceToShape(graph(), gradRho, rhoIn.shape(),
+                                rhoIn.elementType(), prog,
+                                debugContext("AdaptiveLeakyStepGradRho"));
+    ns::maskClampedGrad(graph(), gradRho, rhoIn, prog,
+                        debugContext("AdaptiveLeakyStepGradRhoClamp"));
+
+    // The spike threshold sees -gradSpkU, the threshold of the step gradThr
+    poplar::Tensor gradThreshold;
+    poplar::Tensor gradBetaA;
+    if (subtract) {
+      gradThreshold =
+          popops::map(graph(), pe::Sub(pe::_1, pe::_2), {gradThr, gradSpkU},
+                      prog, debugContext("AdaptiveLeakyStepGradThreshold"));
+      // _1: gradSpkU, _2: a_next, _3: gradThr, _4: a
+      gradBetaA = popops::map(
+          graph(), pe::Sub(pe::Mul(pe::_3, pe::_4), pe::Mul(pe::_1, pe::_2)),
+          {gradSpkU, aNext, gradThr, a}, prog,
+          debugContext("AdaptiveLeakyStepGradBetaA"));
+    } else {
+      gradThreshold =
+          popops::map(graph(), pe::Neg(pe::_1), {gradSpkU}, prog,
+                      debugContext("AdaptiveLeakyStepGradThreshold"));
+      gradBetaA = popops::map(graph(), pe::Neg(pe::Mul(pe::_1, pe::_2)),
+                              {gradSpkU, aNext}, prog,
+                              debugContext("AdaptiveLeakyStepGradBetaA"));
+    }
+    gradThreshold = ns::reduceToShape(
+        graph(), gradThreshold, thresholdIn.shape(),
+        thresholdIn.elementType(), prog,
+        debugContext("AdaptiveLeakyStepGradThresholdReduce"));
+    gradBetaA = ns::reduceToShape(graph(), gradBetaA, betaAIn.shape(),
+                                  betaAIn.elementType(), prog,
+                                  debugContext("AdaptiveLeakyStepGradBetaA"));
+
+    setOutTensor(0, gradInput);
+    setOutTensor(1, gradMem);
+    setOutTensor(2, gradA);
+    setOutTensor(3, gradBeta);
+    setOutTensor(4, gradRho);
+    setOutTensor(5, gradThreshold);
+    setOutTensor(6, gradBetaA);
+  }
+};
+
+AdaptiveLeakyStepGradOp::AdaptiveLeakyStepGradOp(
+    const AdaptiveLeakyStepOp &fwdOp)
+    : popart::Op(CustomGradOperators::AdaptiveLeakyStepGradId,
+                 fwdOp.settings),
+      resetMechanism(fwdOp.getResetMechanism()),
+      surrogate(fwdOp.getSurrogate()) {
+  for (int i = 0; i < 7; ++i) {
+    fwdInInfo.push_back(fwdOp.inInfo(i));
+  }
+}
+
+const std::vector<popart::GradInOutMapper> &
+AdaptiveLeakyStepGradOp::gradInputInfo() const {
+  static const std::vector<popart::GradInOutMapper> inInfo = {
+      {0, 0, popart::GradOpInType::GradOut},
+      {1, 1, popart::GradOpInType::GradOut},
+      {2, 2, popart::GradOpInType::GradOut},
+      {3, 1, popart::GradOpInType::In},
+      {4, 2, popart::GradOpInType::In},
+      {5, 3, popart::GradOpInType::In},
+      {6, 4, popart::GradOpInType::In},
+      {7, 5, popart::GradOpInType::In},
+      {8, 6, popart::GradOpInType::In},
+      {9, 1, popart::GradOpInType::Out},
+      {10, 2, popart::GradOpInType::Out}};
+  return inInfo;
+}
+
+// The Grad Op has 7 outputs, one per forward input
+const std::map<int, int> &AdaptiveLeakyStepGradOp::gradOutToNonGradIn() const {
+  static const std::map<int, int> outInfo = {{0, 0}, {1, 1}, {2, 2}, {3, 3},
+                                             {4, 4}, {5, 5}, {6, 6}};
+  return outInfo;
+}
+
+void AdaptiveLeakyStepGradOp::appendAttributes(
+    popart::OpSerialiserBase &os) const {
+  Op::appendAttributes(os);
+  os.appendAttribute("reset_mechanism", getResetMechanism());
+  neuron_step::appendSurrogate(os, getSurrogate());
+}
+
+void AdaptiveLeakyStepGradOp::appendOutlineAttributes(
+    popart::OpSerialiserBase &os) const {
+  Op::appendOutlineAttributes(os);
+  os.appendAttribute("reset_mechanism", getResetMechanism());
+  neuron_step::appendSurrogate(os, getSurrogate());
+}
+
+static popart::popx::OpxCreator<AdaptiveLeakyStepOpx>
+    AdaptiveLeakyStepOpxCreator({CustomOperators::AdaptiveLeakyStepId});
+static popart::popx::OpxCreator<AdaptiveLeakyStepGradOpx>
+    AdaptiveLeakyStepGradOpxCreator(
+        {CustomGradOperators::AdaptiveLeakyStepGradId});
@@ -0,0 +1,551 @@
+// Fused single-timestep Alpha integrate-and-fire neuron.
+//
+// Takes (input, syn_exc, syn_inh, mem, alpha, beta, threshold) and returns
+// (spk, syn_exc_next, syn_inh_next, mem_next), where
+//
+//   reset        = mem >= threshold                          (detached)
+//   syn_exc_next = clamp(alpha, 0, 1) * syn_exc + input
+//   syn_inh_next = clamp(beta, 0, 1) * syn_inh - input
+//   tau_alpha    = log(alpha) / (log(beta) - log(alpha)) + 1
+//   mem_next     = tau_alpha * (syn_exc_next + syn_inh_next)
+//   spk          = mem_next >= threshold
+//
+// Reset-by-subtraction takes the threshold off syn_exc_next and clears
+// syn_inh_next, reset-to-zero clears all three states (see
+// `Alpha._build_state_function`). Every state is written by one fused
+// element-wise map, so none of the intermediates of the Python expression
+// are materialised on tile.
+// `spike_dtype` = "bool" / "uint8" emits spk at one byte per neuron while
+// the states keep the type of the input; the op then has no grad op.
+#include <popart/opmanager.hpp>
+#include <popart/opserialiser.hpp>
+#include <popart/popx/opx.hpp>
+#include <popart/popx/opxmanager.hpp>
+
+#include <popops/ElementWise.hpp>
+#include <popops/Zero.hpp>
+
+#include "neuron_step.hpp"
+
+namespace CustomOperators {
+const popart::OperatorIdentifier AlphaStepId = {"custom.ops", "AlphaStep", 1};
+} // namespace CustomOperators
+namespace CustomGradOperators {
+const popart::OperatorIdentifier AlphaStepGradId = {"custom.ops",
+                                                    "AlphaStepGrad", 1};
+} // namespace CustomGradOperators
+
+class AlphaStepOp;
+class AlphaStepOpx;
+class AlphaStepGradOpx;
+
+class AlphaStepGradOp : public popart::Op {
+public:
+  AlphaStepGradOp(const AlphaStepOp &fwdOp);
+
+  std::unique_ptr<popart::Op> clone() const final {
+    return std::make_unique<AlphaStepGradOp>(*this);
+  }
+
+  // One gradient per forward input: input, syn_exc, syn_inh, mem, alpha,
+  // beta, threshold
+  void setup() final {
+    for (int i = 0; i < static_cast<int>(fwdInInfo.size()); ++i) {
+      outInfo(i) = fwdInInfo[i];
+    }
+  };
+
+  const std::vector<popart::GradInOutMapper> &gradInputInfo() const;
+
+  const std::map<int, int> &gradOutToNonGradIn() const;
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // an estimate of how valuable sub-graph matching will be
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  int64_t getResetMechanism() const { return resetMechanism; }
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+
+  // Implementation defined below
+  void appendAttributes(popart::OpSerialiserBase &os) const override;
+
+  // Implementation defined below
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override;
+
+private:
+  int64_t resetMechanism;
+  neuron_step::Surrogate surrogate;
+  std::vector<popart::TensorInfo> fwdInInfo;
+};
+
+class AlphaStepOp : public popart::Op {
+public:
+  AlphaStepOp(const popart::OperatorIdentifier &_opid, int64_t _resetMechanism,
+              const neuron_step::Surrogate &_surrogate,
+              const std::string &_spikeDtype,
+              const popart::Op::Settings &settings_)
+      : popart::Op(_opid, settings_), resetMechanism(_resetMechanism),
+        surrogate(_surrogate), spikeDtype(_spikeDtype) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<AlphaStepOp>(*this);
+  }
+
+  // spk and the three states all take the shape and type of the input,
+  // unless spk is emitted as a compact spike_dtype
+  void setup() final {
+    outInfo(0) = neuron_step::spikeInfo(inInfo(0), getSpikeDtype());
+    for (int i = 1; i < 4; ++i) {
+      outInfo(i) = inInfo(0);
+    }
+  }
+
+  void appendAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendAttributes(os);
+    os.appendAttribute("reset_mechanism", getResetMechanism());
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendOutlineAttributes(os);
+    os.appendAttribute("reset_mechanism", getResetMechanism());
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  // Compact spikes carry no gradient
+  std::vector<std::unique_ptr<popart::Op>> getGradOps() {
+    std::vector<std::unique_ptr<Op>> upops;
+    if (neuron_step::compactSpikes(getSpikeDtype())) {
+      return upops;
+    }
+    upops.emplace_back(new AlphaStepGradOp(*this));
+    return upops;
+  }
+
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // Attributes
+  int64_t getResetMechanism() const { return resetMechanism; }
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+  const std::string &getSpikeDtype() const { return spikeDtype; }
+
+private:
+  int64_t resetMechanism;
+  neuron_step::Surrogate surrogate;
+  std::string spikeDtype;
+};
+
+namespace {
+using popart::DataType;
+using popart::OpDefinition;
+
+static OpDefinition::DataTypes T = {DataType::FLOAT16, DataType::FLOAT};
+static OpDefinition::DataTypes Spikes = {DataType::FLOAT16, DataType::FLOAT,
+                                         DataType::BOOL, DataType::UINT8};
+
+static OpDefinition AlphaStepOpDef(
+    {OpDefinition::Inputs({{"input", T},
+                           {"syn_exc", T},
+                           {"syn_inh", T},
+                           {"mem", T},
+                           {"alpha", T},
+                           {"beta", T},
+                           {"threshold", T}}),
+     OpDefinition::Outputs({{"spk", Spikes},
+                            {"syn_exc_next", T},
+                            {"syn_inh_next", T},
+                            {"mem_next", T}}),
+     OpDefinition::Attributes(
+         {{"reset_mechanism", {"*"}},
+          {"surrogate", {"*"}},
+          {"slope", {"*"}},
+          {"beta", {"*"}},
+          {"spike_dtype", {"*"}}})});
+
+static popart::OpCreator<AlphaStepOp> AlphaStepOpCreator(
+    popart::OpDefinitions({{CustomOperators::AlphaStepId, AlphaStepOpDef}}),
+    [](const popart::OpCreatorInfo &info) {
+      // Alpha defaults to reset-to-zero, see SpikingNeuron.reset_dict
+      int64_t resetMechanism =
+          info.attributes.getAttribute<popart::Attributes::Int>(
+              "reset_mechanism", 1);
+      neuron_step::checkResetMechanism("AlphaStep", resetMechanism);
+      neuron_step::Surrogate surrogate = neuron_step::surrogateAttributes(
+          "AlphaStep", info.attributes, "fast_sigmoid");
+      std::string spikeDtype =
+          neuron_step::spikeDtypeAttribute("AlphaStep", info.attributes);
+      return std::make_unique<AlphaStepOp>(info.opid, resetMechanism,
+                                           surrogate, spikeDtype,
+                                           info.settings);
+    },
+    true);
+} // namespace
+
+namespace pe = popops::expr;
+namespace ns = neuron_step;
+
+namespace {
+// Cast alpha and beta to `type` and broadcast them against each other, so
+// tau_alpha and its derivatives are evaluated once per parameter element
+// rather than once per neuron.
+std::pair<poplar::Tensor, poplar::Tensor>
+matchRates(poplar::Graph &graph, poplar::Tensor alpha, poplar::Tensor beta,
+           const poplar::Type &type, poplar::program::Sequence &prog,
+           const poplar::DebugContext &dc) {
+  if (alpha.elementType() != type) {
+    alpha = popops::cast(graph, alpha, type, prog, dc);
+  }
+  if (beta.elementType() != type) {
+    beta = popops::cast(graph, beta, type, prog, dc);
+  }
+  poputil::broadcastToMatch(alpha, beta);
+  return {alpha, beta};
+}
+
+// log(alpha) / (log(beta) - log(alpha)) + 1, on clamped rates
+pe::Add tauAlpha(const pe::Expr &alpha, const pe::Expr &beta) {
+  auto logAlpha = pe::Log(ns::clampUnit(alpha));
+  auto logBeta = pe::Log(ns::clampUnit(beta));
+  return pe::Add(pe::Divide(logAlpha, pe::Sub(logBeta, logAlpha)),
+                 pe::Const(1.0f));
+}
+} // namespace
+
+class AlphaStepOpx : public popart::popx::Opx {
+public:
+  AlphaStepOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<AlphaStepOp>(op, {CustomOperators::AlphaStepId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+
+    auto op = getOp<AlphaStepOp>();
+
+    poplar::Tensor input = getInTensor(0);
+    poplar::Tensor synExc = getInTensor(1);
+    poplar::Tensor synInh = getInTensor(2);
+    poplar::Tensor mem = getInTensor(3);
+    auto type = input.elementType();
+    auto shape = input.shape();
+
+    auto rates = matchRates(graph(), getInTensor(4), getInTensor(5), type,
+                            prog, debugContext("rates"));
+    auto tau = popops::map(graph(), tauAlpha(pe::_1, pe::_2),
+                           {rates.first, rates.second}, prog,
+                           debugContext("AlphaStepTau"));
+    tau = ns::broadcastParam(graph(), tau, type, shape, prog,
+                             debugContext("tau"));
+    poplar::Tensor alpha = ns::broadcastParam(
+        graph(), getInTensor(4), type, shape, prog, debugContext("alpha"));
+    poplar::Tensor beta = ns::broadcastParam(graph(), getInTensor(5), type,
+                                             shape, prog, debugContext("beta"));
+    poplar::Tensor threshold =
+        ns::broadcastParam(graph(), getInTensor(6), type, shape, prog,
+                           debugContext("threshold"));
+
+    // Subtraction only moves syn_exc and clears syn_inh; mem_next is taken
+    // from the pre-reset currents. Each map reads only its own operands,
+    // plus mem and threshold where it applies a reset. The states are op
+    // inputs, which the grad op reads back, so they are not written in place.
+    int64_t rm = op.getResetMechanism();
+
+    // _1: input, _2: syn, _3: its decay rate, then _4: mem, _5: threshold
+    // for a reset
+    auto synNext = [&](const pe::Expr &base, const poplar::Tensor &syn,
+                       const poplar::Tensor &decay, int64_t reset,
+                       const std::string &name) {
+      std::vector<poplar::Tensor> ins = {input, syn, decay};
+      if (reset != ns::None) {
+        ins.push_back(mem);
+        ins.push_back(threshold);
+      }
+      auto expr = ns::applyReset(reset, base, pe::_4, pe::_5);
+      return popops::map(graph(), *expr, ins, prog, debugContext(name));
+    };
+    auto synExcNext =
+        synNext(pe::Add(pe::Mul(ns::clampUnit(pe::_3), pe::_2), pe::_1),
+                synExc, alpha, rm, "AlphaStepSynExc");
+    auto synInhNext =
+        synNext(pe::Sub(pe::Mul(ns::clampUnit(pe::_3), pe::_2), pe::_1),
+                synInh, beta, rm == ns::Subtract ? ns::Zero : rm,
+                "AlphaStepSynInh");
+
+    // _1: input, _2: syn_exc, _3: syn_inh, _4: alpha, _5: beta, _6: tau,
+    // then _7: mem, _8: threshold for a reset
+    std::vector<poplar::Tensor> memIns = {input, synExc, synInh,
+                                          alpha, beta,   tau};
+    const int64_t memReset = rm == ns::Subtract ? ns::None : rm;
+    if (memReset != ns::None) {
+      memIns.push_back(mem);
+      memIns.push_back(threshold);
+    }
+    auto memBase = pe::Mul(
+        pe::_6, pe::Add(pe::Add(pe::Mul(ns::clampUnit(pe::_4), pe::_2), pe::_1),
+                        pe::Sub(pe::Mul(ns::clampUnit(pe::_5), pe::_3),
+                                pe::_1)));
+    auto memExpr = ns::applyReset(memReset, memBase, pe::_7, pe::_8);
+    auto memNext = popops::map(graph(), *memExpr, memIns, prog,
+                               debugContext("AlphaStepMem"));
+
+    auto spkExpr =
+        ns::spikeOutput(ns::spike(pe::_1, pe::_2), op.getSpikeDtype());
+    auto spk = popops::map(graph(), *spkExpr, {memNext, threshold}, prog,
+                           debugContext("AlphaStepSpike"));
+
+    setOutTensor(0, spk);
+    setOutTensor(1, synExcNext);
+    setOutTensor(2, synInhNext);
+    setOutTensor(3, memNext);
+  }
+};
+
+class AlphaStepGradOpx : public popart::popx::Opx {
+public:
+  AlphaStepGradOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<AlphaStepGradOp>(op, {CustomGradOperators::AlphaStepGradId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+
+    auto op = getOp<AlphaStepGradOp>();
+    int64_t rm = op.getResetMechanism();
+
+    poplar::Tensor synExc = getInTensor(5);
+    poplar::Tensor synInh = getInTensor(6);
+    poplar::Tensor mem = getInTensor(7);
+    poplar::Tensor alphaIn = getInTensor(8);
+    poplar::Tensor betaIn = getInTensor(9);
+    poplar::Tensor thresholdIn = getInTensor(10);
+    poplar::Tensor memNext = getInTensor(11);
+    // A loss on the states alone leaves no gradient for spk
+    poplar::Tensor gradSpk =
+        hasInput(0) ? getInTensor(0)
+                    : ns::zerosLike(graph(), memNext, prog,
+                                    debugContext("gradSpk"));
+
+    auto type = gradSpk.elementType();
+    auto shape = gradSpk.shape();
+
+    // tau_alpha and its partial derivatives w.r.t. the clamped rates
+    auto rates = matchRates(graph(), alphaIn, betaIn, type, prog,
+                            debugContext("rates"));
+    auto logAlpha = pe::Log(ns::clampUnit(pe::_1));
+    auto logBeta = pe::Log(ns::clampUnit(pe::_2));
+    auto logDiffSq = pe::Square(pe::Sub(logBeta, logAlpha));
+    auto tau = popops::map(graph(), tauAlpha(pe::_1, pe::_2),
+                           {rates.first, rates.second}, prog,
+                           debugContext("AlphaStepGradTau"));
+    auto dTauDAlpha = popops::map(
+        graph(),
+        pe::Divide(logBeta, pe::Mul(ns::clampUnit(pe::_1), logDiffSq)),
+        {rates.first, rates.second}, prog,
+        debugContext("AlphaStepGradTauAlpha"));
+    auto dTauDBeta = popops::map(
+        graph(),
+        pe::Neg(
+            pe::Divide(logAlpha, pe::Mul(ns::clampUnit(pe::_2), logDiffSq))),
+        {rates.first, rates.second}, prog,
+        debugContext("AlphaStepGradTauBeta"));
+    tau = ns::broadcastParam(graph(), tau, type, shape, prog,
+                             debugContext("tau"));
+    dTauDAlpha = ns::broadcastParam(graph(), dTauDAlpha, type, shape, prog,
+                                    debugContext("dTauDAlpha"));
+    dTauDBeta = ns::broadcastParam(graph(), dTauDBeta, type, shape, prog,
+                                   debugContext("dTauDBeta"));
+
+    poplar::Tensor alpha = ns::broadcastParam(graph(), alphaIn, type, shape,
+                                              prog, debugContext("alpha"));
+    poplar::Tensor beta = ns::broadcastParam(graph(), betaIn, type, shape, prog,
+                                             debugContext("beta"));
+    poplar::Tensor threshold = ns::broadcastParam(
+        graph(), thresholdIn, type, shape, prog, debugContext("threshold"));
+
+    // Gradient reaching mem_next through the spike: gradSpk * dS/dU
+    auto surrogate =
+        ns::surrogateGrad(op.getSurrogate(), pe::Sub(pe::_2, pe::_3));
+    auto gradSpkU =
+        popops::map(graph(), pe::Mul(pe::_1, *surrogate),
+                    {gradSpk, memNext, threshold}, prog,
+                    debugContext("AlphaStepGradSurrogate"));
+
+    // Total gradient w.r.t. mem_next, masked by reset-to-zero
+    poplar::Tensor gradMemBase = gradSpkU;
+    if (hasInput(3)) {
+      gradMemBase = popops::map(graph(), pe::Add(pe::_1, pe::_2),
+                                {getInTensor(3), gradSpkU}, prog,
+                                debugContext("AlphaStepGradMemNext"));
+    }
+    if (rm == ns::Zero) {
+      popops::mapInPlace(graph(),
+                         pe::Select(pe::Const(0.0f), pe::_1,
+                                    pe::Gte(pe::_2, pe::_3)),
+                         {gradMemBase, mem, threshold}, prog,
+                         debugContext("AlphaStepGradMemReset"));
+    }
+
+    // Both currents reach mem_next scaled by tau_alpha
+    auto gradThroughMem =
+        popops::map(graph(), pe::Mul(pe::_1, pe::_2), {gradMemBase, tau}, prog,
+                    debugContext("AlphaStepGradThroughMem"));
+    auto gradSynExcBase = addCarriedGrad(1, rm == ns::Zero, gradThroughMem,
+                                         mem, threshold, prog, "SynExc");
+    auto gradSynInhBase = addCarriedGrad(2, rm != ns::None, gradThroughMem,
+                                         mem, threshold, prog, "SynInh");
+
+    // input enters syn_exc with +1 and syn_inh with -1
+    auto gradInput = popops::map(graph(), pe::Sub(pe::_1, pe::_2),
+                                 {gradSynExcBase, gradSynInhBase}, prog,
+                                 debugContext("AlphaStepGradInput"));
+    auto gradSynExc =
+        popops::map(graph(), pe::Mul(pe::_1, ns::clampUnit(pe::_2)),
+                    {gradSynExcBase, alpha}, prog,
+                    debugContext("AlphaStepGradSynExc"));
+    auto gradSynInh =
+        popops::map(graph(), pe::Mul(pe::_1, ns::clampUnit(pe::_2)),
+                    {gradSynInhBase, beta}, prog,
+                    debugContext("AlphaStepGradSynInh"));
+
+    // mem only decides the (detached) reset
+    auto gradMem = graph().clone(mem, debugContext("AlphaStepGradMem"));
+    popops::zero(graph(), gradMem, prog, debugContext("AlphaStepGradMem"));
+
+    // _1: gradSynBase, _2: syn, _3: gradMemBase, _4: syn_exc, _5: syn_inh,
+    // _6: alpha, _7: beta, _8: dTau
+    auto currentSum = pe::Add(pe::Mul(ns::clampUnit(pe::_6), pe::_4),
+                              pe::Mul(ns::clampUnit(pe::_7), pe::_5));
+    auto gradRateExpr = pe::Add(pe::Mul(pe::_1, pe::_2),
+                                pe::Mul(pe::Mul(pe::_3, currentSum), pe::_8));
+
+    auto gradAlpha = popops::map(graph(), gradRateExpr,
+                                 {gradSynExcBase, synExc, gradMemBase, synExc,
+                                  synInh, alpha, beta, dTauDAlpha},
+                                 prog, debugContext("AlphaStepGradAlpha"));
+    gradAlpha = ns::reduceToShape(graph(), gradAlpha, alphaIn.shape(),
+                                  alphaIn.elementType(), prog,
+                                  debugContext("AlphaStepGradAlphaReduce"));
+    ns::maskClampedGrad(graph(), gradAlpha, alphaIn, prog,
+                        debugContext("AlphaStepGradAlphaClamp"));
+
+    auto gradBeta = popops::map(graph(), gradRateExpr,
+                                {gradSynInhBase, synInh, gradMemBase, synExc,
+                                 synInh, alpha, beta, dTauDBeta},
+                                prog, debugContext("AlphaStepGradBeta"));
+    gradBeta = ns::reduceToShape(graph(), gradBeta, betaIn.shape(),
+                                 betaIn.elementType(), prog,
+                                 debugContext("AlphaStepGradBetaReduce"));
+    ns::maskClampedGrad(graph(), gradBeta, betaIn, prog,
+                        debugContext("AlphaStepGradBetaClamp"));
+
+    // The spike always sees -threshold; reset-by-subtraction takes
+    // -reset * threshold off syn_exc
+    poplar::Tensor gradThreshold;
+    if (rm == ns::Subtract && hasInput(1)) {
+      // _1: gradSpkU, _2: gradSynExcNext, _3: mem, _4: threshold
+      gradThreshold = popops::map(
+          graph(),
+          pe::Neg(pe::Add(pe::_1, pe::Select(pe::_2, pe::Const(0.0f),
+                                             pe::Gte(pe::_3, pe::_4)))),
+          {gradSpkU, getInTensor(1), mem, threshold}, prog,
+          debugContext("AlphaStepGradThreshold"));
+    } else {
+      gradThreshold = popops::map(graph(), pe::Neg(pe::_1), {gradSpkU}, prog,
+                                  debugContext("AlphaStepGradThreshold"));
+    }
+    gradThreshold = ns::reduceToShape(
+        graph(), gradThreshold, thresholdIn.shape(),
+        thresholdIn.elementType(), prog,
+        debugContext("AlphaStepGradThresholdReduce"));
+
+    setOutTensor(0, gradInput);
+    setOutTensor(1, gradSynExc);
+    setOutTensor(2, gradSynInh);
+    setOutTensor(3, gradMem);
+    setOutTensor(4, gradAlpha);
+    setOutTensor(5, gradBeta);
+    setOutTensor(6, gradThreshold);
+  }
+
+private:
+  // Gradient w.r.t. a pre-reset current: the contribution through mem_next
+  // plus the incoming gradient of the current's own output, which is
+  // dropped wherever the reset cleared that output.
+  poplar::Tensor addCarriedGrad(int gradOutIndex, bool masked,
+                                const poplar::Tensor &gradThroughMem,
+                                const poplar::Tensor &mem,
+                                const poplar::Tensor &threshold,
+                                poplar::program::Sequence &prog,
+                                const std::string &name) const {
+    if (!hasInput(gradOutIndex)) {
+      return gradThroughMem;
+    }
+    // _1: gradThroughMem, _2: gradOut, _3: mem, _4: threshold
+    std::unique_ptr<pe::Expr> carried = pe::_2.clone();
+    if (masked) {
+      carried = pe::Select(pe::Const(0.0f), pe::_2, pe::Gte(pe::_3, pe::_4))
+                    .clone();
+    }
+    return popops::map(graph(), pe::Add(pe::_1, *carried),
+                       {gradThroughMem, getInTensor(gradOutIndex), mem,
+                        threshold},
+                       prog, debugContext("AlphaStepGrad" + name + "Next"));
+  }
+};
+
+AlphaStepGradOp::AlphaStepGradOp(const AlphaStepOp &fwdOp)
+    : popart::Op(CustomGradOperators::AlphaStepGradId, fwdOp.settings),
+      resetMechanism(fwdOp.getResetMechanism()),
+      surrogate(fwdOp.getSurrogate()) {
+  for (int i = 0; i < 7; ++i) {
+    fwdInInfo.push_back(fwdOp.inInfo(i));
+  }
+}
+
+const std::vector<popart::GradInOutMapper> &
+AlphaStepGradOp::gradInputInfo() const {
+  static const std::vector<popart::GradInOutMapper> inInfo = {
+      {0, 0, popart::GradOpInType::GradOut},
+      {1, 1, popart::GradOpInType::GradOut},
+      {2, 2, popart::GradOpInType::GradOut},
+      {3, 3, popart::GradOpInType::GradOut},
+      {4, 0, popart::GradOpInType::In},
+      {5, 1, popart::GradOpInType::In},
+      {6, 2, popart::GradOpInType::In},
+      {7, 3, popart::GradOpInType::In},
+      {8, 4, popart::GradOpInType::In},
+      {9, 5, popart::GradOpInType::In},
+      {10, 6, popart::GradOpInType::In},
+      {11, 3, popart::GradOpInType::Out}};
+  return inInfo;
+}
+
+// The Grad Op has 7 outputs, one per forward input
+const std::map<int, int> &AlphaStepGradOp::gradOutToNonGradIn() const {
+  static const std::map<int, int> outInfo = {
+      {0, 0}, {1, 1}, {2, 2}, {3, 3}, {4, 4}, {5, 5}, {6, 6}};
+  return outInfo;
+}
+
+void AlphaStepGradOp::appendAttributes(popart::OpSerialiserBase &os) const {
+  Op::appendAttributes(os);
+  os.appendAttribute("reset_mechanism", getResetMechanism());
+  neuron_step::appendSurrogate(os, getSurrogate());
+}
+
+void AlphaStepGradOp::appendOutlineAttributes(
+    popart::OpSerialiserBase &os) const {
+  Op::appendOutlineAttributes(os);
+  os.appendAttribute("reset_mechanism", getResetMechanism());
+  neuron_step::appendSurrogate(os, getSurrogate());
+}
+
+static popart::popx::OpxCreator<AlphaStepOpx>
+    AlphaStepOpxCreator({CustomOperators::AlphaStepId});
+static popart::popx::OpxCreator<AlphaStepGradOpx>
+    AlphaStepGradOpxCreator({CustomGradOperators::AlphaStepGradId});
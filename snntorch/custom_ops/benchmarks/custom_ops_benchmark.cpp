@@ -0,0 +1,511 @@
+// Cycle counts and tile memory of every custom op, built through PopART on
+// the IPUModel, so that a change to an Opx's grow() shows up as a diff in the
+// numbers rather than on hardware.
+//
+// Usage: custom_ops_benchmark [libsnntorch_ipu_ops.so] [tiles,...]
+//                             [report directory] > custom_ops.csv
+//
+// Every case is a one-op ONNX model built with the popart Builder and run
+// once on an IPUModel with `tiles` tiles per IPU, for both FLOAT and FLOAT16
+// and several sizes. "forward" cases run an InferenceSession; "train" cases
+// put an L1 loss on the first output and run a TrainingSession, so they also
+// time the grad op. The numbers come from the Poplar profile:
+//
+//   vertex_cycles    cycles in compute sets (OnTileExecute)
+//   exchange_cycles  cycles in internal and global exchanges
+//   total_cycles     every program step, including syncs and stream copies
+//   max_tile_bytes   memory of the fullest tile, gaps included
+//   total_bytes      memory of all tiles, gaps included
+//
+// One CSV row is printed per case. As with spike_codelets_benchmark, the
+// IPUModel times vertices from their estimates; compare runs with each other
+// rather than with hardware.
+//
+// The "Inplace" cases feed the op an activation that nothing else reads, so
+// that PopART picks its inplace variant, and fail unless the Poplar graph
+// contains the in-place spike vertices.
+#include <popart/builder.hpp>
+#include <popart/dataflow.hpp>
+#include <popart/devicemanager.hpp>
+#include <popart/inputshapeinfo.hpp>
+#include <popart/ndarraywrapper.hpp>
+#include <popart/op.hpp>
+#include <popart/optimizer.hpp>
+#include <popart/session.hpp>
+#include <popart/sessionoptions.hpp>
+#include <popart/stepio.hpp>
+#include <popart/tensorinfo.hpp>
+
+#include <pva/pva.hpp>
+
+#include <dlfcn.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Neurons per row; a case of n elements is a [n / kNeurons, kNeurons] batch
+constexpr std::int64_t kNeurons = 256;
+// Time steps of the LeakySequence cases
+constexpr std::int64_t kSteps = 8;
+
+// Membrane-like values on both sides of a threshold of 1, as float and as
+// the bits of the same values in half precision
+constexpr std::int64_t kNumValues = 6;
+const float kValues[kNumValues] = {-1.0f, 0.0f, 0.5f, 0.75f, 1.0f, 2.0f};
+const std::uint16_t kHalfValues[kNumValues] = {0xBC00, 0x0000, 0x3800,
+                                               0x3A00, 0x3C00, 0x4000};
+
+popart::OperatorIdentifier customOp(const std::string &type) {
+  return {"custom.ops", type, 1};
+}
+
+// The half bits of one of kValues
+std::uint16_t halfBits(float value) {
+  auto it = std::find(std::begin(kValues), std::end(kValues), value);
+  return kHalfValues[it - std::begin(kValues)];
+}
+
+// Builds the model of one case, keeping the initial values of its tensors
+class Model {
+public:
+  explicit Model(popart::DataType type)
+      : builder(popart::Builder::create()), type(type) {}
+
+  // A weight of the case's float type, cycling through kValues
+  popart::TensorId tensor(const std::vector<std::int64_t> &shape) {
+    return weight(shape,
+                  [](std::int64_t i) { return kValues[i % kNumValues]; });
+  }
+
+  // A parameter holding `value`, one of kValues, in every element
+  popart::TensorId param(float value, std::int64_t n = 1) {
+    return weight({n}, [value](std::int64_t) { return value; });
+  }
+
+  // Packed spikes (see spike_pack.hpp), every other neuron firing
+  popart::TensorId words(const std::vector<std::int64_t> &shape) {
+    popart::TensorInfo info(popart::DataType::INT32, shape);
+    data.emplace_back(info.nbytes());
+    auto *w = reinterpret_cast<std::int32_t *>(data.back().data());
+    std::fill(w, w + info.nelms(), 0x55555555);
+    return builder->addInitializedInputTensor({data.back().data(), info});
+  }
+
+  std::vector<popart::TensorId>
+  op(const std::string &opType, const std::vector<popart::TensorId> &inputs,
+     unsigned numOutputs,
+     const std::map<std::string, popart::any> &attributes = {}) {
+    return builder->customOp(customOp(opType), 1, inputs, numOutputs,
+                             attributes, opType);
+  }
+
+  std::unique_ptr<popart::Builder> builder;
+  popart::DataType type;
+
+private:
+  popart::TensorId weight(const std::vector<std::int64_t> &shape,
+                          const std::function<float(std::int64_t)> &value) {
+    popart::TensorInfo info(type, shape);
+    data.emplace_back(info.nbytes());
+    auto *bytes = data.back().data();
+    for (std::int64_t i = 0; i < info.nelms(); ++i) {
+      if (type == popart::DataType::FLOAT16) {
+        reinterpret_cast<std::uint16_t *>(bytes)[i] = halfBits(value(i));
+      } else {
+        reinterpret_cast<float *>(bytes)[i] = value(i);
+      }
+    }
+    return builder->addInitializedInputTensor({bytes, info});
+  }
+
+  std::vector<std::vector<char>> data;
+};
+
+struct OpCase {
+  std::string name;
+  // whether the op has a grad op to time
+  bool train;
+  // Adds the op to the model for n elements, returns its first output
+  std::function<popart::TensorId(Model &, std::int64_t)> build;
+  // Vertices the graph of the forward and of the train pass must contain
+  std::vector<std::string> forwardVertices = {};
+  std::vector<std::string> trainVertices = {};
+};
+
+std::map<std::string, popart::any> neuronAttributes() {
+  return {{"reset_mechanism", std::int64_t(0)},
+          {"surrogate", std::string("fast_sigmoid")}};
+}
+
+std::vector<OpCase> opCases() {
+  auto spikeCase = [](const std::string &opType) {
+    return OpCase{opType, true, [opType](Model &m, std::int64_t n) {
+                    return m.op(opType, {m.tensor({n / kNeurons, kNeurons}),
+                                         m.param(1.0f)},
+                                2)[0];
+                  }};
+  };
+  // The spike op on x + x, which it may overwrite
+  auto inplaceCase = [](const std::string &opType, const std::string &grad) {
+    return OpCase{opType + "Inplace", true,
+                  [opType](Model &m, std::int64_t n) {
+                    auto x = m.tensor({n / kNeurons, kNeurons});
+                    auto sum = m.builder->aiOnnxOpset11().add({x, x});
+                    return m.op(opType, {sum, m.param(1.0f)}, 2)[0];
+                  },
+                  {"SpikeInPlace"},
+                  {grad}};
+  };
+  return {
+      spikeCase("Heaviside"),
+      inplaceCase("Heaviside", "HeavisideGradInPlace"),
+      spikeCase("StraightThroughEstimator"),
+      spikeCase("FastSigmoid"),
+      inplaceCase("FastSigmoid", "FastSigmoidGradInPlace"),
+      {"SurrogateSpike", true,
+       [](Model &m, std::int64_t n) {
+         return m.op("SurrogateSpike",
+                     {m.tensor({n / kNeurons, kNeurons}), m.param(1.0f)}, 2,
+                     {{"surrogate", std::string("atan")}})[0];
+       }},
+      {"InhibitedFire", true,
+       [](Model &m, std::int64_t n) {
+         return m.op("InhibitedFire",
+                     {m.tensor({n / kNeurons, kNeurons}), m.param(1.0f)}, 2,
+                     {{"surrogate", std::string("fast_sigmoid")}})[0];
+       }},
+      {"LeakyStep", true,
+       [](Model &m, std::int64_t n) {
+         std::vector<std::int64_t> shape = {n / kNeurons, kNeurons};
+         return m.op("LeakyStep",
+                     {m.tensor(shape), m.tensor(shape), m.param(0.5f),
+                      m.param(1.0f)},
+                     2, neuronAttributes())[0];
+       }},
+      {"LeakyStepUint8", false,
+       [](Model &m, std::int64_t n) {
+         std::vector<std::int64_t> shape = {n / kNeurons, kNeurons};
+         auto attributes = neuronAttributes();
+         attributes["spike_dtype"] = std::string("uint8");
+         return m.op("LeakyStep",
+                     {m.tensor(shape), m.tensor(shape), m.param(0.5f),
+                      m.param(1.0f)},
+                     2, attributes)[0];
+       }},
+      {"LeakySequence", true,
+       [](Model &m, std::int64_t n) {
+         std::vector<std::int64_t> shape = {n / kNeurons, kNeurons};
+         return m.op("LeakySequence",
+                     {m.tensor({kSteps, n / kNeurons, kNeurons}),
+                      m.tensor(shape), m.param(0.5f), m.param(1.0f)},
+                     2, neuronAttributes())[0];
+       }},
+      {"SynapticStep", true,
+       [](Model &m, std::int64_t n) {
+         std::vector<std::int64_t> shape = {n / kNeurons, kNeurons};
+         return m.op("SynapticStep",
+                     {m.tensor(shape), m.tensor(shape), m.tensor(shape),
+                      m.param(0.5f), m.param(0.5f), m.param(1.0f)},
+                     3, neuronAttributes())[0];
+       }},
+      {"AlphaStep", true,
+       [](Model &m, std::int64_t n) {
+         std::vector<std::int64_t> shape = {n / kNeurons, kNeurons};
+         return m.op("AlphaStep",
+                     {m.tensor(shape), m.tensor(shape), m.tensor(shape),
+                      m.tensor(shape), m.param(0.75f, kNeurons),
+                      m.param(0.5f, kNeurons), m.param(1.0f)},
+                     4, neuronAttributes())[0];
+       }},
+      {"SLSTMStep", true,
+       [](Model &m, std::int64_t n) {
+         std::vector<std::int64_t> shape = {n / kNeurons, kNeurons};
+         std::vector<std::int64_t> weights = {4 * kNeurons, kNeurons};
+         return m.op("SLSTMStep",
+                     {m.tensor(shape), m.tensor(shape), m.tensor(shape),
+                      m.tensor(weights), m.tensor(weights), m.param(1.0f),
+                      m.param(0.5f, 4 * kNeurons),
+                      m.param(0.5f, 4 * kNeurons)},
+                     3, neuronAttributes())[0];
+       }},
+      {"SConv2dLSTMStep", true,
+       [](Model &m, std::int64_t n) {
+         // 16 channels of 16 x 16 pixels per image, 3 x 3 kernel
+         std::vector<std::int64_t> shape = {n / 4096, 16, 16, 16};
+         return m.op("SConv2dLSTMStep",
+                     {m.tensor(shape), m.tensor(shape), m.tensor(shape),
+                      m.tensor({64, 32, 3, 3}), m.param(1.0f),
+                      m.param(0.5f, 64)},
+                     3, neuronAttributes())[0];
+       }},
+      {"RLeakyStep", true,
+       [](Model &m, std::int64_t n) {
+         std::vector<std::int64_t> shape = {n / kNeurons, kNeurons};
+         return m.op("RLeakyStep",
+                     {m.tensor(shape), m.tensor(shape), m.tensor(shape),
+                      m.param(0.5f, kNeurons), m.param(0.5f), m.param(1.0f)},
+                     2, neuronAttributes())[0];
+       }},
+      {"RLeakyStepDense", true,
+       [](Model &m, std::int64_t n) {
+         std::vector<std::int64_t> shape = {n / kNeurons, kNeurons};
+         return m.op("RLeakyStep",
+                     {m.tensor(shape), m.tensor(shape), m.tensor(shape),
+                      m.tensor({kNeurons, kNeurons}), m.param(0.5f),
+                      m.param(1.0f)},
+                     2, neuronAttributes())[0];
+       }},
+      {"RSynapticStep", true,
+       [](Model &m, std::int64_t n) {
+         std::vector<std::int64_t> shape = {n / kNeurons, kNeurons};
+         return m.op("RSynapticStep",
+                     {m.tensor(shape), m.tensor(shape), m.tensor(shape),
+                      m.tensor(shape), m.param(0.5f, kNeurons), m.param(0.5f),
+                      m.param(0.5f), m.param(1.0f)},
+                     3, neuronAttributes())[0];
+       }},
+      {"LapicqueStep", true,
+       [](Model &m, std::int64_t n) {
+         std::vector<std::int64_t> shape = {n / kNeurons, kNeurons};
+         auto attributes = neuronAttributes();
+         attributes["R"] = 5.0f;
+         attributes["C"] = 1.0f;
+         return m.op("LapicqueStep",
+                     {m.tensor(shape), m.tensor(shape), m.param(1.0f)}, 2,
+                     attributes)[0];
+       }},
+      {"LapicqueStepRC", true,
+       [](Model &m, std::int64_t n) {
+         std::vector<std::int64_t> shape = {n / kNeurons, kNeurons};
+         return m.op("LapicqueStep",
+                     {m.tensor(shape), m.tensor(shape), m.param(1.0f),
+                      m.param(5.0f, kNeurons), m.param(1.0f, kNeurons)},
+                     2, neuronAttributes())[0];
+       }},
+      {"AdaptiveLeakyStep", true,
+       [](Model &m, std::int64_t n) {
+         std::vector<std::int64_t> shape = {n / kNeurons, kNeurons};
+         return m.op("AdaptiveLeakyStep",
+                     {m.tensor(shape), m.tensor(shape), m.tensor(shape),
+                      m.param(0.5f), m.param(0.9f), m.param(1.0f),
+                      m.param(1.8f)},
+                     3, neuronAttributes())[0];
+       }},
+      {"RateEncode", false,
+       [](Model &m, std::int64_t n) {
+         return m.op("RateEncode", {m.tensor({n / kNeurons, kNeurons})}, 1,
+                     {{"num_steps", kSteps}})[0];
+       }},
+      {"LatencyEncode", false,
+       [](Model &m, std::int64_t n) {
+         return m.op("LatencyEncode", {m.tensor({n / kNeurons, kNeurons})}, 1,
+                     {{"num_steps", kSteps},
+                      {"normalize", std::int64_t(1)}})[0];
+       }},
+      {"DeltaEncode", false,
+       [](Model &m, std::int64_t n) {
+         return m.op("DeltaEncode",
+                     {m.tensor({kSteps, n / kNeurons / kSteps, kNeurons})}, 1,
+                     {{"off_spike", std::int64_t(1)}})[0];
+       }},
+      {"SpikePack", false,
+       [](Model &m, std::int64_t n) {
+         return m.op("SpikePack", {m.tensor({n / kNeurons, kNeurons})},
+                     1)[0];
+       }},
+      {"SpikeUnpack", false,
+       [](Model &m, std::int64_t n) {
+         return m.op("SpikeUnpack", {m.words({n / kNeurons, kNeurons / 32})},
+                     1,
+                     {{"size", kNeurons},
+                      {"to", std::int64_t(m.type == popart::DataType::FLOAT16
+                                              ? 10
+                                              : 1)}})[0];
+       }},
+      {"SpikeLinear", true,
+       [](Model &m, std::int64_t n) {
+         return m.op("SpikeLinear",
+                     {m.tensor({n / kNeurons, kNeurons}),
+                      m.tensor({kNeurons, kNeurons})},
+                     1)[0];
+       }},
+      {"SpikeLinearPacked", false,
+       [](Model &m, std::int64_t n) {
+         return m.op("SpikeLinear",
+                     {m.words({n / kNeurons, kNeurons / 32}),
+                      m.tensor({kNeurons, kNeurons})},
+                     1)[0];
+       }},
+  };
+}
+
+struct Result {
+  std::uint64_t vertexCycles = 0;
+  std::uint64_t exchangeCycles = 0;
+  std::uint64_t totalCycles = 0;
+  std::uint64_t maxTileBytes = 0;
+  std::uint64_t totalBytes = 0;
+};
+
+Result summarise(const pva::Report &report) {
+  Result r;
+  for (const auto &tile : report.compilation().tiles()) {
+    const std::uint64_t bytes = tile.memory().total().includingGaps();
+    r.maxTileBytes = std::max(r.maxTileBytes, bytes);
+    r.totalBytes += bytes;
+  }
+  for (const auto &step : report.execution().steps()) {
+    std::uint64_t cycles = 0;
+    for (const auto &ipu : step.ipus()) {
+      cycles = std::max<std::uint64_t>(cycles, ipu.cycles());
+    }
+    r.totalCycles += cycles;
+    switch (step.program()->type()) {
+    case pva::Program::Type::OnTileExecute:
+      r.vertexCycles += cycles;
+      break;
+    case pva::Program::Type::DoExchange:
+    case pva::Program::Type::GlobalExchange:
+      r.exchangeCycles += cycles;
+      break;
+    default:
+      break;
+    }
+  }
+  return r;
+}
+
+Result run(const OpCase &opCase, bool train, popart::DataType type,
+           std::int64_t n, unsigned tiles, const std::string &reportDir) {
+  Model m(type);
+  auto out = opCase.build(m, n);
+
+  popart::TensorId loss;
+  if (train) {
+    loss = m.builder->aiGraphcoreOpset1().l1loss({out}, 1.0f,
+                                                  popart::ReductionType::Sum);
+  }
+
+  popart::DataFlow dataFlow(1, {{out, popart::AnchorReturnType("All")}});
+
+  popart::SessionOptions opts;
+  opts.engineOptions = {{"autoReport.all", "true"},
+                        {"autoReport.directory", reportDir}};
+
+  auto device =
+      popart::DeviceManager::createDeviceManager().createIpuModelDevice(
+          std::map<std::string, std::string>{
+              {"numIPUs", "1"}, {"tilesPerIPU", std::to_string(tiles)}});
+
+  std::unique_ptr<popart::Session> session;
+  if (train) {
+    // A learning rate of 0 leaves the weights as they are
+    popart::ConstSGD optimizer(0.0f);
+    session = popart::TrainingSession::createFromOnnxModel(
+        m.builder->getModelProto(), dataFlow, loss, optimizer, device,
+        popart::InputShapeInfo(), opts);
+  } else {
+    session = popart::InferenceSession::createFromOnnxModel(
+        m.builder->getModelProto(), dataFlow, device,
+        popart::InputShapeInfo(), opts);
+  }
+  session->prepareDevice();
+  session->weightsFromHost();
+
+  // The output of the op is anchored so that it is not pruned
+  std::vector<char> anchor(session->getInfo(out).nbytes());
+  popart::NDArrayWrapper<char> anchorArray(anchor.data(),
+                                           session->getInfo(out));
+  std::map<popart::TensorId, popart::IArray &> inputs;
+  std::map<popart::TensorId, popart::IArray &> outputs = {{out, anchorArray}};
+  popart::StepIO stepio(inputs, outputs);
+  session->run(stepio);
+
+  // The serialised graph names the type of every vertex
+  const auto graph = session->getSerializedGraph();
+  for (const auto &vertex :
+       train ? opCase.trainVertices : opCase.forwardVertices) {
+    if (graph.find(vertex + "<") == std::string::npos) {
+      throw std::runtime_error("no " + vertex + " vertex in the graph");
+    }
+  }
+  return summarise(session->getReport());
+}
+
+std::vector<unsigned> parseTiles(const std::string &list) {
+  std::vector<unsigned> tiles;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    tiles.push_back(std::atoi(item.c_str()));
+  }
+  return tiles;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::string library =
+      argc > 1 ? argv[1] : "../../so_file/libsnntorch_ipu_ops.so";
+  const auto tileCounts = parseTiles(argc > 2 ? argv[2] : "4,64");
+  const std::string reportDir =
+      argc > 3 ? argv[3] : "custom_ops_benchmark_reports";
+
+  // Registers the ops, and lets them find spike_codelets.gp next to it
+  if (dlopen(library.c_str(), RTLD_NOW | RTLD_GLOBAL) == nullptr) {
+    std::cerr << "cannot load " << library << ": " << dlerror() << "\n";
+    return 1;
+  }
+
+  std::cout << "op,pass,type,elements,tiles,vertex_cycles,exchange_cycles,"
+               "total_cycles,max_tile_bytes,total_bytes\n";
+
+  const std::vector<popart::DataType> types = {popart::DataType::FLOAT,
+                                               popart::DataType::FLOAT16};
+  const std::vector<std::int64_t> sizes = {4096, 65536, 262144};
+  int failures = 0;
+  for (const auto &opCase : opCases()) {
+    for (bool train : {false, true}) {
+      if (train && !opCase.train) {
+        continue;
+      }
+      const std::string pass = train ? "train" : "forward";
+      for (auto type : types) {
+        const std::string typeName =
+            type == popart::DataType::FLOAT16 ? "half" : "float";
+        for (auto tiles : tileCounts) {
+          for (auto n : sizes) {
+            const std::string caseName = opCase.name + "_" + pass + "_" +
+                                         typeName + "_" + std::to_string(n) +
+                                         "_" + std::to_string(tiles);
+            try {
+              auto r = run(opCase, train, type, n, tiles,
+                           reportDir + "/" + caseName);
+              std::cout << opCase.name << "," << pass << "," << typeName
+                        << "," << n << "," << tiles << "," << r.vertexCycles
+                        << "," << r.exchangeCycles << "," << r.totalCycles
+                        << "," << r.maxTileBytes << "," << r.totalBytes
+                        << std::endl;
+            } catch (const std::exception &e) {
+              // e.g. a case that does not fit on this few tiles
+              std::cerr << caseName << ": " << e.what() << "\n";
+              ++failures;
+            }
+          }
+        }
+      }
+    }
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,195 @@
+// Cycle counts of the spike vertices in codelets/spike_codelets.cpp against
+// the popops expressions they replace, out of place and, as for the
+// inplace variants of the ops, in place.
+//
+// Usage: spike_codelets_benchmark [spike_codelets.gp] [tiles]
+//
+// Runs on an IPU when one can be attached, which times both. Otherwise it
+// runs on an IPUModel with `tiles` tiles, which times popops from its own
+// estimates and the spike vertices from the perf estimates that
+// spike_codelets.hpp derives from their inner loops, so the two columns
+// compare instruction counts rather than measurements.
+#include <poplar/CycleCount.hpp>
+#include <poplar/DeviceManager.hpp>
+#include <poplar/Engine.hpp>
+#include <poplar/Graph.hpp>
+#include <poplar/IPUModel.hpp>
+#include <popops/ElementWise.hpp>
+#include <popops/codelets.hpp>
+#include <poputil/TileMapping.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../spike_codelets.hpp"
+
+namespace pe = popops::expr;
+
+namespace {
+
+struct Case {
+  std::string name;
+  poplar::program::Sequence popops;
+  poplar::program::Sequence vertices;
+};
+
+// Wrap `body` in cycle counters on tile 0 and stream the count to the host
+poplar::program::Sequence timed(poplar::Graph &graph,
+                                poplar::program::Sequence body,
+                                const std::string &handle) {
+  auto cycles = poplar::cycleCount(graph, body, 0,
+                                   poplar::SyncType::INTERNAL, handle);
+  graph.createHostRead(handle, cycles);
+  return body;
+}
+
+std::uint64_t readCycles(poplar::Engine &engine, const std::string &handle) {
+  std::uint32_t cycles[2];
+  engine.readTensor(handle, cycles, cycles + 2);
+  return (std::uint64_t(cycles[1]) << 32) | cycles[0];
+}
+
+std::vector<Case> buildCases(poplar::Graph &graph, const poplar::Type &type,
+                             std::size_t n) {
+  auto in = graph.addVariable(type, {n}, "in");
+  auto grad = graph.addVariable(type, {n}, "grad");
+  auto threshold = graph.addVariable(type, {1}, "threshold");
+  poputil::mapTensorLinearly(graph, in);
+  poputil::mapTensorLinearly(graph, grad);
+  graph.setTileMapping(threshold, 0);
+  graph.setInitialValue(threshold, 1.0f);
+
+  // The tensors the in-place cases write over, mapped like `in` and `grad`
+  auto inOut = graph.clone(in, "inOut");
+  auto gradOut = graph.clone(grad, "gradOut");
+
+  auto thr = threshold.broadcast(n, 0);
+  std::vector<Case> cases(6);
+
+  cases[0].name = "Spike";
+  popops::map(graph,
+              pe::Select(pe::Const(0.0f), pe::Const(1.0f),
+                         pe::Lt(pe::_1, pe::_2)),
+              {in, thr}, cases[0].popops, "popops");
+  spike_codelets::spike(graph, in, threshold, cases[0].vertices, "vertices");
+
+  cases[1].name = "HeavisideGrad";
+  popops::map(graph,
+              pe::Mul(pe::Select(pe::Const(0.0f), pe::Const(1.0f),
+                                 pe::Lt(pe::Sub(pe::_2, pe::_3),
+                                        pe::Const(0.0f))),
+                      pe::_1),
+              {grad, in, thr}, cases[1].popops, "popops");
+  spike_codelets::heavisideGrad(graph, grad, in, threshold, cases[1].vertices,
+                                "vertices");
+
+  cases[2].name = "FastSigmoidGrad";
+  popops::map(graph,
+              pe::Divide(pe::_1,
+                         pe::Pow(pe::Add(pe::Abs(pe::Sub(pe::_2, pe::_3)),
+                                         pe::Const(1.0f)),
+                                 pe::Const(2.0f))),
+              {grad, in, thr}, cases[2].popops, "popops");
+  spike_codelets::fastSigmoidGrad(graph, grad, in, threshold, 1.0f,
+                                  cases[2].vertices, "vertices");
+
+  cases[3].name = "SpikeInPlace";
+  popops::mapInPlace(graph,
+                     pe::Select(pe::Const(0.0f), pe::Const(1.0f),
+                                pe::Lt(pe::_1, pe::_2)),
+                     {inOut, thr}, cases[3].popops, "popops");
+  spike_codelets::spikeInPlace(graph, inOut, threshold, cases[3].vertices,
+                               "vertices");
+
+  cases[4].name = "HeavisideGradInPlace";
+  popops::mapInPlace(graph,
+                     pe::Mul(pe::Select(pe::Const(0.0f), pe::Const(1.0f),
+                                        pe::Lt(pe::Sub(pe::_2, pe::_3),
+                                               pe::Const(0.0f))),
+                             pe::_1),
+                     {gradOut, in, thr}, cases[4].popops, "popops");
+  spike_codelets::heavisideGradInPlace(graph, gradOut, in, threshold,
+                                       cases[4].vertices, "vertices");
+
+  cases[5].name = "FastSigmoidGradInPlace";
+  popops::mapInPlace(
+      graph,
+      pe::Divide(pe::_1, pe::Pow(pe::Add(pe::Abs(pe::Sub(pe::_2, pe::_3)),
+                                         pe::Const(1.0f)),
+                                 pe::Const(2.0f))),
+      {gradOut, in, thr}, cases[5].popops, "popops");
+  spike_codelets::fastSigmoidGradInPlace(graph, gradOut, in, threshold, 1.0f,
+                                         cases[5].vertices, "vertices");
+  return cases;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::string codelets =
+      argc > 1 ? argv[1] : "../../so_file/spike_codelets.gp";
+  const unsigned tiles = argc > 2 ? std::atoi(argv[2]) : 4;
+
+  // An IPU if one can be attached, the IPUModel otherwise
+  auto devices = poplar::DeviceManager::createDeviceManager().getDevices(
+      poplar::TargetType::IPU, 1);
+  bool hardware = false;
+  poplar::Device device;
+  for (auto &candidate : devices) {
+    if (candidate.attach()) {
+      device = std::move(candidate);
+      hardware = true;
+      break;
+    }
+  }
+  if (!hardware) {
+    std::cerr << "no IPU attached: cycles are the IPUModel estimates\n";
+    poplar::IPUModel model;
+    model.numIPUs = 1;
+    model.tilesPerIPU = tiles;
+    device = model.createDevice();
+  }
+
+  std::cout << std::left << std::setw(24) << "op" << std::setw(8) << "type"
+            << std::right << std::setw(10) << "elements" << std::setw(12)
+            << "popops" << std::setw(12) << "vertices" << "\n";
+
+  const std::vector<poplar::Type> types = {poplar::FLOAT, poplar::HALF};
+  const std::vector<std::size_t> sizes = {1024, 16384, 262144};
+  for (const auto &type : types) {
+    for (auto n : sizes) {
+      poplar::Graph graph(device.getTarget());
+      popops::addCodelets(graph);
+      if (!spike_codelets::addCodelets(graph, codelets)) {
+        std::cerr << "cannot find " << codelets << "\n";
+        return 1;
+      }
+
+      auto cases = buildCases(graph, type, n);
+      std::vector<poplar::program::Program> progs;
+      for (auto &c : cases) {
+        progs.push_back(timed(graph, c.popops, c.name + "/popops"));
+        progs.push_back(timed(graph, c.vertices, c.name + "/vertices"));
+      }
+
+      poplar::Engine engine(graph, progs);
+      engine.load(device);
+      for (unsigned i = 0; i < progs.size(); ++i) {
+        engine.run(i);
+      }
+
+      for (const auto &c : cases) {
+        std::cout << std::left << std::setw(24) << c.name << std::setw(8)
+                  << (type == poplar::HALF ? "half" : "float") << std::right
+                  << std::setw(10) << n << std::setw(12)
+                  << readCycles(engine, c.name + "/popops") << std::setw(12)
+                  << readCycles(engine, c.name + "/vertices") << "\n";
+      }
+    }
+  }
+  return 0;
+}
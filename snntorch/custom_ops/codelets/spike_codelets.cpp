@@ -0,0 +1,575 @@
+// Vertices for the spike nonlinearity, its surrogate gradients and the
+// forward pass of the leaky neuron steps.
+//
+// Every vertex is a MultiVertex: the six workers of a tile stride over
+// 64-bit chunks of the flattened region (half4 / float2 on device), and
+// worker 0 handles the tail that does not fill a whole chunk. Keeping each
+// worker on whole 64-bit chunks means no two workers ever write the same
+// 32-bit word, which matters for half.
+//
+// The threshold field is either one element per output, or a single
+// element shared by the whole region.
+//
+// Each vertex has an InPlace form for the inplace variants of the ops, which
+// writes over its `in` (Spike) or `grad` field instead of an `out` field.
+//
+// The vectorised loops compare and then mask with a bitwise and, so a
+// neuron below threshold gives 0 even where grad is NaN or Inf, as in the
+// scalar selects. spike_codelets.hpp derives the perf estimates of the
+// vertices from these loops.
+//
+// Compiled with popc into spike_codelets.gp, see the custom_ops Makefile.
+#include <poplar/HalfFloat.hpp>
+#include <poplar/Vertex.hpp>
+
+#include <cmath>
+
+#ifdef __IPU__
+#include <ipu_vector_math>
+#endif
+
+using namespace poplar;
+
+static constexpr auto SPAN = VectorLayout::SPAN;
+
+// Number of elements of T in a 64-bit chunk
+template <typename T> struct Chunk;
+template <> struct Chunk<float> {
+  static constexpr unsigned width = 2;
+#ifdef __IPU__
+  using type = float2;
+#endif
+};
+template <> struct Chunk<half> {
+  static constexpr unsigned width = 4;
+#ifdef __IPU__
+  using type = half4;
+#endif
+};
+
+// Scalar forms, used for the tail and for CPU / IPUModel builds
+template <typename T> static inline T spike(T x, T threshold) {
+  return x < threshold ? T(0) : T(1);
+}
+
+template <typename T>
+static inline T heavisideGrad(T grad, T x, T threshold) {
+  return x < threshold ? T(0) : grad;
+}
+
+// grad / (slope * |x - threshold| + 1)^2, with the square as a multiply
+template <typename T>
+static inline T fastSigmoidGrad(T grad, T x, T threshold, T slope) {
+  T d = slope * T(std::fabs(float(x - threshold))) + T(1);
+  return grad / (d * d);
+}
+
+#ifdef __IPU__
+// The integer vector a compare of V gives, all ones in the lanes where it
+// holds
+template <typename V> struct Mask;
+template <> struct Mask<float2> {
+  using type = int2;
+};
+template <> struct Mask<half4> {
+  using type = short4;
+};
+
+// Lane-wise x >= threshold; `threshold` may be a vector or a scalar splat
+// across the lanes
+template <typename V, typename U>
+static inline typename Mask<V>::type fired(V x, U threshold) {
+  return x >= threshold;
+}
+
+// v in the lanes of `mask`, 0 elsewhere, whatever v holds there
+template <typename V>
+static inline V masked(V v, typename Mask<V>::type mask) {
+  using M = typename Mask<V>::type;
+  return (V)((M)v & mask);
+}
+#endif
+
+// The loops of worker `workerId` of `workers` over the n elements of a
+// region, shared by the vertices and their in-place forms. `out` may be one
+// of the inputs: every chunk is read before it is written.
+
+// out = in < threshold ? 0 : 1
+template <typename T>
+static inline void spikeLoop(const T *in, const T *threshold, bool shared,
+                             T *out, unsigned n, unsigned workerId,
+                             unsigned workers) {
+  constexpr unsigned W = Chunk<T>::width;
+  const unsigned chunks = n / W;
+#ifdef __IPU__
+  using V = typename Chunk<T>::type;
+  const V *inV = reinterpret_cast<const V *>(in);
+  const V *thrV = reinterpret_cast<const V *>(threshold);
+  V *outV = reinterpret_cast<V *>(out);
+  const V one = V{} + T(1);
+  if (shared) {
+    const T t = threshold[0];
+    for (unsigned i = workerId; i < chunks; i += workers) {
+      outV[i] = masked(one, fired(inV[i], t));
+    }
+  } else {
+    for (unsigned i = workerId; i < chunks; i += workers) {
+      outV[i] = masked(one, fired(inV[i], thrV[i]));
+    }
+  }
+#else
+  for (unsigned i = workerId; i < chunks; i += workers) {
+    for (unsigned j = i * W; j < (i + 1) * W; ++j) {
+      out[j] = spike(in[j], threshold[shared ? 0 : j]);
+    }
+  }
+#endif
+  if (workerId == 0) {
+    for (unsigned j = chunks * W; j < n; ++j) {
+      out[j] = spike(in[j], threshold[shared ? 0 : j]);
+    }
+  }
+}
+
+// out = in < threshold ? 0 : grad
+template <typename T>
+static inline void heavisideGradLoop(const T *grad, const T *in,
+                                     const T *threshold, bool shared, T *out,
+                                     unsigned n, unsigned workerId,
+                                     unsigned workers) {
+  constexpr unsigned W = Chunk<T>::width;
+  const unsigned chunks = n / W;
+#ifdef __IPU__
+  using V = typename Chunk<T>::type;
+  const V *gradV = reinterpret_cast<const V *>(grad);
+  const V *inV = reinterpret_cast<const V *>(in);
+  const V *thrV = reinterpret_cast<const V *>(threshold);
+  V *outV = reinterpret_cast<V *>(out);
+  if (shared) {
+    const T t = threshold[0];
+    for (unsigned i = workerId; i < chunks; i += workers) {
+      outV[i] = masked(gradV[i], fired(inV[i], t));
+    }
+  } else {
+    for (unsigned i = workerId; i < chunks; i += workers) {
+      outV[i] = masked(gradV[i], fired(inV[i], thrV[i]));
+    }
+  }
+#else
+  for (unsigned i = workerId; i < chunks; i += workers) {
+    for (unsigned j = i * W; j < (i + 1) * W; ++j) {
+      out[j] = heavisideGrad(grad[j], in[j], threshold[shared ? 0 : j]);
+    }
+  }
+#endif
+  if (workerId == 0) {
+    for (unsigned j = chunks * W; j < n; ++j) {
+      out[j] = heavisideGrad(grad[j], in[j], threshold[shared ? 0 : j]);
+    }
+  }
+}
+
+// out = grad / (slope * |in - threshold| + 1)^2
+template <typename T>
+static inline void fastSigmoidGradLoop(const T *grad, const T *in,
+                                       const T *threshold, bool shared,
+                                       float slope, T *out, unsigned n,
+                                       unsigned workerId, unsigned workers) {
+  constexpr unsigned W = Chunk<T>::width;
+  const unsigned chunks = n / W;
+  const T k = T(slope);
+#ifdef __IPU__
+  using V = typename Chunk<T>::type;
+  const V *gradV = reinterpret_cast<const V *>(grad);
+  const V *inV = reinterpret_cast<const V *>(in);
+  const V *thrV = reinterpret_cast<const V *>(threshold);
+  V *outV = reinterpret_cast<V *>(out);
+  if (shared) {
+    const T t = threshold[0];
+    for (unsigned i = workerId; i < chunks; i += workers) {
+      V d = k * ipu::fabs(inV[i] - t) + T(1);
+      outV[i] = gradV[i] / (d * d);
+    }
+  } else {
+    for (unsigned i = workerId; i < chunks; i += workers) {
+      V d = k * ipu::fabs(inV[i] - thrV[i]) + T(1);
+      outV[i] = gradV[i] / (d * d);
+    }
+  }
+#else
+  for (unsigned i = workerId; i < chunks; i += workers) {
+    for (unsigned j = i * W; j < (i + 1) * W; ++j) {
+      out[j] = fastSigmoidGrad(grad[j], in[j], threshold[shared ? 0 : j], k);
+    }
+  }
+#endif
+  if (workerId == 0) {
+    for (unsigned j = chunks * W; j < n; ++j) {
+      out[j] = fastSigmoidGrad(grad[j], in[j], threshold[shared ? 0 : j], k);
+    }
+  }
+}
+
+template <typename T> class Spike : public MultiVertex {
+public:
+  Input<Vector<T, SPAN, 8>> in;
+  Input<Vector<T, SPAN, 8>> threshold;
+  Output<Vector<T, SPAN, 8>> out;
+
+  bool compute(unsigned workerId) {
+    spikeLoop(&in[0], &threshold[0], threshold.size() == 1, &out[0],
+              out.size(), workerId, numWorkers());
+    return true;
+  }
+};
+
+template class Spike<float>;
+template class Spike<half>;
+
+// Spike writing the spikes over `in`
+template <typename T> class SpikeInPlace : public MultiVertex {
+public:
+  InOut<Vector<T, SPAN, 8>> in;
+  Input<Vector<T, SPAN, 8>> threshold;
+
+  bool compute(unsigned workerId) {
+    spikeLoop(&in[0], &threshold[0], threshold.size() == 1, &in[0], in.size(),
+              workerId, numWorkers());
+    return true;
+  }
+};
+
+template class SpikeInPlace<float>;
+template class SpikeInPlace<half>;
+
+template <typename T> class HeavisideGrad : public MultiVertex {
+public:
+  Input<Vector<T, SPAN, 8>> grad;
+  Input<Vector<T, SPAN, 8>> in;
+  Input<Vector<T, SPAN, 8>> threshold;
+  Output<Vector<T, SPAN, 8>> out;
+
+  bool compute(unsigned workerId) {
+    heavisideGradLoop(&grad[0], &in[0], &threshold[0], threshold.size() == 1,
+                      &out[0], out.size(), workerId, numWorkers());
+    return true;
+  }
+};
+
+template class HeavisideGrad<float>;
+template class HeavisideGrad<half>;
+
+// HeavisideGrad writing the gradient over `grad`
+template <typename T> class HeavisideGradInPlace : public MultiVertex {
+public:
+  InOut<Vector<T, SPAN, 8>> grad;
+  Input<Vector<T, SPAN, 8>> in;
+  Input<Vector<T, SPAN, 8>> threshold;
+
+  bool compute(unsigned workerId) {
+    heavisideGradLoop(&grad[0], &in[0], &threshold[0], threshold.size() == 1,
+                      &grad[0], grad.size(), workerId, numWorkers());
+    return true;
+  }
+};
+
+template class HeavisideGradInPlace<float>;
+template class HeavisideGradInPlace<half>;
+
+template <typename T> class FastSigmoidGrad : public MultiVertex {
+public:
+  Input<Vector<T, SPAN, 8>> grad;
+  Input<Vector<T, SPAN, 8>> in;
+  Input<Vector<T, SPAN, 8>> threshold;
+  Output<Vector<T, SPAN, 8>> out;
+  const float slope;
+
+  bool compute(unsigned workerId) {
+    fastSigmoidGradLoop(&grad[0], &in[0], &threshold[0],
+                        threshold.size() == 1, slope, &out[0], out.size(),
+                        workerId, numWorkers());
+    return true;
+  }
+};
+
+template class FastSigmoidGrad<float>;
+template class FastSigmoidGrad<half>;
+
+// FastSigmoidGrad writing the gradient over `grad`
+template <typename T> class FastSigmoidGradInPlace : public MultiVertex {
+public:
+  InOut<Vector<T, SPAN, 8>> grad;
+  Input<Vector<T, SPAN, 8>> in;
+  Input<Vector<T, SPAN, 8>> threshold;
+  const float slope;
+
+  bool compute(unsigned workerId) {
+    fastSigmoidGradLoop(&grad[0], &in[0], &threshold[0],
+                        threshold.size() == 1, slope, &grad[0], grad.size(),
+                        workerId, numWorkers());
+    return true;
+  }
+};
+
+template class FastSigmoidGradInPlace<float>;
+template class FastSigmoidGradInPlace<half>;
+
+// The neuron steps below fuse the state update and the spike into one
+// vertex writing every output, where the popops path runs one map per
+// output and reads the new state back. R is the reset mechanism, numbered
+// as neuron_step::ResetMechanism. beta, rho, threshold and beta_a are
+// per-element fields or a single element shared by the region.
+enum Reset : unsigned { Subtract = 0, Zero = 1, None = 2 };
+
+template <typename T> static inline T clampUnit(T x) {
+  return T(std::fmin(std::fmax(float(x), 0.0f), 1.0f));
+}
+
+// base after the reset decided by `fired`
+template <unsigned R, typename T>
+static inline T applyReset(T base, bool fired, T threshold) {
+  if (R == Subtract) {
+    return fired ? base - threshold : base;
+  }
+  if (R == Zero) {
+    return fired ? T(0) : base;
+  }
+  return base;
+}
+
+// A per-element or shared field of a neuron vertex
+template <typename T> struct Param {
+  const T *p;
+  bool shared;
+
+  T operator[](unsigned j) const { return p[shared ? 0 : j]; }
+
+#ifdef __IPU__
+  using V = typename Chunk<T>::type;
+  V chunk(unsigned i) const {
+    return shared ? V{} + p[0] : reinterpret_cast<const V *>(p)[i];
+  }
+#endif
+};
+
+// The Param of a field connected in addVertices (spike_codelets.hpp)
+template <typename T, typename F> static inline Param<T> param(const F &field) {
+  return {&field[0], field.size() == 1};
+}
+
+#ifdef __IPU__
+template <typename V> static inline V clampUnit(V x, V one) {
+  return ipu::fmin(ipu::fmax(x, V{}), one);
+}
+
+template <unsigned R, typename V>
+static inline V applyReset(V base, typename Mask<V>::type fired,
+                           V threshold) {
+  if (R == Subtract) {
+    return base - masked(threshold, fired);
+  }
+  if (R == Zero) {
+    return masked(base, ~fired);
+  }
+  return base;
+}
+#endif
+
+// mem_next = clamp(beta, 0, 1) * mem + in, reset where mem >= threshold;
+// spk = mem_next >= threshold, as neuron_step::leakyMemNext
+template <unsigned R, typename T>
+static inline void leakyStep(T in, T mem, T beta, T threshold, T &spk,
+                             T &memNext) {
+  memNext = applyReset<R>(clampUnit(beta) * mem + in, !(mem < threshold),
+                          threshold);
+  spk = spike(memNext, threshold);
+}
+
+template <typename T, unsigned R> class LeakyStep : public MultiVertex {
+public:
+  Input<Vector<T, SPAN, 8>> in;
+  Input<Vector<T, SPAN, 8>> mem;
+  Input<Vector<T, SPAN, 8>> beta;
+  Input<Vector<T, SPAN, 8>> threshold;
+  Output<Vector<T, SPAN, 8>> spk;
+  Output<Vector<T, SPAN, 8>> memNext;
+
+  bool compute(unsigned workerId) {
+    constexpr unsigned W = Chunk<T>::width;
+    const unsigned n = memNext.size();
+    const unsigned chunks = n / W;
+    const auto b = param<T>(beta);
+    const auto t = param<T>(threshold);
+#ifdef __IPU__
+    using V = typename Chunk<T>::type;
+    const V *inV = reinterpret_cast<const V *>(&in[0]);
+    const V *memV = reinterpret_cast<const V *>(&mem[0]);
+    V *spkV = reinterpret_cast<V *>(&spk[0]);
+    V *memNextV = reinterpret_cast<V *>(&memNext[0]);
+    const V one = V{} + T(1);
+    for (unsigned i = workerId; i < chunks; i += numWorkers()) {
+      const V m = memV[i];
+      const V ti = t.chunk(i);
+      const V next = applyReset<R>(clampUnit(b.chunk(i), one) * m + inV[i],
+                                   fired(m, ti), ti);
+      memNextV[i] = next;
+      spkV[i] = masked(one, fired(next, ti));
+    }
+#else
+    for (unsigned i = workerId; i < chunks; i += numWorkers()) {
+      for (unsigned j = i * W; j < (i + 1) * W; ++j) {
+        leakyStep<R>(in[j], mem[j], b[j], t[j], spk[j], memNext[j]);
+      }
+    }
+#endif
+    if (workerId == 0) {
+      for (unsigned j = chunks * W; j < n; ++j) {
+        leakyStep<R>(in[j], mem[j], b[j], t[j], spk[j], memNext[j]);
+      }
+    }
+    return true;
+  }
+};
+
+template class LeakyStep<float, Subtract>;
+template class LeakyStep<float, Zero>;
+template class LeakyStep<float, None>;
+template class LeakyStep<half, Subtract>;
+template class LeakyStep<half, Zero>;
+template class LeakyStep<half, None>;
+
+// The leaky step against the threshold threshold + beta_a * a, which the
+// adaptation a_next = clamp(rho, 0, 1) * a + (mem >= it) then raises for
+// the spike, as AdaptiveLeakyStepOpx
+template <unsigned R, typename T>
+static inline void adaptiveLeakyStep(T in, T mem, T a, T beta, T rho,
+                                     T threshold, T betaA, T &spk,
+                                     T &memNext, T &aNext) {
+  const T adapted = threshold + betaA * a;
+  const bool fired = !(mem < adapted);
+  memNext = applyReset<R>(clampUnit(beta) * mem + in, fired, adapted);
+  aNext = clampUnit(rho) * a + (fired ? T(1) : T(0));
+  spk = spike(memNext, threshold + betaA * aNext);
+}
+
+template <typename T, unsigned R>
+class AdaptiveLeakyStep : public MultiVertex {
+public:
+  Input<Vector<T, SPAN, 8>> in;
+  Input<Vector<T, SPAN, 8>> mem;
+  Input<Vector<T, SPAN, 8>> a;
+  Input<Vector<T, SPAN, 8>> beta;
+  Input<Vector<T, SPAN, 8>> rho;
+  Input<Vector<T, SPAN, 8>> threshold;
+  Input<Vector<T, SPAN, 8>> betaA;
+  Output<Vector<T, SPAN, 8>> spk;
+  Output<Vector<T, SPAN, 8>> memNext;
+  Output<Vector<T, SPAN, 8>> aNext;
+
+  bool compute(unsigned workerId) {
+    constexpr unsigned W = Chunk<T>::width;
+    const unsigned n = memNext.size();
+    const unsigned chunks = n / W;
+    const auto b = param<T>(beta);
+    const auto r = param<T>(rho);
+    const auto t = param<T>(threshold);
+    const auto ba = param<T>(betaA);
+#ifdef __IPU__
+    using V = typename Chunk<T>::type;
+    const V *inV = reinterpret_cast<const V *>(&in[0]);
+    const V *memV = reinterpret_cast<const V *>(&mem[0]);
+    const V *aV = reinterpret_cast<const V *>(&a[0]);
+    V *spkV = reinterpret_cast<V *>(&spk[0]);
+    V *memNextV = reinterpret_cast<V *>(&memNext[0]);
+    V *aNextV = reinterpret_cast<V *>(&aNext[0]);
+    const V one = V{} + T(1);
+    for (unsigned i = workerId; i < chunks; i += numWorkers()) {
+      const V m = memV[i];
+      const V ai = aV[i];
+      const V ti = t.chunk(i);
+      const V bai = ba.chunk(i);
+      const V adapted = ti + bai * ai;
+      const auto f = fired(m, adapted);
+      const V next = applyReset<R>(clampUnit(b.chunk(i), one) * m + inV[i],
+                                   f, adapted);
+      const V an = clampUnit(r.chunk(i), one) * ai + masked(one, f);
+      memNextV[i] = next;
+      aNextV[i] = an;
+      spkV[i] = masked(one, fired(next, ti + bai * an));
+    }
+#else
+    for (unsigned i = workerId; i < chunks; i += numWorkers()) {
+      for (unsigned j = i * W; j < (i + 1) * W; ++j) {
+        adaptiveLeakyStep<R>(in[j], mem[j], a[j], b[j], r[j], t[j], ba[j],
+                             spk[j], memNext[j], aNext[j]);
+      }
+    }
+#endif
+    if (workerId == 0) {
+      for (unsigned j = chunks * W; j < n; ++j) {
+        adaptiveLeakyStep<R>(in[j], mem[j], a[j], b[j], r[j], t[j], ba[j],
+                             spk[j], memNext[j], aNext[j]);
+      }
+    }
+    return true;
+  }
+};
+
+template class AdaptiveLeakyStep<float, Subtract>;
+template class AdaptiveLeakyStep<float, Zero>;
+template class AdaptiveLeakyStep<float, None>;
+template class AdaptiveLeakyStep<half, Subtract>;
+template class AdaptiveLeakyStep<half, Zero>;
+template class AdaptiveLeakyStep<half, None>;
+
+// Spikes packed 32 to an int word, neuron j of the region in bit j % 32 of
+// word j / 32. A region always starts on a word boundary; the last word of
+// a region may be partly filled, its high bits are zero. Workers take whole
+// words, so they never share an output word.
+template <typename T> class SpikePack : public MultiVertex {
+public:
+  Input<Vector<T, SPAN, 8>> in;
+  Input<Vector<T, SPAN, 8>> threshold;
+  Output<Vector<int, SPAN, 4>> out;
+
+  bool compute(unsigned workerId) {
+    const bool shared = threshold.size() == 1;
+    for (unsigned w = workerId; w < out.size(); w += numWorkers()) {
+      const unsigned begin = w * 32;
+      const unsigned end = begin + 32 < in.size() ? begin + 32 : in.size();
+      unsigned word = 0;
+      for (unsigned j = begin; j < end; ++j) {
+        word |= unsigned(!(in[j] < threshold[shared ? 0 : j])) << (j - begin);
+      }
+      out[w] = int(word);
+    }
+    return true;
+  }
+};
+
+template class SpikePack<float>;
+template class SpikePack<half>;
+
+// The inverse of SpikePack: out[j] = bit j % 32 of in[j / 32] as 0 / 1.
+// Worker boundaries fall every 32 elements, so two workers never write the
+// same 32-bit word of a half output.
+template <typename T> class SpikeUnpack : public MultiVertex {
+public:
+  Input<Vector<int, SPAN, 4>> in;
+  Output<Vector<T, SPAN, 8>> out;
+
+  bool compute(unsigned workerId) {
+    for (unsigned w = workerId; w < in.size(); w += numWorkers()) {
+      const unsigned word = unsigned(in[w]);
+      const unsigned begin = w * 32;
+      const unsigned end = begin + 32 < out.size() ? begin + 32 : out.size();
+      for (unsigned j = begin; j < end; ++j) {
+        out[j] = T(float((word >> (j - begin)) & 1u));
+      }
+    }
+    return true;
+  }
+};
+
+template class SpikeUnpack<float>;
+template class SpikeUnpack<half>;
@@ -0,0 +1,224 @@
+// Event-driven spike x weight products for SpikeLinear.
+//
+// Each tile owns a slab of the output columns and holds that slab of every
+// weight row. For each row of spikes the vertices walk only the neurons that
+// fired and add (or accumulate into) their weight rows, so the work follows
+// the number of spikes rather than the layer width. Dense spikes (any
+// non-zero value counts as a spike) are first turned into index lists by
+// SpikeIndices, once per row rather than once per slab; spikes packed as in
+// spike_pack.hpp give the firing neurons straight out of their set bits.
+//
+// Sums are accumulated in float and rounded to the output type once.
+//
+// Compiled with popc into spike_codelets.gp, see the custom_ops Makefile.
+#include <poplar/HalfFloat.hpp>
+#include <poplar/Vertex.hpp>
+
+using namespace poplar;
+
+static constexpr auto ONE_PTR = VectorLayout::ONE_PTR;
+static constexpr auto DELTAN = VectorListLayout::DELTANELEMENTS;
+
+// Elements per row of spikes for `n` neurons: an index list holds the count
+// and up to n indices, padded to whole 32-bit words so that workers writing
+// different rows never share one
+template <typename S> static inline unsigned rowLength(unsigned n) {
+  constexpr unsigned perWord = 4 / sizeof(S);
+  return (n + perWord) / perWord * perWord;
+}
+template <> inline unsigned rowLength<int>(unsigned n) { return (n + 31) / 32; }
+
+// Call `f(j)` for every neuron j that fired in one row of an index list
+template <typename S, typename F>
+static inline void forEachSpike(const S *row, unsigned, F f) {
+  const unsigned count = row[0];
+  for (unsigned k = 1; k <= count; ++k) {
+    f(unsigned(row[k]));
+  }
+}
+
+// ... or of packed words
+template <typename F>
+static inline void forEachSpike(const int *row, unsigned n, F f) {
+  for (unsigned w = 0; w < rowLength<int>(n); ++w) {
+    unsigned bits = unsigned(row[w]);
+    while (bits != 0) {
+      f(w * 32 + __builtin_ctz(bits));
+      bits &= bits - 1;
+    }
+  }
+}
+
+// The index list of each of `rows` rows of n dense spikes of type D: the
+// number of neurons that fired, then their indices. Workers take whole rows.
+template <typename D, typename S> class SpikeIndices : public MultiVertex {
+public:
+  Input<Vector<D, ONE_PTR, 4>> spikes;
+  Output<Vector<S, ONE_PTR, 4>> indices;
+  const unsigned rows;
+  const unsigned n;
+
+  bool compute(unsigned workerId) {
+    for (unsigned b = workerId; b < rows; b += numWorkers()) {
+      const D *row = &spikes[b * n];
+      S *list = &indices[b * rowLength<S>(n)];
+      unsigned count = 0;
+      for (unsigned j = 0; j < n; ++j) {
+        if (float(row[j]) != 0.0f) {
+          list[++count] = S(j);
+        }
+      }
+      list[0] = S(count);
+    }
+    return true;
+  }
+};
+
+template class SpikeIndices<float, unsigned short>;
+template class SpikeIndices<half, unsigned short>;
+template class SpikeIndices<bool, unsigned short>;
+template class SpikeIndices<unsigned char, unsigned short>;
+template class SpikeIndices<float, unsigned>;
+template class SpikeIndices<half, unsigned>;
+template class SpikeIndices<bool, unsigned>;
+template class SpikeIndices<unsigned char, unsigned>;
+
+// Output columns summed at a time in float registers
+static constexpr unsigned COLUMNS = 16;
+
+// out[b, :width] = sum of weights[j] over the neurons j that fired in row b.
+// Workers take whole rows; `stride` is even so that rows of a half output
+// never share a 32-bit word. Each run of COLUMNS columns is summed in float
+// over the row's spikes and rounded once.
+template <typename T, typename S> class SpikeLinear : public MultiVertex {
+public:
+  Input<Vector<S, ONE_PTR, 4>> spikes;
+  Input<VectorList<T, DELTAN>> weights;
+  Output<Vector<T, ONE_PTR, 4>> out;
+  const unsigned rows;
+  const unsigned width;
+  const unsigned stride;
+
+  bool compute(unsigned workerId) {
+    const unsigned n = weights.size();
+    for (unsigned b = workerId; b < rows; b += numWorkers()) {
+      const S *row = &spikes[b * rowLength<S>(n)];
+      T *o = &out[b * stride];
+      for (unsigned c0 = 0; c0 < width; c0 += COLUMNS) {
+        const unsigned k = width - c0 < COLUMNS ? width - c0 : COLUMNS;
+        float acc[COLUMNS] = {};
+        forEachSpike(row, n, [&](unsigned j) {
+          const T *w = &weights[j][c0];
+          for (unsigned c = 0; c < k; ++c) {
+            acc[c] += float(w[c]);
+          }
+        });
+        for (unsigned c = 0; c < k; ++c) {
+          o[c0 + c] = T(acc[c]);
+        }
+      }
+    }
+    return true;
+  }
+};
+
+template class SpikeLinear<float, unsigned short>;
+template class SpikeLinear<half, unsigned short>;
+template class SpikeLinear<float, unsigned>;
+template class SpikeLinear<half, unsigned>;
+template class SpikeLinear<float, int>;
+template class SpikeLinear<half, int>;
+
+// The columns [begin, end) of `width` of this worker, on even boundaries
+// for half
+static inline bool workerColumns(unsigned workerId, unsigned workers,
+                                 unsigned width, unsigned &begin,
+                                 unsigned &end) {
+  unsigned perWorker = (width + workers - 1) / workers;
+  perWorker += perWorker % 2;
+  begin = workerId * perWorker;
+  end = begin + perWorker < width ? begin + perWorker : width;
+  return begin < end;
+}
+
+// row(j)[begin:end] = sum of grad[b, begin:end] over the rows b in which
+// neuron j fired, accumulated in float rows
+template <typename T, typename S, typename Row>
+static inline void accumulateWeightGrad(const S *spikes, const T *grad,
+                                        unsigned rows, unsigned n,
+                                        unsigned width, unsigned begin,
+                                        unsigned end, Row row) {
+  for (unsigned j = 0; j < n; ++j) {
+    float *o = row(j);
+    for (unsigned c = begin; c < end; ++c) {
+      o[c] = 0.0f;
+    }
+  }
+  for (unsigned b = 0; b < rows; ++b) {
+    const T *g = &grad[b * width];
+    forEachSpike(&spikes[b * rowLength<S>(n)], n, [&](unsigned j) {
+      float *o = row(j);
+      for (unsigned c = begin; c < end; ++c) {
+        o[c] += float(g[c]);
+      }
+    });
+  }
+}
+
+// out[j, :width] = sum of grad[b, :width] over the rows b in which neuron j
+// fired. Any row of `out` can be hit by any spike, so workers split the
+// columns instead. A float output is its own accumulator.
+template <typename T, typename S>
+class SpikeLinearWeightGrad : public MultiVertex {
+public:
+  Input<Vector<S, ONE_PTR, 4>> spikes;
+  Input<Vector<T, ONE_PTR, 4>> grad;
+  Output<VectorList<T, DELTAN>> out;
+  const unsigned rows;
+  const unsigned width;
+
+  bool compute(unsigned workerId) {
+    unsigned begin, end;
+    if (!workerColumns(workerId, numWorkers(), width, begin, end)) {
+      return true;
+    }
+    accumulateWeightGrad(&spikes[0], &grad[0], rows, out.size(), width, begin,
+                         end, [&](unsigned j) { return &out[j][0]; });
+    return true;
+  }
+};
+
+// A half output is summed in the [n, width] float `acc`, then rounded once
+template <typename S>
+class SpikeLinearWeightGrad<half, S> : public MultiVertex {
+public:
+  Input<Vector<S, ONE_PTR, 4>> spikes;
+  Input<Vector<half, ONE_PTR, 4>> grad;
+  Output<VectorList<half, DELTAN>> out;
+  Output<Vector<float, ONE_PTR, 4>> acc;
+  const unsigned rows;
+  const unsigned width;
+
+  bool compute(unsigned workerId) {
+    unsigned begin, end;
+    if (!workerColumns(workerId, numWorkers(), width, begin, end)) {
+      return true;
+    }
+    const unsigned n = out.size();
+    accumulateWeightGrad(&spikes[0], &grad[0], rows, n, width, begin, end,
+                         [&](unsigned j) { return &acc[j * width]; });
+    for (unsigned j = 0; j < n; ++j) {
+      for (unsigned c = begin; c < end; ++c) {
+        out[j][c] = half(acc[j * width + c]);
+      }
+    }
+    return true;
+  }
+};
+
+template class SpikeLinearWeightGrad<float, unsigned short>;
+template class SpikeLinearWeightGrad<half, unsigned short>;
+template class SpikeLinearWeightGrad<float, unsigned>;
+template class SpikeLinearWeightGrad<half, unsigned>;
+template class SpikeLinearWeightGrad<float, int>;
+template class SpikeLinearWeightGrad<half, int>;
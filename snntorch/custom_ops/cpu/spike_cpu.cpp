@@ -0,0 +1,163 @@
+// CPU implementations of the spike ops, registered with torch as
+// torch.ops.snntorch_cpu.*. snntorch.cpu loads them and wraps them in
+// autograd functions; the models pick them instead of the PopART custom ops
+// when they do not run on an IPU.
+//
+//   spike(input, threshold)                   Heaviside / STE / FastSigmoid
+//   surrogate_grad(grad, input, threshold, surrogate, slope, beta)
+//   leaky_step(input, mem, beta, threshold, reset_mechanism)
+//   leaky_step_backward(grad_spk, grad_mem_next, mem, beta, threshold,
+//                       mem_next, reset_mechanism, surrogate, slope,
+//                       surrogate_beta)
+//
+// threshold and beta hold one value or one per neuron. The kernels work in
+// float32; other floating types are computed in float32 and cast back.
+// leaky_step_backward returns the beta and threshold gradients per neuron,
+// before they are summed to the parameter shapes.
+#include <ATen/ATen.h>
+#include <torch/library.h>
+
+#include <string>
+#include <tuple>
+
+#include "spike_kernels.hpp"
+
+namespace sk = spike_kernels;
+
+namespace {
+
+at::Tensor asFloat(const at::Tensor &t) {
+  return t.to(at::kFloat).contiguous();
+}
+
+// `t` broadcast against `like`, keeping single values unexpanded.
+// `storage` keeps the converted tensor alive.
+sk::Param param(const at::Tensor &t, const at::Tensor &like,
+                at::Tensor &storage) {
+  if (t.numel() == 1) {
+    storage = asFloat(t);
+    return {storage.data_ptr<float>(), 0};
+  }
+  storage = asFloat(t.expand_as(like));
+  return {storage.data_ptr<float>(), 1};
+}
+
+sk::Surrogate surrogate(const std::string &name, double slope, double beta) {
+  sk::Surrogate s;
+  TORCH_CHECK(sk::parseSurrogate(name, s.kind),
+              "snntorch_cpu: unknown surrogate '", name, "'");
+  s.slope = static_cast<float>(slope);
+  s.beta = static_cast<float>(beta);
+  return s;
+}
+
+void checkResetMechanism(int64_t resetMechanism) {
+  TORCH_CHECK(resetMechanism >= sk::Subtract && resetMechanism <= sk::None,
+              "snntorch_cpu: reset_mechanism must be 0 (subtract), 1 (zero) "
+              "or 2 (none), got ",
+              resetMechanism);
+}
+
+at::Tensor spike(const at::Tensor &input, const at::Tensor &threshold) {
+  auto x = asFloat(input);
+  at::Tensor thrStorage;
+  auto thr = param(threshold, x, thrStorage);
+  auto out = at::empty_like(x);
+  sk::spikeForward(x.data_ptr<float>(), thr, out.data_ptr<float>(),
+                   x.numel());
+  return out.to(input.scalar_type());
+}
+
+at::Tensor surrogateGrad(const at::Tensor &grad, const at::Tensor &input,
+                         const at::Tensor &threshold,
+                         const std::string &surrogateName, double slope,
+                         double beta) {
+  const auto s = surrogate(surrogateName, slope, beta);
+  auto g = asFloat(grad);
+  auto x = asFloat(input);
+  at::Tensor thrStorage;
+  auto thr = param(threshold, x, thrStorage);
+  auto out = at::empty_like(x);
+  sk::surrogateBackward(s, g.data_ptr<float>(), x.data_ptr<float>(), thr,
+                        out.data_ptr<float>(), x.numel());
+  return out.to(grad.scalar_type());
+}
+
+std::tuple<at::Tensor, at::Tensor>
+leakyStep(const at::Tensor &input, const at::Tensor &mem,
+          const at::Tensor &beta, const at::Tensor &threshold,
+          int64_t resetMechanism) {
+  checkResetMechanism(resetMechanism);
+  auto x = asFloat(input);
+  auto m = asFloat(mem.expand_as(input));
+  at::Tensor betaStorage;
+  at::Tensor thrStorage;
+  auto b = param(beta, x, betaStorage);
+  auto thr = param(threshold, x, thrStorage);
+  auto spk = at::empty_like(x);
+  auto memNext = at::empty_like(x);
+  sk::leakyStepForward(resetMechanism, x.data_ptr<float>(),
+                       m.data_ptr<float>(), b, thr, spk.data_ptr<float>(),
+                       memNext.data_ptr<float>(), x.numel());
+  return std::make_tuple(spk.to(input.scalar_type()),
+                         memNext.to(input.scalar_type()));
+}
+
+std::tuple<at::Tensor, at::Tensor, at::Tensor, at::Tensor>
+leakyStepBackward(const at::Tensor &gradSpk,
+                  const c10::optional<at::Tensor> &gradMemNext,
+                  const at::Tensor &mem, const at::Tensor &beta,
+                  const at::Tensor &threshold, const at::Tensor &memNext,
+                  int64_t resetMechanism, const std::string &surrogateName,
+                  double slope, double surrogateBeta) {
+  checkResetMechanism(resetMechanism);
+  const auto s = surrogate(surrogateName, slope, surrogateBeta);
+  auto gs = asFloat(gradSpk);
+  // no grad_mem_next means mem_next was not used
+  at::Tensor gm;
+  if (gradMemNext.has_value() && gradMemNext->defined()) {
+    gm = asFloat(gradMemNext->expand_as(gradSpk));
+  }
+  auto m = asFloat(mem.expand_as(gradSpk));
+  auto next = asFloat(memNext);
+  at::Tensor betaStorage;
+  at::Tensor thrStorage;
+  auto b = param(beta, gs, betaStorage);
+  auto thr = param(threshold, gs, thrStorage);
+
+  auto gradInput = at::empty_like(gs);
+  auto gradMem = at::empty_like(gs);
+  auto gradBeta = at::empty_like(gs);
+  auto gradThreshold = at::empty_like(gs);
+  sk::leakyStepBackward(
+      resetMechanism, s, gs.data_ptr<float>(),
+      gm.defined() ? gm.data_ptr<float>() : nullptr, m.data_ptr<float>(), b,
+      thr, next.data_ptr<float>(), gradInput.data_ptr<float>(),
+      gradMem.data_ptr<float>(), gradBeta.data_ptr<float>(),
+      gradThreshold.data_ptr<float>(), gs.numel());
+
+  const auto type = gradSpk.scalar_type();
+  return std::make_tuple(gradInput.to(type), gradMem.to(type),
+                         gradBeta.to(type), gradThreshold.to(type));
+}
+
+} // namespace
+
+TORCH_LIBRARY(snntorch_cpu, m) {
+  m.def("spike(Tensor input, Tensor threshold) -> Tensor");
+  m.def("surrogate_grad(Tensor grad, Tensor input, Tensor threshold, "
+        "str surrogate, float slope, float beta) -> Tensor");
+  m.def("leaky_step(Tensor input, Tensor mem, Tensor beta, Tensor threshold, "
+        "int reset_mechanism) -> (Tensor, Tensor)");
+  m.def("leaky_step_backward(Tensor grad_spk, Tensor? grad_mem_next, "
+        "Tensor mem, Tensor beta, Tensor threshold, Tensor mem_next, "
+        "int reset_mechanism, str surrogate, float slope, "
+        "float surrogate_beta) -> (Tensor, Tensor, Tensor, Tensor)");
+}
+
+TORCH_LIBRARY_IMPL(snntorch_cpu, CPU, m) {
+  m.impl("spike", &spike);
+  m.impl("surrogate_grad", &surrogateGrad);
+  m.impl("leaky_step", &leakyStep);
+  m.impl("leaky_step_backward", &leakyStepBackward);
+}
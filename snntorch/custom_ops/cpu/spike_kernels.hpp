@@ -0,0 +1,349 @@
+// Host kernels behind the snntorch_cpu torch ops (see spike_cpu.cpp).
+//
+// They follow the popops expressions of the IPU ops term by term: the spike
+// compares x < threshold rather than x - threshold < 0, products and sums
+// are never fused into an FMA, and the surrogates are those of
+// neuron_step::surrogateGrad. Float32 results therefore match the IPU ops
+// bit for bit wherever the IPU evaluates the same float32 expression. Half
+// tensors are computed in float32 and rounded once (see spike_cpu.cpp), so
+// they can differ in the last bit from the IPU, which works in half.
+//
+// Each kernel has a scalar loop and, for the cheap element-wise bodies, an
+// AVX2 loop that is picked at run time when the CPU supports it, so that one
+// build runs on any x86-64 host.
+#ifndef SNNTORCH_CUSTOM_OPS_CPU_SPIKE_KERNELS_HPP
+#define SNNTORCH_CUSTOM_OPS_CPU_SPIKE_KERNELS_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SNNTORCH_CPU_X86 1
+#endif
+
+namespace spike_kernels {
+
+// See neuron_step::ResetMechanism
+enum ResetMechanism : int64_t { Subtract = 0, Zero = 1, None = 2 };
+
+enum SurrogateKind {
+  Heaviside,
+  StraightThroughEstimator,
+  FastSigmoid,
+  Sigmoid,
+  ATan,
+  Triangular,
+  SpikeRateEscape
+};
+
+struct Surrogate {
+  SurrogateKind kind;
+  float slope;
+  float beta;
+};
+
+// Returns false for a name neuron_step::checkSurrogate would reject
+inline bool parseSurrogate(const std::string &name, SurrogateKind &kind) {
+  if (name == "heaviside") {
+    kind = Heaviside;
+  } else if (name == "straight_through_estimator") {
+    kind = StraightThroughEstimator;
+  } else if (name == "fast_sigmoid") {
+    kind = FastSigmoid;
+  } else if (name == "sigmoid") {
+    kind = Sigmoid;
+  } else if (name == "atan") {
+    kind = ATan;
+  } else if (name == "triangular") {
+    kind = Triangular;
+  } else if (name == "spike_rate_escape") {
+    kind = SpikeRateEscape;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// A per-neuron operand, or one value for every neuron when `step` is 0
+struct Param {
+  const float *data;
+  int64_t step;
+
+  float operator[](int64_t i) const { return data[i * step]; }
+};
+
+// x < threshold ? 0:1
+inline float spike(float x, float threshold) {
+  return x < threshold ? 0.0f : 1.0f;
+}
+
+inline float clampUnit(float x) {
+  return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+}
+
+// dS/dU at u = mem - threshold, k being the slope
+inline float surrogateGrad(const Surrogate &s, float u) {
+  const float k = s.slope;
+  switch (s.kind) {
+  case Heaviside:
+    return u < 0.0f ? 0.0f : 1.0f;
+  case StraightThroughEstimator:
+    return 1.0f;
+  case Sigmoid: {
+    const float e = 1.0f / (1.0f + std::exp(-(k * u)));
+    return k * (e * (1.0f - e));
+  }
+  case ATan: {
+    const float a = 1.57079632679f * k * u;
+    return (k / 2.0f) / (1.0f + a * a);
+  }
+  case Triangular: {
+    const float t = 1.0f - k * std::fabs(u);
+    return k * (t > 0.0f ? t : 0.0f);
+  }
+  case SpikeRateEscape:
+    return k * std::exp(-s.beta * std::fabs(u));
+  case FastSigmoid:
+  default: {
+    const float d = k * std::fabs(u) + 1.0f;
+    return 1.0f / (d * d);
+  }
+  }
+}
+
+#ifdef SNNTORCH_CPU_X86
+inline bool haveAvx2() {
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  return avx2;
+}
+
+__attribute__((target("avx2"))) inline __m256 load(const Param &p,
+                                                    int64_t i) {
+  return p.step == 0 ? _mm256_set1_ps(p.data[0])
+                     : _mm256_loadu_ps(p.data + i);
+}
+
+// Lane-wise x < threshold ? 0:1
+__attribute__((target("avx2"))) inline __m256 spike8(__m256 x,
+                                                      __m256 threshold) {
+  return _mm256_andnot_ps(_mm256_cmp_ps(x, threshold, _CMP_LT_OQ),
+                          _mm256_set1_ps(1.0f));
+}
+
+__attribute__((target("avx2"))) inline __m256 abs8(__m256 x) {
+  return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x);
+}
+
+// Returns the number of elements done, for the scalar loop to finish
+__attribute__((target("avx2"))) inline int64_t
+spikeAvx2(const float *x, Param threshold, float *out, int64_t n) {
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_ps(out + i,
+                     spike8(_mm256_loadu_ps(x + i), load(threshold, i)));
+  }
+  return i;
+}
+
+// The surrogates with no transcendental, the common choices, have a vector
+// form; the others stay on the scalar loop
+inline bool haveSurrogate8(const Surrogate &s) {
+  return s.kind == Heaviside || s.kind == StraightThroughEstimator ||
+         s.kind == FastSigmoid || s.kind == Triangular;
+}
+
+// Lane-wise surrogateGrad for the kinds of haveSurrogate8
+__attribute__((target("avx2"))) inline __m256 surrogateGrad8(const Surrogate &s,
+                                                              __m256 u) {
+  const __m256 k = _mm256_set1_ps(s.slope);
+  const __m256 one = _mm256_set1_ps(1.0f);
+  switch (s.kind) {
+  case Heaviside:
+    return spike8(u, _mm256_setzero_ps());
+  case StraightThroughEstimator:
+    return one;
+  case Triangular: {
+    const __m256 t = _mm256_sub_ps(one, _mm256_mul_ps(k, abs8(u)));
+    return _mm256_mul_ps(k, _mm256_max_ps(t, _mm256_setzero_ps()));
+  }
+  case FastSigmoid:
+  default: {
+    const __m256 d = _mm256_add_ps(_mm256_mul_ps(k, abs8(u)), one);
+    return _mm256_div_ps(one, _mm256_mul_ps(d, d));
+  }
+  }
+}
+
+__attribute__((target("avx2"))) inline int64_t
+surrogateGradAvx2(const Surrogate &s, const float *grad, const float *x,
+                  Param threshold, float *out, int64_t n) {
+  if (!haveSurrogate8(s)) {
+    return 0;
+  }
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256 u = _mm256_sub_ps(_mm256_loadu_ps(x + i), load(threshold, i));
+    _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(grad + i),
+                                            surrogateGrad8(s, u)));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) inline int64_t
+leakyStepAvx2(int64_t resetMechanism, const float *input, const float *mem,
+              Param beta, Param threshold, float *spk, float *memNext,
+              int64_t n) {
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256 m = _mm256_loadu_ps(mem + i);
+    const __m256 thr = load(threshold, i);
+    const __m256 b = _mm256_min_ps(_mm256_max_ps(load(beta, i), zero), one);
+    const __m256 base =
+        _mm256_add_ps(_mm256_mul_ps(b, m), _mm256_loadu_ps(input + i));
+    const __m256 fired = _mm256_cmp_ps(m, thr, _CMP_GE_OQ);
+    __m256 next = base;
+    if (resetMechanism == Subtract) {
+      next = _mm256_blendv_ps(base, _mm256_sub_ps(base, thr), fired);
+    } else if (resetMechanism == Zero) {
+      next = _mm256_andnot_ps(fired, base);
+    }
+    _mm256_storeu_ps(memNext + i, next);
+    _mm256_storeu_ps(spk + i, spike8(next, thr));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) inline int64_t
+leakyStepBackwardAvx2(int64_t resetMechanism, const Surrogate &s,
+                      const float *gradSpk, const float *gradMemNext,
+                      const float *mem, Param beta, Param threshold,
+                      const float *memNext, float *gradInput, float *gradMem,
+                      float *gradBeta, float *gradThreshold, int64_t n) {
+  if (!haveSurrogate8(s)) {
+    return 0;
+  }
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 sign = _mm256_set1_ps(-0.0f);
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256 m = _mm256_loadu_ps(mem + i);
+    const __m256 thr = load(threshold, i);
+    const __m256 u = _mm256_sub_ps(_mm256_loadu_ps(memNext + i), thr);
+    const __m256 gradSpkU =
+        _mm256_mul_ps(_mm256_loadu_ps(gradSpk + i), surrogateGrad8(s, u));
+    const __m256 gradU =
+        gradMemNext == nullptr
+            ? gradSpkU
+            : _mm256_add_ps(_mm256_loadu_ps(gradMemNext + i), gradSpkU);
+    const __m256 fired = _mm256_cmp_ps(m, thr, _CMP_GE_OQ);
+    const __m256 g =
+        resetMechanism == Zero ? _mm256_andnot_ps(fired, gradU) : gradU;
+    const __m256 b = _mm256_min_ps(_mm256_max_ps(load(beta, i), zero), one);
+    const __m256 gradThr =
+        resetMechanism == Subtract
+            ? _mm256_add_ps(gradSpkU, _mm256_and_ps(fired, gradU))
+            : gradSpkU;
+    _mm256_storeu_ps(gradInput + i, g);
+    _mm256_storeu_ps(gradMem + i, _mm256_mul_ps(g, b));
+    _mm256_storeu_ps(gradBeta + i, _mm256_mul_ps(g, m));
+    _mm256_storeu_ps(gradThreshold + i, _mm256_xor_ps(gradThr, sign));
+  }
+  return i;
+}
+#endif
+
+// out = x < threshold ? 0:1
+inline void spikeForward(const float *x, Param threshold, float *out,
+                         int64_t n) {
+  int64_t i = 0;
+#ifdef SNNTORCH_CPU_X86
+  if (haveAvx2()) {
+    i = spikeAvx2(x, threshold, out, n);
+  }
+#endif
+  for (; i < n; ++i) {
+    out[i] = spike(x[i], threshold[i]);
+  }
+}
+
+// out = grad * dS/dU at x - threshold
+inline void surrogateBackward(const Surrogate &s, const float *grad,
+                              const float *x, Param threshold, float *out,
+                              int64_t n) {
+  int64_t i = 0;
+#ifdef SNNTORCH_CPU_X86
+  if (haveAvx2()) {
+    i = surrogateGradAvx2(s, grad, x, threshold, out, n);
+  }
+#endif
+  for (; i < n; ++i) {
+    out[i] = grad[i] * surrogateGrad(s, x[i] - threshold[i]);
+  }
+}
+
+// spk, mem_next of LeakyStep, see leaky_step.cpp
+inline void leakyStepForward(int64_t resetMechanism, const float *input,
+                             const float *mem, Param beta, Param threshold,
+                             float *spk, float *memNext, int64_t n) {
+  int64_t i = 0;
+#ifdef SNNTORCH_CPU_X86
+  if (haveAvx2()) {
+    i = leakyStepAvx2(resetMechanism, input, mem, beta, threshold, spk,
+                      memNext, n);
+  }
+#endif
+  for (; i < n; ++i) {
+    const float base = clampUnit(beta[i]) * mem[i] + input[i];
+    const bool fired = mem[i] >= threshold[i];
+    float next = base;
+    if (resetMechanism == Subtract) {
+      next = fired ? base - threshold[i] : base;
+    } else if (resetMechanism == Zero) {
+      next = fired ? 0.0f : base;
+    }
+    memNext[i] = next;
+    spk[i] = spike(next, threshold[i]);
+  }
+}
+
+// Element-wise gradients of LeakyStep, as LeakyStepGradOpx computes them
+// before reducing beta and threshold to their shapes. `gradMemNext` may be
+// null when mem_next receives no gradient.
+inline void leakyStepBackward(int64_t resetMechanism, const Surrogate &s,
+                              const float *gradSpk, const float *gradMemNext,
+                              const float *mem, Param beta, Param threshold,
+                              const float *memNext, float *gradInput,
+                              float *gradMem, float *gradBeta,
+                              float *gradThreshold, int64_t n) {
+  int64_t i = 0;
+#ifdef SNNTORCH_CPU_X86
+  if (haveAvx2()) {
+    i = leakyStepBackwardAvx2(resetMechanism, s, gradSpk, gradMemNext, mem,
+                              beta, threshold, memNext, gradInput, gradMem,
+                              gradBeta, gradThreshold, n);
+  }
+#endif
+  for (; i < n; ++i) {
+    const float gradSpkU =
+        gradSpk[i] * surrogateGrad(s, memNext[i] - threshold[i]);
+    const float gradU =
+        gradMemNext == nullptr ? gradSpkU : gradMemNext[i] + gradSpkU;
+    const bool fired = mem[i] >= threshold[i];
+    const float g = resetMechanism == Zero && fired ? 0.0f : gradU;
+    gradInput[i] = g;
+    gradMem[i] = g * clampUnit(beta[i]);
+    gradBeta[i] = g * mem[i];
+    gradThreshold[i] = resetMechanism == Subtract
+                           ? -(gradSpkU + (fired ? gradU : 0.0f))
+                           : -gradSpkU;
+  }
+}
+
+} // namespace spike_kernels
+
+#endif // SNNTORCH_CUSTOM_OPS_CPU_SPIKE_KERNELS_HPP
@@ -0,0 +1,251 @@
+// On-device delta encoding, the op behind `spikegen.delta`.
+//
+// Takes a [num_steps, ...] input and returns spikes of the same shape, where
+//
+//   d[t]   = input[t] - input[t - 1]
+//   spk[t] = (d[t] >= threshold) - (off_spike && d[t] <= -threshold)
+//
+// and input[-1] is input[0] with `padding`, zeros otherwise. Steps 1.. are
+// one element-wise map over two overlapping views of the input, so neither
+// the shifted copy of spikegen.delta nor the differences are materialised.
+// The inplace variant writes the spikes over the input: the even steps go
+// first, reading the odd frames they follow, and the odd steps then read a
+// copy of the even frames taken before, so only half the frames are copied.
+// The encoding is not differentiable, so the op has no grad op.
+#include <popart/error.hpp>
+#include <popart/opmanager.hpp>
+#include <popart/opserialiser.hpp>
+#include <popart/popx/opx.hpp>
+#include <popart/popx/opxmanager.hpp>
+#include <popart/region.hpp>
+
+#include <popops/ElementWise.hpp>
+
+#include <tuple>
+#include <vector>
+
+namespace CustomOperators {
+const popart::OperatorIdentifier DeltaEncodeId = {"custom.ops", "DeltaEncode",
+                                                  1};
+const popart::OperatorIdentifier DeltaEncodeInplaceId = {
+    "custom.ops", "DeltaEncodeInplace", 1};
+} // namespace CustomOperators
+
+class DeltaEncodeOp : public popart::Op {
+public:
+  DeltaEncodeOp(const popart::OperatorIdentifier &_opid, float _threshold,
+                bool _padding, bool _offSpike,
+                const popart::Op::Settings &settings_)
+      : popart::Op(_opid, settings_), threshold(_threshold),
+        padding(_padding), offSpike(_offSpike) {}
+
+  std::unique_ptr<Op> clone() const override {
+    return std::make_unique<DeltaEncodeOp>(*this);
+  }
+
+  void setup() final {
+    if (inInfo(0).rank() < 1) {
+      throw popart::error("DeltaEncode: expected time-first data of rank >= 1");
+    }
+    outInfo(0) = inInfo(0);
+  }
+
+  void appendAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendAttributes(os);
+    appendDeltaAttributes(os);
+  }
+
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendOutlineAttributes(os);
+    appendDeltaAttributes(os);
+  }
+
+  float getSubgraphValue() const final { return getLowSubgraphValue(); }
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // The spikes may overwrite the input
+  std::vector<std::tuple<popart::OperatorIdentifier, float>>
+  inplacePriorityDefault() const override {
+    return {{CustomOperators::DeltaEncodeInplaceId, 10}};
+  }
+
+  // Implementation defined below
+  std::unique_ptr<popart::Op>
+  getInplaceVariant(const popart::OperatorIdentifier &id) const override;
+
+  // Attributes
+  float getThreshold() const { return threshold; }
+  bool getPadding() const { return padding; }
+  bool getOffSpike() const { return offSpike; }
+
+private:
+  void appendDeltaAttributes(popart::OpSerialiserBase &os) const {
+    os.appendAttribute("threshold", getThreshold());
+    os.appendAttribute("padding", static_cast<int64_t>(getPadding()));
+    os.appendAttribute("off_spike", static_cast<int64_t>(getOffSpike()));
+  }
+
+  float threshold;
+  bool padding;
+  bool offSpike;
+};
+
+// Writes the spikes over the input, which output 0 then aliases
+class DeltaEncodeInplaceOp : public DeltaEncodeOp {
+public:
+  DeltaEncodeInplaceOp(const DeltaEncodeOp &op)
+      : DeltaEncodeOp(CustomOperators::DeltaEncodeInplaceId, op.getThreshold(),
+                      op.getPadding(), op.getOffSpike(), op.settings) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<DeltaEncodeInplaceOp>(*this);
+  }
+
+  popart::view::Regions aliases(popart::InIndex in,
+                                popart::OutIndex out) const final {
+    if (in == 0 && out == 0) {
+      return {popart::view::Region::getFull(inShape(0))};
+    }
+    return Op::aliases(in, out);
+  }
+
+  popart::view::Regions modifies(popart::InIndex in) const final {
+    return aliases(in, 0);
+  }
+};
+
+std::unique_ptr<popart::Op>
+DeltaEncodeOp::getInplaceVariant(const popart::OperatorIdentifier &id) const {
+  if (id == CustomOperators::DeltaEncodeInplaceId) {
+    return std::make_unique<DeltaEncodeInplaceOp>(*this);
+  }
+  return Op::getInplaceVariant(id);
+}
+
+namespace {
+using popart::DataType;
+using popart::OpDefinition;
+
+static OpDefinition::DataTypes T = {DataType::FLOAT16, DataType::FLOAT};
+
+static OpDefinition
+    DeltaEncodeOpDef({OpDefinition::Inputs({{"input", T}}),
+                      OpDefinition::Outputs({{"output", T}}),
+                      OpDefinition::Attributes({{"threshold", {"*"}},
+                                                {"padding", {"*"}},
+                                                {"off_spike", {"*"}}})});
+
+static popart::OpCreator<DeltaEncodeOp> DeltaEncodeOpCreator(
+    popart::OpDefinitions({{CustomOperators::DeltaEncodeId,
+                            DeltaEncodeOpDef}}),
+    [](const popart::OpCreatorInfo &info) {
+      const auto &a = info.attributes;
+      float threshold =
+          a.getAttribute<popart::Attributes::Float>("threshold", 0.1f);
+      bool padding = a.getAttribute<popart::Attributes::Int>("padding", 0) != 0;
+      bool offSpike =
+          a.getAttribute<popart::Attributes::Int>("off_spike", 0) != 0;
+      return std::make_unique<DeltaEncodeOp>(info.opid, threshold, padding,
+                                             offSpike, info.settings);
+    },
+    true);
+} // namespace
+
+namespace pe = popops::expr;
+
+namespace {
+// Spike of the change d: 1 for a rise of at least threshold, less 1 for a
+// fall of at least threshold when offSpike is set. As in spikegen.delta the
+// two add up, so a change that is both (threshold <= 0) gives 0
+std::unique_ptr<pe::Expr> deltaSpike(const pe::Expr &d, float threshold,
+                                     bool offSpike) {
+  auto on = pe::Select(pe::Const(1.0f), pe::Const(0.0f),
+                       pe::Gte(d, pe::Const(threshold)));
+  if (!offSpike) {
+    return on.clone();
+  }
+  auto off = pe::Select(pe::Const(1.0f), pe::Const(0.0f),
+                        pe::Lte(d, pe::Const(-threshold)));
+  return pe::Sub(on, off).clone();
+}
+} // namespace
+
+class DeltaEncodeOpx : public popart::popx::Opx {
+public:
+  DeltaEncodeOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<DeltaEncodeOp>(op, {CustomOperators::DeltaEncodeId,
+                                 CustomOperators::DeltaEncodeInplaceId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+    auto op = getOp<DeltaEncodeOp>();
+
+    poplar::Tensor input = getInTensor(0);
+    const auto numSteps = input.dim(0);
+
+    // The first step compares against itself (padding) or zeros
+    auto firstDelta = op.getPadding() ? pe::Sub(pe::_1, pe::_1).clone()
+                                      : pe::_1.clone();
+    auto firstExpr =
+        deltaSpike(*firstDelta, op.getThreshold(), op.getOffSpike());
+    auto expr = deltaSpike(pe::Sub(pe::_1, pe::_2), op.getThreshold(),
+                           op.getOffSpike());
+
+    if (op.opid == CustomOperators::DeltaEncodeInplaceId) {
+      growInplace(input, *firstExpr, *expr, prog);
+      setOutTensor(0, input);
+      return;
+    }
+
+    std::vector<poplar::Tensor> steps = {
+        popops::map(graph(), *firstExpr, {input.slice(0, 1, 0)}, prog,
+                    debugContext("DeltaEncodeFirst"))};
+
+    // Every later step against the one before it
+    if (numSteps > 1) {
+      steps.push_back(popops::map(
+          graph(), *expr,
+          {input.slice(1, numSteps, 0), input.slice(0, numSteps - 1, 0)},
+          prog, debugContext("DeltaEncodeSpikes")));
+    }
+
+    setOutTensor(0, poplar::concat(steps, 0));
+  }
+
+private:
+  // Every step t >= 1 reads frame t - 1 as it was, so the even frames that
+  // an odd step follows are copied before the even steps overwrite them
+  void growInplace(const poplar::Tensor &input, const pe::Expr &firstExpr,
+                   const pe::Expr &expr,
+                   poplar::program::Sequence &prog) const {
+    const auto numSteps = input.dim(0);
+    const auto every2 = [&](std::size_t begin, std::size_t end) {
+      return input.slice(begin, end, 0).subSample(2, 0);
+    };
+
+    poplar::Tensor evenPrev;
+    if (numSteps > 1) {
+      evenPrev = graph().clone(every2(0, numSteps - 1),
+                               debugContext("DeltaEncodeEvenFrames"));
+      prog.add(poplar::program::Copy(every2(0, numSteps - 1), evenPrev, false,
+                                     debugContext("DeltaEncodeEvenFrames")));
+    }
+
+    popops::mapInPlace(graph(), firstExpr, {input.slice(0, 1, 0)}, prog,
+                       debugContext("DeltaEncodeFirst"));
+    if (numSteps > 2) {
+      popops::mapInPlace(graph(), expr,
+                         {every2(2, numSteps), every2(1, numSteps - 1)}, prog,
+                         debugContext("DeltaEncodeEvenSpikes"));
+    }
+    if (numSteps > 1) {
+      popops::mapInPlace(graph(), expr, {every2(1, numSteps), evenPrev}, prog,
+                         debugContext("DeltaEncodeOddSpikes"));
+    }
+  }
+};
+
+static popart::popx::OpxCreator<DeltaEncodeOpx> DeltaEncodeOpxCreator(
+    {CustomOperators::DeltaEncodeId, CustomOperators::DeltaEncodeInplaceId});
@@ -1,16 +1,25 @@
+#include <popart/error.hpp>
 #include <popart/opmanager.hpp>
 #include <popart/opserialiser.hpp>
 #include <popart/popx/opxmanager.hpp>
+#include <popart/region.hpp>
 
 #include <popart/popx/opx.hpp>
 #include <popops/ElementWise.hpp>
 
+#include "neuron_step.hpp"
+#include "spike_codelets.hpp"
+
 namespace CustomOperators {
 const popart::OperatorIdentifier FastSigmoidId = {"custom.ops", "FastSigmoid", 1};
+const popart::OperatorIdentifier FastSigmoidInplaceId = {
+    "custom.ops", "FastSigmoidInplace", 1};
 } // namespace CustomOperators
 namespace CustomGradOperators {
 const popart::OperatorIdentifier FastSigmoidGradId = {"custom.ops", "FastSigmoidGrad",
                                                     1};
+const popart::OperatorIdentifier FastSigmoidGradInplaceId = {
+    "custom.ops", "FastSigmoidGradInplace", 1};
 } // namespace CustomGradOperators
 
 class FastSigmoidOp;
@@ -21,14 +30,20 @@ class FastSigmoidGradOp : public popart::Op {
 public:
   FastSigmoidGradOp(const FastSigmoidOp &fwdOp);
 
-  std::unique_ptr<popart::Op> clone() const final {
+  std::unique_ptr<popart::Op> clone() const override {
     return std::make_unique<FastSigmoidGradOp>(*this);
   }
-  void setup() final { outInfo(0) = inInfo(0); };
+  void setup() final {
+    outInfo(0) = inInfo(0);
+    if (hasThreshold) {
+      outInfo(1) = thresholdInfo;
+    }
+  };
 
   const std::vector<popart::GradInOutMapper> &gradInputInfo() const;
 
-  // The Grad Op has 1 output, which is the gradient of the only input
+  // The Grad Op has 1 output per forward input: the gradient of the input
+  // and, when the threshold is passed in, of the threshold
   const std::map<int, int> &gradOutToNonGradIn() const;
 
   bool requiresRandomSeed() const override { return false; }
@@ -36,7 +51,20 @@ public:
   // an estimate of how valuable sub-graph matching will be
   float getSubgraphValue() const final { return getHighSubgraphValue(); }
 
+  // The gradient of the input may overwrite the incoming gradient
+  std::vector<std::tuple<popart::OperatorIdentifier, float>>
+  inplacePriorityDefault() const override {
+    return {{CustomGradOperators::FastSigmoidGradInplaceId, 10}};
+  }
+
+  // Implementation defined below
+  std::unique_ptr<popart::Op>
+  getInplaceVariant(const popart::OperatorIdentifier &id) const override;
+
   float getAlpha() const { return alpha; }
+  float getSlope() const { return slope; }
+  bool getHasThreshold() const { return hasThreshold; }
+  bool getCompact() const { return compact; }
 
   // Implementation defined below
   void appendAttributes(popart::OpSerialiserBase &os) const override;
@@ -44,37 +72,76 @@ public:
   // Implementation defined below
   void appendOutlineAttributes(popart::OpSerialiserBase &os) const override;
 
+protected:
+  FastSigmoidGradOp(const popart::OperatorIdentifier &_opid,
+                    const FastSigmoidGradOp &other)
+      : popart::Op(_opid, other.settings), alpha(other.alpha),
+        slope(other.slope), hasThreshold(other.hasThreshold),
+        compact(other.compact), thresholdInfo(other.thresholdInfo) {}
+
 private:
   float alpha;
+  float slope;
+  bool hasThreshold;
+  bool compact;
+  popart::TensorInfo thresholdInfo;
 };
 
 class FastSigmoidOp : public popart::Op {
 public:
   FastSigmoidOp(const popart::OperatorIdentifier &_opid, float _alpha,
+              float _slope, bool _compact, const std::string &_spikeDtype,
               const popart::Op::Settings &settings_)
-      : popart::Op(_opid, settings_), alpha(_alpha) {}
+      : popart::Op(_opid, settings_), alpha(_alpha), slope(_slope),
+        compact(_compact), spikeDtype(_spikeDtype) {}
   FastSigmoidOp(const popart::OperatorIdentifier &_opid,
               const popart::Op::Settings &settings_)
       : popart::Op(_opid, settings_) {}
 
-  std::unique_ptr<Op> clone() const final {
+  std::unique_ptr<Op> clone() const override {
     return std::make_unique<FastSigmoidOp>(*this);
   }
 
-  void setup() final { outInfo(0) = inInfo(0); }
+  // The optional second output is the detached reset mask. With
+  // saved = "compact", the third output is a FLOAT16 copy of
+  // input - threshold, which the backward pass reads instead of the input.
+  // spike_dtype = "bool" / "uint8" emits the spikes at one byte each.
+  void setup() final {
+    outInfo(0) = neuron_step::spikeInfo(inInfo(0), getSpikeDtype());
+    if (output->hasIndex(1)) {
+      outInfo(1) = inInfo(0);
+    }
+    if (getCompact()) {
+      if (!output->hasIndex(2)) {
+        throw popart::error("FastSigmoid: saved = 'compact' needs the third "
+                            "(saved) output");
+      }
+      outInfo(2) = {popart::DataType::FLOAT16, inInfo(0).shape()};
+    }
+  }
 
   void appendAttributes(popart::OpSerialiserBase &os) const override {
     Op::appendAttributes(os);
     os.appendAttribute("alpha", getAlpha());
+    os.appendAttribute("slope", getSlope());
+    os.appendAttribute("saved", getCompact() ? "compact" : "input");
+    os.appendAttribute("spike_dtype", getSpikeDtype());
   }
 
   void appendOutlineAttributes(popart::OpSerialiserBase &os) const override {
     Op::appendOutlineAttributes(os);
     os.appendAttribute("alpha", getAlpha());
+    os.appendAttribute("slope", getSlope());
+    os.appendAttribute("saved", getCompact() ? "compact" : "input");
+    os.appendAttribute("spike_dtype", getSpikeDtype());
   }
 
+  // Compact spikes carry no gradient
   std::vector<std::unique_ptr<popart::Op>> getGradOps() {
     std::vector<std::unique_ptr<Op>> upops;
+    if (neuron_step::compactSpikes(getSpikeDtype())) {
+      return upops;
+    }
     upops.emplace_back(new FastSigmoidGradOp(*this));
     return upops;
   }
@@ -83,22 +150,109 @@ public:
 
   bool requiresRandomSeed() const override { return false; }
 
+  // The spikes may overwrite the input, unless they are compact
+  std::vector<std::tuple<popart::OperatorIdentifier, float>>
+  inplacePriorityDefault() const override {
+    if (neuron_step::compactSpikes(getSpikeDtype())) {
+      return {};
+    }
+    return {{CustomOperators::FastSigmoidInplaceId, 10}};
+  }
+
+  // Implementation defined below
+  std::unique_ptr<popart::Op>
+  getInplaceVariant(const popart::OperatorIdentifier &id) const override;
+
   // Attributes
   float getAlpha() const { return alpha; }
+  float getSlope() const { return slope; }
+  bool getCompact() const { return compact; }
+  const std::string &getSpikeDtype() const { return spikeDtype; }
 
 private:
   float alpha;
+  float slope = 1.0f;
+  bool compact = false;
+  std::string spikeDtype = "input";
+};
+
+// Writes the spikes over the input, which output 0 then aliases
+class FastSigmoidInplaceOp : public FastSigmoidOp {
+public:
+  FastSigmoidInplaceOp(const FastSigmoidOp &op)
+      : FastSigmoidOp(CustomOperators::FastSigmoidInplaceId, op.getAlpha(),
+                      op.getSlope(), op.getCompact(), op.getSpikeDtype(),
+                      op.settings) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<FastSigmoidInplaceOp>(*this);
+  }
+
+  popart::view::Regions aliases(popart::InIndex in,
+                                popart::OutIndex out) const final {
+    if (in == 0 && out == 0) {
+      return {popart::view::Region::getFull(inShape(0))};
+    }
+    return Op::aliases(in, out);
+  }
+
+  popart::view::Regions modifies(popart::InIndex in) const final {
+    return aliases(in, 0);
+  }
+};
+
+std::unique_ptr<popart::Op>
+FastSigmoidOp::getInplaceVariant(const popart::OperatorIdentifier &id) const {
+  if (id == CustomOperators::FastSigmoidInplaceId) {
+    return std::make_unique<FastSigmoidInplaceOp>(*this);
+  }
+  return Op::getInplaceVariant(id);
+}
+
+// Writes the gradient of the input over the incoming gradient
+class FastSigmoidGradInplaceOp : public FastSigmoidGradOp {
+public:
+  FastSigmoidGradInplaceOp(const FastSigmoidGradOp &op)
+      : FastSigmoidGradOp(CustomGradOperators::FastSigmoidGradInplaceId, op) {}
+
+  std::unique_ptr<popart::Op> clone() const final {
+    return std::make_unique<FastSigmoidGradInplaceOp>(*this);
+  }
+
+  popart::view::Regions aliases(popart::InIndex in,
+                                popart::OutIndex out) const final {
+    if (in == 0 && out == 0) {
+      return {popart::view::Region::getFull(inShape(0))};
+    }
+    return Op::aliases(in, out);
+  }
+
+  popart::view::Regions modifies(popart::InIndex in) const final {
+    return aliases(in, 0);
+  }
 };
 
+std::unique_ptr<popart::Op> FastSigmoidGradOp::getInplaceVariant(
+    const popart::OperatorIdentifier &id) const {
+  if (id == CustomGradOperators::FastSigmoidGradInplaceId) {
+    return std::make_unique<FastSigmoidGradInplaceOp>(*this);
+  }
+  return Op::getInplaceVariant(id);
+}
+
 namespace {
 using popart::OpDefinition;
 using popart::DataType;
 
 static OpDefinition::DataTypes T = {DataType::FLOAT16, DataType::FLOAT};
+static OpDefinition::DataTypes Spikes = {DataType::FLOAT16, DataType::FLOAT,
+                                         DataType::BOOL, DataType::UINT8};
 
 static OpDefinition
-      FastSigmoidOpDef({OpDefinition::Inputs({{"input", T}}),
-                      OpDefinition::Outputs({{"output", T}}),
+      FastSigmoidOpDef({OpDefinition::Inputs({{"input", T}, {"threshold", T}}),
+                      OpDefinition::Outputs({{"output", Spikes},
+                                             {"reset", T},
+                                             {"saved", {DataType::FLOAT16}}}),
                       OpDefinition::Attributes()});
 
 static popart::OpCreator<FastSigmoidOp> FastSigmoidOpCreator(
@@ -107,7 +261,23 @@ static popart::OpCreator<FastSigmoidOp> FastSigmoidOpCreator(
         // default alpha is 10**(-2)
         float alpha = info.attributes.getAttribute<popart::Attributes::Float>(
             "alpha", 1e-2f);
-        return std::make_unique<FastSigmoidOp>(info.opid, alpha, info.settings);
+        // k in 1 / (k|x| + 1)^2, 1 unless snntorch.surrogate passes one
+        float slope = info.attributes.getAttribute<popart::Attributes::Float>(
+            "slope", 1.0f);
+        // saved = "compact" keeps a FLOAT16 copy for the backward pass
+        bool compact = neuron_step::checkSaved(
+            "FastSigmoid",
+            info.attributes.getAttribute<popart::Attributes::String>(
+                "saved", "input"));
+        // spike_dtype = "bool" / "uint8" emits one-byte spikes
+        std::string spikeDtype =
+            neuron_step::spikeDtypeAttribute("FastSigmoid", info.attributes);
+        int64_t recompute =
+            info.attributes.getAttribute<popart::Attributes::Int>("recompute",
+                                                                  0);
+        return std::make_unique<FastSigmoidOp>(
+            info.opid, alpha, slope, compact, spikeDtype,
+            neuron_step::recomputeSettings(info.settings, recompute));
         return std::make_unique<FastSigmoidOp>(info.opid, info.settings);
       },
       true);
@@ -119,8 +289,8 @@ class FastSigmoidOpx : public popart::popx::Opx {
 public:
   FastSigmoidOpx(popart::Op *op, popart::popx::Devicex *devicex)
       : popart::popx::Opx(op, devicex) {
-    verifyOp<FastSigmoidOp>(
-        op, {CustomOperators::FastSigmoidId});
+    verifyOp<FastSigmoidOp>(op, {CustomOperators::FastSigmoidId,
+                                 CustomOperators::FastSigmoidInplaceId});
   }
 
   void grow(poplar::program::Sequence &prog) const final {
@@ -129,17 +299,76 @@ public:
 
     poplar::Tensor input = getInTensor(0);
 
-    float alpha = op.getAlpha();
-
-    // x < 0.0f ? 0:1
-    auto expression = pe::Select(pe::Const(0.0f), pe::Const(1.0f),
-                                 pe::Lt(pe::_1, pe::Const(0.0f)));
-
-
-    popops::mapInPlace(graph(), expression, {input}, prog,
-                       debugContext("FastSigmoid"), poplar::OptionFlags());
-
-    setOutTensor(0, input);
+    const bool inplace = op.opid == CustomOperators::FastSigmoidInplaceId;
+
+    // input - threshold at half precision, all the surrogate needs. Taken
+    // before the spikes, which the inplace variant writes over the input.
+    if (hasOutput(2)) {
+      std::vector<poplar::Tensor> ins = {input};
+      std::unique_ptr<pe::Expr> expr = pe::_1.clone();
+      if (hasInput(1)) {
+        ins.push_back(neuron_step::broadcastParam(
+            graph(), getInTensor(1), input.elementType(), input.shape(), prog,
+            debugContext("threshold")));
+        expr = pe::Sub(pe::_1, pe::_2).clone();
+      }
+      setOutTensor(2, popops::map(graph(), pe::Cast(*expr, poplar::HALF), ins,
+                                  prog, debugContext("FastSigmoidSaved")));
+    }
+
+    poplar::Tensor output = input;
+    if (spike_codelets::addCodelets(graph())) {
+      // Vectorised vertices, see codelets/spike_codelets.cpp; the inplace
+      // variant writes the spikes over the input
+      poplar::Tensor threshold = spike_codelets::thresholdOrZero(
+          graph(), hasInput(1), hasInput(1) ? getInTensor(1) : input, input,
+          prog, debugContext("threshold"));
+      if (inplace) {
+        spike_codelets::spikeInPlace(graph(), input, threshold, prog,
+                                     debugContext("FastSigmoid"));
+      } else {
+        output = spike_codelets::spike(graph(), input, threshold, prog,
+                                       debugContext("FastSigmoid"));
+      }
+    } else {
+      // x < 0.0f ? 0:1, or x < threshold with a threshold input, so that
+      // mem - threshold is never materialised
+      std::vector<poplar::Tensor> ins = {input};
+      std::unique_ptr<pe::Expr> expression =
+          pe::Select(pe::Const(0.0f), pe::Const(1.0f),
+                     pe::Lt(pe::_1, pe::Const(0.0f)))
+              .clone();
+      if (hasInput(1)) {
+        ins.push_back(neuron_step::broadcastParam(
+            graph(), getInTensor(1), input.elementType(), input.shape(), prog,
+            debugContext("threshold")));
+        expression = pe::Select(pe::Const(0.0f), pe::Const(1.0f),
+                                pe::Lt(pe::_1, pe::_2))
+                         .clone();
+      }
+      // The inplace variant writes the spikes over the input
+      if (inplace) {
+        popops::mapInPlace(graph(), *expression, ins, prog,
+                           debugContext("FastSigmoid"), poplar::OptionFlags());
+      } else {
+        output = popops::map(graph(), *expression, ins, prog,
+                             debugContext("FastSigmoid"),
+                             poplar::OptionFlags());
+      }
+    }
+
+    // The reset takes the same value as the spike, but is a separate tensor
+    // that the grad op never reads, so it carries no gradient.
+    if (hasOutput(1)) {
+      auto reset = graph().clone(output, debugContext("FastSigmoidReset"));
+      prog.add(poplar::program::Copy(output, reset, false,
+                                     debugContext("FastSigmoidReset")));
+      setOutTensor(1, reset);
+    }
+
+    setOutTensor(0, neuron_step::castSpikes(graph(), output,
+                                            op.getSpikeDtype(), prog,
+                                            debugContext("FastSigmoidSpikes")));
   }
 };
 
@@ -147,7 +376,9 @@ class FastSigmoidGradOpx : public popart::popx::Opx {
 public:
   FastSigmoidGradOpx(popart::Op *op, popart::popx::Devicex *devicex)
       : popart::popx::Opx(op, devicex) {
-    verifyOp<FastSigmoidGradOp>(op, {CustomGradOperators::FastSigmoidGradId});
+    verifyOp<FastSigmoidGradOp>(
+        op, {CustomGradOperators::FastSigmoidGradId,
+             CustomGradOperators::FastSigmoidGradInplaceId});
   }
 
   void grow(poplar::program::Sequence &prog) const final {
@@ -157,53 +388,140 @@ public:
     poplar::Tensor grad = getInTensor(0);
     poplar::Tensor input = getInTensor(1);
 
-    float alpha = op.getAlpha();
-
-    // (grad * (x < 0.0f ? alpha : 1))
-    // pe::Mul expression = pe::Mul(pe::Select(pe::Const(0.0f), pe::Const(1.0f),
-    //                                        pe::Lt(pe::_2, pe::Const(0.0f))),  // check if pe::_2 is less than 0.0. If so, return pe:Const(0.0f) else pe::Const(1.0f)
-    //                            pe::_1);
-
-    auto expression = pe::Divide(pe::_1, 
-                                 pe::Pow(pe::Add(pe::Abs(pe::_2),pe::Const(1.0f)), pe::Const(2.0f)));                          
-
-    auto output =
-        popops::map(graph(), expression, {grad, input}, prog,
-                    debugContext("FastSigmoidGrad"), poplar::OptionFlags());
+    // The inplace variant writes the gradient over the incoming one
+    const bool inplace =
+        op.opid == CustomGradOperators::FastSigmoidGradInplaceId;
+
+    poplar::Tensor output = grad;
+    const auto k = pe::Const(op.getSlope());
+    if (op.getCompact()) {
+      // The saved copy already has the threshold subtracted
+      auto expression = pe::Divide(
+          pe::_1,
+          pe::Square(pe::Add(
+              pe::Mul(k, pe::Abs(pe::Cast(pe::_2, grad.elementType()))),
+              pe::Const(1.0f))));
+      if (inplace) {
+        popops::mapInPlace(graph(), expression, {grad, input}, prog,
+                           debugContext("FastSigmoidGrad"));
+      } else {
+        output = popops::map(graph(), expression, {grad, input}, prog,
+                             debugContext("FastSigmoidGrad"));
+      }
+    } else if (spike_codelets::addCodelets(graph())) {
+      // Vectorised vertices, see codelets/spike_codelets.cpp
+      poplar::Tensor threshold = spike_codelets::thresholdOrZero(
+          graph(), op.getHasThreshold(),
+          op.getHasThreshold() ? getInTensor(2) : input, input, prog,
+          debugContext("threshold"));
+      if (inplace) {
+        spike_codelets::fastSigmoidGradInPlace(
+            graph(), grad, input, threshold, op.getSlope(), prog,
+            debugContext("FastSigmoidGrad"));
+      } else {
+        output = spike_codelets::fastSigmoidGrad(
+            graph(), grad, input, threshold, op.getSlope(), prog,
+            debugContext("FastSigmoidGrad"));
+      }
+    } else {
+      // With a threshold input, x is mem - threshold evaluated inside the map
+      std::vector<poplar::Tensor> ins = {grad, input};
+      std::unique_ptr<pe::Expr> x = pe::_2.clone();
+      if (op.getHasThreshold()) {
+        ins.push_back(neuron_step::broadcastParam(
+            graph(), getInTensor(2), input.elementType(), input.shape(), prog,
+            debugContext("threshold")));
+        x = pe::Sub(pe::_2, pe::_3).clone();
+      }
+
+      // grad / (k|x| + 1)^2, with the square as a multiply
+      auto expression = pe::Divide(
+          pe::_1,
+          pe::Square(pe::Add(pe::Mul(k, pe::Abs(*x)), pe::Const(1.0f))));
+
+      if (inplace) {
+        popops::mapInPlace(graph(), expression, ins, prog,
+                           debugContext("FastSigmoidGrad"),
+                           poplar::OptionFlags());
+      } else {
+        output =
+            popops::map(graph(), expression, ins, prog,
+                        debugContext("FastSigmoidGrad"), poplar::OptionFlags());
+      }
+    }
 
     setOutTensor(0, output);
+
+    // d(mem - threshold)/dthreshold = -1
+    if (op.getHasThreshold()) {
+      poplar::Tensor threshold = getInTensor(2);
+      auto gradThreshold = neuron_step::reduceToShape(
+          graph(), output, threshold.shape(), threshold.elementType(), prog,
+          debugContext("FastSigmoidGradThresholdReduce"));
+      gradThreshold = popops::map(graph(), pe::Neg(pe::_1), {gradThreshold},
+                                  prog, debugContext("FastSigmoidGradThreshold"));
+      setOutTensor(1, gradThreshold);
+    }
   }
 };
 
 FastSigmoidGradOp::FastSigmoidGradOp(const FastSigmoidOp &fwdOp)
     : popart::Op(CustomGradOperators::FastSigmoidGradId, fwdOp.settings),
-      alpha(fwdOp.getAlpha()) {}
+      alpha(fwdOp.getAlpha()), slope(fwdOp.getSlope()),
+      hasThreshold(fwdOp.input->hasIndex(1)),
+      compact(fwdOp.getCompact()) {
+  if (hasThreshold) {
+    thresholdInfo = fwdOp.inInfo(1);
+  }
+}
 
 const std::vector<popart::GradInOutMapper> &
 FastSigmoidGradOp::gradInputInfo() const {
   static const std::vector<popart::GradInOutMapper> inInfo = {
       {0, 0, popart::GradOpInType::GradOut}, {1, 0, popart::GradOpInType::In}};
-  return inInfo;
+  static const std::vector<popart::GradInOutMapper> inInfoWithThreshold = {
+      {0, 0, popart::GradOpInType::GradOut},
+      {1, 0, popart::GradOpInType::In},
+      {2, 1, popart::GradOpInType::In}};
+  // saved = "compact": the FLOAT16 copy (forward output 2) in place of the
+  // input
+  static const std::vector<popart::GradInOutMapper> inInfoCompact = {
+      {0, 0, popart::GradOpInType::GradOut}, {1, 2, popart::GradOpInType::Out}};
+  static const std::vector<popart::GradInOutMapper>
+      inInfoCompactWithThreshold = {{0, 0, popart::GradOpInType::GradOut},
+                                    {1, 2, popart::GradOpInType::Out},
+                                    {2, 1, popart::GradOpInType::In}};
+  if (compact) {
+    return hasThreshold ? inInfoCompactWithThreshold : inInfoCompact;
+  }
+  return hasThreshold ? inInfoWithThreshold : inInfo;
 }
 
-// The Grad Op has 1 output, which is the gradient of the only input
+// The Grad Op has 1 output per forward input: the gradient of the input
+// and, when the threshold is passed in, of the threshold
 const std::map<int, int> &FastSigmoidGradOp::gradOutToNonGradIn() const {
   static const std::map<int, int> outInfo = {{0, 0}};
-  return outInfo;
+  static const std::map<int, int> outInfoWithThreshold = {{0, 0}, {1, 1}};
+  return hasThreshold ? outInfoWithThreshold : outInfo;
 }
 
 void FastSigmoidGradOp::appendAttributes(popart::OpSerialiserBase &os) const {
   Op::appendAttributes(os);
   os.appendAttribute("alpha", getAlpha());
+  os.appendAttribute("slope", getSlope());
+  os.appendAttribute("saved", getCompact() ? "compact" : "input");
 }
 
 void FastSigmoidGradOp::appendOutlineAttributes(
     popart::OpSerialiserBase &os) const {
   Op::appendOutlineAttributes(os);
   os.appendAttribute("alpha", getAlpha());
+  os.appendAttribute("slope", getSlope());
+  os.appendAttribute("saved", getCompact() ? "compact" : "input");
 }
 
 static popart::popx::OpxCreator<FastSigmoidOpx> FastSigmoidOpxCreator(
-    {CustomOperators::FastSigmoidId});
+    {CustomOperators::FastSigmoidId, CustomOperators::FastSigmoidInplaceId});
 static popart::popx::OpxCreator<FastSigmoidGradOpx>
-    FastSigmoidGradOpxCreator({CustomGradOperators::FastSigmoidGradId});
+    FastSigmoidGradOpxCreator({CustomGradOperators::FastSigmoidGradId,
+                               CustomGradOperators::FastSigmoidGradInplaceId});
@@ -8,16 +8,25 @@
 #include <popart/opmanager.hpp>
 #include <popart/opserialiser.hpp>
 #include <popart/popx/opxmanager.hpp>
+#include <popart/region.hpp>
 
 #include <popart/popx/opx.hpp>
 #include <popops/ElementWise.hpp>
 
+#include "neuron_step.hpp"
+#include "spike_codelets.hpp"
+#include "spike_pack.hpp"
+
 namespace CustomOperators {
 const popart::OperatorIdentifier HeavisideId = {"custom.ops", "Heaviside", 1};
+const popart::OperatorIdentifier HeavisideInplaceId = {"custom.ops",
+                                                       "HeavisideInplace", 1};
 } // namespace CustomOperators
 namespace CustomGradOperators {
 const popart::OperatorIdentifier HeavisideGradId = {"custom.ops", "HeavisideGrad",
                                                     1};
+const popart::OperatorIdentifier HeavisideGradInplaceId = {
+    "custom.ops", "HeavisideGradInplace", 1};
 } // namespace CustomGradOperators
 
 class HeavisideOp;
@@ -28,14 +37,20 @@ class HeavisideGradOp : public popart::Op {
 public:
   HeavisideGradOp(const HeavisideOp &fwdOp);
 
-  std::unique_ptr<popart::Op> clone() const final {
+  std::unique_ptr<popart::Op> clone() const override {
     return std::make_unique<HeavisideGradOp>(*this);
   }
-  void setup() final { outInfo(0) = inInfo(0); };
+  void setup() final {
+    outInfo(0) = inInfo(0);
+    if (hasThreshold) {
+      outInfo(1) = thresholdInfo;
+    }
+  };
 
   const std::vector<popart::GradInOutMapper> &gradInputInfo() const;
 
-  // The Grad Op has 1 output, which is the gradient of the only input
+  // The Grad Op has 1 output per forward input: the gradient of the input
+  // and, when the threshold is passed in, of the threshold
   const std::map<int, int> &gradOutToNonGradIn() const;
 
   bool requiresRandomSeed() const override { return false; }
@@ -43,7 +58,19 @@ public:
   // an estimate of how valuable sub-graph matching will be
   float getSubgraphValue() const final { return getHighSubgraphValue(); }
 
+  // The gradient of the input may overwrite the incoming gradient
+  std::vector<std::tuple<popart::OperatorIdentifier, float>>
+  inplacePriorityDefault() const override {
+    return {{CustomGradOperators::HeavisideGradInplaceId, 10}};
+  }
+
+  // Implementation defined below
+  std::unique_ptr<popart::Op>
+  getInplaceVariant(const popart::OperatorIdentifier &id) const override;
+
   float getAlpha() const { return alpha; }
+  bool getHasThreshold() const { return hasThreshold; }
+  bool getCompact() const { return compact; }
 
   // Implementation defined below
   void appendAttributes(popart::OpSerialiserBase &os) const override;
@@ -51,37 +78,89 @@ public:
   // Implementation defined below
   void appendOutlineAttributes(popart::OpSerialiserBase &os) const override;
 
+protected:
+  HeavisideGradOp(const popart::OperatorIdentifier &_opid,
+                  const HeavisideGradOp &other)
+      : popart::Op(_opid, other.settings), alpha(other.alpha),
+        hasThreshold(other.hasThreshold), compact(other.compact),
+        thresholdInfo(other.thresholdInfo) {}
+
 private:
   float alpha;
+  bool hasThreshold;
+  bool compact;
+  popart::TensorInfo thresholdInfo;
 };
 
 class HeavisideOp : public popart::Op {
 public:
   HeavisideOp(const popart::OperatorIdentifier &_opid, float _alpha,
+              int64_t _packed, bool _compact, const std::string &_spikeDtype,
               const popart::Op::Settings &settings_)
-      : popart::Op(_opid, settings_), alpha(_alpha) {}
+      : popart::Op(_opid, settings_), alpha(_alpha), packed(_packed),
+        compact(_compact), spikeDtype(_spikeDtype) {}
   HeavisideOp(const popart::OperatorIdentifier &_opid,
               const popart::Op::Settings &settings_)
       : popart::Op(_opid, settings_) {}
 
-  std::unique_ptr<Op> clone() const final {
+  std::unique_ptr<Op> clone() const override {
     return std::make_unique<HeavisideOp>(*this);
   }
 
-  void setup() final { outInfo(0) = inInfo(0); }
+  // The optional second output is the detached reset mask. With `packed`,
+  // the spikes come out bit-packed (see spike_pack.hpp) instead. With
+  // saved = "compact", the third output is the spike mask packed to one bit
+  // per neuron, which the backward pass reads instead of the input.
+  // spike_dtype = "bool" / "uint8" emits the spikes at one byte each.
+  void setup() final {
+    if (getPacked()) {
+      if (output->hasIndex(1) || output->hasIndex(2)) {
+        throw popart::error("Heaviside: only the spikes are available with "
+                            "packed spikes");
+      }
+      if (neuron_step::compactSpikes(getSpikeDtype())) {
+        throw popart::error("Heaviside: packed spikes take no spike_dtype");
+      }
+      outInfo(0) = {popart::DataType::INT32,
+                    spike_pack::packedShape(inInfo(0).shape())};
+      return;
+    }
+    outInfo(0) = neuron_step::spikeInfo(inInfo(0), getSpikeDtype());
+    if (output->hasIndex(1)) {
+      outInfo(1) = inInfo(0);
+    }
+    if (getCompact() != output->hasIndex(2)) {
+      throw popart::error("Heaviside: the third (saved) output comes with, "
+                          "and only with, saved = 'compact'");
+    }
+    if (getCompact()) {
+      outInfo(2) = {popart::DataType::INT32,
+                    spike_pack::packedShape(inInfo(0).shape())};
+    }
+  }
 
   void appendAttributes(popart::OpSerialiserBase &os) const override {
     Op::appendAttributes(os);
     os.appendAttribute("alpha", getAlpha());
+    os.appendAttribute("packed", getPacked());
+    os.appendAttribute("saved", getCompact() ? "compact" : "input");
+    os.appendAttribute("spike_dtype", getSpikeDtype());
   }
 
   void appendOutlineAttributes(popart::OpSerialiserBase &os) const override {
     Op::appendOutlineAttributes(os);
     os.appendAttribute("alpha", getAlpha());
+    os.appendAttribute("packed", getPacked());
+    os.appendAttribute("saved", getCompact() ? "compact" : "input");
+    os.appendAttribute("spike_dtype", getSpikeDtype());
   }
 
+  // Packed or compact spikes carry no gradient
   std::vector<std::unique_ptr<popart::Op>> getGradOps() {
     std::vector<std::unique_ptr<Op>> upops;
+    if (getPacked() || neuron_step::compactSpikes(getSpikeDtype())) {
+      return upops;
+    }
     upops.emplace_back(new HeavisideGradOp(*this));
     return upops;
   }
@@ -90,22 +169,110 @@ public:
 
   bool requiresRandomSeed() const override { return false; }
 
+  // The spikes may overwrite the input, unless they are packed or compact
+  std::vector<std::tuple<popart::OperatorIdentifier, float>>
+  inplacePriorityDefault() const override {
+    if (getPacked() || neuron_step::compactSpikes(getSpikeDtype())) {
+      return {};
+    }
+    return {{CustomOperators::HeavisideInplaceId, 10}};
+  }
+
+  // Implementation defined below
+  std::unique_ptr<popart::Op>
+  getInplaceVariant(const popart::OperatorIdentifier &id) const override;
+
   // Attributes
   float getAlpha() const { return alpha; }
+  int64_t getPacked() const { return packed; }
+  bool getCompact() const { return compact; }
+  const std::string &getSpikeDtype() const { return spikeDtype; }
 
 private:
   float alpha;
+  int64_t packed = 0;
+  bool compact = false;
+  std::string spikeDtype = "input";
 };
 
+// Writes the spikes over the input, which output 0 then aliases
+class HeavisideInplaceOp : public HeavisideOp {
+public:
+  HeavisideInplaceOp(const HeavisideOp &op)
+      : HeavisideOp(CustomOperators::HeavisideInplaceId, op.getAlpha(),
+                    op.getPacked(), op.getCompact(), op.getSpikeDtype(),
+                    op.settings) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<HeavisideInplaceOp>(*this);
+  }
+
+  popart::view::Regions aliases(popart::InIndex in,
+                                popart::OutIndex out) const final {
+    if (in == 0 && out == 0) {
+      return {popart::view::Region::getFull(inShape(0))};
+    }
+    return Op::aliases(in, out);
+  }
+
+  popart::view::Regions modifies(popart::InIndex in) const final {
+    return aliases(in, 0);
+  }
+};
+
+std::unique_ptr<popart::Op>
+HeavisideOp::getInplaceVariant(const popart::OperatorIdentifier &id) const {
+  if (id == CustomOperators::HeavisideInplaceId) {
+    return std::make_unique<HeavisideInplaceOp>(*this);
+  }
+  return Op::getInplaceVariant(id);
+}
+
+// Writes the gradient of the input over the incoming gradient
+class HeavisideGradInplaceOp : public HeavisideGradOp {
+public:
+  HeavisideGradInplaceOp(const HeavisideGradOp &op)
+      : HeavisideGradOp(CustomGradOperators::HeavisideGradInplaceId, op) {}
+
+  std::unique_ptr<popart::Op> clone() const final {
+    return std::make_unique<HeavisideGradInplaceOp>(*this);
+  }
+
+  popart::view::Regions aliases(popart::InIndex in,
+                                popart::OutIndex out) const final {
+    if (in == 0 && out == 0) {
+      return {popart::view::Region::getFull(inShape(0))};
+    }
+    return Op::aliases(in, out);
+  }
+
+  popart::view::Regions modifies(popart::InIndex in) const final {
+    return aliases(in, 0);
+  }
+};
+
+std::unique_ptr<popart::Op> HeavisideGradOp::getInplaceVariant(
+    const popart::OperatorIdentifier &id) const {
+  if (id == CustomGradOperators::HeavisideGradInplaceId) {
+    return std::make_unique<HeavisideGradInplaceOp>(*this);
+  }
+  return Op::getInplaceVariant(id);
+}
+
 namespace {
 using popart::OpDefinition;
 using popart::DataType;
 
 static OpDefinition::DataTypes T = {DataType::FLOAT16, DataType::FLOAT};
+static OpDefinition::DataTypes TOrWords = {DataType::FLOAT16, DataType::FLOAT,
+                                           DataType::INT32, DataType::BOOL,
+                                           DataType::UINT8};
 
 static OpDefinition
-      HeavisideOpDef({OpDefinition::Inputs({{"input", T}}),
-                      OpDefinition::Outputs({{"output", T}}),
+      HeavisideOpDef({OpDefinition::Inputs({{"input", T}, {"threshold", T}}),
+                      OpDefinition::Outputs({{"output", TOrWords},
+                                             {"reset", T},
+                                             {"saved", {DataType::INT32}}}),
                       OpDefinition::Attributes()});
 
 static popart::OpCreator<HeavisideOp> HeavisideOpCreator(
@@ -114,7 +281,23 @@ static popart::OpCreator<HeavisideOp> HeavisideOpCreator(
         // default alpha is 10**(-2)
         float alpha = info.attributes.getAttribute<popart::Attributes::Float>(
             "alpha", 1e-2f);
-        return std::make_unique<HeavisideOp>(info.opid, alpha, info.settings);
+        // packed = 1 emits bit-packed spikes, see spike_pack.hpp
+        int64_t packed = info.attributes.getAttribute<popart::Attributes::Int>(
+            "packed", 0);
+        // saved = "compact" keeps a 1-bit mask for the backward pass
+        bool compact = neuron_step::checkSaved(
+            "Heaviside",
+            info.attributes.getAttribute<popart::Attributes::String>(
+                "saved", "input"));
+        // spike_dtype = "bool" / "uint8" emits one-byte spikes
+        std::string spikeDtype =
+            neuron_step::spikeDtypeAttribute("Heaviside", info.attributes);
+        int64_t recompute =
+            info.attributes.getAttribute<popart::Attributes::Int>("recompute",
+                                                                  0);
+        return std::make_unique<HeavisideOp>(
+            info.opid, alpha, packed, compact, spikeDtype,
+            neuron_step::recomputeSettings(info.settings, recompute));
         return std::make_unique<HeavisideOp>(info.opid, info.settings);
       },
       true);
@@ -126,8 +309,8 @@ class HeavisideOpx : public popart::popx::Opx {
 public:
   HeavisideOpx(popart::Op *op, popart::popx::Devicex *devicex)
       : popart::popx::Opx(op, devicex) {
-    verifyOp<HeavisideOp>(
-        op, {CustomOperators::HeavisideId});
+    verifyOp<HeavisideOp>(op, {CustomOperators::HeavisideId,
+                               CustomOperators::HeavisideInplaceId});
   }
 
   void grow(poplar::program::Sequence &prog) const final {
@@ -136,17 +319,78 @@ public:
 
     poplar::Tensor input = getInTensor(0);
 
-    float alpha = op.getAlpha();
-
-    // x < 0.0f ? 0:1
-    auto expression = pe::Select(pe::Const(0.0f), pe::Const(1.0f),
-                                 pe::Lt(pe::_1, pe::Const(0.0f)));
-
+    if (op.getPacked()) {
+      poplar::Tensor threshold = spike_codelets::thresholdOrZero(
+          graph(), hasInput(1), hasInput(1) ? getInTensor(1) : input, input,
+          prog, debugContext("threshold"));
+      setOutTensor(0, spike_pack::pack(graph(), input, threshold, prog,
+                                       debugContext("HeavisidePacked")));
+      return;
+    }
 
-    popops::mapInPlace(graph(), expression, {input}, prog,
-                       debugContext("Heaviside"), poplar::OptionFlags());
-
-    setOutTensor(0, input);
+    float alpha = op.getAlpha();
+    const bool inplace = op.opid == CustomOperators::HeavisideInplaceId;
+
+    poplar::Tensor output = input;
+    if (spike_codelets::addCodelets(graph())) {
+      // Vectorised vertices, see codelets/spike_codelets.cpp; the inplace
+      // variant writes the spikes over the input
+      poplar::Tensor threshold = spike_codelets::thresholdOrZero(
+          graph(), hasInput(1), hasInput(1) ? getInTensor(1) : input, input,
+          prog, debugContext("threshold"));
+      if (inplace) {
+        spike_codelets::spikeInPlace(graph(), input, threshold, prog,
+                                     debugContext("Heaviside"));
+      } else {
+        output = spike_codelets::spike(graph(), input, threshold, prog,
+                                       debugContext("Heaviside"));
+      }
+    } else {
+      // x < 0.0f ? 0:1, or x < threshold with a threshold input, so that
+      // mem - threshold is never materialised
+      std::vector<poplar::Tensor> ins = {input};
+      std::unique_ptr<pe::Expr> expression =
+          pe::Select(pe::Const(0.0f), pe::Const(1.0f),
+                     pe::Lt(pe::_1, pe::Const(0.0f)))
+              .clone();
+      if (hasInput(1)) {
+        ins.push_back(neuron_step::broadcastParam(
+            graph(), getInTensor(1), input.elementType(), input.shape(), prog,
+            debugContext("threshold")));
+        expression = pe::Select(pe::Const(0.0f), pe::Const(1.0f),
+                                pe::Lt(pe::_1, pe::_2))
+                         .clone();
+      }
+      // The inplace variant writes the spikes over the input
+      if (inplace) {
+        popops::mapInPlace(graph(), *expression, ins, prog,
+                           debugContext("Heaviside"), poplar::OptionFlags());
+      } else {
+        output = popops::map(graph(), *expression, ins, prog,
+                             debugContext("Heaviside"), poplar::OptionFlags());
+      }
+    }
+
+    // The reset takes the same value as the spike, but is a separate tensor
+    // that the grad op never reads, so it carries no gradient.
+    if (hasOutput(1)) {
+      auto reset = graph().clone(output, debugContext("HeavisideReset"));
+      prog.add(poplar::program::Copy(output, reset, false,
+                                     debugContext("HeavisideReset")));
+      setOutTensor(1, reset);
+    }
+
+    // The spikes are the mask the backward pass needs, at one bit each
+    if (hasOutput(2)) {
+      auto threshold = spike_pack::spikeThreshold(
+          graph(), output.elementType(), debugContext("threshold"));
+      setOutTensor(2, spike_pack::pack(graph(), output, threshold, prog,
+                                       debugContext("HeavisideSaved")));
+    }
+
+    setOutTensor(0, neuron_step::castSpikes(graph(), output,
+                                            op.getSpikeDtype(), prog,
+                                            debugContext("HeavisideSpikes")));
   }
 };
 
@@ -154,7 +398,9 @@ class HeavisideGradOpx : public popart::popx::Opx {
 public:
   HeavisideGradOpx(popart::Op *op, popart::popx::Devicex *devicex)
       : popart::popx::Opx(op, devicex) {
-    verifyOp<HeavisideGradOp>(op, {CustomGradOperators::HeavisideGradId});
+    verifyOp<HeavisideGradOp>(op,
+                              {CustomGradOperators::HeavisideGradId,
+                               CustomGradOperators::HeavisideGradInplaceId});
   }
 
   void grow(poplar::program::Sequence &prog) const final {
@@ -164,50 +410,137 @@ public:
     poplar::Tensor grad = getInTensor(0);
     poplar::Tensor input = getInTensor(1);
 
-    float alpha = op.getAlpha();
-
-    // (grad * (x < 0.0f ? alpha : 1))
-    pe::Mul expression = pe::Mul(pe::Select(pe::Const(0.0f), pe::Const(1.0f),
-                                            pe::Lt(pe::_2, pe::Const(0.0f))),
-                                 pe::_1);
-
-    auto output =
-        popops::map(graph(), expression, {grad, input}, prog,
-                    debugContext("HeavisideGrad"), poplar::OptionFlags());
+    // The inplace variant writes the gradient over the incoming one
+    const bool inplace =
+        op.opid == CustomGradOperators::HeavisideGradInplaceId;
+
+    poplar::Tensor output = grad;
+    if (op.getCompact()) {
+      // grad * spike, with the spikes unpacked from the saved mask
+      const std::size_t n = grad.rank() == 0 ? 1 : grad.dim(grad.rank() - 1);
+      auto mask = spike_pack::unpack(graph(), input, n, grad.elementType(),
+                                     prog, debugContext("HeavisideGradMask"));
+      if (inplace) {
+        popops::mapInPlace(graph(), pe::Mul(pe::_1, pe::_2),
+                           {grad, mask.reshape(grad.shape())}, prog,
+                           debugContext("HeavisideGrad"));
+      } else {
+        output = popops::map(graph(), pe::Mul(pe::_1, pe::_2),
+                             {grad, mask.reshape(grad.shape())}, prog,
+                             debugContext("HeavisideGrad"));
+      }
+    } else if (spike_codelets::addCodelets(graph())) {
+      // Vectorised vertices, see codelets/spike_codelets.cpp
+      poplar::Tensor threshold = spike_codelets::thresholdOrZero(
+          graph(), op.getHasThreshold(),
+          op.getHasThreshold() ? getInTensor(2) : input, input, prog,
+          debugContext("threshold"));
+      if (inplace) {
+        spike_codelets::heavisideGradInPlace(graph(), grad, input, threshold,
+                                             prog,
+                                             debugContext("HeavisideGrad"));
+      } else {
+        output = spike_codelets::heavisideGrad(
+            graph(), grad, input, threshold, prog,
+            debugContext("HeavisideGrad"));
+      }
+    } else {
+      // With a threshold input, x is mem - threshold evaluated inside the map
+      std::vector<poplar::Tensor> ins = {grad, input};
+      std::unique_ptr<pe::Expr> x = pe::_2.clone();
+      if (op.getHasThreshold()) {
+        ins.push_back(neuron_step::broadcastParam(
+            graph(), getInTensor(2), input.elementType(), input.shape(), prog,
+            debugContext("threshold")));
+        x = pe::Sub(pe::_2, pe::_3).clone();
+      }
+
+      float alpha = op.getAlpha();
+
+      // (grad * (x < 0.0f ? alpha : 1))
+      pe::Mul expression = pe::Mul(pe::Select(pe::Const(0.0f), pe::Const(1.0f),
+                                              pe::Lt(*x, pe::Const(0.0f))),
+                                   pe::_1);
+
+      if (inplace) {
+        popops::mapInPlace(graph(), expression, ins, prog,
+                           debugContext("HeavisideGrad"),
+                           poplar::OptionFlags());
+      } else {
+        output =
+            popops::map(graph(), expression, ins, prog,
+                        debugContext("HeavisideGrad"), poplar::OptionFlags());
+      }
+    }
 
     setOutTensor(0, output);
+
+    // d(mem - threshold)/dthreshold = -1
+    if (op.getHasThreshold()) {
+      poplar::Tensor threshold = getInTensor(2);
+      auto gradThreshold = neuron_step::reduceToShape(
+          graph(), output, threshold.shape(), threshold.elementType(), prog,
+          debugContext("HeavisideGradThresholdReduce"));
+      gradThreshold = popops::map(graph(), pe::Neg(pe::_1), {gradThreshold},
+                                  prog, debugContext("HeavisideGradThreshold"));
+      setOutTensor(1, gradThreshold);
+    }
   }
 };
 
 HeavisideGradOp::HeavisideGradOp(const HeavisideOp &fwdOp)
     : popart::Op(CustomGradOperators::HeavisideGradId, fwdOp.settings),
-      alpha(fwdOp.getAlpha()) {}
+      alpha(fwdOp.getAlpha()), hasThreshold(fwdOp.input->hasIndex(1)),
+      compact(fwdOp.getCompact()) {
+  if (hasThreshold) {
+    thresholdInfo = fwdOp.inInfo(1);
+  }
+}
 
 const std::vector<popart::GradInOutMapper> &
 HeavisideGradOp::gradInputInfo() const {
   static const std::vector<popart::GradInOutMapper> inInfo = {
       {0, 0, popart::GradOpInType::GradOut}, {1, 0, popart::GradOpInType::In}};
-  return inInfo;
+  static const std::vector<popart::GradInOutMapper> inInfoWithThreshold = {
+      {0, 0, popart::GradOpInType::GradOut},
+      {1, 0, popart::GradOpInType::In},
+      {2, 1, popart::GradOpInType::In}};
+  // saved = "compact": the packed mask (forward output 2) in place of the input
+  static const std::vector<popart::GradInOutMapper> inInfoCompact = {
+      {0, 0, popart::GradOpInType::GradOut}, {1, 2, popart::GradOpInType::Out}};
+  static const std::vector<popart::GradInOutMapper>
+      inInfoCompactWithThreshold = {{0, 0, popart::GradOpInType::GradOut},
+                                    {1, 2, popart::GradOpInType::Out},
+                                    {2, 1, popart::GradOpInType::In}};
+  if (compact) {
+    return hasThreshold ? inInfoCompactWithThreshold : inInfoCompact;
+  }
+  return hasThreshold ? inInfoWithThreshold : inInfo;
 }
 
-// The Grad Op has 1 output, which is the gradient of the only input
+// The Grad Op has 1 output per forward input: the gradient of the input
+// and, when the threshold is passed in, of the threshold
 const std::map<int, int> &HeavisideGradOp::gradOutToNonGradIn() const {
   static const std::map<int, int> outInfo = {{0, 0}};
-  return outInfo;
+  static const std::map<int, int> outInfoWithThreshold = {{0, 0}, {1, 1}};
+  return hasThreshold ? outInfoWithThreshold : outInfo;
 }
 
 void HeavisideGradOp::appendAttributes(popart::OpSerialiserBase &os) const {
   Op::appendAttributes(os);
   os.appendAttribute("alpha", getAlpha());
+  os.appendAttribute("saved", getCompact() ? "compact" : "input");
 }
 
 void HeavisideGradOp::appendOutlineAttributes(
     popart::OpSerialiserBase &os) const {
   Op::appendOutlineAttributes(os);
   os.appendAttribute("alpha", getAlpha());
+  os.appendAttribute("saved", getCompact() ? "compact" : "input");
 }
 
 static popart::popx::OpxCreator<HeavisideOpx> HeavisideOpxCreator(
-    {CustomOperators::HeavisideId});
+    {CustomOperators::HeavisideId, CustomOperators::HeavisideInplaceId});
 static popart::popx::OpxCreator<HeavisideGradOpx>
-    HeavisideGradOpxCreator({CustomGradOperators::HeavisideGradId});
+    HeavisideGradOpxCreator({CustomGradOperators::HeavisideGradId,
+                             CustomGradOperators::HeavisideGradInplaceId});
@@ -0,0 +1,341 @@
+// Winner-take-all firing, the op behind `SpikingNeuron.fire_inhibition`.
+//
+// Takes (mem, [threshold]) of shape [batch, neurons] and returns
+// (spk, [reset]), where with u = mem - threshold
+//
+//   winner = argmax(u[b, :])                     (the first one on ties)
+//   spk    = u >= 0 where n == winner, 0 elsewhere
+//   reset  = u >= 0, detached
+//
+// so only the neuron with the largest shifted membrane of each row may fire,
+// while the reset stays that of every neuron above threshold, as
+// `mem_reset` gives it. The backward pass is grad * dS/dU at u for the
+// winner of each row and 0 for the inhibited neurons, the argmax itself
+// carrying no gradient; see neuron_step::surrogateGrad for the surrogates.
+//
+// The winner is found with two row reductions, the largest u and then the
+// first column holding it, and no one-hot mask or scatter is materialised:
+// the column index is compared against the winner inside the spike map.
+// The grad op finds the winners again rather than keep them alive.
+#include <popart/error.hpp>
+#include <popart/opmanager.hpp>
+#include <popart/opserialiser.hpp>
+#include <popart/popx/opx.hpp>
+#include <popart/popx/opxmanager.hpp>
+
+#include <popops/ElementWise.hpp>
+#include <popops/Reduce.hpp>
+#include <poputil/Broadcast.hpp>
+
+#include <vector>
+
+#include "neuron_step.hpp"
+
+namespace CustomOperators {
+const popart::OperatorIdentifier InhibitedFireId = {"custom.ops",
+                                                    "InhibitedFire", 1};
+} // namespace CustomOperators
+namespace CustomGradOperators {
+const popart::OperatorIdentifier InhibitedFireGradId = {
+    "custom.ops", "InhibitedFireGrad", 1};
+} // namespace CustomGradOperators
+
+class InhibitedFireOp;
+class InhibitedFireOpx;
+class InhibitedFireGradOpx;
+
+class InhibitedFireGradOp : public popart::Op {
+public:
+  InhibitedFireGradOp(const InhibitedFireOp &fwdOp);
+
+  std::unique_ptr<popart::Op> clone() const final {
+    return std::make_unique<InhibitedFireGradOp>(*this);
+  }
+  void setup() final {
+    outInfo(0) = inInfo(1);
+    if (hasThreshold) {
+      outInfo(1) = thresholdInfo;
+    }
+  };
+
+  const std::vector<popart::GradInOutMapper> &gradInputInfo() const;
+
+  // The Grad Op has 1 output per forward input: the gradient of mem and,
+  // when the threshold is passed in, of the threshold
+  const std::map<int, int> &gradOutToNonGradIn() const;
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // an estimate of how valuable sub-graph matching will be
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+  bool getHasThreshold() const { return hasThreshold; }
+
+  // Implementation defined below
+  void appendAttributes(popart::OpSerialiserBase &os) const override;
+
+  // Implementation defined below
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override;
+
+private:
+  neuron_step::Surrogate surrogate;
+  bool hasThreshold;
+  popart::TensorInfo thresholdInfo;
+};
+
+class InhibitedFireOp : public popart::Op {
+public:
+  InhibitedFireOp(const popart::OperatorIdentifier &_opid,
+                  const neuron_step::Surrogate &_surrogate,
+                  const popart::Op::Settings &settings_)
+      : popart::Op(_opid, settings_), surrogate(_surrogate) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<InhibitedFireOp>(*this);
+  }
+
+  // The optional second output is the detached reset mask
+  void setup() final {
+    if (inInfo(0).rank() != 2) {
+      throw popart::error("InhibitedFire: expected mem of shape "
+                          "[batch, neurons], got rank {}",
+                          inInfo(0).rank());
+    }
+    outInfo(0) = inInfo(0);
+    if (output->hasIndex(1)) {
+      outInfo(1) = inInfo(0);
+    }
+  }
+
+  void appendAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendAttributes(os);
+    neuron_step::appendSurrogate(os, getSurrogate());
+  }
+
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendOutlineAttributes(os);
+    neuron_step::appendSurrogate(os, getSurrogate());
+  }
+
+  std::vector<std::unique_ptr<popart::Op>> getGradOps() {
+    std::vector<std::unique_ptr<Op>> upops;
+    upops.emplace_back(new InhibitedFireGradOp(*this));
+    return upops;
+  }
+
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // Attributes
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+
+private:
+  neuron_step::Surrogate surrogate;
+};
+
+namespace {
+using popart::DataType;
+using popart::OpDefinition;
+
+static OpDefinition::DataTypes T = {DataType::FLOAT16, DataType::FLOAT};
+
+static OpDefinition InhibitedFireOpDef(
+    {OpDefinition::Inputs({{"mem", T}, {"threshold", T}}),
+     OpDefinition::Outputs({{"output", T}, {"reset", T}}),
+     OpDefinition::Attributes(
+         {{"surrogate", {"*"}}, {"slope", {"*"}}, {"beta", {"*"}}})});
+
+static popart::OpCreator<InhibitedFireOp> InhibitedFireOpCreator(
+    popart::OpDefinitions({{CustomOperators::InhibitedFireId,
+                            InhibitedFireOpDef}}),
+    [](const popart::OpCreatorInfo &info) {
+      neuron_step::Surrogate surrogate = neuron_step::surrogateAttributes(
+          "InhibitedFire", info.attributes, "fast_sigmoid");
+      return std::make_unique<InhibitedFireOp>(info.opid, surrogate,
+                                               info.settings);
+    },
+    true);
+} // namespace
+
+namespace pe = popops::expr;
+namespace ns = neuron_step;
+
+namespace {
+// The shifted membrane u = mem - threshold, or mem itself without threshold
+poplar::Tensor shiftedMem(poplar::Graph &graph, const poplar::Tensor &mem,
+                          bool hasThreshold, const poplar::Tensor &threshold,
+                          poplar::program::Sequence &prog,
+                          const poplar::DebugContext &dc) {
+  if (!hasThreshold) {
+    return mem;
+  }
+  auto thr = ns::broadcastParam(graph, threshold, mem.elementType(),
+                                mem.shape(), prog, dc);
+  return popops::map(graph, pe::Sub(pe::_1, pe::_2), {mem, thr}, prog, dc);
+}
+
+// The column index of every element of u, and the column of the winner of
+// its row, both broadcast to the shape of u, so that the one-hot of the
+// winners is Equal(columns, winners) inside the map that uses it
+struct Winners {
+  poplar::Tensor columns;
+  poplar::Tensor winners;
+};
+
+Winners findWinners(poplar::Graph &graph, const poplar::Tensor &u,
+                    poplar::program::Sequence &prog,
+                    const poplar::DebugContext &dc) {
+  const auto numColumns = u.dim(1);
+
+  std::vector<float> index(numColumns);
+  for (std::size_t n = 0; n < numColumns; ++n) {
+    index[n] = static_cast<float>(n);
+  }
+  auto columns =
+      graph.addConstant(poplar::FLOAT, {1, numColumns}, index.data(), dc);
+  graph.setTileMapping(columns, 0);
+  poputil::broadcastToMatch(columns, u.shape());
+
+  // Largest u of each row, then the first column holding it
+  auto largest = popops::reduce(graph, u, {1}, {popops::Operation::MAX},
+                                prog, dc);
+  auto candidates = popops::map(
+      graph,
+      pe::Select(pe::_3, pe::Const(static_cast<float>(numColumns)),
+                 pe::Equal(pe::_1, pe::_2)),
+      {u, largest.expand({1}).broadcast(numColumns, 1), columns}, prog, dc);
+  auto winners = popops::reduce(graph, candidates, {1},
+                                {popops::Operation::MIN}, prog, dc);
+
+  return {columns, winners.expand({1}).broadcast(numColumns, 1)};
+}
+} // namespace
+
+class InhibitedFireOpx : public popart::popx::Opx {
+public:
+  InhibitedFireOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<InhibitedFireOp>(op, {CustomOperators::InhibitedFireId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+    poplar::Tensor mem = getInTensor(0);
+
+    poplar::Tensor u = shiftedMem(
+        graph(), mem, hasInput(1), hasInput(1) ? getInTensor(1) : mem, prog,
+        debugContext("InhibitedFireShift"));
+    Winners w = findWinners(graph(), u, prog,
+                            debugContext("InhibitedFireWinners"));
+
+    // u >= 0 for the winner of each row, 0 for the others
+    poplar::Tensor output = popops::map(
+        graph(),
+        pe::Cast(pe::Select(pe::Const(1.0f), pe::Const(0.0f),
+                            pe::And(pe::Equal(pe::_1, pe::_2),
+                                    pe::Gte(pe::_3, pe::Const(0.0f)))),
+                 mem.elementType()),
+        {w.columns, w.winners, u}, prog, debugContext("InhibitedFire"));
+
+    setOutTensor(0, output);
+
+    // The reset of every neuron above threshold, which the grad op never
+    // reads, so it carries no gradient
+    if (hasOutput(1)) {
+      setOutTensor(1, popops::map(graph(), ns::spike(pe::_1, pe::Const(0.0f)),
+                                  {u}, prog,
+                                  debugContext("InhibitedFireReset")));
+    }
+  }
+};
+
+class InhibitedFireGradOpx : public popart::popx::Opx {
+public:
+  InhibitedFireGradOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<InhibitedFireGradOp>(op,
+                                  {CustomGradOperators::InhibitedFireGradId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+    auto op = getOp<InhibitedFireGradOp>();
+
+    poplar::Tensor grad = getInTensor(0);
+    poplar::Tensor mem = getInTensor(1);
+
+    poplar::Tensor u = shiftedMem(
+        graph(), mem, op.getHasThreshold(),
+        op.getHasThreshold() ? getInTensor(2) : mem, prog,
+        debugContext("InhibitedFireGradShift"));
+    Winners w = findWinners(graph(), u, prog,
+                            debugContext("InhibitedFireGradWinners"));
+
+    // grad * dS/dU for the winners, 0 for the inhibited neurons
+    auto surrogate = ns::surrogateGrad(op.getSurrogate(), pe::_2);
+    poplar::Tensor output = popops::map(
+        graph(),
+        pe::Select(pe::Mul(pe::_1, *surrogate), pe::Const(0.0f),
+                   pe::Equal(pe::_3, pe::_4)),
+        {grad, u, w.columns, w.winners}, prog,
+        debugContext("InhibitedFireGrad"));
+
+    setOutTensor(0, output);
+
+    // d(mem - threshold)/dthreshold = -1
+    if (op.getHasThreshold()) {
+      poplar::Tensor threshold = getInTensor(2);
+      auto gradThreshold = ns::reduceToShape(
+          graph(), output, threshold.shape(), threshold.elementType(), prog,
+          debugContext("InhibitedFireGradThresholdReduce"));
+      popops::mapInPlace(graph(), pe::Neg(pe::_1), {gradThreshold}, prog,
+                         debugContext("InhibitedFireGradThreshold"));
+      setOutTensor(1, gradThreshold);
+    }
+  }
+};
+
+InhibitedFireGradOp::InhibitedFireGradOp(const InhibitedFireOp &fwdOp)
+    : popart::Op(CustomGradOperators::InhibitedFireGradId, fwdOp.settings),
+      surrogate(fwdOp.getSurrogate()),
+      hasThreshold(fwdOp.input->hasIndex(1)) {
+  if (hasThreshold) {
+    thresholdInfo = fwdOp.inInfo(1);
+  }
+}
+
+const std::vector<popart::GradInOutMapper> &
+InhibitedFireGradOp::gradInputInfo() const {
+  static const std::vector<popart::GradInOutMapper> inInfo = {
+      {0, 0, popart::GradOpInType::GradOut}, {1, 0, popart::GradOpInType::In}};
+  static const std::vector<popart::GradInOutMapper> inInfoWithThreshold = {
+      {0, 0, popart::GradOpInType::GradOut},
+      {1, 0, popart::GradOpInType::In},
+      {2, 1, popart::GradOpInType::In}};
+  return hasThreshold ? inInfoWithThreshold : inInfo;
+}
+
+// The Grad Op has 1 output per forward input: the gradient of mem and,
+// when the threshold is passed in, of the threshold
+const std::map<int, int> &InhibitedFireGradOp::gradOutToNonGradIn() const {
+  static const std::map<int, int> outInfo = {{0, 0}};
+  static const std::map<int, int> outInfoWithThreshold = {{0, 0}, {1, 1}};
+  return hasThreshold ? outInfoWithThreshold : outInfo;
+}
+
+void InhibitedFireGradOp::appendAttributes(
+    popart::OpSerialiserBase &os) const {
+  Op::appendAttributes(os);
+  ns::appendSurrogate(os, getSurrogate());
+}
+
+void InhibitedFireGradOp::appendOutlineAttributes(
+    popart::OpSerialiserBase &os) const {
+  Op::appendOutlineAttributes(os);
+  ns::appendSurrogate(os, getSurrogate());
+}
+
+static popart::popx::OpxCreator<InhibitedFireOpx>
+    InhibitedFireOpxCreator({CustomOperators::InhibitedFireId});
+static popart::popx::OpxCreator<InhibitedFireGradOpx>
+    InhibitedFireGradOpxCreator({CustomGradOperators::InhibitedFireGradId});
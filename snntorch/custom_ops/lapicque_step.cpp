@@ -0,0 +1,534 @@
+// Fused single-timestep Lapicque (RC circuit) neuron, the op behind
+// `Lapicque`.
+//
+// Takes (input, mem, threshold, [R, C]) and returns (spk, mem_next), where
+//
+//   decay    = 1 - time_step / (R * C)
+//   gain     = time_step / C
+//   reset    = mem >= threshold                        (detached)
+//   mem_next = decay * mem + gain * input - reset * threshold
+//   spk      = mem_next >= threshold
+//
+// for the default reset-by-subtraction, the same update as LeakyStep with
+// the decay taken from the circuit (and left unclamped, as in Lapicque).
+// `time_step` is an attribute. R and C are either the `R` and `C` float
+// attributes, in which case decay and gain are folded into the compiled
+// map as constants, or tensors of one value or one per neuron, in which
+// case decay and gain are computed once per step over their shape rather
+// than per neuron, and the grad op also returns their gradients.
+// `reset_mechanism` follows `SpikingNeuron.reset_dict` (0: subtract,
+// 1: zero, 2: none) and `surrogate` selects the gradient used for dS/dU in
+// the backward pass. `spike_dtype` = "bool" / "uint8" emits spk at one byte
+// per neuron while mem_next keeps the type of the input; the op then has no
+// grad op.
+#include <popart/error.hpp>
+#include <popart/opmanager.hpp>
+#include <popart/opserialiser.hpp>
+#include <popart/popx/opx.hpp>
+#include <popart/popx/opxmanager.hpp>
+
+#include <popops/ElementWise.hpp>
+#include <poputil/Broadcast.hpp>
+
+#include <utility>
+
+#include "neuron_step.hpp"
+
+namespace CustomOperators {
+const popart::OperatorIdentifier LapicqueStepId = {"custom.ops",
+                                                   "LapicqueStep", 1};
+} // namespace CustomOperators
+namespace CustomGradOperators {
+const popart::OperatorIdentifier LapicqueStepGradId = {"custom.ops",
+                                                       "LapicqueStepGrad", 1};
+} // namespace CustomGradOperators
+
+// The `time_step`, `R` and `C` attributes
+struct RCCircuit {
+  float timeStep;
+  float r;
+  float c;
+
+  float decay() const { return 1.0f - timeStep / (r * c); }
+  float gain() const { return timeStep / c; }
+};
+
+class LapicqueStepOp;
+class LapicqueStepOpx;
+class LapicqueStepGradOpx;
+
+class LapicqueStepGradOp : public popart::Op {
+public:
+  LapicqueStepGradOp(const LapicqueStepOp &fwdOp);
+
+  std::unique_ptr<popart::Op> clone() const final {
+    return std::make_unique<LapicqueStepGradOp>(*this);
+  }
+
+  // One gradient per forward input: input, mem, threshold and, when given,
+  // R and C
+  void setup() final {
+    for (int i = 0; i < static_cast<int>(fwdInInfo.size()); ++i) {
+      outInfo(i) = fwdInInfo[i];
+    }
+  };
+
+  const std::vector<popart::GradInOutMapper> &gradInputInfo() const;
+
+  const std::map<int, int> &gradOutToNonGradIn() const;
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // an estimate of how valuable sub-graph matching will be
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  int64_t getResetMechanism() const { return resetMechanism; }
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+  const RCCircuit &getCircuit() const { return circuit; }
+  bool getHasRC() const { return fwdInInfo.size() > 3; }
+
+  // Implementation defined below
+  void appendAttributes(popart::OpSerialiserBase &os) const override;
+
+  // Implementation defined below
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override;
+
+private:
+  int64_t resetMechanism;
+  neuron_step::Surrogate surrogate;
+  RCCircuit circuit;
+  std::vector<popart::TensorInfo> fwdInInfo;
+};
+
+class LapicqueStepOp : public popart::Op {
+public:
+  LapicqueStepOp(const popart::OperatorIdentifier &_opid,
+                 int64_t _resetMechanism,
+                 const neuron_step::Surrogate &_surrogate,
+                 const RCCircuit &_circuit, const std::string &_spikeDtype,
+                 const popart::Op::Settings &settings_)
+      : popart::Op(_opid, settings_), resetMechanism(_resetMechanism),
+        surrogate(_surrogate), circuit(_circuit), spikeDtype(_spikeDtype) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<LapicqueStepOp>(*this);
+  }
+
+  // spk and mem_next both take the shape and type of the input current,
+  // unless spk is emitted as a compact spike_dtype
+  void setup() final {
+    if (hasInput(3) != hasInput(4)) {
+      throw popart::error("LapicqueStep: R and C go together");
+    }
+    outInfo(0) = neuron_step::spikeInfo(inInfo(0), getSpikeDtype());
+    outInfo(1) = inInfo(0);
+  }
+
+  void appendAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendAttributes(os);
+    os.appendAttribute("reset_mechanism", getResetMechanism());
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("time_step", circuit.timeStep);
+    os.appendAttribute("R", circuit.r);
+    os.appendAttribute("C", circuit.c);
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendOutlineAttributes(os);
+    os.appendAttribute("reset_mechanism", getResetMechanism());
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("time_step", circuit.timeStep);
+    os.appendAttribute("R", circuit.r);
+    os.appendAttribute("C", circuit.c);
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  // Compact spikes carry no gradient
+  std::vector<std::unique_ptr<popart::Op>> getGradOps() {
+    std::vector<std::unique_ptr<Op>> upops;
+    if (neuron_step::compactSpikes(getSpikeDtype())) {
+      return upops;
+    }
+    upops.emplace_back(new LapicqueStepGradOp(*this));
+    return upops;
+  }
+
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // Attributes
+  int64_t getResetMechanism() const { return resetMechanism; }
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+  const RCCircuit &getCircuit() const { return circuit; }
+  const std::string &getSpikeDtype() const { return spikeDtype; }
+
+private:
+  int64_t resetMechanism;
+  neuron_step::Surrogate surrogate;
+  RCCircuit circuit;
+  std::string spikeDtype;
+};
+
+namespace {
+using popart::DataType;
+using popart::OpDefinition;
+
+static OpDefinition::DataTypes T = {DataType::FLOAT16, DataType::FLOAT};
+static OpDefinition::DataTypes Spikes = {DataType::FLOAT16, DataType::FLOAT,
+                                         DataType::BOOL, DataType::UINT8};
+
+static OpDefinition
+    LapicqueStepOpDef({OpDefinition::Inputs({{"input", T},
+                                             {"mem", T},
+                                             {"threshold", T},
+                                             {"R", T},
+                                             {"C", T}}),
+                       OpDefinition::Outputs({{"spk", Spikes},
+                                              {"mem_next", T}}),
+                       OpDefinition::Attributes({{"reset_mechanism", {"*"}},
+                                                 {"surrogate", {"*"}},
+                                                 {"slope", {"*"}},
+                                                 {"beta", {"*"}},
+                                                 {"time_step", {"*"}},
+                                                 {"R", {"*"}},
+                                                 {"C", {"*"}},
+                                                 {"spike_dtype", {"*"}}})});
+
+static popart::OpCreator<LapicqueStepOp> LapicqueStepOpCreator(
+    popart::OpDefinitions(
+        {{CustomOperators::LapicqueStepId, LapicqueStepOpDef}}),
+    [](const popart::OpCreatorInfo &info) {
+      // default reset mechanism is subtraction, see SpikingNeuron.reset_dict
+      int64_t resetMechanism =
+          info.attributes.getAttribute<popart::Attributes::Int>(
+              "reset_mechanism", 0);
+      neuron_step::checkResetMechanism("LapicqueStep", resetMechanism);
+      neuron_step::Surrogate surrogate = neuron_step::surrogateAttributes(
+          "LapicqueStep", info.attributes, "fast_sigmoid");
+      RCCircuit circuit;
+      circuit.timeStep =
+          info.attributes.getAttribute<popart::Attributes::Float>(
+              "time_step", 1.0f);
+      circuit.r =
+          info.attributes.getAttribute<popart::Attributes::Float>("R", 1.0f);
+      circuit.c =
+          info.attributes.getAttribute<popart::Attributes::Float>("C", 1.0f);
+      if (circuit.r == 0.0f || circuit.c == 0.0f) {
+        throw popart::error("LapicqueStep: R and C must be non-zero, got "
+                            "R = {} and C = {}",
+                            circuit.r, circuit.c);
+      }
+      std::string spikeDtype =
+          neuron_step::spikeDtypeAttribute("LapicqueStep", info.attributes);
+      return std::make_unique<LapicqueStepOp>(info.opid, resetMechanism,
+                                              surrogate, circuit, spikeDtype,
+                                              info.settings);
+    },
+    true);
+} // namespace
+
+namespace pe = popops::expr;
+namespace ns = neuron_step;
+
+namespace {
+// R and C cast to `type` and broadcast against each other
+std::pair<poplar::Tensor, poplar::Tensor>
+rcParams(poplar::Graph &graph, poplar::Tensor r, poplar::Tensor c,
+         const poplar::Type &type, poplar::program::Sequence &prog,
+         const poplar::DebugContext &dc) {
+  if (r.elementType() != type) {
+    r = popops::cast(graph, r, type, prog, dc);
+  }
+  if (c.elementType() != type) {
+    c = popops::cast(graph, c, type, prog, dc);
+  }
+  poputil::broadcastToMatch(r, c);
+  return {r, c};
+}
+
+// decay = 1 - time_step / (R * C) and gain = time_step / C, over the shape
+// of R and C rather than that of the neurons
+std::pair<poplar::Tensor, poplar::Tensor>
+decayAndGain(poplar::Graph &graph, const poplar::Tensor &r,
+             const poplar::Tensor &c, float timeStep,
+             poplar::program::Sequence &prog, const poplar::DebugContext &dc) {
+  const auto dt = pe::Const(timeStep);
+  auto decay = popops::map(
+      graph, pe::Sub(pe::Const(1.0f), pe::Divide(dt, pe::Mul(pe::_1, pe::_2))),
+      {r, c}, prog, dc);
+  auto gain = popops::map(graph, pe::Divide(dt, pe::_1), {c}, prog, dc);
+  return {decay, gain};
+}
+} // namespace
+
+class LapicqueStepOpx : public popart::popx::Opx {
+public:
+  LapicqueStepOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<LapicqueStepOp>(op, {CustomOperators::LapicqueStepId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+
+    auto op = getOp<LapicqueStepOp>();
+
+    poplar::Tensor input = getInTensor(0);
+    poplar::Tensor mem = getInTensor(1);
+    auto type = input.elementType();
+    poplar::Tensor threshold =
+        ns::broadcastParam(graph(), getInTensor(2), type, input.shape(),
+                           prog, debugContext("threshold"));
+
+    // _1: input, _2: mem, _3: threshold and, for R and C tensors,
+    // _4: decay, _5: gain
+    std::vector<poplar::Tensor> ins = {input, mem, threshold};
+    std::unique_ptr<pe::Expr> decay =
+        pe::Const(op.getCircuit().decay()).clone();
+    std::unique_ptr<pe::Expr> gain = pe::Const(op.getCircuit().gain()).clone();
+    if (hasInput(3)) {
+      auto rc = rcParams(graph(), getInTensor(3), getInTensor(4), type, prog,
+                         debugContext("rc"));
+      auto decayGain =
+          decayAndGain(graph(), rc.first, rc.second, op.getCircuit().timeStep,
+                       prog, debugContext("LapicqueStepDecay"));
+      ins.push_back(ns::broadcastParam(graph(), decayGain.first, type,
+                                       input.shape(), prog,
+                                       debugContext("decay")));
+      ins.push_back(ns::broadcastParam(graph(), decayGain.second, type,
+                                       input.shape(), prog,
+                                       debugContext("gain")));
+      decay = pe::_4.clone();
+      gain = pe::_5.clone();
+    }
+
+    auto memNextExpr = ns::decayMemNext(op.getResetMechanism(),
+                                        pe::Mul(*gain, pe::_1), pe::_2,
+                                        *decay, pe::_3);
+    auto memNext = popops::map(graph(), *memNextExpr, ins, prog,
+                               debugContext("LapicqueStepMem"));
+
+    auto spkExpr =
+        ns::spikeOutput(ns::spike(pe::_1, pe::_2), op.getSpikeDtype());
+    auto spk = popops::map(graph(), *spkExpr, {memNext, threshold}, prog,
+                           debugContext("LapicqueStepSpike"));
+
+    setOutTensor(0, spk);
+    setOutTensor(1, memNext);
+  }
+};
+
+class LapicqueStepGradOpx : public popart::popx::Opx {
+public:
+  LapicqueStepGradOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<LapicqueStepGradOp>(op,
+                                 {CustomGradOperators::LapicqueStepGradId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+
+    auto op = getOp<LapicqueStepGradOp>();
+    const RCCircuit &circuit = op.getCircuit();
+
+    poplar::Tensor mem = getInTensor(2);
+    poplar::Tensor thresholdIn = getInTensor(3);
+    poplar::Tensor memNext = getInTensor(4);
+    // A loss on the states alone leaves no gradient for spk
+    poplar::Tensor gradSpk =
+        hasInput(0) ? getInTensor(0)
+                    : ns::zerosLike(graph(), memNext, prog,
+                                    debugContext("gradSpk"));
+
+    auto type = gradSpk.elementType();
+    auto shape = gradSpk.shape();
+    poplar::Tensor threshold = ns::broadcastParam(
+        graph(), thresholdIn, type, shape, prog, debugContext("threshold"));
+
+    // Gradient reaching mem_next through the spike: gradSpk * dS/dU
+    auto surrogate =
+        ns::surrogateGrad(op.getSurrogate(), pe::Sub(pe::_2, pe::_3));
+    auto gradSpkU =
+        popops::map(graph(), pe::Mul(pe::_1, *surrogate),
+                    {gradSpk, memNext, threshold}, prog,
+                    debugContext("LapicqueStepGradSurrogate"));
+
+    // Total gradient w.r.t. mem_next
+    poplar::Tensor gradU = gradSpkU;
+    if (hasInput(1)) {
+      gradU = popops::map(graph(), pe::Add(pe::_1, pe::_2),
+                          {getInTensor(1), gradSpkU}, prog,
+                          debugContext("LapicqueStepGradMemNext"));
+    }
+
+    // Reset-to-zero masks every path through the integration
+    poplar::Tensor gradBase = gradU;
+    if (op.getResetMechanism() == ns::Zero) {
+      // _1: gradU, _2: mem, _3: threshold
+      gradBase = popops::map(graph(),
+                             pe::Select(pe::Const(0.0f), pe::_1,
+                                        pe::Gte(pe::_2, pe::_3)),
+                             {gradU, mem, threshold}, prog,
+                             debugContext("LapicqueStepGradBase"));
+    }
+
+    // dmem_next/dinput = gain, dmem_next/dmem = decay
+    poplar::Tensor gradInput;
+    poplar::Tensor gradMem;
+    if (!op.getHasRC()) {
+      gradInput = popops::map(graph(),
+                              pe::Mul(pe::_1, pe::Const(circuit.gain())),
+                              {gradBase}, prog,
+                              debugContext("LapicqueStepGradInput"));
+      gradMem = popops::map(graph(),
+                            pe::Mul(pe::_1, pe::Const(circuit.decay())),
+                            {gradBase}, prog,
+                            debugContext("LapicqueStepGradMem"));
+    } else {
+      poplar::Tensor input = getInTensor(5);
+      poplar::Tensor rIn = getInTensor(6);
+      poplar::Tensor cIn = getInTensor(7);
+      auto rc = rcParams(graph(), rIn, cIn, type, prog, debugContext("rc"));
+      auto decayGain = decayAndGain(graph(), rc.first, rc.second,
+                                    circuit.timeStep, prog,
+                                    debugContext("LapicqueStepGradDecay"));
+      poplar::Tensor decay =
+          ns::broadcastParam(graph(), decayGain.first, type, shape, prog,
+                             debugContext("decay"));
+      poplar::Tensor gain =
+          ns::broadcastParam(graph(), decayGain.second, type, shape, prog,
+                             debugContext("gain"));
+      gradInput = popops::map(graph(), pe::Mul(pe::_1, pe::_2),
+                              {gradBase, gain}, prog,
+                              debugContext("LapicqueStepGradInput"));
+      gradMem = popops::map(graph(), pe::Mul(pe::_1, pe::_2),
+                            {gradBase, decay}, prog,
+                            debugContext("LapicqueStepGradMem"));
+
+      // Reduce the gradients of decay (mem) and gain (input) to the shape
+      // of R and C before chaining them through
+      //   ddecay/dR = dt / (R^2 C), ddecay/dC = dt / (R C^2),
+      //   dgain/dC = -dt / C^2
+      const auto rcShape = rc.first.shape();
+      auto gradDecay = popops::map(graph(), pe::Mul(pe::_1, pe::_2),
+                                   {gradBase, mem}, prog,
+                                   debugContext("LapicqueStepGradDecay"));
+      gradDecay = ns::reduceToShape(graph(), gradDecay, rcShape, type, prog,
+                                    debugContext("LapicqueStepGradDecay"));
+      auto gradGain = popops::map(graph(), pe::Mul(pe::_1, pe::_2),
+                                  {gradBase, input}, prog,
+                                  debugContext("LapicqueStepGradGain"));
+      gradGain = ns::reduceToShape(graph(), gradGain, rcShape, type, prog,
+                                   debugContext("LapicqueStepGradGain"));
+
+      const auto dt = pe::Const(circuit.timeStep);
+      // _1: gradDecay, _2: R, _3: C
+      auto gradR = popops::map(
+          graph(),
+          pe::Divide(pe::Mul(pe::_1, dt),
+                     pe::Mul(pe::Mul(pe::_2, pe::_2), pe::_3)),
+          {gradDecay, rc.first, rc.second}, prog,
+          debugContext("LapicqueStepGradR"));
+      // _1: gradDecay, _2: R, _3: gradGain, _4: C
+      auto gradC = popops::map(
+          graph(),
+          pe::Divide(pe::Mul(pe::Sub(pe::Divide(pe::_1, pe::_2), pe::_3), dt),
+                     pe::Mul(pe::_4, pe::_4)),
+          {gradDecay, rc.first, gradGain, rc.second}, prog,
+          debugContext("LapicqueStepGradC"));
+      setOutTensor(3, ns::reduceToShape(graph(), gradR, rIn.shape(),
+                                        rIn.elementType(), prog,
+                                        debugContext("LapicqueStepGradR")));
+      setOutTensor(4, ns::reduceToShape(graph(), gradC, cIn.shape(),
+                                        cIn.elementType(), prog,
+                                        debugContext("LapicqueStepGradC")));
+    }
+
+    // The spike always sees -threshold; reset-by-subtraction adds -reset
+    std::unique_ptr<pe::Expr> gradThresholdExpr;
+    if (op.getResetMechanism() == ns::Subtract) {
+      // _1: gradSpkU, _2: gradU, _3: mem, _4: threshold
+      gradThresholdExpr =
+          pe::Neg(pe::Add(pe::_1, pe::Select(pe::_2, pe::Const(0.0f),
+                                             pe::Gte(pe::_3, pe::_4))))
+              .clone();
+    } else {
+      gradThresholdExpr = pe::Neg(pe::_1).clone();
+    }
+    auto gradThreshold =
+        popops::map(graph(), *gradThresholdExpr,
+                    {gradSpkU, gradU, mem, threshold}, prog,
+                    debugContext("LapicqueStepGradThreshold"));
+    gradThreshold = ns::reduceToShape(
+        graph(), gradThreshold, thresholdIn.shape(),
+        thresholdIn.elementType(), prog,
+        debugContext("LapicqueStepGradThresholdReduce"));
+
+    setOutTensor(0, gradInput);
+    setOutTensor(1, gradMem);
+    setOutTensor(2, gradThreshold);
+  }
+};
+
+LapicqueStepGradOp::LapicqueStepGradOp(const LapicqueStepOp &fwdOp)
+    : popart::Op(CustomGradOperators::LapicqueStepGradId, fwdOp.settings),
+      resetMechanism(fwdOp.getResetMechanism()),
+      surrogate(fwdOp.getSurrogate()), circuit(fwdOp.getCircuit()) {
+  const int numInputs = fwdOp.input->hasIndex(3) ? 5 : 3;
+  for (int i = 0; i < numInputs; ++i) {
+    fwdInInfo.push_back(fwdOp.inInfo(i));
+  }
+}
+
+const std::vector<popart::GradInOutMapper> &
+LapicqueStepGradOp::gradInputInfo() const {
+  static const std::vector<popart::GradInOutMapper> inInfo = {
+      {0, 0, popart::GradOpInType::GradOut},
+      {1, 1, popart::GradOpInType::GradOut},
+      {2, 1, popart::GradOpInType::In},
+      {3, 2, popart::GradOpInType::In},
+      {4, 1, popart::GradOpInType::Out}};
+  static const std::vector<popart::GradInOutMapper> inInfoWithRC = {
+      {0, 0, popart::GradOpInType::GradOut},
+      {1, 1, popart::GradOpInType::GradOut},
+      {2, 1, popart::GradOpInType::In},
+      {3, 2, popart::GradOpInType::In},
+      {4, 1, popart::GradOpInType::Out},
+      {5, 0, popart::GradOpInType::In},
+      {6, 3, popart::GradOpInType::In},
+      {7, 4, popart::GradOpInType::In}};
+  return getHasRC() ? inInfoWithRC : inInfo;
+}
+
+// The Grad Op has one output per forward input
+const std::map<int, int> &LapicqueStepGradOp::gradOutToNonGradIn() const {
+  static const std::map<int, int> outInfo = {{0, 0}, {1, 1}, {2, 2}};
+  static const std::map<int, int> outInfoWithRC = {
+      {0, 0}, {1, 1}, {2, 2}, {3, 3}, {4, 4}};
+  return getHasRC() ? outInfoWithRC : outInfo;
+}
+
+void LapicqueStepGradOp::appendAttributes(popart::OpSerialiserBase &os) const {
+  Op::appendAttributes(os);
+  os.appendAttribute("reset_mechanism", getResetMechanism());
+  neuron_step::appendSurrogate(os, getSurrogate());
+  os.appendAttribute("time_step", circuit.timeStep);
+  os.appendAttribute("R", circuit.r);
+  os.appendAttribute("C", circuit.c);
+}
+
+void LapicqueStepGradOp::appendOutlineAttributes(
+    popart::OpSerialiserBase &os) const {
+  Op::appendOutlineAttributes(os);
+  os.appendAttribute("reset_mechanism", getResetMechanism());
+  neuron_step::appendSurrogate(os, getSurrogate());
+  os.appendAttribute("time_step", circuit.timeStep);
+  os.appendAttribute("R", circuit.r);
+  os.appendAttribute("C", circuit.c);
+}
+
+static popart::popx::OpxCreator<LapicqueStepOpx>
+    LapicqueStepOpxCreator({CustomOperators::LapicqueStepId});
+static popart::popx::OpxCreator<LapicqueStepGradOpx>
+    LapicqueStepGradOpxCreator({CustomGradOperators::LapicqueStepGradId});
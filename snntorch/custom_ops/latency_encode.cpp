@@ -0,0 +1,269 @@
+// On-device latency encoding, the op behind `spikegen.latency`.
+//
+// Takes an input [...] in [0, 1] and returns [num_steps, ...], each element
+// firing once at the step nearest its spike time (spikegen.latency_code):
+//
+//   log:    spike_time = tau * log(x / (x - threshold)) + first_spike_time,
+//           with x = max(input, threshold + epsilon)
+//   linear: spike_time = min(-tau * (input - 1), -tau * (threshold - 1))
+//                        + first_spike_time
+//
+// `normalize` stretches the spike times over num_steps: the log code is
+// scaled by its largest spike time, the linear code takes
+// tau = num_steps - 1 - first_spike_time. Elements whose step falls past
+// num_steps - 1 never fire, and with `clip` neither do those below the
+// threshold. Spikes are on_target, the rest off_target, both floored at 0 as
+// in spikegen.latency.
+//
+// Spike times are computed in float for both input types. Steps are rounded
+// half to even, as torch.round does. The encoding is not differentiable, so
+// the op has no grad op.
+#include <popart/error.hpp>
+#include <popart/opmanager.hpp>
+#include <popart/opserialiser.hpp>
+#include <popart/popx/opx.hpp>
+#include <popart/popx/opxmanager.hpp>
+
+#include <popops/ElementWise.hpp>
+#include <popops/Reduce.hpp>
+#include <poputil/Broadcast.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace CustomOperators {
+const popart::OperatorIdentifier LatencyEncodeId = {"custom.ops",
+                                                    "LatencyEncode", 1};
+} // namespace CustomOperators
+
+struct LatencyCode {
+  int64_t numSteps;
+  float threshold;
+  float tau;
+  int64_t firstSpikeTime;
+  bool linear;
+  bool normalize;
+  bool clip;
+  float onTarget;
+  float offTarget;
+  float epsilon;
+};
+
+class LatencyEncodeOp : public popart::Op {
+public:
+  LatencyEncodeOp(const popart::OperatorIdentifier &_opid,
+                  const LatencyCode &_code,
+                  const popart::Op::Settings &settings_)
+      : popart::Op(_opid, settings_), code(_code) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<LatencyEncodeOp>(*this);
+  }
+
+  // Time is prepended to the input shape
+  void setup() final {
+    popart::Shape shape = inInfo(0).shape();
+    shape.insert(shape.begin(), code.numSteps);
+    outInfo(0) = {inInfo(0).dataType(), shape};
+  }
+
+  void appendAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendAttributes(os);
+    appendCode(os);
+  }
+
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendOutlineAttributes(os);
+    appendCode(os);
+  }
+
+  float getSubgraphValue() const final { return getLowSubgraphValue(); }
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // Attributes
+  const LatencyCode &getCode() const { return code; }
+
+private:
+  void appendCode(popart::OpSerialiserBase &os) const {
+    os.appendAttribute("num_steps", code.numSteps);
+    os.appendAttribute("threshold", code.threshold);
+    os.appendAttribute("tau", code.tau);
+    os.appendAttribute("first_spike_time", code.firstSpikeTime);
+    os.appendAttribute("linear", static_cast<int64_t>(code.linear));
+    os.appendAttribute("normalize", static_cast<int64_t>(code.normalize));
+    os.appendAttribute("clip", static_cast<int64_t>(code.clip));
+    os.appendAttribute("on_target", code.onTarget);
+    os.appendAttribute("off_target", code.offTarget);
+    os.appendAttribute("epsilon", code.epsilon);
+  }
+
+  LatencyCode code;
+};
+
+namespace {
+using popart::DataType;
+using popart::OpDefinition;
+
+static OpDefinition::DataTypes T = {DataType::FLOAT16, DataType::FLOAT};
+
+static OpDefinition LatencyEncodeOpDef(
+    {OpDefinition::Inputs({{"input", T}}),
+     OpDefinition::Outputs({{"output", T}}),
+     OpDefinition::Attributes({{"num_steps", {"*"}},
+                               {"threshold", {"*"}},
+                               {"tau", {"*"}},
+                               {"first_spike_time", {"*"}},
+                               {"linear", {"*"}},
+                               {"normalize", {"*"}},
+                               {"clip", {"*"}},
+                               {"on_target", {"*"}},
+                               {"off_target", {"*"}},
+                               {"epsilon", {"*"}}})});
+
+static popart::OpCreator<LatencyEncodeOp> LatencyEncodeOpCreator(
+    popart::OpDefinitions({{CustomOperators::LatencyEncodeId,
+                            LatencyEncodeOpDef}}),
+    [](const popart::OpCreatorInfo &info) {
+      const auto &a = info.attributes;
+      LatencyCode code;
+      code.numSteps = a.getAttribute<popart::Attributes::Int>("num_steps", 0);
+      code.threshold =
+          a.getAttribute<popart::Attributes::Float>("threshold", 0.01f);
+      code.tau = a.getAttribute<popart::Attributes::Float>("tau", 1.0f);
+      code.firstSpikeTime =
+          a.getAttribute<popart::Attributes::Int>("first_spike_time", 0);
+      code.linear = a.getAttribute<popart::Attributes::Int>("linear", 0) != 0;
+      code.normalize =
+          a.getAttribute<popart::Attributes::Int>("normalize", 0) != 0;
+      code.clip = a.getAttribute<popart::Attributes::Int>("clip", 0) != 0;
+      code.onTarget =
+          a.getAttribute<popart::Attributes::Float>("on_target", 1.0f);
+      code.offTarget =
+          a.getAttribute<popart::Attributes::Float>("off_target", 0.0f);
+      code.epsilon =
+          a.getAttribute<popart::Attributes::Float>("epsilon", 1e-7f);
+
+      // The checks of spikegen._latency_errors that do not need the data
+      if (code.numSteps <= 0) {
+        throw popart::error(
+            "LatencyEncode: num_steps must be positive, got {}",
+            code.numSteps);
+      }
+      if (code.threshold <= 0.0f || code.threshold >= 1.0f) {
+        throw popart::error(
+            "LatencyEncode: threshold must be between 0 and 1, got {}",
+            code.threshold);
+      }
+      if (code.tau <= 0.0f) {
+        throw popart::error("LatencyEncode: tau must be positive, got {}",
+                            code.tau);
+      }
+      if (code.firstSpikeTime < 0 ||
+          code.firstSpikeTime > code.numSteps - 1) {
+        throw popart::error("LatencyEncode: first_spike_time must be in "
+                            "[0, {}], got {}",
+                            code.numSteps - 1, code.firstSpikeTime);
+      }
+      return std::make_unique<LatencyEncodeOp>(info.opid, code,
+                                               info.settings);
+    },
+    true);
+} // namespace
+
+namespace pe = popops::expr;
+
+class LatencyEncodeOpx : public popart::popx::Opx {
+public:
+  LatencyEncodeOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<LatencyEncodeOp>(op, {CustomOperators::LatencyEncodeId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+    const LatencyCode &code = getOp<LatencyEncodeOp>().getCode();
+
+    poplar::Tensor input = getInTensor(0);
+    const auto type = input.elementType();
+    const auto numSteps = static_cast<std::size_t>(code.numSteps);
+    const float first = static_cast<float>(code.firstSpikeTime);
+    const float last = static_cast<float>(code.numSteps - 1);
+    auto x = pe::Cast(pe::_1, poplar::FLOAT);
+
+    // Spike time of every element, without first_spike_time
+    poplar::Tensor spikeTime;
+    if (code.linear) {
+      const float tau = code.normalize ? last - first : code.tau;
+      spikeTime = popops::map(
+          graph(),
+          pe::Min(pe::Mul(pe::Const(-tau), pe::Sub(x, pe::Const(1.0f))),
+                  pe::Const(-tau * (code.threshold - 1.0f))),
+          {input}, prog, debugContext("LatencyEncodeTime"));
+    } else {
+      auto saturated = pe::Max(x, pe::Const(code.threshold + code.epsilon));
+      spikeTime = popops::map(
+          graph(),
+          pe::Mul(pe::Const(code.tau),
+                  pe::Log(pe::Divide(
+                      saturated,
+                      pe::Sub(saturated, pe::Const(code.threshold))))),
+          {input}, prog, debugContext("LatencyEncodeTime"));
+      if (code.normalize) {
+        // Scale by the latest spike time so it lands on num_steps - 1
+        auto latest = popops::reduce(graph(), spikeTime.flatten(), {0},
+                                     {popops::Operation::MAX}, prog,
+                                     debugContext("LatencyEncodeLatest"));
+        auto scale = latest.reshape({1})
+                         .broadcast(spikeTime.numElements(), 0)
+                         .reshape(spikeTime.shape());
+        popops::mapInPlace(
+            graph(),
+            pe::Divide(pe::Mul(pe::_1, pe::Const(last - first)), pe::_2),
+            {spikeTime, scale}, prog, debugContext("LatencyEncodeNormalize"));
+      }
+    }
+
+    // Step of every element, or -1 where it does not fire
+    auto step = pe::NearbyInt(pe::Add(pe::_1, pe::Const(first)));
+    std::unique_ptr<pe::Expr> fires =
+        pe::Lte(step, pe::Const(last)).clone();
+    if (code.clip) {
+      fires = pe::And(*fires, pe::Gte(pe::Cast(pe::_2, poplar::FLOAT),
+                                      pe::Const(code.threshold)))
+                  .clone();
+    }
+    auto steps = popops::map(graph(),
+                             pe::Select(step, pe::Const(-1.0f), *fires),
+                             {spikeTime, input}, prog,
+                             debugContext("LatencyEncodeStep"));
+
+    // Spike train: out[t, ...] fires where steps[...] == t
+    std::vector<float> times(numSteps);
+    for (std::size_t t = 0; t < numSteps; ++t) {
+      times[t] = static_cast<float>(t);
+    }
+    auto shape = input.shape();
+    shape.insert(shape.begin(), numSteps);
+    std::vector<std::size_t> timeShape(shape.size(), 1);
+    timeShape[0] = numSteps;
+    auto time = graph().addConstant(poplar::FLOAT, timeShape, times.data(),
+                                    debugContext("LatencyEncodeTimes"));
+    graph().setTileMapping(time, 0);
+    poputil::broadcastToMatch(time, shape);
+
+    const float on = std::max(code.onTarget, code.offTarget);
+    const float off = std::max(0.0f, code.offTarget);
+    auto output = popops::map(
+        graph(),
+        pe::Cast(pe::Select(pe::Const(on), pe::Const(off),
+                            pe::Equal(pe::_1, pe::_2)),
+                 type),
+        {time, steps.expand({0}).broadcast(numSteps, 0)}, prog,
+        debugContext("LatencyEncodeSpikes"));
+
+    setOutTensor(0, output);
+  }
+};
+
+static popart::popx::OpxCreator<LatencyEncodeOpx>
+    LatencyEncodeOpxCreator({CustomOperators::LatencyEncodeId});
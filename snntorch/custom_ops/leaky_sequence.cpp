@@ -0,0 +1,469 @@
+// Multi-timestep Leaky integrate-and-fire neuron.
+//
+// Takes (input, mem, beta, threshold) where `input` is the [T, ...] input
+// current for the whole sequence and `mem` the initial [...] membrane
+// potential, and returns the [T, ...] spike and membrane records. The
+// recurrence of `LeakyStep` runs inside a single `poplar::program::Repeat`
+// with the membrane potential kept resident on its tiles, so the graph does
+// not grow with the number of time steps. The backward pass runs
+// backpropagation through time in a second `Repeat`, walking the records in
+// reverse. `spike_dtype` = "bool" / "uint8" records the spikes at one byte
+// per neuron while mem_rec keeps the type of the input; the op then has no
+// grad op.
+#include <popart/opmanager.hpp>
+#include <popart/opserialiser.hpp>
+#include <popart/popx/opx.hpp>
+#include <popart/popx/opxmanager.hpp>
+
+#include <popops/DynamicSlice.hpp>
+#include <popops/ElementWise.hpp>
+#include <popops/Zero.hpp>
+
+#include <algorithm>
+
+#include "neuron_step.hpp"
+
+namespace CustomOperators {
+const popart::OperatorIdentifier LeakySequenceId = {"custom.ops",
+                                                    "LeakySequence", 1};
+} // namespace CustomOperators
+namespace CustomGradOperators {
+const popart::OperatorIdentifier LeakySequenceGradId = {
+    "custom.ops", "LeakySequenceGrad", 1};
+} // namespace CustomGradOperators
+
+class LeakySequenceOp;
+class LeakySequenceOpx;
+class LeakySequenceGradOpx;
+
+class LeakySequenceGradOp : public popart::Op {
+public:
+  LeakySequenceGradOp(const LeakySequenceOp &fwdOp);
+
+  std::unique_ptr<popart::Op> clone() const final {
+    return std::make_unique<LeakySequenceGradOp>(*this);
+  }
+
+  // One gradient per forward input: input, mem, beta, threshold
+  void setup() final {
+    outInfo(0) = inputInfo;
+    outInfo(1) = memInfo;
+    outInfo(2) = betaInfo;
+    outInfo(3) = thresholdInfo;
+  };
+
+  const std::vector<popart::GradInOutMapper> &gradInputInfo() const;
+
+  const std::map<int, int> &gradOutToNonGradIn() const;
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // an estimate of how valuable sub-graph matching will be
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  int64_t getResetMechanism() const { return resetMechanism; }
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+
+  // Implementation defined below
+  void appendAttributes(popart::OpSerialiserBase &os) const override;
+
+  // Implementation defined below
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override;
+
+private:
+  int64_t resetMechanism;
+  neuron_step::Surrogate surrogate;
+  popart::TensorInfo inputInfo;
+  popart::TensorInfo memInfo;
+  popart::TensorInfo betaInfo;
+  popart::TensorInfo thresholdInfo;
+};
+
+class LeakySequenceOp : public popart::Op {
+public:
+  LeakySequenceOp(const popart::OperatorIdentifier &_opid,
+                  int64_t _resetMechanism,
+                  const neuron_step::Surrogate &_surrogate,
+                  const std::string &_spikeDtype,
+                  const popart::Op::Settings &settings_)
+      : popart::Op(_opid, settings_), resetMechanism(_resetMechanism),
+        surrogate(_surrogate), spikeDtype(_spikeDtype) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<LeakySequenceOp>(*this);
+  }
+
+  // spk_rec and mem_rec both take the [T, ...] shape of the input current,
+  // and its type unless spk_rec is recorded as a compact spike_dtype
+  void setup() final {
+    const auto &input = inInfo(0).shape();
+    const auto &mem = inInfo(1).shape();
+    if (input.size() != mem.size() + 1 ||
+        !std::equal(mem.begin(), mem.end(), input.begin() + 1)) {
+      throw popart::error("LeakySequence: input must have the shape of mem "
+                          "after its leading time dimension");
+    }
+    // The backward pass steps back from T - 1
+    if (input[0] <= 0) {
+      throw popart::error("LeakySequence: input needs at least one time step");
+    }
+    outInfo(0) = neuron_step::spikeInfo(inInfo(0), getSpikeDtype());
+    outInfo(1) = inInfo(0);
+  }
+
+  void appendAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendAttributes(os);
+    os.appendAttribute("reset_mechanism", getResetMechanism());
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendOutlineAttributes(os);
+    os.appendAttribute("reset_mechanism", getResetMechanism());
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  // Compact spikes carry no gradient
+  std::vector<std::unique_ptr<popart::Op>> getGradOps() {
+    std::vector<std::unique_ptr<Op>> upops;
+    if (neuron_step::compactSpikes(getSpikeDtype())) {
+      return upops;
+    }
+    upops.emplace_back(new LeakySequenceGradOp(*this));
+    return upops;
+  }
+
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // Attributes
+  int64_t getResetMechanism() const { return resetMechanism; }
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+  const std::string &getSpikeDtype() const { return spikeDtype; }
+
+private:
+  int64_t resetMechanism;
+  neuron_step::Surrogate surrogate;
+  std::string spikeDtype;
+};
+
+namespace {
+using popart::DataType;
+using popart::OpDefinition;
+
+static OpDefinition::DataTypes T = {DataType::FLOAT16, DataType::FLOAT};
+static OpDefinition::DataTypes Spikes = {DataType::FLOAT16, DataType::FLOAT,
+                                         DataType::BOOL, DataType::UINT8};
+
+static OpDefinition LeakySequenceOpDef(
+    {OpDefinition::Inputs(
+         {{"input", T}, {"mem", T}, {"beta", T}, {"threshold", T}}),
+     OpDefinition::Outputs({{"spk_rec", Spikes}, {"mem_rec", T}}),
+     OpDefinition::Attributes(
+         {{"reset_mechanism", {"*"}},
+          {"surrogate", {"*"}},
+          {"slope", {"*"}},
+          {"beta", {"*"}},
+          {"spike_dtype", {"*"}}})});
+
+static popart::OpCreator<LeakySequenceOp> LeakySequenceOpCreator(
+    popart::OpDefinitions(
+        {{CustomOperators::LeakySequenceId, LeakySequenceOpDef}}),
+    [](const popart::OpCreatorInfo &info) {
+      // default reset mechanism is subtraction, see SpikingNeuron.reset_dict
+      int64_t resetMechanism =
+          info.attributes.getAttribute<popart::Attributes::Int>(
+              "reset_mechanism", 0);
+      neuron_step::checkResetMechanism("LeakySequence", resetMechanism);
+      neuron_step::Surrogate surrogate = neuron_step::surrogateAttributes(
+          "LeakySequence", info.attributes, "fast_sigmoid");
+      std::string spikeDtype =
+          neuron_step::spikeDtypeAttribute("LeakySequence", info.attributes);
+      return std::make_unique<LeakySequenceOp>(info.opid, resetMechanism,
+                                               surrogate, spikeDtype,
+                                               info.settings);
+    },
+    true);
+} // namespace
+
+namespace pe = popops::expr;
+namespace ns = neuron_step;
+
+namespace {
+// Scalar loop counter living on tile 0, initialised to `start`.
+poplar::Tensor addStepCounter(poplar::Graph &graph, unsigned start,
+                              poplar::program::Sequence &prog,
+                              const poplar::DebugContext &dc) {
+  auto step = graph.addVariable(poplar::UNSIGNED_INT, {1}, dc);
+  graph.setTileMapping(step, 0);
+  auto init = graph.addConstant(poplar::UNSIGNED_INT, {1}, start, dc);
+  graph.setTileMapping(init, 0);
+  prog.add(poplar::program::Copy(init, step, false, dc));
+  return step;
+}
+
+poplar::Tensor sliceStep(poplar::Graph &graph, const poplar::Tensor &rec,
+                         const poplar::Tensor &step,
+                         poplar::program::Sequence &prog,
+                         const poplar::DebugContext &dc) {
+  return popops::dynamicSlice(graph, rec, step, {0}, {1}, prog, dc)
+      .squeeze({0});
+}
+
+void updateStep(poplar::Graph &graph, const poplar::Tensor &rec,
+                const poplar::Tensor &value, const poplar::Tensor &step,
+                poplar::program::Sequence &prog,
+                const poplar::DebugContext &dc) {
+  popops::dynamicUpdate(graph, rec, value.expand({0}), step, {0}, {1}, prog,
+                        dc);
+}
+} // namespace
+
+class LeakySequenceOpx : public popart::popx::Opx {
+public:
+  LeakySequenceOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<LeakySequenceOp>(op, {CustomOperators::LeakySequenceId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+
+    auto op = getOp<LeakySequenceOp>();
+
+    poplar::Tensor input = getInTensor(0);
+    const unsigned numSteps = input.dim(0);
+    auto type = input.elementType();
+
+    // State stays on the tiles of the initial membrane potential
+    poplar::Tensor mem = graph().clone(getInTensor(1), debugContext("mem"));
+    prog.add(poplar::program::Copy(getInTensor(1), mem, false,
+                                   debugContext("memInit")));
+
+    poplar::Tensor beta =
+        ns::broadcastParam(graph(), getInTensor(2), type, mem.shape(), prog,
+                           debugContext("beta"));
+    poplar::Tensor threshold =
+        ns::broadcastParam(graph(), getInTensor(3), type, mem.shape(), prog,
+                           debugContext("threshold"));
+
+    auto spkRec =
+        graph().clone(ns::spikeType(op.getSpikeDtype(), type), input,
+                      debugContext("spkRec"));
+    auto memRec = graph().clone(input, debugContext("memRec"));
+
+    auto step = addStepCounter(graph(), 0, prog, debugContext("step"));
+
+    poplar::program::Sequence body(debugContext("LeakySequenceStep"));
+    auto inputStep =
+        sliceStep(graph(), input, step, body, debugContext("inputStep"));
+
+    // _1: mem, _2: input, _3: beta, _4: threshold
+    auto memNextExpr = ns::leakyMemNext(op.getResetMechanism(), pe::_2,
+                                        pe::_1, pe::_3, pe::_4);
+    popops::mapInPlace(graph(), *memNextExpr,
+                       {mem, inputStep, beta, threshold}, body,
+                       debugContext("LeakySequenceMem"));
+
+    auto spkExpr =
+        ns::spikeOutput(ns::spike(pe::_1, pe::_2), op.getSpikeDtype());
+    auto spk = popops::map(graph(), *spkExpr, {mem, threshold}, body,
+                           debugContext("LeakySequenceSpike"));
+
+    updateStep(graph(), spkRec, spk, step, body, debugContext("spkRec"));
+    updateStep(graph(), memRec, mem, step, body, debugContext("memRec"));
+    popops::mapInPlace(graph(), pe::Add(pe::_1, pe::Const(1u)), {step}, body,
+                       debugContext("stepIncrement"));
+
+    prog.add(poplar::program::Repeat(numSteps, body,
+                                     debugContext("LeakySequence")));
+
+    setOutTensor(0, spkRec);
+    setOutTensor(1, memRec);
+  }
+};
+
+class LeakySequenceGradOpx : public popart::popx::Opx {
+public:
+  LeakySequenceGradOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<LeakySequenceGradOp>(op,
+                                  {CustomGradOperators::LeakySequenceGradId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+
+    auto op = getOp<LeakySequenceGradOp>();
+
+    poplar::Tensor mem0 = getInTensor(2);
+    poplar::Tensor betaIn = getInTensor(3);
+    poplar::Tensor thresholdIn = getInTensor(4);
+    poplar::Tensor memRec = getInTensor(5);
+    // A loss on the states alone leaves no gradient for spk_rec
+    poplar::Tensor gradSpkRec =
+        hasInput(0) ? getInTensor(0)
+                    : ns::zerosLike(graph(), memRec, prog,
+                                    debugContext("gradSpkRec"));
+
+    const unsigned numSteps = gradSpkRec.dim(0);
+    auto type = gradSpkRec.elementType();
+    auto shape = mem0.shape();
+
+    poplar::Tensor beta = ns::broadcastParam(graph(), betaIn, type, shape, prog,
+                                             debugContext("beta"));
+    poplar::Tensor threshold = ns::broadcastParam(
+        graph(), thresholdIn, type, shape, prog, debugContext("threshold"));
+
+    // mem before each step: mem0 followed by all but the last record
+    poplar::Tensor memPrevRec = poplar::concat(
+        mem0.expand({0}), memRec.slice(0, numSteps - 1, 0), 0);
+
+    // Gradient flowing back into mem[t] from step t + 1, plus the
+    // elementwise beta/threshold gradients summed over time
+    auto carry = graph().clone(mem0, debugContext("carry"));
+    auto gradBetaAcc = graph().clone(mem0, debugContext("gradBetaAcc"));
+    auto gradThresholdAcc =
+        graph().clone(mem0, debugContext("gradThresholdAcc"));
+    popops::zero(graph(), carry, prog, debugContext("carryInit"));
+    popops::zero(graph(), gradBetaAcc, prog, debugContext("gradBetaInit"));
+    popops::zero(graph(), gradThresholdAcc, prog,
+                 debugContext("gradThresholdInit"));
+
+    auto gradInputRec = graph().clone(gradSpkRec, debugContext("gradInputRec"));
+
+    auto step =
+        addStepCounter(graph(), numSteps - 1, prog, debugContext("step"));
+
+    poplar::program::Sequence body(debugContext("LeakySequenceGradStep"));
+    auto gradSpk =
+        sliceStep(graph(), gradSpkRec, step, body, debugContext("gradSpk"));
+    auto memNext =
+        sliceStep(graph(), memRec, step, body, debugContext("memNext"));
+    auto mem =
+        sliceStep(graph(), memPrevRec, step, body, debugContext("memPrev"));
+
+    // Gradient reaching mem_next through the spike: gradSpk * dS/dU
+    auto surrogate =
+        ns::surrogateGrad(op.getSurrogate(), pe::Sub(pe::_2, pe::_3));
+    auto gradSpkU =
+        popops::map(graph(), pe::Mul(pe::_1, *surrogate),
+                    {gradSpk, memNext, threshold}, body,
+                    debugContext("LeakySequenceGradSurrogate"));
+
+    // carry <- total gradient w.r.t. mem_next
+    if (hasInput(1)) {
+      auto gradMem = sliceStep(graph(), getInTensor(1), step, body,
+                               debugContext("gradMem"));
+      popops::mapInPlace(graph(), pe::Add(pe::_1, pe::Add(pe::_2, pe::_3)),
+                         {carry, gradMem, gradSpkU}, body,
+                         debugContext("LeakySequenceGradMemNext"));
+    } else {
+      popops::mapInPlace(graph(), pe::Add(pe::_1, pe::_2), {carry, gradSpkU},
+                         body, debugContext("LeakySequenceGradMemNext"));
+    }
+
+    // The spike always sees -threshold; reset-by-subtraction adds -reset
+    if (op.getResetMechanism() == ns::Subtract) {
+      // _1: acc, _2: gradSpkU, _3: carry, _4: mem, _5: threshold
+      popops::mapInPlace(
+          graph(),
+          pe::Sub(pe::_1,
+                  pe::Add(pe::_2, pe::Select(pe::_3, pe::Const(0.0f),
+                                             pe::Gte(pe::_4, pe::_5)))),
+          {gradThresholdAcc, gradSpkU, carry, mem, threshold}, body,
+          debugContext("LeakySequenceGradThreshold"));
+    } else {
+      popops::mapInPlace(graph(), pe::Sub(pe::_1, pe::_2),
+                         {gradThresholdAcc, gradSpkU}, body,
+                         debugContext("LeakySequenceGradThreshold"));
+    }
+
+    // Reset-to-zero masks every path through the integration; carry now
+    // holds the gradient w.r.t. this step's input current
+    if (op.getResetMechanism() == ns::Zero) {
+      popops::mapInPlace(graph(),
+                         pe::Select(pe::Const(0.0f), pe::_1,
+                                    pe::Gte(pe::_2, pe::_3)),
+                         {carry, mem, threshold}, body,
+                         debugContext("LeakySequenceGradInput"));
+    }
+    updateStep(graph(), gradInputRec, carry, step, body,
+               debugContext("gradInputRec"));
+
+    // _1: acc, _2: carry, _3: mem
+    popops::mapInPlace(graph(), pe::Add(pe::_1, pe::Mul(pe::_2, pe::_3)),
+                       {gradBetaAcc, carry, mem}, body,
+                       debugContext("LeakySequenceGradBeta"));
+
+    // carry <- gradient w.r.t. mem, consumed by the previous step
+    popops::mapInPlace(graph(), pe::Mul(pe::_1, ns::clampUnit(pe::_2)),
+                       {carry, beta}, body,
+                       debugContext("LeakySequenceGradMem"));
+
+    popops::mapInPlace(graph(), pe::Sub(pe::_1, pe::Const(1u)), {step}, body,
+                       debugContext("stepDecrement"));
+
+    prog.add(poplar::program::Repeat(numSteps, body,
+                                     debugContext("LeakySequenceGrad")));
+
+    auto gradBeta = ns::reduceToShape(
+        graph(), gradBetaAcc, betaIn.shape(), betaIn.elementType(), prog,
+        debugContext("LeakySequenceGradBetaReduce"));
+    ns::maskClampedGrad(graph(), gradBeta, betaIn, prog,
+                        debugContext("LeakySequenceGradBetaClamp"));
+    auto gradThreshold = ns::reduceToShape(
+        graph(), gradThresholdAcc, thresholdIn.shape(),
+        thresholdIn.elementType(), prog,
+        debugContext("LeakySequenceGradThresholdReduce"));
+
+    setOutTensor(0, gradInputRec);
+    setOutTensor(1, carry);
+    setOutTensor(2, gradBeta);
+    setOutTensor(3, gradThreshold);
+  }
+};
+
+LeakySequenceGradOp::LeakySequenceGradOp(const LeakySequenceOp &fwdOp)
+    : popart::Op(CustomGradOperators::LeakySequenceGradId, fwdOp.settings),
+      resetMechanism(fwdOp.getResetMechanism()),
+      surrogate(fwdOp.getSurrogate()), inputInfo(fwdOp.inInfo(0)),
+      memInfo(fwdOp.inInfo(1)), betaInfo(fwdOp.inInfo(2)),
+      thresholdInfo(fwdOp.inInfo(3)) {}
+
+const std::vector<popart::GradInOutMapper> &
+LeakySequenceGradOp::gradInputInfo() const {
+  static const std::vector<popart::GradInOutMapper> inInfo = {
+      {0, 0, popart::GradOpInType::GradOut},
+      {1, 1, popart::GradOpInType::GradOut},
+      {2, 1, popart::GradOpInType::In},
+      {3, 2, popart::GradOpInType::In},
+      {4, 3, popart::GradOpInType::In},
+      {5, 1, popart::GradOpInType::Out}};
+  return inInfo;
+}
+
+// The Grad Op has 4 outputs, one per forward input
+const std::map<int, int> &LeakySequenceGradOp::gradOutToNonGradIn() const {
+  static const std::map<int, int> outInfo = {{0, 0}, {1, 1}, {2, 2}, {3, 3}};
+  return outInfo;
+}
+
+void LeakySequenceGradOp::appendAttributes(popart::OpSerialiserBase &os) const {
+  Op::appendAttributes(os);
+  os.appendAttribute("reset_mechanism", getResetMechanism());
+  neuron_step::appendSurrogate(os, getSurrogate());
+}
+
+void LeakySequenceGradOp::appendOutlineAttributes(
+    popart::OpSerialiserBase &os) const {
+  Op::appendOutlineAttributes(os);
+  os.appendAttribute("reset_mechanism", getResetMechanism());
+  neuron_step::appendSurrogate(os, getSurrogate());
+}
+
+static popart::popx::OpxCreator<LeakySequenceOpx>
+    LeakySequenceOpxCreator({CustomOperators::LeakySequenceId});
+static popart::popx::OpxCreator<LeakySequenceGradOpx>
+    LeakySequenceGradOpxCreator({CustomGradOperators::LeakySequenceGradId});
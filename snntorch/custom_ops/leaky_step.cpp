@@ -0,0 +1,379 @@
+// Fused single-timestep Leaky integrate-and-fire neuron.
+//
+// Takes (input, mem, beta, threshold) and returns (spk, mem_next), where
+//
+//   reset    = mem >= threshold                        (detached)
+//   mem_next = clamp(beta, 0, 1) * mem + input - reset * threshold
+//   spk      = mem_next >= threshold
+//
+// for the default reset-by-subtraction. `reset_mechanism` follows
+// `SpikingNeuron.reset_dict` (0: subtract, 1: zero, 2: none) and `surrogate`
+// selects the gradient used for dS/dU in the backward pass, with its `slope`
+// (and `beta` for "spike_rate_escape"), see neuron_step::surrogateGrad.
+// `spike_dtype` = "bool" / "uint8" emits spk at one byte per neuron while
+// mem_next keeps the type of the input; the op then has no grad op.
+//
+// The forward pass is one LeakyStep vertex per region writing both outputs
+// (codelets/spike_codelets.cpp). Without the codelets, or with compact
+// spikes, it is two maps, the second reading mem_next back.
+#include <popart/opmanager.hpp>
+#include <popart/opserialiser.hpp>
+#include <popart/popx/opx.hpp>
+#include <popart/popx/opxmanager.hpp>
+
+#include <popops/ElementWise.hpp>
+
+#include "neuron_step.hpp"
+#include "spike_codelets.hpp"
+
+namespace CustomOperators {
+const popart::OperatorIdentifier LeakyStepId = {"custom.ops", "LeakyStep", 1};
+} // namespace CustomOperators
+namespace CustomGradOperators {
+const popart::OperatorIdentifier LeakyStepGradId = {"custom.ops",
+                                                    "LeakyStepGrad", 1};
+} // namespace CustomGradOperators
+
+class LeakyStepOp;
+class LeakyStepOpx;
+class LeakyStepGradOpx;
+
+class LeakyStepGradOp : public popart::Op {
+public:
+  LeakyStepGradOp(const LeakyStepOp &fwdOp);
+
+  std::unique_ptr<popart::Op> clone() const final {
+    return std::make_unique<LeakyStepGradOp>(*this);
+  }
+
+  // One gradient per forward input: input, mem, beta, threshold
+  void setup() final {
+    outInfo(0) = inputInfo;
+    outInfo(1) = memInfo;
+    outInfo(2) = betaInfo;
+    outInfo(3) = thresholdInfo;
+  };
+
+  const std::vector<popart::GradInOutMapper> &gradInputInfo() const;
+
+  const std::map<int, int> &gradOutToNonGradIn() const;
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // an estimate of how valuable sub-graph matching will be
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  int64_t getResetMechanism() const { return resetMechanism; }
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+
+  // Implementation defined below
+  void appendAttributes(popart::OpSerialiserBase &os) const override;
+
+  // Implementation defined below
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override;
+
+private:
+  int64_t resetMechanism;
+  neuron_step::Surrogate surrogate;
+  popart::TensorInfo inputInfo;
+  popart::TensorInfo memInfo;
+  popart::TensorInfo betaInfo;
+  popart::TensorInfo thresholdInfo;
+};
+
+class LeakyStepOp : public popart::Op {
+public:
+  LeakyStepOp(const popart::OperatorIdentifier &_opid, int64_t _resetMechanism,
+              const neuron_step::Surrogate &_surrogate,
+              const std::string &_spikeDtype,
+              const popart::Op::Settings &settings_)
+      : popart::Op(_opid, settings_), resetMechanism(_resetMechanism),
+        surrogate(_surrogate), spikeDtype(_spikeDtype) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<LeakyStepOp>(*this);
+  }
+
+  // spk and mem_next both take the shape and type of the input current,
+  // unless spk is emitted as a compact spike_dtype
+  void setup() final {
+    outInfo(0) = neuron_step::spikeInfo(inInfo(0), getSpikeDtype());
+    outInfo(1) = inInfo(0);
+  }
+
+  void appendAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendAttributes(os);
+    os.appendAttribute("reset_mechanism", getResetMechanism());
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendOutlineAttributes(os);
+    os.appendAttribute("reset_mechanism", getResetMechanism());
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  // Compact spikes carry no gradient
+  std::vector<std::unique_ptr<popart::Op>> getGradOps() {
+    std::vector<std::unique_ptr<Op>> upops;
+    if (neuron_step::compactSpikes(getSpikeDtype())) {
+      return upops;
+    }
+    upops.emplace_back(new LeakyStepGradOp(*this));
+    return upops;
+  }
+
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // Attributes
+  int64_t getResetMechanism() const { return resetMechanism; }
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+  const std::string &getSpikeDtype() const { return spikeDtype; }
+
+private:
+  int64_t resetMechanism;
+  neuron_step::Surrogate surrogate;
+  std::string spikeDtype;
+};
+
+namespace {
+using popart::DataType;
+using popart::OpDefinition;
+
+static OpDefinition::DataTypes T = {DataType::FLOAT16, DataType::FLOAT};
+static OpDefinition::DataTypes Spikes = {DataType::FLOAT16, DataType::FLOAT,
+                                         DataType::BOOL, DataType::UINT8};
+
+static OpDefinition
+    LeakyStepOpDef({OpDefinition::Inputs({{"input", T},
+                                          {"mem", T},
+                                          {"beta", T},
+                                          {"threshold", T}}),
+                    OpDefinition::Outputs({{"spk", Spikes},
+                                           {"mem_next", T}}),
+                    OpDefinition::Attributes({{"reset_mechanism", {"*"}},
+                                              {"surrogate", {"*"}},
+                                              {"slope", {"*"}},
+                                              {"beta", {"*"}},
+                                              {"spike_dtype", {"*"}}})});
+
+static popart::OpCreator<LeakyStepOp> LeakyStepOpCreator(
+    popart::OpDefinitions({{CustomOperators::LeakyStepId, LeakyStepOpDef}}),
+    [](const popart::OpCreatorInfo &info) {
+      // default reset mechanism is subtraction, see SpikingNeuron.reset_dict
+      int64_t resetMechanism =
+          info.attributes.getAttribute<popart::Attributes::Int>(
+              "reset_mechanism", 0);
+      neuron_step::checkResetMechanism("LeakyStep", resetMechanism);
+      neuron_step::Surrogate surrogate = neuron_step::surrogateAttributes(
+          "LeakyStep", info.attributes, "fast_sigmoid");
+      std::string spikeDtype =
+          neuron_step::spikeDtypeAttribute("LeakyStep", info.attributes);
+      return std::make_unique<LeakyStepOp>(info.opid, resetMechanism,
+                                           surrogate, spikeDtype,
+                                           info.settings);
+    },
+    true);
+} // namespace
+
+namespace pe = popops::expr;
+namespace ns = neuron_step;
+
+class LeakyStepOpx : public popart::popx::Opx {
+public:
+  LeakyStepOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<LeakyStepOp>(op, {CustomOperators::LeakyStepId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+
+    auto op = getOp<LeakyStepOp>();
+
+    poplar::Tensor input = getInTensor(0);
+    poplar::Tensor mem = getInTensor(1);
+
+    if (!ns::compactSpikes(op.getSpikeDtype()) &&
+        spike_codelets::addCodelets(graph())) {
+      const auto type = input.elementType();
+      auto beta = spike_codelets::prepareThreshold(
+          graph(), getInTensor(2), type, input.shape(), prog,
+          debugContext("beta"));
+      auto threshold = spike_codelets::prepareThreshold(
+          graph(), getInTensor(3), type, input.shape(), prog,
+          debugContext("threshold"));
+      auto outs = spike_codelets::leakyStep(
+          graph(), input, mem, beta, threshold, op.getResetMechanism(), prog,
+          debugContext("LeakyStep"));
+      setOutTensor(0, outs.first);
+      setOutTensor(1, outs.second);
+      return;
+    }
+
+    poplar::Tensor beta =
+        ns::broadcastParam(graph(), getInTensor(2), input.elementType(),
+                           input.shape(), prog, debugContext("beta"));
+    poplar::Tensor threshold =
+        ns::broadcastParam(graph(), getInTensor(3), input.elementType(),
+                           input.shape(), prog, debugContext("threshold"));
+
+    // _1: input, _2: mem, _3: beta, _4: threshold
+    auto memNextExpr = ns::leakyMemNext(op.getResetMechanism(), pe::_1,
+                                        pe::_2, pe::_3, pe::_4);
+    auto memNext = popops::map(graph(), *memNextExpr,
+                               {input, mem, beta, threshold}, prog,
+                               debugContext("LeakyStepMem"));
+
+    auto spkExpr =
+        ns::spikeOutput(ns::spike(pe::_1, pe::_2), op.getSpikeDtype());
+    auto spk = popops::map(graph(), *spkExpr, {memNext, threshold}, prog,
+                           debugContext("LeakyStepSpike"));
+
+    setOutTensor(0, spk);
+    setOutTensor(1, memNext);
+  }
+};
+
+class LeakyStepGradOpx : public popart::popx::Opx {
+public:
+  LeakyStepGradOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<LeakyStepGradOp>(op, {CustomGradOperators::LeakyStepGradId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+
+    auto op = getOp<LeakyStepGradOp>();
+
+    poplar::Tensor mem = getInTensor(2);
+    poplar::Tensor betaIn = getInTensor(3);
+    poplar::Tensor thresholdIn = getInTensor(4);
+    poplar::Tensor memNext = getInTensor(5);
+    // A loss on the states alone leaves no gradient for spk
+    poplar::Tensor gradSpk =
+        hasInput(0) ? getInTensor(0)
+                    : ns::zerosLike(graph(), memNext, prog,
+                                    debugContext("gradSpk"));
+
+    auto type = gradSpk.elementType();
+    auto shape = gradSpk.shape();
+    poplar::Tensor beta = ns::broadcastParam(graph(), betaIn, type, shape, prog,
+                                             debugContext("beta"));
+    poplar::Tensor threshold = ns::broadcastParam(
+        graph(), thresholdIn, type, shape, prog, debugContext("threshold"));
+
+    // Gradient reaching mem_next through the spike: gradSpk * dS/dU
+    auto surrogate =
+        ns::surrogateGrad(op.getSurrogate(), pe::Sub(pe::_2, pe::_3));
+    auto gradSpkU =
+        popops::map(graph(), pe::Mul(pe::_1, *surrogate),
+                    {gradSpk, memNext, threshold}, prog,
+                    debugContext("LeakyStepGradSurrogate"));
+
+    // Total gradient w.r.t. mem_next
+    poplar::Tensor gradU = gradSpkU;
+    if (hasInput(1)) {
+      gradU = popops::map(graph(), pe::Add(pe::_1, pe::_2),
+                          {getInTensor(1), gradSpkU}, prog,
+                          debugContext("LeakyStepGradMemNext"));
+    }
+
+    // Reset-to-zero masks every path through the integration
+    poplar::Tensor gradInput = gradU;
+    if (op.getResetMechanism() == ns::Zero) {
+      // _1: gradU, _2: mem, _3: threshold
+      gradInput = popops::map(graph(),
+                              pe::Select(pe::Const(0.0f), pe::_1,
+                                         pe::Gte(pe::_2, pe::_3)),
+                              {gradU, mem, threshold}, prog,
+                              debugContext("LeakyStepGradInput"));
+    }
+
+    // _1: gradInput, _2: beta
+    auto gradMem =
+        popops::map(graph(), pe::Mul(pe::_1, ns::clampUnit(pe::_2)),
+                    {gradInput, beta}, prog, debugContext("LeakyStepGradMem"));
+
+    // dmem_next/dbeta = mem, only where beta is not clamped
+    auto gradBeta = popops::map(graph(), pe::Mul(pe::_1, pe::_2),
+                                {gradInput, mem}, prog,
+                                debugContext("LeakyStepGradBeta"));
+    gradBeta = ns::reduceToShape(graph(), gradBeta, betaIn.shape(),
+                                 betaIn.elementType(), prog,
+                                 debugContext("LeakyStepGradBetaReduce"));
+    ns::maskClampedGrad(graph(), gradBeta, betaIn, prog,
+                        debugContext("LeakyStepGradBetaClamp"));
+
+    // The spike always sees -threshold; reset-by-subtraction adds -reset
+    std::unique_ptr<pe::Expr> gradThresholdExpr;
+    if (op.getResetMechanism() == ns::Subtract) {
+      // _1: gradSpkU, _2: gradU, _3: mem, _4: threshold
+      gradThresholdExpr =
+          pe::Neg(pe::Add(pe::_1, pe::Select(pe::_2, pe::Const(0.0f),
+                                             pe::Gte(pe::_3, pe::_4))))
+              .clone();
+    } else {
+      gradThresholdExpr = pe::Neg(pe::_1).clone();
+    }
+    auto gradThreshold =
+        popops::map(graph(), *gradThresholdExpr,
+                    {gradSpkU, gradU, mem, threshold}, prog,
+                    debugContext("LeakyStepGradThreshold"));
+    gradThreshold = ns::reduceToShape(
+        graph(), gradThreshold, thresholdIn.shape(),
+        thresholdIn.elementType(), prog,
+        debugContext("LeakyStepGradThresholdReduce"));
+
+    setOutTensor(0, gradInput);
+    setOutTensor(1, gradMem);
+    setOutTensor(2, gradBeta);
+    setOutTensor(3, gradThreshold);
+  }
+};
+
+LeakyStepGradOp::LeakyStepGradOp(const LeakyStepOp &fwdOp)
+    : popart::Op(CustomGradOperators::LeakyStepGradId, fwdOp.settings),
+      resetMechanism(fwdOp.getResetMechanism()),
+      surrogate(fwdOp.getSurrogate()), inputInfo(fwdOp.inInfo(0)),
+      memInfo(fwdOp.inInfo(1)), betaInfo(fwdOp.inInfo(2)),
+      thresholdInfo(fwdOp.inInfo(3)) {}
+
+const std::vector<popart::GradInOutMapper> &
+LeakyStepGradOp::gradInputInfo() const {
+  static const std::vector<popart::GradInOutMapper> inInfo = {
+      {0, 0, popart::GradOpInType::GradOut},
+      {1, 1, popart::GradOpInType::GradOut},
+      {2, 1, popart::GradOpInType::In},
+      {3, 2, popart::GradOpInType::In},
+      {4, 3, popart::GradOpInType::In},
+      {5, 1, popart::GradOpInType::Out}};
+  return inInfo;
+}
+
+// The Grad Op has 4 outputs, one per forward input
+const std::map<int, int> &LeakyStepGradOp::gradOutToNonGradIn() const {
+  static const std::map<int, int> outInfo = {{0, 0}, {1, 1}, {2, 2}, {3, 3}};
+  return outInfo;
+}
+
+void LeakyStepGradOp::appendAttributes(popart::OpSerialiserBase &os) const {
+  Op::appendAttributes(os);
+  os.appendAttribute("reset_mechanism", getResetMechanism());
+  neuron_step::appendSurrogate(os, getSurrogate());
+}
+
+void LeakyStepGradOp::appendOutlineAttributes(
+    popart::OpSerialiserBase &os) const {
+  Op::appendOutlineAttributes(os);
+  os.appendAttribute("reset_mechanism", getResetMechanism());
+  neuron_step::appendSurrogate(os, getSurrogate());
+}
+
+static popart::popx::OpxCreator<LeakyStepOpx>
+    LeakyStepOpxCreator({CustomOperators::LeakyStepId});
+static popart::popx::OpxCreator<LeakyStepGradOpx>
+    LeakyStepGradOpxCreator({CustomGradOperators::LeakyStepGradId});
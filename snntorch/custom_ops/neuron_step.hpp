@@ -0,0 +1,339 @@
+// Helpers shared by the fused neuron custom ops (LeakyStep, LeakySequence,
+// ...). Everything here only builds popops expressions or small poplar
+// programs, and is inline so that every op of the library can include it.
+#ifndef SNNTORCH_CUSTOM_OPS_NEURON_STEP_HPP
+#define SNNTORCH_CUSTOM_OPS_NEURON_STEP_HPP
+
+#include <popart/attributes.hpp>
+#include <popart/error.hpp>
+#include <popart/op.hpp>
+#include <popart/opserialiser.hpp>
+
+#include <popops/Cast.hpp>
+#include <popops/ElementWise.hpp>
+#include <popops/Reduce.hpp>
+#include <popops/Zero.hpp>
+#include <poputil/Broadcast.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace neuron_step {
+
+namespace pe = popops::expr;
+
+// See `SpikingNeuron.reset_dict`
+enum ResetMechanism : int64_t { Subtract = 0, Zero = 1, None = 2 };
+
+inline void checkResetMechanism(const std::string &opName,
+                                int64_t resetMechanism) {
+  if (resetMechanism < Subtract || resetMechanism > None) {
+    throw popart::error("{}: reset_mechanism must be 0 (subtract), 1 (zero) "
+                        "or 2 (none), got {}",
+                        opName, resetMechanism);
+  }
+}
+
+// The gradient used for dS/dU in the backward pass, see `surrogateGrad`.
+// `slope` and `beta` are op attributes, so they are folded into the
+// compiled expression as constants.
+struct Surrogate {
+  std::string name;
+  float slope;
+  float beta;
+};
+
+inline void checkSurrogate(const std::string &opName,
+                           const std::string &surrogate) {
+  if (surrogate != "heaviside" && surrogate != "straight_through_estimator" &&
+      surrogate != "fast_sigmoid" && surrogate != "sigmoid" &&
+      surrogate != "atan" && surrogate != "triangular" &&
+      surrogate != "spike_rate_escape") {
+    throw popart::error("{}: unknown surrogate '{}'", opName, surrogate);
+  }
+}
+
+// The slope used when the `slope` attribute is not given. fast_sigmoid
+// keeps the slope of 1 the ops have always used; the others follow the
+// defaults of `snntorch.surrogate`.
+inline float defaultSlope(const std::string &surrogate) {
+  if (surrogate == "sigmoid" || surrogate == "spike_rate_escape") {
+    return 25.0f;
+  }
+  if (surrogate == "atan") {
+    return 2.0f;
+  }
+  return 1.0f;
+}
+
+// Read the `surrogate`, `slope` and `beta` attributes
+inline Surrogate surrogateAttributes(const std::string &opName,
+                                     const popart::Attributes &attributes,
+                                     const std::string &defaultName) {
+  Surrogate surrogate;
+  surrogate.name = attributes.getAttribute<popart::Attributes::String>(
+      "surrogate", defaultName);
+  checkSurrogate(opName, surrogate.name);
+  surrogate.slope = attributes.getAttribute<popart::Attributes::Float>(
+      "slope", defaultSlope(surrogate.name));
+  surrogate.beta =
+      attributes.getAttribute<popart::Attributes::Float>("beta", 1.0f);
+  return surrogate;
+}
+
+inline void appendSurrogate(popart::OpSerialiserBase &os,
+                            const Surrogate &surrogate) {
+  os.appendAttribute("surrogate", surrogate.name);
+  os.appendAttribute("slope", surrogate.slope);
+  os.appendAttribute("beta", surrogate.beta);
+}
+
+// The `saved` attribute of the spike ops: "input" keeps the forward input
+// for the backward pass, "compact" has the op emit a smaller saved tensor
+// as its third output instead. Returns whether it is "compact".
+inline bool checkSaved(const std::string &opName, const std::string &saved) {
+  if (saved != "input" && saved != "compact") {
+    throw popart::error("{}: saved must be 'input' or 'compact', got '{}'",
+                        opName, saved);
+  }
+  return saved == "compact";
+}
+
+// The `spike_dtype` attribute of the spike ops: "input" emits the spikes in
+// the type of the input, "bool" and "uint8" at one byte per neuron, while
+// the state keeps the input type. Compact spikes carry no gradient, so the
+// ops emitting them have no grad op.
+inline std::string spikeDtypeAttribute(const std::string &opName,
+                                       const popart::Attributes &attributes) {
+  std::string spikeDtype = attributes.getAttribute<popart::Attributes::String>(
+      "spike_dtype", "input");
+  if (spikeDtype != "input" && spikeDtype != "bool" &&
+      spikeDtype != "uint8") {
+    throw popart::error(
+        "{}: spike_dtype must be 'input', 'bool' or 'uint8', got '{}'",
+        opName, spikeDtype);
+  }
+  return spikeDtype;
+}
+
+inline bool compactSpikes(const std::string &spikeDtype) {
+  return spikeDtype != "input";
+}
+
+// The spike output of an op whose input (or state) is `info`
+inline popart::TensorInfo spikeInfo(const popart::TensorInfo &info,
+                                    const std::string &spikeDtype) {
+  if (spikeDtype == "bool") {
+    return {popart::DataType::BOOL, info.shape()};
+  }
+  if (spikeDtype == "uint8") {
+    return {popart::DataType::UINT8, info.shape()};
+  }
+  return info;
+}
+
+inline poplar::Type spikeType(const std::string &spikeDtype,
+                              const poplar::Type &type) {
+  if (spikeDtype == "bool") {
+    return poplar::BOOL;
+  }
+  if (spikeDtype == "uint8") {
+    return poplar::UNSIGNED_CHAR;
+  }
+  return type;
+}
+
+// The 0 / 1 expression `spikes`, cast to the spike type inside the map
+inline std::unique_ptr<pe::Expr> spikeOutput(const pe::Expr &spikes,
+                                             const std::string &spikeDtype) {
+  if (!compactSpikes(spikeDtype)) {
+    return spikes.clone();
+  }
+  return pe::Cast(spikes, spikeType(spikeDtype, poplar::FLOAT)).clone();
+}
+
+// 0 / 1 `spikes` of the input type, cast to the spike type
+inline poplar::Tensor castSpikes(poplar::Graph &graph,
+                                 const poplar::Tensor &spikes,
+                                 const std::string &spikeDtype,
+                                 poplar::program::Sequence &prog,
+                                 const poplar::DebugContext &dc) {
+  if (!compactSpikes(spikeDtype)) {
+    return spikes;
+  }
+  return popops::cast(graph, spikes,
+                      spikeType(spikeDtype, spikes.elementType()), prog, dc);
+}
+
+// `settings`, asking PopART to recompute the op's outputs in the backward
+// pass rather than keep them alive when `recompute` is set
+inline popart::Op::Settings recomputeSettings(popart::Op::Settings settings,
+                                              int64_t recompute) {
+  if (recompute != 0) {
+    settings.recomputeType = popart::RecomputeType::Recompute;
+  }
+  return settings;
+}
+
+// Zeros laid out like `like`, standing in for the gradient of an output
+// that the loss does not depend on, which PopART leaves unconnected
+inline poplar::Tensor zerosLike(poplar::Graph &graph,
+                                const poplar::Tensor &like,
+                                poplar::program::Sequence &prog,
+                                const poplar::DebugContext &dc) {
+  auto zeros = graph.clone(like, dc);
+  popops::zero(graph, zeros, prog, dc);
+  return zeros;
+}
+
+// Cast `t` to `type` and broadcast it against `shape`, so that scalar or
+// per-neuron parameters can be used inside a single element-wise map.
+inline poplar::Tensor broadcastParam(poplar::Graph &graph, poplar::Tensor t,
+                                     const poplar::Type &type,
+                                     const std::vector<std::size_t> &shape,
+                                     poplar::program::Sequence &prog,
+                                     const poplar::DebugContext &dc) {
+  if (t.elementType() != type) {
+    t = popops::cast(graph, t, type, prog, dc);
+  }
+  poputil::broadcastToMatch(t, shape);
+  return t;
+}
+
+// Sum `t` over the dimensions that were broadcast to reach it from `shape`,
+// and cast the result to `type`.
+inline poplar::Tensor reduceToShape(poplar::Graph &graph,
+                                    const poplar::Tensor &t,
+                                    const std::vector<std::size_t> &shape,
+                                    const poplar::Type &type,
+                                    poplar::program::Sequence &prog,
+                                    const poplar::DebugContext &dc) {
+  poplar::Tensor out = t;
+  if (t.shape() != shape) {
+    std::vector<std::size_t> padded(t.rank() - shape.size(), 1);
+    padded.insert(padded.end(), shape.begin(), shape.end());
+    std::vector<std::size_t> dims;
+    for (std::size_t i = 0; i < t.rank(); ++i) {
+      if (padded[i] == 1 && t.dim(i) != 1) {
+        dims.push_back(i);
+      }
+    }
+    out = popops::reduce(graph, t, dims, {popops::Operation::ADD}, prog, dc)
+              .reshape(shape);
+  }
+  if (out.elementType() != type) {
+    out = popops::cast(graph, out, type, prog, dc);
+  }
+  return out;
+}
+
+// Zero the gradient of a decay rate wherever the forward pass clamped it
+// to [0, 1], matching the backward of `torch.clamp`.
+inline void maskClampedGrad(poplar::Graph &graph, const poplar::Tensor &grad,
+                            poplar::Tensor param,
+                            poplar::program::Sequence &prog,
+                            const poplar::DebugContext &dc) {
+  if (param.elementType() != grad.elementType()) {
+    param = popops::cast(graph, param, grad.elementType(), prog, dc);
+  }
+  popops::mapInPlace(graph,
+                     pe::Select(pe::_1, pe::Const(0.0f),
+                                pe::And(pe::Gte(pe::_2, pe::Const(0.0f)),
+                                        pe::Lte(pe::_2, pe::Const(1.0f)))),
+                     {grad, param}, prog, dc);
+}
+
+inline pe::Clamp clampUnit(const pe::Expr &x) {
+  return pe::Clamp(x, pe::Const(0.0f), pe::Const(1.0f));
+}
+
+// x < threshold ? 0:1
+inline pe::Select spike(const pe::Expr &x, const pe::Expr &threshold) {
+  return pe::Select(pe::Const(0.0f), pe::Const(1.0f), pe::Lt(x, threshold));
+}
+
+// dS/dU evaluated at `u = mem - threshold`, k being the slope
+inline std::unique_ptr<pe::Expr> surrogateGrad(const Surrogate &surrogate,
+                                               const pe::Expr &u) {
+  const auto k = pe::Const(surrogate.slope);
+  if (surrogate.name == "heaviside") {
+    // u < 0.0f ? 0:1
+    return pe::Select(pe::Const(0.0f), pe::Const(1.0f),
+                      pe::Lt(u, pe::Const(0.0f)))
+        .clone();
+  }
+  if (surrogate.name == "straight_through_estimator") {
+    return pe::Const(1.0f).clone();
+  }
+  if (surrogate.name == "sigmoid") {
+    // k * s * (1 - s), s = sigmoid(k * u)
+    auto s = pe::Sigmoid(pe::Mul(k, u));
+    return pe::Mul(k, pe::Mul(s, pe::Sub(pe::Const(1.0f), s))).clone();
+  }
+  if (surrogate.name == "atan") {
+    // (k / 2) / (1 + (pi / 2 * k * u)^2)
+    return pe::Divide(pe::Const(surrogate.slope / 2.0f),
+                      pe::Add(pe::Const(1.0f),
+                              pe::Square(pe::Mul(
+                                  pe::Const(1.57079632679f * surrogate.slope),
+                                  u))))
+        .clone();
+  }
+  if (surrogate.name == "triangular") {
+    // k * max(0, 1 - k * |u|)
+    return pe::Mul(k, pe::Max(pe::Const(0.0f),
+                              pe::Sub(pe::Const(1.0f),
+                                      pe::Mul(k, pe::Abs(u)))))
+        .clone();
+  }
+  if (surrogate.name == "spike_rate_escape") {
+    // k * exp(-beta * |u|)
+    return pe::Mul(k, pe::Exp(pe::Mul(pe::Const(-surrogate.beta),
+                                      pe::Abs(u))))
+        .clone();
+  }
+  // 1 / (k * |u| + 1)^2
+  return pe::Divide(pe::Const(1.0f),
+                    pe::Square(pe::Add(pe::Mul(k, pe::Abs(u)),
+                                       pe::Const(1.0f))))
+      .clone();
+}
+
+// Apply `resetMechanism` to the freshly integrated state `base`, where the
+// (detached) reset is decided by the previous membrane potential `mem`.
+inline std::unique_ptr<pe::Expr> applyReset(int64_t resetMechanism,
+                                            const pe::Expr &base,
+                                            const pe::Expr &mem,
+                                            const pe::Expr &threshold) {
+  auto fired = pe::Gte(mem, threshold);
+  switch (resetMechanism) {
+  case Subtract:
+    return pe::Select(pe::Sub(base, threshold), base, fired).clone();
+  case Zero:
+    return pe::Select(pe::Const(0.0f), base, fired).clone();
+  default: // no reset, pure integration
+    return base.clone();
+  }
+}
+
+// decay * mem + input, followed by the reset
+inline std::unique_ptr<pe::Expr>
+decayMemNext(int64_t resetMechanism, const pe::Expr &input,
+             const pe::Expr &mem, const pe::Expr &decay,
+             const pe::Expr &threshold) {
+  auto base = pe::Add(pe::Mul(decay, mem), input);
+  return applyReset(resetMechanism, base, mem, threshold);
+}
+
+// clamp(beta, 0, 1) * mem + input, followed by the reset
+inline std::unique_ptr<pe::Expr>
+leakyMemNext(int64_t resetMechanism, const pe::Expr &input,
+             const pe::Expr &mem, const pe::Expr &beta,
+             const pe::Expr &threshold) {
+  return decayMemNext(resetMechanism, input, mem, clampUnit(beta), threshold);
+}
+
+} // namespace neuron_step
+
+#endif // SNNTORCH_CUSTOM_OPS_NEURON_STEP_HPP
@@ -0,0 +1,181 @@
+// On-device rate (Bernoulli) encoding, the op behind `spikegen.rate`.
+//
+// Takes a static input [...] and returns [num_steps, ...] spikes, where
+//
+//   p           = clamp(gain * input + offset, 0, 1)
+//   spk[t, ...] = u[t, ...] < p                  with u ~ U[0, 1) on device
+//   spk[t, ...] = 0                              for t < first_spike_time
+//
+// so that only the input crosses the host link, not the num_steps times
+// larger spike train. The uniform draws come from poprand, seeded by the
+// random seed PopART connects to the op (`requiresRandomSeed`). The encoding
+// is not differentiable, so the op has no grad op.
+#include <popart/error.hpp>
+#include <popart/opmanager.hpp>
+#include <popart/opserialiser.hpp>
+#include <popart/popx/opx.hpp>
+#include <popart/popx/opxmanager.hpp>
+
+#include <popops/ElementWise.hpp>
+#include <popops/Zero.hpp>
+#include <poprand/RandomGen.hpp>
+#include <poputil/TileMapping.hpp>
+
+namespace CustomOperators {
+const popart::OperatorIdentifier RateEncodeId = {"custom.ops", "RateEncode",
+                                                 1};
+} // namespace CustomOperators
+
+class RateEncodeOp : public popart::Op {
+public:
+  RateEncodeOp(const popart::OperatorIdentifier &_opid, int64_t _numSteps,
+               float _gain, float _offset, int64_t _firstSpikeTime,
+               const popart::Op::Settings &settings_)
+      : popart::Op(_opid, settings_), numSteps(_numSteps), gain(_gain),
+        offset(_offset), firstSpikeTime(_firstSpikeTime) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<RateEncodeOp>(*this);
+  }
+
+  // Time is prepended to the input shape
+  void setup() final {
+    popart::Shape shape = inInfo(0).shape();
+    shape.insert(shape.begin(), numSteps);
+    outInfo(0) = {inInfo(0).dataType(), shape};
+  }
+
+  void appendAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendAttributes(os);
+    appendRateAttributes(os);
+  }
+
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendOutlineAttributes(os);
+    appendRateAttributes(os);
+  }
+
+  float getSubgraphValue() const final { return getLowSubgraphValue(); }
+
+  // PopART connects the seed after the input
+  bool requiresRandomSeed() const override { return true; }
+  popart::InIndex getSeedInIndex() const override { return 1; }
+
+  // Attributes
+  int64_t getNumSteps() const { return numSteps; }
+  float getGain() const { return gain; }
+  float getOffset() const { return offset; }
+  int64_t getFirstSpikeTime() const { return firstSpikeTime; }
+
+private:
+  void appendRateAttributes(popart::OpSerialiserBase &os) const {
+    os.appendAttribute("num_steps", getNumSteps());
+    os.appendAttribute("gain", getGain());
+    os.appendAttribute("offset", getOffset());
+    os.appendAttribute("first_spike_time", getFirstSpikeTime());
+  }
+
+  int64_t numSteps;
+  float gain;
+  float offset;
+  int64_t firstSpikeTime;
+};
+
+namespace {
+using popart::DataType;
+using popart::OpDefinition;
+
+static OpDefinition::DataTypes T = {DataType::FLOAT16, DataType::FLOAT};
+
+static OpDefinition
+    RateEncodeOpDef({OpDefinition::Inputs({{"input", T}}),
+                     OpDefinition::Outputs({{"output", T}}),
+                     OpDefinition::Attributes({{"num_steps", {"*"}},
+                                               {"gain", {"*"}},
+                                               {"offset", {"*"}},
+                                               {"first_spike_time", {"*"}}})});
+
+static popart::OpCreator<RateEncodeOp> RateEncodeOpCreator(
+    popart::OpDefinitions({{CustomOperators::RateEncodeId, RateEncodeOpDef}}),
+    [](const popart::OpCreatorInfo &info) {
+      int64_t numSteps =
+          info.attributes.getAttribute<popart::Attributes::Int>("num_steps",
+                                                                0);
+      float gain =
+          info.attributes.getAttribute<popart::Attributes::Float>("gain", 1.0f);
+      float offset = info.attributes.getAttribute<popart::Attributes::Float>(
+          "offset", 0.0f);
+      int64_t firstSpikeTime =
+          info.attributes.getAttribute<popart::Attributes::Int>(
+              "first_spike_time", 0);
+      if (numSteps <= 0) {
+        throw popart::error("RateEncode: num_steps must be positive, got {}",
+                            numSteps);
+      }
+      if (firstSpikeTime < 0 || firstSpikeTime > numSteps - 1) {
+        throw popart::error("RateEncode: first_spike_time must be in [0, {}], "
+                            "got {}",
+                            numSteps - 1, firstSpikeTime);
+      }
+      return std::make_unique<RateEncodeOp>(info.opid, numSteps, gain, offset,
+                                            firstSpikeTime, info.settings);
+    },
+    true);
+} // namespace
+
+namespace pe = popops::expr;
+
+class RateEncodeOpx : public popart::popx::Opx {
+public:
+  RateEncodeOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<RateEncodeOp>(op, {CustomOperators::RateEncodeId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+    auto op = getOp<RateEncodeOp>();
+
+    poplar::Tensor input = getInTensor(0);
+    poplar::Tensor seed = getInTensor(op.getSeedInIndex());
+    const auto type = input.elementType();
+    const auto numSteps = static_cast<std::size_t>(op.getNumSteps());
+
+    // Firing probability, computed once for all steps
+    auto probability = popops::map(
+        graph(),
+        pe::Clamp(pe::Add(pe::Mul(pe::_1, pe::Const(op.getGain())),
+                          pe::Const(op.getOffset())),
+                  pe::Const(0.0f), pe::Const(1.0f)),
+        {input}, prog, debugContext("RateEncodeProbability"));
+
+    // The draws take the tile mapping of the spike train, spread over tiles
+    auto shape = input.shape();
+    shape.insert(shape.begin(), numSteps);
+    auto reference =
+        graph().addVariable(type, shape, debugContext("RateEncodeReference"));
+    poputil::mapTensorLinearly(graph(), reference);
+    auto spikes = poprand::uniform(graph(), &seed, 0u, reference, type, 0.0,
+                                   1.0, prog, debugContext("RateEncodeDraws"));
+
+    // u < p, turned into 0 / 1 in place. p = 1 always fires, in case a draw
+    // rounds up to 1 in half precision.
+    popops::mapInPlace(
+        graph(),
+        pe::Select(pe::Const(1.0f), pe::Const(0.0f),
+                   pe::Or(pe::Lt(pe::_1, pe::_2),
+                          pe::Gte(pe::_2, pe::Const(1.0f)))),
+        {spikes, probability.expand({0}).broadcast(numSteps, 0)}, prog,
+        debugContext("RateEncodeSpikes"));
+
+    if (op.getFirstSpikeTime() > 0) {
+      popops::zero(graph(),
+                   spikes.slice(0, op.getFirstSpikeTime(), 0), prog,
+                   debugContext("RateEncodeFirstSpikeTime"));
+    }
+
+    setOutTensor(0, spikes);
+  }
+};
+
+static popart::popx::OpxCreator<RateEncodeOpx>
+    RateEncodeOpxCreator({CustomOperators::RateEncodeId});
@@ -0,0 +1,100 @@
+// Helpers shared by the recurrent neuron ops (RLeakyStep, RSynapticStep),
+// which add the spikes of the previous step, weighted by V, to the input
+// current. V is either broadcast against the spikes (one weight for the
+// layer or one per neuron, as RLeaky and RSynaptic take it), or a square
+// [N, N] matrix of all-to-all weights applied as spk @ V^T.
+#ifndef SNNTORCH_CUSTOM_OPS_RECURRENT_HPP
+#define SNNTORCH_CUSTOM_OPS_RECURRENT_HPP
+
+#include <poplin/MatMul.hpp>
+#include <popops/ElementWise.hpp>
+
+#include <memory>
+#include <utility>
+
+#include "neuron_step.hpp"
+
+namespace recurrent {
+
+namespace pe = popops::expr;
+
+// Whether V is the [N, N] matrix of the all-to-all recurrence for spikes of
+// shape [..., N]
+inline bool isDense(const poplar::Tensor &v, const poplar::Tensor &spk) {
+  const std::size_t n = spk.dim(spk.rank() - 1);
+  return v.rank() == 2 && v.dim(0) == n && v.dim(1) == n;
+}
+
+// spk @ V^T over the last dimension of spk, for a dense V
+inline poplar::Tensor matMulLast(poplar::Graph &graph,
+                                 const poplar::Tensor &spk,
+                                 const poplar::Tensor &v,
+                                 poplar::program::Sequence &prog,
+                                 const poplar::DebugContext &dc) {
+  const std::size_t n = spk.dim(spk.rank() - 1);
+  auto out = poplin::matMul(graph, spk.reshape({spk.numElements() / n, n}), v,
+                            prog, spk.elementType(), dc);
+  return out.reshape(spk.shape());
+}
+
+// The tensor standing in for V in the neuron maps: V broadcast to the shape
+// of the spikes, or the whole recurrent current spk @ V^T when V is dense.
+// The matmul is the only op added to the neuron update.
+inline poplar::Tensor operand(poplar::Graph &graph, const poplar::Tensor &spk,
+                              poplar::Tensor v,
+                              poplar::program::Sequence &prog,
+                              const poplar::DebugContext &dc) {
+  if (!isDense(v, spk)) {
+    return neuron_step::broadcastParam(graph, v, spk.elementType(),
+                                       spk.shape(), prog, dc);
+  }
+  if (v.elementType() != spk.elementType()) {
+    v = popops::cast(graph, v, spk.elementType(), prog, dc);
+  }
+  return matMulLast(graph, spk, v.transpose(), prog, dc);
+}
+
+// The recurrent current in terms of the `spk` and `operand` placeholders
+inline std::unique_ptr<pe::Expr> current(bool dense, const pe::Expr &spk,
+                                         const pe::Expr &operand) {
+  if (dense) {
+    return operand.clone();
+  }
+  return pe::Mul(operand, spk).clone();
+}
+
+// The gradients of the spikes and of V from that of the recurrent current
+inline std::pair<poplar::Tensor, poplar::Tensor>
+grads(poplar::Graph &graph, const poplar::Tensor &gradCurrent,
+      const poplar::Tensor &spk, poplar::Tensor v,
+      poplar::program::Sequence &prog, const poplar::DebugContext &dc) {
+  auto type = gradCurrent.elementType();
+  const auto vShape = v.shape();
+  const auto vType = v.elementType();
+  if (!isDense(v, spk)) {
+    v = neuron_step::broadcastParam(graph, v, type, spk.shape(), prog, dc);
+    auto gradSpk = popops::map(graph, pe::Mul(pe::_1, pe::_2),
+                               {gradCurrent, v}, prog, dc);
+    auto gradV = popops::map(graph, pe::Mul(pe::_1, pe::_2),
+                             {gradCurrent, spk}, prog, dc);
+    return {gradSpk, neuron_step::reduceToShape(graph, gradV, vShape, vType,
+                                                prog, dc)};
+  }
+  if (vType != type) {
+    v = popops::cast(graph, v, type, prog, dc);
+  }
+  const std::size_t n = spk.dim(spk.rank() - 1);
+  auto gradSpk = matMulLast(graph, gradCurrent, v, prog, dc);
+  auto gradV = poplin::matMul(
+      graph, gradCurrent.reshape({gradCurrent.numElements() / n, n})
+                 .transpose(),
+      spk.reshape({spk.numElements() / n, n}), prog, type, dc);
+  if (vType != type) {
+    gradV = popops::cast(graph, gradV, vType, prog, dc);
+  }
+  return {gradSpk, gradV};
+}
+
+} // namespace recurrent
+
+#endif // SNNTORCH_CUSTOM_OPS_RECURRENT_HPP
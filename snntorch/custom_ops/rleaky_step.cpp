@@ -0,0 +1,387 @@
+// Fused single-timestep recurrent Leaky integrate-and-fire neuron, the op
+// behind `RLeaky`.
+//
+// Takes (input, spk, mem, V, beta, threshold), spk being the spikes of the
+// previous step, and returns (spk_next, mem_next), where
+//
+//   rec      = V * spk        or spk @ V^T for a square [N, N] V
+//   reset    = mem >= threshold                        (detached)
+//   mem_next = clamp(beta, 0, 1) * mem + input + rec - reset * threshold
+//   spk_next = mem_next >= threshold
+//
+// for the default reset-by-subtraction, see recurrent.hpp for V. With a
+// broadcast V the recurrence is folded into the membrane map; a dense V
+// adds the one matmul. `reset_mechanism` follows `SpikingNeuron.reset_dict`
+// (0: subtract, 1: zero, 2: none) and `surrogate` selects the gradient used
+// for dS/dU in the backward pass, which also reaches spk, so gradients run
+// through the recurrence over time.
+// `spike_dtype` = "bool" / "uint8" emits spk_next at one byte per neuron
+// while mem_next keeps the type of the input; the op then has no grad op.
+#include <popart/error.hpp>
+#include <popart/opmanager.hpp>
+#include <popart/opserialiser.hpp>
+#include <popart/popx/opx.hpp>
+#include <popart/popx/opxmanager.hpp>
+
+#include <popops/ElementWise.hpp>
+
+#include "neuron_step.hpp"
+#include "recurrent.hpp"
+
+namespace CustomOperators {
+const popart::OperatorIdentifier RLeakyStepId = {"custom.ops", "RLeakyStep",
+                                                 1};
+} // namespace CustomOperators
+namespace CustomGradOperators {
+const popart::OperatorIdentifier RLeakyStepGradId = {"custom.ops",
+                                                     "RLeakyStepGrad", 1};
+} // namespace CustomGradOperators
+
+class RLeakyStepOp;
+class RLeakyStepOpx;
+class RLeakyStepGradOpx;
+
+class RLeakyStepGradOp : public popart::Op {
+public:
+  RLeakyStepGradOp(const RLeakyStepOp &fwdOp);
+
+  std::unique_ptr<popart::Op> clone() const final {
+    return std::make_unique<RLeakyStepGradOp>(*this);
+  }
+
+  // One gradient per forward input: input, spk, mem, V, beta, threshold
+  void setup() final {
+    for (int i = 0; i < static_cast<int>(fwdInInfo.size()); ++i) {
+      outInfo(i) = fwdInInfo[i];
+    }
+  };
+
+  const std::vector<popart::GradInOutMapper> &gradInputInfo() const;
+
+  const std::map<int, int> &gradOutToNonGradIn() const;
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // an estimate of how valuable sub-graph matching will be
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  int64_t getResetMechanism() const { return resetMechanism; }
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+
+  // Implementation defined below
+  void appendAttributes(popart::OpSerialiserBase &os) const override;
+
+  // Implementation defined below
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override;
+
+private:
+  int64_t resetMechanism;
+  neuron_step::Surrogate surrogate;
+  std::vector<popart::TensorInfo> fwdInInfo;
+};
+
+class RLeakyStepOp : public popart::Op {
+public:
+  RLeakyStepOp(const popart::OperatorIdentifier &_opid,
+               int64_t _resetMechanism,
+               const neuron_step::Surrogate &_surrogate,
+               const std::string &_spikeDtype,
+               const popart::Op::Settings &settings_)
+      : popart::Op(_opid, settings_), resetMechanism(_resetMechanism),
+        surrogate(_surrogate), spikeDtype(_spikeDtype) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<RLeakyStepOp>(*this);
+  }
+
+  // spk_next and mem_next both take the shape and type of the input
+  // current, unless spk_next is emitted as a compact spike_dtype
+  void setup() final {
+    if (inInfo(1).shape() != inInfo(0).shape() ||
+        inInfo(2).shape() != inInfo(0).shape()) {
+      throw popart::error("RLeakyStep: spk and mem must have the shape of "
+                          "the input");
+    }
+    outInfo(0) = neuron_step::spikeInfo(inInfo(0), getSpikeDtype());
+    outInfo(1) = inInfo(0);
+  }
+
+  void appendAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendAttributes(os);
+    os.appendAttribute("reset_mechanism", getResetMechanism());
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendOutlineAttributes(os);
+    os.appendAttribute("reset_mechanism", getResetMechanism());
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  // Compact spikes carry no gradient
+  std::vector<std::unique_ptr<popart::Op>> getGradOps() {
+    std::vector<std::unique_ptr<Op>> upops;
+    if (neuron_step::compactSpikes(getSpikeDtype())) {
+      return upops;
+    }
+    upops.emplace_back(new RLeakyStepGradOp(*this));
+    return upops;
+  }
+
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // Attributes
+  int64_t getResetMechanism() const { return resetMechanism; }
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+  const std::string &getSpikeDtype() const { return spikeDtype; }
+
+private:
+  int64_t resetMechanism;
+  neuron_step::Surrogate surrogate;
+  std::string spikeDtype;
+};
+
+namespace {
+using popart::DataType;
+using popart::OpDefinition;
+
+static OpDefinition::DataTypes T = {DataType::FLOAT16, DataType::FLOAT};
+static OpDefinition::DataTypes Spikes = {DataType::FLOAT16, DataType::FLOAT,
+                                         DataType::BOOL, DataType::UINT8};
+
+static OpDefinition RLeakyStepOpDef(
+    {OpDefinition::Inputs({{"input", T},
+                           {"spk", T},
+                           {"mem", T},
+                           {"V", T},
+                           {"beta", T},
+                           {"threshold", T}}),
+     OpDefinition::Outputs({{"spk_next", Spikes}, {"mem_next", T}}),
+     OpDefinition::Attributes({{"reset_mechanism", {"*"}},
+                               {"surrogate", {"*"}},
+                               {"slope", {"*"}},
+                               {"beta", {"*"}},
+                               {"spike_dtype", {"*"}}})});
+
+static popart::OpCreator<RLeakyStepOp> RLeakyStepOpCreator(
+    popart::OpDefinitions({{CustomOperators::RLeakyStepId, RLeakyStepOpDef}}),
+    [](const popart::OpCreatorInfo &info) {
+      // default reset mechanism is subtraction, see SpikingNeuron.reset_dict
+      int64_t resetMechanism =
+          info.attributes.getAttribute<popart::Attributes::Int>(
+              "reset_mechanism", 0);
+      neuron_step::checkResetMechanism("RLeakyStep", resetMechanism);
+      neuron_step::Surrogate surrogate = neuron_step::surrogateAttributes(
+          "RLeakyStep", info.attributes, "fast_sigmoid");
+      std::string spikeDtype =
+          neuron_step::spikeDtypeAttribute("RLeakyStep", info.attributes);
+      return std::make_unique<RLeakyStepOp>(info.opid, resetMechanism,
+                                            surrogate, spikeDtype,
+                                            info.settings);
+    },
+    true);
+} // namespace
+
+namespace pe = popops::expr;
+namespace ns = neuron_step;
+
+class RLeakyStepOpx : public popart::popx::Opx {
+public:
+  RLeakyStepOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<RLeakyStepOp>(op, {CustomOperators::RLeakyStepId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+
+    auto op = getOp<RLeakyStepOp>();
+
+    poplar::Tensor input = getInTensor(0);
+    poplar::Tensor spk = getInTensor(1);
+    poplar::Tensor mem = getInTensor(2);
+    auto type = input.elementType();
+    auto shape = input.shape();
+    const bool dense = recurrent::isDense(getInTensor(3), spk);
+    poplar::Tensor v = recurrent::operand(graph(), spk, getInTensor(3), prog,
+                                          debugContext("RLeakyStepV"));
+    poplar::Tensor beta = ns::broadcastParam(graph(), getInTensor(4), type,
+                                             shape, prog, debugContext("beta"));
+    poplar::Tensor threshold =
+        ns::broadcastParam(graph(), getInTensor(5), type, shape, prog,
+                           debugContext("threshold"));
+
+    // _1: input, _2: spk, _3: mem, _4: beta, _5: threshold, _6: V or rec
+    auto integrand =
+        pe::Add(pe::_1, *recurrent::current(dense, pe::_2, pe::_6));
+    auto memNextExpr = ns::leakyMemNext(op.getResetMechanism(), integrand,
+                                        pe::_3, pe::_4, pe::_5);
+    auto memNext = popops::map(graph(), *memNextExpr,
+                               {input, spk, mem, beta, threshold, v}, prog,
+                               debugContext("RLeakyStepMem"));
+
+    auto spkExpr =
+        ns::spikeOutput(ns::spike(pe::_1, pe::_2), op.getSpikeDtype());
+    auto spkNext = popops::map(graph(), *spkExpr, {memNext, threshold}, prog,
+                               debugContext("RLeakyStepSpike"));
+
+    setOutTensor(0, spkNext);
+    setOutTensor(1, memNext);
+  }
+};
+
+class RLeakyStepGradOpx : public popart::popx::Opx {
+public:
+  RLeakyStepGradOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<RLeakyStepGradOp>(op, {CustomGradOperators::RLeakyStepGradId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+
+    auto op = getOp<RLeakyStepGradOp>();
+
+    poplar::Tensor spk = getInTensor(2);
+    poplar::Tensor mem = getInTensor(3);
+    poplar::Tensor vIn = getInTensor(4);
+    poplar::Tensor betaIn = getInTensor(5);
+    poplar::Tensor thresholdIn = getInTensor(6);
+    poplar::Tensor memNext = getInTensor(7);
+    // A loss on the states alone leaves no gradient for spk
+    poplar::Tensor gradSpk =
+        hasInput(0) ? getInTensor(0)
+                    : ns::zerosLike(graph(), memNext, prog,
+                                    debugContext("gradSpk"));
+
+    auto type = gradSpk.elementType();
+    auto shape = gradSpk.shape();
+    poplar::Tensor beta = ns::broadcastParam(graph(), betaIn, type, shape, prog,
+                                             debugContext("beta"));
+    poplar::Tensor threshold = ns::broadcastParam(
+        graph(), thresholdIn, type, shape, prog, debugContext("threshold"));
+
+    // Gradient reaching mem_next through the spike: gradSpk * dS/dU
+    auto surrogate =
+        ns::surrogateGrad(op.getSurrogate(), pe::Sub(pe::_2, pe::_3));
+    auto gradSpkU =
+        popops::map(graph(), pe::Mul(pe::_1, *surrogate),
+                    {gradSpk, memNext, threshold}, prog,
+                    debugContext("RLeakyStepGradSurrogate"));
+
+    // Total gradient w.r.t. mem_next
+    poplar::Tensor gradU = gradSpkU;
+    if (hasInput(1)) {
+      gradU = popops::map(graph(), pe::Add(pe::_1, pe::_2),
+                          {getInTensor(1), gradSpkU}, prog,
+                          debugContext("RLeakyStepGradMemNext"));
+    }
+
+    // Reset-to-zero masks every path through the integration; what is left
+    // is the gradient of the input and of the recurrent current alike
+    poplar::Tensor gradInput = gradU;
+    if (op.getResetMechanism() == ns::Zero) {
+      // _1: gradU, _2: mem, _3: threshold
+      gradInput = popops::map(graph(),
+                              pe::Select(pe::Const(0.0f), pe::_1,
+                                         pe::Gte(pe::_2, pe::_3)),
+                              {gradU, mem, threshold}, prog,
+                              debugContext("RLeakyStepGradInput"));
+    }
+
+    auto gradRecurrent = recurrent::grads(graph(), gradInput, spk, vIn, prog,
+                                          debugContext("RLeakyStepGradV"));
+
+    // _1: gradInput, _2: beta
+    auto gradMem = popops::map(graph(), pe::Mul(pe::_1, ns::clampUnit(pe::_2)),
+                               {gradInput, beta}, prog,
+                               debugContext("RLeakyStepGradMem"));
+
+    // dmem_next/dbeta = mem, only where beta is not clamped
+    auto gradBeta = popops::map(graph(), pe::Mul(pe::_1, pe::_2),
+                                {gradInput, mem}, prog,
+                                debugContext("RLeakyStepGradBeta"));
+    gradBeta = ns::reduceToShape(graph(), gradBeta, betaIn.shape(),
+                                 betaIn.elementType(), prog,
+                                 debugContext("RLeakyStepGradBetaReduce"));
+    ns::maskClampedGrad(graph(), gradBeta, betaIn, prog,
+                        debugContext("RLeakyStepGradBetaClamp"));
+
+    // The spike always sees -threshold; reset-by-subtraction adds -reset
+    std::unique_ptr<pe::Expr> gradThresholdExpr;
+    if (op.getResetMechanism() == ns::Subtract) {
+      // _1: gradSpkU, _2: gradU, _3: mem, _4: threshold
+      gradThresholdExpr =
+          pe::Neg(pe::Add(pe::_1, pe::Select(pe::_2, pe::Const(0.0f),
+                                             pe::Gte(pe::_3, pe::_4))))
+              .clone();
+    } else {
+      gradThresholdExpr = pe::Neg(pe::_1).clone();
+    }
+    auto gradThreshold =
+        popops::map(graph(), *gradThresholdExpr,
+                    {gradSpkU, gradU, mem, threshold}, prog,
+                    debugContext("RLeakyStepGradThreshold"));
+    gradThreshold = ns::reduceToShape(
+        graph(), gradThreshold, thresholdIn.shape(),
+        thresholdIn.elementType(), prog,
+        debugContext("RLeakyStepGradThresholdReduce"));
+
+    setOutTensor(0, gradInput);
+    setOutTensor(1, gradRecurrent.first);
+    setOutTensor(2, gradMem);
+    setOutTensor(3, gradRecurrent.second);
+    setOutTensor(4, gradBeta);
+    setOutTensor(5, gradThreshold);
+  }
+};
+
+RLeakyStepGradOp::RLeakyStepGradOp(const RLeakyStepOp &fwdOp)
+    : popart::Op(CustomGradOperators::RLeakyStepGradId, fwdOp.settings),
+      resetMechanism(fwdOp.getResetMechanism()),
+      surrogate(fwdOp.getSurrogate()) {
+  for (int i = 0; i < 6; ++i) {
+    fwdInInfo.push_back(fwdOp.inInfo(i));
+  }
+}
+
+const std::vector<popart::GradInOutMapper> &
+RLeakyStepGradOp::gradInputInfo() const {
+  static const std::vector<popart::GradInOutMapper> inInfo = {
+      {0, 0, popart::GradOpInType::GradOut},
+      {1, 1, popart::GradOpInType::GradOut},
+      {2, 1, popart::GradOpInType::In},
+      {3, 2, popart::GradOpInType::In},
+      {4, 3, popart::GradOpInType::In},
+      {5, 4, popart::GradOpInType::In},
+      {6, 5, popart::GradOpInType::In},
+      {7, 1, popart::GradOpInType::Out}};
+  return inInfo;
+}
+
+// The Grad Op has 6 outputs, one per forward input
+const std::map<int, int> &RLeakyStepGradOp::gradOutToNonGradIn() const {
+  static const std::map<int, int> outInfo = {{0, 0}, {1, 1}, {2, 2},
+                                             {3, 3}, {4, 4}, {5, 5}};
+  return outInfo;
+}
+
+void RLeakyStepGradOp::appendAttributes(popart::OpSerialiserBase &os) const {
+  Op::appendAttributes(os);
+  os.appendAttribute("reset_mechanism", getResetMechanism());
+  neuron_step::appendSurrogate(os, getSurrogate());
+}
+
+void RLeakyStepGradOp::appendOutlineAttributes(
+    popart::OpSerialiserBase &os) const {
+  Op::appendOutlineAttributes(os);
+  os.appendAttribute("reset_mechanism", getResetMechanism());
+  neuron_step::appendSurrogate(os, getSurrogate());
+}
+
+static popart::popx::OpxCreator<RLeakyStepOpx>
+    RLeakyStepOpxCreator({CustomOperators::RLeakyStepId});
+static popart::popx::OpxCreator<RLeakyStepGradOpx>
+    RLeakyStepGradOpxCreator({CustomGradOperators::RLeakyStepGradId});
@@ -0,0 +1,442 @@
+// Fused single-timestep recurrent Synaptic (2nd order) integrate-and-fire
+// neuron, the op behind `RSynaptic`.
+//
+// Takes (input, spk, syn, mem, V, alpha, beta, threshold), spk being the
+// spikes of the previous step, and returns (spk_next, syn_next, mem_next),
+// where
+//
+//   rec      = V * spk        or spk @ V^T for a square [N, N] V
+//   reset    = mem >= threshold                          (detached)
+//   syn_next = clamp(alpha, 0, 1) * syn + input + rec
+//   mem_next = clamp(beta, 0, 1) * mem + syn_next - reset * threshold
+//   spk_next = mem_next >= threshold
+//
+// for the default reset-by-subtraction, see recurrent.hpp for V. With a
+// broadcast V the recurrence is folded into the state maps; a dense V adds
+// the one matmul. Reset-to-zero zeroes mem_next and leaves syn_next
+// untouched. `reset_mechanism` follows `SpikingNeuron.reset_dict`
+// (0: subtract, 1: zero, 2: none) and `surrogate` selects the gradient used
+// for dS/dU in the backward pass, which also reaches spk, so gradients run
+// through the recurrence over time.
+// `spike_dtype` = "bool" / "uint8" emits spk_next at one byte per neuron
+// while the states keep the type of the input; the op then has no grad op.
+#include <popart/error.hpp>
+#include <popart/opmanager.hpp>
+#include <popart/opserialiser.hpp>
+#include <popart/popx/opx.hpp>
+#include <popart/popx/opxmanager.hpp>
+
+#include <popops/ElementWise.hpp>
+
+#include "neuron_step.hpp"
+#include "recurrent.hpp"
+
+namespace CustomOperators {
+const popart::OperatorIdentifier RSynapticStepId = {"custom.ops",
+                                                    "RSynapticStep", 1};
+} // namespace CustomOperators
+namespace CustomGradOperators {
+const popart::OperatorIdentifier RSynapticStepGradId = {"custom.ops",
+                                                       "RSynapticStepGrad", 1};
+} // namespace CustomGradOperators
+
+class RSynapticStepOp;
+class RSynapticStepOpx;
+class RSynapticStepGradOpx;
+
+class RSynapticStepGradOp : public popart::Op {
+public:
+  RSynapticStepGradOp(const RSynapticStepOp &fwdOp);
+
+  std::unique_ptr<popart::Op> clone() const final {
+    return std::make_unique<RSynapticStepGradOp>(*this);
+  }
+
+  // One gradient per forward input: input, spk, syn, mem, V, alpha, beta,
+  // threshold
+  void setup() final {
+    for (int i = 0; i < static_cast<int>(fwdInInfo.size()); ++i) {
+      outInfo(i) = fwdInInfo[i];
+    }
+  };
+
+  const std::vector<popart::GradInOutMapper> &gradInputInfo() const;
+
+  const std::map<int, int> &gradOutToNonGradIn() const;
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // an estimate of how valuable sub-graph matching will be
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  int64_t getResetMechanism() const { return resetMechanism; }
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+
+  // Implementation defined below
+  void appendAttributes(popart::OpSerialiserBase &os) const override;
+
+  // Implementation defined below
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override;
+
+private:
+  int64_t resetMechanism;
+  neuron_step::Surrogate surrogate;
+  std::vector<popart::TensorInfo> fwdInInfo;
+};
+
+class RSynapticStepOp : public popart::Op {
+public:
+  RSynapticStepOp(const popart::OperatorIdentifier &_opid,
+                  int64_t _resetMechanism,
+                  const neuron_step::Surrogate &_surrogate,
+                  const std::string &_spikeDtype,
+                  const popart::Op::Settings &settings_)
+      : popart::Op(_opid, settings_), resetMechanism(_resetMechanism),
+        surrogate(_surrogate), spikeDtype(_spikeDtype) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<RSynapticStepOp>(*this);
+  }
+
+  // spk_next, syn_next and mem_next all take the shape and type of the
+  // input, unless spk_next is emitted as a compact spike_dtype
+  void setup() final {
+    for (int i = 1; i < 4; ++i) {
+      if (inInfo(i).shape() != inInfo(0).shape()) {
+        throw popart::error("RSynapticStep: spk, syn and mem must have the "
+                            "shape of the input");
+      }
+    }
+    outInfo(0) = neuron_step::spikeInfo(inInfo(0), getSpikeDtype());
+    outInfo(1) = inInfo(0);
+    outInfo(2) = inInfo(0);
+  }
+
+  void appendAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendAttributes(os);
+    os.appendAttribute("reset_mechanism", getResetMechanism());
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendOutlineAttributes(os);
+    os.appendAttribute("reset_mechanism", getResetMechanism());
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  // Compact spikes carry no gradient
+  std::vector<std::unique_ptr<popart::Op>> getGradOps() {
+    std::vector<std::unique_ptr<Op>> upops;
+    if (neuron_step::compactSpikes(getSpikeDtype())) {
+      return upops;
+    }
+    upops.emplace_back(new RSynapticStepGradOp(*this));
+    return upops;
+  }
+
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // Attributes
+  int64_t getResetMechanism() const { return resetMechanism; }
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+  const std::string &getSpikeDtype() const { return spikeDtype; }
+
+private:
+  int64_t resetMechanism;
+  neuron_step::Surrogate surrogate;
+  std::string spikeDtype;
+};
+
+namespace {
+using popart::DataType;
+using popart::OpDefinition;
+
+static OpDefinition::DataTypes T = {DataType::FLOAT16, DataType::FLOAT};
+static OpDefinition::DataTypes Spikes = {DataType::FLOAT16, DataType::FLOAT,
+                                         DataType::BOOL, DataType::UINT8};
+
+static OpDefinition RSynapticStepOpDef(
+    {OpDefinition::Inputs({{"input", T},
+                           {"spk", T},
+                           {"syn", T},
+                           {"mem", T},
+                           {"V", T},
+                           {"alpha", T},
+                           {"beta", T},
+                           {"threshold", T}}),
+     OpDefinition::Outputs(
+         {{"spk_next", Spikes}, {"syn_next", T}, {"mem_next", T}}),
+     OpDefinition::Attributes(
+         {{"reset_mechanism", {"*"}},
+          {"surrogate", {"*"}},
+          {"slope", {"*"}},
+          {"beta", {"*"}},
+          {"spike_dtype", {"*"}}})});
+
+static popart::OpCreator<RSynapticStepOp> RSynapticStepOpCreator(
+    popart::OpDefinitions(
+        {{CustomOperators::RSynapticStepId, RSynapticStepOpDef}}),
+    [](const popart::OpCreatorInfo &info) {
+      // default reset mechanism is subtraction, see SpikingNeuron.reset_dict
+      int64_t resetMechanism =
+          info.attributes.getAttribute<popart::Attributes::Int>(
+              "reset_mechanism", 0);
+      neuron_step::checkResetMechanism("RSynapticStep", resetMechanism);
+      neuron_step::Surrogate surrogate = neuron_step::surrogateAttributes(
+          "RSynapticStep", info.attributes, "fast_sigmoid");
+      std::string spikeDtype =
+          neuron_step::spikeDtypeAttribute("RSynapticStep", info.attributes);
+      return std::make_unique<RSynapticStepOp>(info.opid, resetMechanism,
+                                               surrogate, spikeDtype,
+                                               info.settings);
+    },
+    true);
+} // namespace
+
+namespace pe = popops::expr;
+namespace ns = neuron_step;
+
+class RSynapticStepOpx : public popart::popx::Opx {
+public:
+  RSynapticStepOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<RSynapticStepOp>(op, {CustomOperators::RSynapticStepId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+
+    auto op = getOp<RSynapticStepOp>();
+
+    poplar::Tensor input = getInTensor(0);
+    poplar::Tensor spk = getInTensor(1);
+    poplar::Tensor syn = getInTensor(2);
+    poplar::Tensor mem = getInTensor(3);
+    auto type = input.elementType();
+    auto shape = input.shape();
+    const bool dense = recurrent::isDense(getInTensor(4), spk);
+    poplar::Tensor v = recurrent::operand(graph(), spk, getInTensor(4), prog,
+                                          debugContext("RSynapticStepV"));
+    poplar::Tensor alpha = ns::broadcastParam(
+        graph(), getInTensor(5), type, shape, prog, debugContext("alpha"));
+    poplar::Tensor beta = ns::broadcastParam(graph(), getInTensor(6), type,
+                                             shape, prog, debugContext("beta"));
+    poplar::Tensor threshold =
+        ns::broadcastParam(graph(), getInTensor(7), type, shape, prog,
+                           debugContext("threshold"));
+    std::vector<poplar::Tensor> ins = {input, syn,       mem, alpha,
+                                       beta,  threshold, spk, v};
+
+    // _1: input, _2: syn, _3: mem, _4: alpha, _5: beta, _6: threshold,
+    // _7: spk, _8: V or rec
+    auto synNextExpr =
+        pe::Add(pe::Add(pe::Mul(ns::clampUnit(pe::_4), pe::_2), pe::_1),
+                *recurrent::current(dense, pe::_7, pe::_8));
+    auto synNext = popops::map(graph(), synNextExpr, ins, prog,
+                               debugContext("RSynapticStepSyn"));
+
+    // syn_next is recomputed inline so both states come from the same reads
+    auto memNextExpr = ns::leakyMemNext(op.getResetMechanism(), synNextExpr,
+                                        pe::_3, pe::_5, pe::_6);
+    auto memNext = popops::map(graph(), *memNextExpr, ins, prog,
+                               debugContext("RSynapticStepMem"));
+
+    auto spkExpr =
+        ns::spikeOutput(ns::spike(pe::_1, pe::_2), op.getSpikeDtype());
+    auto spkNext = popops::map(graph(), *spkExpr, {memNext, threshold}, prog,
+                               debugContext("RSynapticStepSpike"));
+
+    setOutTensor(0, spkNext);
+    setOutTensor(1, synNext);
+    setOutTensor(2, memNext);
+  }
+};
+
+class RSynapticStepGradOpx : public popart::popx::Opx {
+public:
+  RSynapticStepGradOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<RSynapticStepGradOp>(op,
+                                  {CustomGradOperators::RSynapticStepGradId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+
+    auto op = getOp<RSynapticStepGradOp>();
+
+    poplar::Tensor spk = getInTensor(3);
+    poplar::Tensor syn = getInTensor(4);
+    poplar::Tensor mem = getInTensor(5);
+    poplar::Tensor vIn = getInTensor(6);
+    poplar::Tensor alphaIn = getInTensor(7);
+    poplar::Tensor betaIn = getInTensor(8);
+    poplar::Tensor thresholdIn = getInTensor(9);
+    poplar::Tensor memNext = getInTensor(10);
+    // A loss on the states alone leaves no gradient for spk
+    poplar::Tensor gradSpk =
+        hasInput(0) ? getInTensor(0)
+                    : ns::zerosLike(graph(), memNext, prog,
+                                    debugContext("gradSpk"));
+
+    auto type = gradSpk.elementType();
+    auto shape = gradSpk.shape();
+    poplar::Tensor alpha = ns::broadcastParam(graph(), alphaIn, type, shape,
+                                              prog, debugContext("alpha"));
+    poplar::Tensor beta = ns::broadcastParam(graph(), betaIn, type, shape, prog,
+                                             debugContext("beta"));
+    poplar::Tensor threshold = ns::broadcastParam(
+        graph(), thresholdIn, type, shape, prog, debugContext("threshold"));
+
+    // Gradient reaching mem_next through the spike: gradSpk * dS/dU
+    auto surrogate =
+        ns::surrogateGrad(op.getSurrogate(), pe::Sub(pe::_2, pe::_3));
+    auto gradSpkU =
+        popops::map(graph(), pe::Mul(pe::_1, *surrogate),
+                    {gradSpk, memNext, threshold}, prog,
+                    debugContext("RSynapticStepGradSurrogate"));
+
+    // Total gradient w.r.t. mem_next
+    poplar::Tensor gradU = gradSpkU;
+    if (hasInput(2)) {
+      gradU = popops::map(graph(), pe::Add(pe::_1, pe::_2),
+                          {getInTensor(2), gradSpkU}, prog,
+                          debugContext("RSynapticStepGradMemNext"));
+    }
+
+    // Gradient through the integration, masked by reset-to-zero
+    poplar::Tensor gradIntegrate = gradU;
+    if (op.getResetMechanism() == ns::Zero) {
+      // _1: gradU, _2: mem, _3: threshold
+      gradIntegrate = popops::map(graph(),
+                                  pe::Select(pe::Const(0.0f), pe::_1,
+                                             pe::Gte(pe::_2, pe::_3)),
+                                  {gradU, mem, threshold}, prog,
+                                  debugContext("RSynapticStepGradIntegrate"));
+    }
+
+    // Total gradient w.r.t. syn_next, which is also dL/dinput and the
+    // gradient of the recurrent current
+    poplar::Tensor gradSynNext = gradIntegrate;
+    if (hasInput(1)) {
+      gradSynNext = popops::map(graph(), pe::Add(pe::_1, pe::_2),
+                                {getInTensor(1), gradIntegrate}, prog,
+                                debugContext("RSynapticStepGradSynNext"));
+    }
+
+    auto gradRecurrent = recurrent::grads(graph(), gradSynNext, spk, vIn,
+                                          prog,
+                                          debugContext("RSynapticStepGradV"));
+
+    auto gradSyn =
+        popops::map(graph(), pe::Mul(pe::_1, ns::clampUnit(pe::_2)),
+                    {gradSynNext, alpha}, prog,
+                    debugContext("RSynapticStepGradSyn"));
+    auto gradMem =
+        popops::map(graph(), pe::Mul(pe::_1, ns::clampUnit(pe::_2)),
+                    {gradIntegrate, beta}, prog,
+                    debugContext("RSynapticStepGradMem"));
+
+    auto gradAlpha = popops::map(graph(), pe::Mul(pe::_1, pe::_2),
+                                 {gradSynNext, syn}, prog,
+                                 debugContext("RSynapticStepGradAlpha"));
+    gradAlpha = ns::reduceToShape(graph(), gradAlpha, alphaIn.shape(),
+                                  alphaIn.elementType(), prog,
+                                  debugContext("RSynapticStepGradAlphaReduce"));
+    ns::maskClampedGrad(graph(), gradAlpha, alphaIn, prog,
+                        debugContext("RSynapticStepGradAlphaClamp"));
+
+    auto gradBeta = popops::map(graph(), pe::Mul(pe::_1, pe::_2),
+                                {gradIntegrate, mem}, prog,
+                                debugContext("RSynapticStepGradBeta"));
+    gradBeta = ns::reduceToShape(graph(), gradBeta, betaIn.shape(),
+                                 betaIn.elementType(), prog,
+                                 debugContext("RSynapticStepGradBetaReduce"));
+    ns::maskClampedGrad(graph(), gradBeta, betaIn, prog,
+                        debugContext("RSynapticStepGradBetaClamp"));
+
+    // The spike always sees -threshold; reset-by-subtraction adds -reset
+    std::unique_ptr<pe::Expr> gradThresholdExpr;
+    if (op.getResetMechanism() == ns::Subtract) {
+      // _1: gradSpkU, _2: gradU, _3: mem, _4: threshold
+      gradThresholdExpr =
+          pe::Neg(pe::Add(pe::_1, pe::Select(pe::_2, pe::Const(0.0f),
+                                             pe::Gte(pe::_3, pe::_4))))
+              .clone();
+    } else {
+      gradThresholdExpr = pe::Neg(pe::_1).clone();
+    }
+    auto gradThreshold =
+        popops::map(graph(), *gradThresholdExpr,
+                    {gradSpkU, gradU, mem, threshold}, prog,
+                    debugContext("RSynapticStepGradThreshold"));
+    gradThreshold = ns::reduceToShape(
+        graph(), gradThreshold, thresholdIn.shape(),
+        thresholdIn.elementType(), prog,
+        debugContext("RSynapticStepGradThresholdReduce"));
+
+    setOutTensor(0, gradSynNext);
+    setOutTensor(1, gradRecurrent.first);
+    setOutTensor(2, gradSyn);
+    setOutTensor(3, gradMem);
+    setOutTensor(4, gradRecurrent.second);
+    setOutTensor(5, gradAlpha);
+    setOutTensor(6, gradBeta);
+    setOutTensor(7, gradThreshold);
+  }
+};
+
+RSynapticStepGradOp::RSynapticStepGradOp(const RSynapticStepOp &fwdOp)
+    : popart::Op(CustomGradOperators::RSynapticStepGradId, fwdOp.settings),
+      resetMechanism(fwdOp.getResetMechanism()),
+      surrogate(fwdOp.getSurrogate()) {
+  for (int i = 0; i < 8; ++i) {
+    fwdInInfo.push_back(fwdOp.inInfo(i));
+  }
+}
+
+const std::vector<popart::GradInOutMapper> &
+RSynapticStepGradOp::gradInputInfo() const {
+  static const std::vector<popart::GradInOutMapper> inInfo = {
+      {0, 0, popart::GradOpInType::GradOut},
+      {1, 1, popart::GradOpInType::GradOut},
+      {2, 2, popart::GradOpInType::GradOut},
+      {3, 1, popart::GradOpInType::In},
+      {4, 2, popart::GradOpInType::In},
+      {5, 3, popart::GradOpInType::In},
+      {6, 4, popart::GradOpInType::In},
+      {7, 5, popart::GradOpInType::In},
+      {8, 6, popart::GradOpInType::In},
+      {9, 7, popart::GradOpInType::In},
+      {10, 2, popart::GradOpInType::Out}};
+  return inInfo;
+}
+
+// The Grad Op has 8 outputs, one per forward input
+const std::map<int, int> &RSynapticStepGradOp::gradOutToNonGradIn() const {
+  static const std::map<int, int> outInfo = {
+      {0, 0}, {1, 1}, {2, 2}, {3, 3}, {4, 4}, {5, 5}, {6, 6}, {7, 7}};
+  return outInfo;
+}
+
+void RSynapticStepGradOp::appendAttributes(
+    popart::OpSerialiserBase &os) const {
+  Op::appendAttributes(os);
+  os.appendAttribute("reset_mechanism", getResetMechanism());
+  neuron_step::appendSurrogate(os, getSurrogate());
+}
+
+void RSynapticStepGradOp::appendOutlineAttributes(
+    popart::OpSerialiserBase &os) const {
+  Op::appendOutlineAttributes(os);
+  os.appendAttribute("reset_mechanism", getResetMechanism());
+  neuron_step::appendSurrogate(os, getSurrogate());
+}
+
+static popart::popx::OpxCreator<RSynapticStepOpx>
+    RSynapticStepOpxCreator({CustomOperators::RSynapticStepId});
+static popart::popx::OpxCreator<RSynapticStepGradOpx>
+    RSynapticStepGradOpxCreator(
+        {CustomGradOperators::RSynapticStepGradId});
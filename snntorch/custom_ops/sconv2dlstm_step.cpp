@@ -0,0 +1,576 @@
+// Fused single-timestep spiking convolutional LSTM cell, the op behind
+// `SConv2dLSTM`.
+//
+// Takes (input, syn, mem, weight, threshold, [bias]) and returns
+// (spk, syn_next, mem_next), where input is [B, Cin, H, W], syn and mem are
+// [B, C, H, W], weight is the [4C, Cin + C, kH, kW] kernel of the cell's
+// nn.Conv2d and bias its [4C] bias, and
+//
+//   i, f, o, g = split(conv2d([input, mem], weight, padding=k // 2)
+//                      + bias, 4)
+//   syn_next   = sigmoid(f) * syn + sigmoid(i) * tanh(g)
+//   h          = sigmoid(o) * tanh(syn_next)
+//   reset      = mem >= threshold                          (detached)
+//   mem_next   = h - reset * threshold
+//   spk        = mem_next >= threshold
+//
+// for reset-by-subtraction. Reset-to-zero zeroes mem_next instead, and
+// `reset_mechanism` defaults to none (2), as for SConv2dLSTM. The kernel
+// must have odd sides so that the states keep their H x W.
+//
+// All four gates come out of one poplin convolution. The gate activations,
+// the cell update, the reset and the spike run as element-wise maps over
+// slices of its output, so the activated gates are never materialised. The
+// grad op recomputes the convolution from the forward inputs rather than
+// keeping the [B, 4C, H, W] gates alive between the passes; every plan
+// (forward, input gradient and weight update) goes through one planning
+// cache, so the recomputation, and every time step, reuse the plans of the
+// first. `surrogate` selects dS/dU, straight_through_estimator by default.
+// `spike_dtype` = "bool" / "uint8" emits spk at one byte per neuron while
+// the states keep the type of the input; the op then has no grad op.
+#include <popart/error.hpp>
+#include <popart/opmanager.hpp>
+#include <popart/opserialiser.hpp>
+#include <popart/popx/opx.hpp>
+#include <popart/popx/opxmanager.hpp>
+
+#include <poplin/Convolution.hpp>
+#include <popops/ElementWise.hpp>
+#include <popops/Reduce.hpp>
+
+#include <vector>
+
+#include "neuron_step.hpp"
+
+namespace CustomOperators {
+const popart::OperatorIdentifier SConv2dLSTMStepId = {"custom.ops",
+                                                      "SConv2dLSTMStep", 1};
+} // namespace CustomOperators
+namespace CustomGradOperators {
+const popart::OperatorIdentifier SConv2dLSTMStepGradId = {
+    "custom.ops", "SConv2dLSTMStepGrad", 1};
+} // namespace CustomGradOperators
+
+class SConv2dLSTMStepOp;
+class SConv2dLSTMStepOpx;
+class SConv2dLSTMStepGradOpx;
+
+class SConv2dLSTMStepGradOp : public popart::Op {
+public:
+  SConv2dLSTMStepGradOp(const SConv2dLSTMStepOp &fwdOp);
+
+  std::unique_ptr<popart::Op> clone() const final {
+    return std::make_unique<SConv2dLSTMStepGradOp>(*this);
+  }
+
+  // One gradient per forward input: input, syn, mem, weight, threshold and,
+  // when given, bias
+  void setup() final {
+    for (int i = 0; i < static_cast<int>(fwdInInfo.size()); ++i) {
+      outInfo(i) = fwdInInfo[i];
+    }
+  };
+
+  const std::vector<popart::GradInOutMapper> &gradInputInfo() const;
+
+  const std::map<int, int> &gradOutToNonGradIn() const;
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // an estimate of how valuable sub-graph matching will be
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  int64_t getResetMechanism() const { return resetMechanism; }
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+  bool getHasBias() const { return fwdInInfo.size() > 5; }
+
+  // Implementation defined below
+  void appendAttributes(popart::OpSerialiserBase &os) const override;
+
+  // Implementation defined below
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override;
+
+private:
+  int64_t resetMechanism;
+  neuron_step::Surrogate surrogate;
+  std::vector<popart::TensorInfo> fwdInInfo;
+};
+
+class SConv2dLSTMStepOp : public popart::Op {
+public:
+  SConv2dLSTMStepOp(const popart::OperatorIdentifier &_opid,
+                    int64_t _resetMechanism,
+                    const neuron_step::Surrogate &_surrogate,
+                    const std::string &_spikeDtype,
+                    const popart::Op::Settings &settings_)
+      : popart::Op(_opid, settings_), resetMechanism(_resetMechanism),
+        surrogate(_surrogate), spikeDtype(_spikeDtype) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<SConv2dLSTMStepOp>(*this);
+  }
+
+  // spk, syn_next and mem_next take the shape and type of mem, unless spk
+  // is emitted as a compact spike_dtype
+  void setup() final {
+    const auto &x = inInfo(0);
+    const auto &mem = inInfo(2);
+    if (x.rank() != 4 || mem.rank() != 4 ||
+        inInfo(1).shape() != mem.shape() || x.dim(0) != mem.dim(0) ||
+        x.dim(2) != mem.dim(2) || x.dim(3) != mem.dim(3)) {
+      throw popart::error("SConv2dLSTMStep: expected input [B, Cin, H, W] "
+                          "and syn, mem [B, C, H, W]");
+    }
+    const auto &weight = inInfo(3);
+    const int64_t gates = 4 * mem.dim(1);
+    if (weight.rank() != 4 || weight.dim(0) != gates ||
+        weight.dim(1) != x.dim(1) + mem.dim(1)) {
+      throw popart::error("SConv2dLSTMStep: expected weight [{}, {}, kH, kW]",
+                          gates, x.dim(1) + mem.dim(1));
+    }
+    if (weight.dim(2) % 2 == 0 || weight.dim(3) % 2 == 0) {
+      throw popart::error("SConv2dLSTMStep: the kernel must have odd sides "
+                          "to keep the state shape, got {} x {}",
+                          weight.dim(2), weight.dim(3));
+    }
+    if (hasInput(5) && inInfo(5).shape() != popart::Shape({gates})) {
+      throw popart::error("SConv2dLSTMStep: expected bias of shape [{}]",
+                          gates);
+    }
+    outInfo(0) = neuron_step::spikeInfo(mem, getSpikeDtype());
+    outInfo(1) = mem;
+    outInfo(2) = mem;
+  }
+
+  void appendAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendAttributes(os);
+    os.appendAttribute("reset_mechanism", getResetMechanism());
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendOutlineAttributes(os);
+    os.appendAttribute("reset_mechanism", getResetMechanism());
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  // Compact spikes carry no gradient
+  std::vector<std::unique_ptr<popart::Op>> getGradOps() {
+    std::vector<std::unique_ptr<Op>> upops;
+    if (neuron_step::compactSpikes(getSpikeDtype())) {
+      return upops;
+    }
+    upops.emplace_back(new SConv2dLSTMStepGradOp(*this));
+    return upops;
+  }
+
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // Attributes
+  int64_t getResetMechanism() const { return resetMechanism; }
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+  const std::string &getSpikeDtype() const { return spikeDtype; }
+
+private:
+  int64_t resetMechanism;
+  neuron_step::Surrogate surrogate;
+  std::string spikeDtype;
+};
+
+namespace {
+using popart::DataType;
+using popart::OpDefinition;
+
+static OpDefinition::DataTypes T = {DataType::FLOAT16, DataType::FLOAT};
+static OpDefinition::DataTypes Spikes = {DataType::FLOAT16, DataType::FLOAT,
+                                         DataType::BOOL, DataType::UINT8};
+
+static OpDefinition SConv2dLSTMStepOpDef(
+    {OpDefinition::Inputs({{"input", T},
+                           {"syn", T},
+                           {"mem", T},
+                           {"weight", T},
+                           {"threshold", T},
+                           {"bias", T}}),
+     OpDefinition::Outputs(
+         {{"spk", Spikes}, {"syn_next", T}, {"mem_next", T}}),
+     OpDefinition::Attributes(
+         {{"reset_mechanism", {"*"}},
+          {"surrogate", {"*"}},
+          {"slope", {"*"}},
+          {"beta", {"*"}},
+          {"spike_dtype", {"*"}}})});
+
+static popart::OpCreator<SConv2dLSTMStepOp> SConv2dLSTMStepOpCreator(
+    popart::OpDefinitions(
+        {{CustomOperators::SConv2dLSTMStepId, SConv2dLSTMStepOpDef}}),
+    [](const popart::OpCreatorInfo &info) {
+      // SConv2dLSTM does not reset by default, see SpikingNeuron.reset_dict
+      int64_t resetMechanism =
+          info.attributes.getAttribute<popart::Attributes::Int>(
+              "reset_mechanism", neuron_step::None);
+      neuron_step::checkResetMechanism("SConv2dLSTMStep", resetMechanism);
+      neuron_step::Surrogate surrogate = neuron_step::surrogateAttributes(
+          "SConv2dLSTMStep", info.attributes, "straight_through_estimator");
+      std::string spikeDtype = neuron_step::spikeDtypeAttribute(
+          "SConv2dLSTMStep", info.attributes);
+      return std::make_unique<SConv2dLSTMStepOp>(info.opid, resetMechanism,
+                                                 surrogate, spikeDtype,
+                                                 info.settings);
+    },
+    true);
+} // namespace
+
+namespace pe = popops::expr;
+namespace ns = neuron_step;
+
+namespace {
+// Every SConv2dLSTMStep and its grad op plan the same convolutions for a
+// given layer, so they share one cache
+poplin::PlanningCache &planningCache() {
+  static poplin::PlanningCache cache;
+  return cache;
+}
+
+// The convolution from [input, mem] ([B, Cin + C, H, W]) to the gates
+// ([B, 4C, H, W]) for a [4C, Cin + C, kH, kW] weight, padded to keep H x W
+poplin::ConvParams gateConvParams(const poplar::Tensor &combined,
+                                  const poplar::Tensor &weight) {
+  poplin::ConvParams params(combined.elementType(), combined.dim(0),
+                            {combined.dim(2), combined.dim(3)},
+                            {weight.dim(2), weight.dim(3)}, weight.dim(1),
+                            weight.dim(0), 1);
+  const std::vector<unsigned> padding = {
+      static_cast<unsigned>(weight.dim(2) / 2),
+      static_cast<unsigned>(weight.dim(3) / 2)};
+  params.inputTransform.paddingLower = padding;
+  params.inputTransform.paddingUpper = padding;
+  return params;
+}
+
+// The same convolution run backwards, from the gates to [input, mem]
+poplin::ConvParams gateConvBwdParams(const poplar::Tensor &combined,
+                                     const poplar::Tensor &weight) {
+  poplin::ConvParams params(combined.elementType(), combined.dim(0),
+                            {combined.dim(2), combined.dim(3)},
+                            {weight.dim(2), weight.dim(3)}, weight.dim(0),
+                            weight.dim(1), 1);
+  const std::vector<unsigned> padding = {
+      static_cast<unsigned>(weight.dim(2) / 2),
+      static_cast<unsigned>(weight.dim(3) / 2)};
+  params.inputTransform.paddingLower = padding;
+  params.inputTransform.paddingUpper = padding;
+  return params;
+}
+
+// The gate pre-activations [B, 4C, H, W], i, f, o and g in the order of
+// SConv2dLSTM, from a single convolution over the concatenated input
+poplar::Tensor gatePreactivations(poplar::Graph &graph,
+                                  const poplar::Tensor &combined,
+                                  const poplar::Tensor &weight,
+                                  const poplar::Tensor *bias,
+                                  poplar::program::Sequence &prog,
+                                  const poplar::DebugContext &dc) {
+  auto gates = poplin::convolution(
+      graph, combined, weight.expand({0}), gateConvParams(combined, weight),
+      false, prog, dc, {{"pass", "TRAINING_FWD"}}, &planningCache());
+  if (bias) {
+    poplin::addBias(graph, gates, *bias, prog, dc);
+  }
+  return gates;
+}
+
+// Gate `index` (0: i, 1: f, 2: o, 3: g) of the pre-activations
+poplar::Tensor gate(const poplar::Tensor &gates, unsigned index) {
+  const std::size_t channels = gates.dim(1) / 4;
+  return gates.slice(index * channels, (index + 1) * channels, 1);
+}
+} // namespace
+
+class SConv2dLSTMStepOpx : public popart::popx::Opx {
+public:
+  SConv2dLSTMStepOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<SConv2dLSTMStepOp>(op, {CustomOperators::SConv2dLSTMStepId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+
+    auto op = getOp<SConv2dLSTMStepOp>();
+
+    poplar::Tensor input = getInTensor(0);
+    poplar::Tensor syn = getInTensor(1);
+    poplar::Tensor mem = getInTensor(2);
+    auto type = mem.elementType();
+    poplar::Tensor threshold =
+        ns::broadcastParam(graph(), getInTensor(4), type, mem.shape(), prog,
+                           debugContext("threshold"));
+    poplar::Tensor bias;
+    if (hasInput(5)) {
+      bias = getInTensor(5);
+    }
+
+    auto gates = gatePreactivations(
+        graph(), poplar::concat(input, mem, 1), getInTensor(3),
+        hasInput(5) ? &bias : nullptr, prog,
+        debugContext("SConv2dLSTMStepGates"));
+
+    // _1: syn, _2: i, _3: f, _4: g
+    auto synNext = popops::map(
+        graph(),
+        pe::Add(pe::Mul(pe::Sigmoid(pe::_3), pe::_1),
+                pe::Mul(pe::Sigmoid(pe::_2), pe::Tanh(pe::_4))),
+        {syn, gate(gates, 0), gate(gates, 1), gate(gates, 3)}, prog,
+        debugContext("SConv2dLSTMStepSyn"));
+
+    // _1: mem, _2: syn_next, _3: o, _4: threshold
+    auto h = pe::Mul(pe::Sigmoid(pe::_3), pe::Tanh(pe::_2));
+    auto memNextExpr =
+        ns::applyReset(op.getResetMechanism(), h, pe::_1, pe::_4);
+    auto memNext = popops::map(graph(), *memNextExpr,
+                               {mem, synNext, gate(gates, 2), threshold},
+                               prog, debugContext("SConv2dLSTMStepMem"));
+
+    auto spkExpr =
+        ns::spikeOutput(ns::spike(pe::_1, pe::_2), op.getSpikeDtype());
+    auto spk = popops::map(graph(), *spkExpr, {memNext, threshold}, prog,
+                           debugContext("SConv2dLSTMStepSpike"));
+
+    setOutTensor(0, spk);
+    setOutTensor(1, synNext);
+    setOutTensor(2, memNext);
+  }
+};
+
+class SConv2dLSTMStepGradOpx : public popart::popx::Opx {
+public:
+  SConv2dLSTMStepGradOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<SConv2dLSTMStepGradOp>(
+        op, {CustomGradOperators::SConv2dLSTMStepGradId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+
+    auto op = getOp<SConv2dLSTMStepGradOp>();
+
+    poplar::Tensor input = getInTensor(3);
+    poplar::Tensor syn = getInTensor(4);
+    poplar::Tensor mem = getInTensor(5);
+    poplar::Tensor weight = getInTensor(6);
+    poplar::Tensor thresholdIn = getInTensor(7);
+    poplar::Tensor synNext = getInTensor(8);
+    poplar::Tensor memNext = getInTensor(9);
+    // A loss on the states alone leaves no gradient for spk
+    poplar::Tensor gradSpk =
+        hasInput(0) ? getInTensor(0)
+                    : ns::zerosLike(graph(), memNext, prog,
+                                    debugContext("gradSpk"));
+    poplar::Tensor bias;
+    if (op.getHasBias()) {
+      bias = getInTensor(10);
+    }
+
+    auto type = gradSpk.elementType();
+    auto shape = gradSpk.shape();
+    poplar::Tensor threshold = ns::broadcastParam(
+        graph(), thresholdIn, type, shape, prog, debugContext("threshold"));
+
+    poplar::Tensor combined = poplar::concat(input, mem, 1);
+    auto gates = gatePreactivations(graph(), combined, weight,
+                                    op.getHasBias() ? &bias : nullptr, prog,
+                                    debugContext("SConv2dLSTMStepGradGates"));
+    auto gateI = gate(gates, 0);
+    auto gateF = gate(gates, 1);
+    auto gateO = gate(gates, 2);
+    auto gateG = gate(gates, 3);
+
+    // Gradient reaching mem_next through the spike: gradSpk * dS/dU
+    auto surrogate =
+        ns::surrogateGrad(op.getSurrogate(), pe::Sub(pe::_2, pe::_3));
+    auto gradSpkU =
+        popops::map(graph(), pe::Mul(pe::_1, *surrogate),
+                    {gradSpk, memNext, threshold}, prog,
+                    debugContext("SConv2dLSTMStepGradSurrogate"));
+
+    // Total gradient w.r.t. mem_next
+    poplar::Tensor gradU = gradSpkU;
+    if (hasInput(2)) {
+      gradU = popops::map(graph(), pe::Add(pe::_1, pe::_2),
+                          {getInTensor(2), gradSpkU}, prog,
+                          debugContext("SConv2dLSTMStepGradMemNext"));
+    }
+
+    // Gradient w.r.t. h, masked by reset-to-zero
+    poplar::Tensor gradH = gradU;
+    if (op.getResetMechanism() == ns::Zero) {
+      // _1: gradU, _2: mem, _3: threshold
+      gradH = popops::map(graph(),
+                          pe::Select(pe::Const(0.0f), pe::_1,
+                                     pe::Gte(pe::_2, pe::_3)),
+                          {gradU, mem, threshold}, prog,
+                          debugContext("SConv2dLSTMStepGradH"));
+    }
+
+    // Total gradient w.r.t. syn_next: through h, and from the next step
+    // _1: gradH, _2: o, _3: syn_next
+    auto tanhSynNext = pe::Tanh(pe::_3);
+    auto gradSynNextExpr = pe::Mul(
+        pe::Mul(pe::_1, pe::Sigmoid(pe::_2)),
+        pe::Sub(pe::Const(1.0f), pe::Square(tanhSynNext)));
+    std::vector<poplar::Tensor> synNextIns = {gradH, gateO, synNext};
+    std::unique_ptr<pe::Expr> gradCExpr = gradSynNextExpr.clone();
+    if (hasInput(1)) {
+      synNextIns.push_back(getInTensor(1));
+      gradCExpr = pe::Add(gradSynNextExpr, pe::_4).clone();
+    }
+    auto gradC = popops::map(graph(), *gradCExpr, synNextIns, prog,
+                             debugContext("SConv2dLSTMStepGradSynNext"));
+
+    auto gradSyn = popops::map(graph(), pe::Mul(pe::_1, pe::Sigmoid(pe::_2)),
+                               {gradC, gateF}, prog,
+                               debugContext("SConv2dLSTMStepGradSyn"));
+
+    // Gradients of the pre-activations, s' = s (1 - s), tanh' = 1 - tanh^2
+    auto sigmoidGrad = [](const pe::Expr &x) {
+      return pe::Mul(pe::Sigmoid(x), pe::Sub(pe::Const(1.0f), pe::Sigmoid(x)));
+    };
+    // _1: gradC, _2: i, _3: g
+    auto gradI = popops::map(
+        graph(),
+        pe::Mul(pe::Mul(pe::_1, pe::Tanh(pe::_3)), sigmoidGrad(pe::_2)),
+        {gradC, gateI, gateG}, prog, debugContext("SConv2dLSTMStepGradI"));
+    auto gradG = popops::map(
+        graph(),
+        pe::Mul(pe::Mul(pe::_1, pe::Sigmoid(pe::_2)),
+                pe::Sub(pe::Const(1.0f), pe::Square(pe::Tanh(pe::_3)))),
+        {gradC, gateI, gateG}, prog, debugContext("SConv2dLSTMStepGradG"));
+    // _1: gradC, _2: f, _3: syn
+    auto gradF = popops::map(
+        graph(), pe::Mul(pe::Mul(pe::_1, pe::_3), sigmoidGrad(pe::_2)),
+        {gradC, gateF, syn}, prog, debugContext("SConv2dLSTMStepGradF"));
+    // _1: gradH, _2: o, _3: syn_next
+    auto gradO = popops::map(
+        graph(), pe::Mul(pe::Mul(pe::_1, tanhSynNext), sigmoidGrad(pe::_2)),
+        {gradH, gateO, synNext}, prog, debugContext("SConv2dLSTMStepGradO"));
+    auto gradGates = poplar::concat({gradI, gradF, gradO, gradG}, 1);
+
+    // Back through the gate convolution: [input, mem] and the weight at
+    // once. The reset is detached, so mem only gets the recurrent gradient.
+    const std::size_t numInputs = input.dim(1);
+    auto gradCombined = poplin::convolution(
+        graph(), gradGates, weight.expand({0}),
+        gateConvBwdParams(combined, weight), true, prog,
+        debugContext("SConv2dLSTMStepGradInput"), {{"pass", "TRAINING_BWD"}},
+        &planningCache());
+    auto gradWeight = poplin::calculateWeightDeltas(
+        graph(), gradGates, combined, gateConvParams(combined, weight), prog,
+        debugContext("SConv2dLSTMStepGradWeight"), {{"pass", "TRAINING_WU"}},
+        &planningCache());
+
+    // The spike always sees -threshold; reset-by-subtraction adds -reset
+    std::unique_ptr<pe::Expr> gradThresholdExpr;
+    if (op.getResetMechanism() == ns::Subtract) {
+      // _1: gradSpkU, _2: gradU, _3: mem, _4: threshold
+      gradThresholdExpr =
+          pe::Neg(pe::Add(pe::_1, pe::Select(pe::_2, pe::Const(0.0f),
+                                             pe::Gte(pe::_3, pe::_4))))
+              .clone();
+    } else {
+      gradThresholdExpr = pe::Neg(pe::_1).clone();
+    }
+    auto gradThreshold =
+        popops::map(graph(), *gradThresholdExpr,
+                    {gradSpkU, gradU, mem, threshold}, prog,
+                    debugContext("SConv2dLSTMStepGradThreshold"));
+    gradThreshold = ns::reduceToShape(
+        graph(), gradThreshold, thresholdIn.shape(),
+        thresholdIn.elementType(), prog,
+        debugContext("SConv2dLSTMStepGradThresholdReduce"));
+
+    setOutTensor(0, gradCombined.slice(0, numInputs, 1));
+    setOutTensor(1, gradSyn);
+    setOutTensor(2, gradCombined.slice(numInputs, gradCombined.dim(1), 1));
+    setOutTensor(3, gradWeight.squeeze({0}));
+    setOutTensor(4, gradThreshold);
+
+    // The bias is added to every pixel of every image
+    if (op.getHasBias()) {
+      setOutTensor(5, popops::reduce(graph(), gradGates, bias.elementType(),
+                                     {0, 2, 3}, {popops::Operation::ADD},
+                                     prog,
+                                     debugContext("SConv2dLSTMStepGradBias")));
+    }
+  }
+};
+
+SConv2dLSTMStepGradOp::SConv2dLSTMStepGradOp(const SConv2dLSTMStepOp &fwdOp)
+    : popart::Op(CustomGradOperators::SConv2dLSTMStepGradId, fwdOp.settings),
+      resetMechanism(fwdOp.getResetMechanism()),
+      surrogate(fwdOp.getSurrogate()) {
+  const int numInputs = fwdOp.input->hasIndex(5) ? 6 : 5;
+  for (int i = 0; i < numInputs; ++i) {
+    fwdInInfo.push_back(fwdOp.inInfo(i));
+  }
+}
+
+const std::vector<popart::GradInOutMapper> &
+SConv2dLSTMStepGradOp::gradInputInfo() const {
+  static const std::vector<popart::GradInOutMapper> inInfo = {
+      {0, 0, popart::GradOpInType::GradOut},
+      {1, 1, popart::GradOpInType::GradOut},
+      {2, 2, popart::GradOpInType::GradOut},
+      {3, 0, popart::GradOpInType::In},
+      {4, 1, popart::GradOpInType::In},
+      {5, 2, popart::GradOpInType::In},
+      {6, 3, popart::GradOpInType::In},
+      {7, 4, popart::GradOpInType::In},
+      {8, 1, popart::GradOpInType::Out},
+      {9, 2, popart::GradOpInType::Out}};
+  static const std::vector<popart::GradInOutMapper> inInfoWithBias = {
+      {0, 0, popart::GradOpInType::GradOut},
+      {1, 1, popart::GradOpInType::GradOut},
+      {2, 2, popart::GradOpInType::GradOut},
+      {3, 0, popart::GradOpInType::In},
+      {4, 1, popart::GradOpInType::In},
+      {5, 2, popart::GradOpInType::In},
+      {6, 3, popart::GradOpInType::In},
+      {7, 4, popart::GradOpInType::In},
+      {8, 1, popart::GradOpInType::Out},
+      {9, 2, popart::GradOpInType::Out},
+      {10, 5, popart::GradOpInType::In}};
+  return getHasBias() ? inInfoWithBias : inInfo;
+}
+
+// The Grad Op has one output per forward input
+const std::map<int, int> &SConv2dLSTMStepGradOp::gradOutToNonGradIn() const {
+  static const std::map<int, int> outInfo = {
+      {0, 0}, {1, 1}, {2, 2}, {3, 3}, {4, 4}};
+  static const std::map<int, int> outInfoWithBias = {
+      {0, 0}, {1, 1}, {2, 2}, {3, 3}, {4, 4}, {5, 5}};
+  return getHasBias() ? outInfoWithBias : outInfo;
+}
+
+void SConv2dLSTMStepGradOp::appendAttributes(
+    popart::OpSerialiserBase &os) const {
+  Op::appendAttributes(os);
+  os.appendAttribute("reset_mechanism", getResetMechanism());
+  neuron_step::appendSurrogate(os, getSurrogate());
+}
+
+void SConv2dLSTMStepGradOp::appendOutlineAttributes(
+    popart::OpSerialiserBase &os) const {
+  Op::appendOutlineAttributes(os);
+  os.appendAttribute("reset_mechanism", getResetMechanism());
+  neuron_step::appendSurrogate(os, getSurrogate());
+}
+
+static popart::popx::OpxCreator<SConv2dLSTMStepOpx>
+    SConv2dLSTMStepOpxCreator({CustomOperators::SConv2dLSTMStepId});
+static popart::popx::OpxCreator<SConv2dLSTMStepGradOpx>
+    SConv2dLSTMStepGradOpxCreator(
+        {CustomGradOperators::SConv2dLSTMStepGradId});
@@ -0,0 +1,536 @@
+// Fused single-timestep spiking LSTM cell, the op behind `SLSTM`.
+//
+// Takes (input, syn, mem, weight_ih, weight_hh, threshold, [bias_ih,
+// bias_hh]) and returns (spk, syn_next, mem_next), where input is [B, X],
+// syn and mem are [B, H], the weights and biases are those of nn.LSTMCell
+// and
+//
+//   i, f, g, o = split([input, mem] @ [weight_ih, weight_hh]^T
+//                      + bias_ih + bias_hh, 4)
+//   syn_next   = sigmoid(f) * syn + sigmoid(i) * tanh(g)
+//   h          = sigmoid(o) * tanh(syn_next)
+//   reset      = mem >= threshold                          (detached)
+//   mem_next   = h - reset * threshold
+//   spk        = mem_next >= threshold
+//
+// for reset-by-subtraction. Reset-to-zero zeroes mem_next instead, and
+// `reset_mechanism` defaults to none (2), as for SLSTM. All four gates come
+// out of one matmul, and the cell update and the spike run as element-wise
+// maps over its output, so syn_next and mem_next take the tile mapping of syn
+// and mem. The grad op recomputes the gates from the forward inputs rather
+// than keeping them alive between the passes. `surrogate` selects dS/dU,
+// straight_through_estimator by default.
+// `spike_dtype` = "bool" / "uint8" emits spk at one byte per neuron while
+// the states keep the type of the input; the op then has no grad op.
+#include <popart/error.hpp>
+#include <popart/opmanager.hpp>
+#include <popart/opserialiser.hpp>
+#include <popart/popx/opx.hpp>
+#include <popart/popx/opxmanager.hpp>
+
+#include <poplin/MatMul.hpp>
+#include <popops/ElementWise.hpp>
+
+#include <vector>
+
+#include "neuron_step.hpp"
+
+namespace CustomOperators {
+const popart::OperatorIdentifier SLSTMStepId = {"custom.ops", "SLSTMStep", 1};
+} // namespace CustomOperators
+namespace CustomGradOperators {
+const popart::OperatorIdentifier SLSTMStepGradId = {"custom.ops",
+                                                    "SLSTMStepGrad", 1};
+} // namespace CustomGradOperators
+
+class SLSTMStepOp;
+class SLSTMStepOpx;
+class SLSTMStepGradOpx;
+
+class SLSTMStepGradOp : public popart::Op {
+public:
+  SLSTMStepGradOp(const SLSTMStepOp &fwdOp);
+
+  std::unique_ptr<popart::Op> clone() const final {
+    return std::make_unique<SLSTMStepGradOp>(*this);
+  }
+
+  // One gradient per forward input: input, syn, mem, weight_ih, weight_hh,
+  // threshold and, when given, bias_ih and bias_hh
+  void setup() final {
+    for (int i = 0; i < static_cast<int>(fwdInInfo.size()); ++i) {
+      outInfo(i) = fwdInInfo[i];
+    }
+  };
+
+  const std::vector<popart::GradInOutMapper> &gradInputInfo() const;
+
+  const std::map<int, int> &gradOutToNonGradIn() const;
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // an estimate of how valuable sub-graph matching will be
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  int64_t getResetMechanism() const { return resetMechanism; }
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+  bool getHasBias() const { return fwdInInfo.size() > 6; }
+
+  // Implementation defined below
+  void appendAttributes(popart::OpSerialiserBase &os) const override;
+
+  // Implementation defined below
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override;
+
+private:
+  int64_t resetMechanism;
+  neuron_step::Surrogate surrogate;
+  std::vector<popart::TensorInfo> fwdInInfo;
+};
+
+class SLSTMStepOp : public popart::Op {
+public:
+  SLSTMStepOp(const popart::OperatorIdentifier &_opid,
+              int64_t _resetMechanism,
+              const neuron_step::Surrogate &_surrogate,
+              const std::string &_spikeDtype,
+              const popart::Op::Settings &settings_)
+      : popart::Op(_opid, settings_), resetMechanism(_resetMechanism),
+        surrogate(_surrogate), spikeDtype(_spikeDtype) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<SLSTMStepOp>(*this);
+  }
+
+  // spk, syn_next and mem_next take the shape and type of mem, unless spk
+  // is emitted as a compact spike_dtype
+  void setup() final {
+    const auto &x = inInfo(0);
+    const auto &mem = inInfo(2);
+    if (x.rank() != 2 || mem.rank() != 2 ||
+        inInfo(1).shape() != mem.shape()) {
+      throw popart::error("SLSTMStep: expected input [B, X] and syn, mem "
+                          "[B, H]");
+    }
+    const int64_t gates = 4 * mem.dim(1);
+    if (inInfo(3).shape() != popart::Shape({gates, x.dim(1)}) ||
+        inInfo(4).shape() != popart::Shape({gates, mem.dim(1)})) {
+      throw popart::error("SLSTMStep: expected weight_ih [{}, {}] and "
+                          "weight_hh [{}, {}]",
+                          gates, x.dim(1), gates, mem.dim(1));
+    }
+    if (hasInput(6) != hasInput(7)) {
+      throw popart::error("SLSTMStep: bias_ih and bias_hh go together");
+    }
+    if (hasInput(6) && (inInfo(6).shape() != popart::Shape({gates}) ||
+                        inInfo(7).shape() != popart::Shape({gates}))) {
+      throw popart::error("SLSTMStep: expected biases of shape [{}]", gates);
+    }
+    outInfo(0) = neuron_step::spikeInfo(mem, getSpikeDtype());
+    outInfo(1) = mem;
+    outInfo(2) = mem;
+  }
+
+  void appendAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendAttributes(os);
+    os.appendAttribute("reset_mechanism", getResetMechanism());
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendOutlineAttributes(os);
+    os.appendAttribute("reset_mechanism", getResetMechanism());
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  // Compact spikes carry no gradient
+  std::vector<std::unique_ptr<popart::Op>> getGradOps() {
+    std::vector<std::unique_ptr<Op>> upops;
+    if (neuron_step::compactSpikes(getSpikeDtype())) {
+      return upops;
+    }
+    upops.emplace_back(new SLSTMStepGradOp(*this));
+    return upops;
+  }
+
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // Attributes
+  int64_t getResetMechanism() const { return resetMechanism; }
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+  const std::string &getSpikeDtype() const { return spikeDtype; }
+
+private:
+  int64_t resetMechanism;
+  neuron_step::Surrogate surrogate;
+  std::string spikeDtype;
+};
+
+namespace {
+using popart::DataType;
+using popart::OpDefinition;
+
+static OpDefinition::DataTypes T = {DataType::FLOAT16, DataType::FLOAT};
+static OpDefinition::DataTypes Spikes = {DataType::FLOAT16, DataType::FLOAT,
+                                         DataType::BOOL, DataType::UINT8};
+
+static OpDefinition SLSTMStepOpDef(
+    {OpDefinition::Inputs({{"input", T},
+                           {"syn", T},
+                           {"mem", T},
+                           {"weight_ih", T},
+                           {"weight_hh", T},
+                           {"threshold", T},
+                           {"bias_ih", T},
+                           {"bias_hh", T}}),
+     OpDefinition::Outputs(
+         {{"spk", Spikes}, {"syn_next", T}, {"mem_next", T}}),
+     OpDefinition::Attributes(
+         {{"reset_mechanism", {"*"}},
+          {"surrogate", {"*"}},
+          {"slope", {"*"}},
+          {"beta", {"*"}},
+          {"spike_dtype", {"*"}}})});
+
+static popart::OpCreator<SLSTMStepOp> SLSTMStepOpCreator(
+    popart::OpDefinitions({{CustomOperators::SLSTMStepId, SLSTMStepOpDef}}),
+    [](const popart::OpCreatorInfo &info) {
+      // SLSTM does not reset by default, see SpikingNeuron.reset_dict
+      int64_t resetMechanism =
+          info.attributes.getAttribute<popart::Attributes::Int>(
+              "reset_mechanism", neuron_step::None);
+      neuron_step::checkResetMechanism("SLSTMStep", resetMechanism);
+      neuron_step::Surrogate surrogate = neuron_step::surrogateAttributes(
+          "SLSTMStep", info.attributes, "straight_through_estimator");
+      std::string spikeDtype =
+          neuron_step::spikeDtypeAttribute("SLSTMStep", info.attributes);
+      return std::make_unique<SLSTMStepOp>(info.opid, resetMechanism,
+                                           surrogate, spikeDtype,
+                                           info.settings);
+    },
+    true);
+} // namespace
+
+namespace pe = popops::expr;
+namespace ns = neuron_step;
+
+namespace {
+// The gate pre-activations [B, 4H], i, f, g and o in the order of
+// nn.LSTMCell, from a single matmul over the concatenated input and weights
+poplar::Tensor gatePreactivations(poplar::Graph &graph,
+                                  const poplar::Tensor &input,
+                                  const poplar::Tensor &mem,
+                                  const poplar::Tensor &weightIh,
+                                  const poplar::Tensor &weightHh,
+                                  const std::vector<poplar::Tensor> &biases,
+                                  poplar::program::Sequence &prog,
+                                  const poplar::DebugContext &dc) {
+  auto gates = poplin::matMul(graph, poplar::concat(input, mem, 1),
+                              poplar::concat(weightIh, weightHh, 1).transpose(),
+                              prog, input.elementType(), dc);
+  if (!biases.empty()) {
+    const std::size_t rows = gates.dim(0);
+    popops::mapInPlace(graph, pe::Add(pe::Add(pe::_1, pe::_2), pe::_3),
+                       {gates, biases[0].expand({0}).broadcast(rows, 0),
+                        biases[1].expand({0}).broadcast(rows, 0)},
+                       prog, dc);
+  }
+  return gates;
+}
+
+// Gate `index` (0: i, 1: f, 2: g, 3: o) of the pre-activations
+poplar::Tensor gate(const poplar::Tensor &gates, unsigned index) {
+  const std::size_t hidden = gates.dim(1) / 4;
+  return gates.slice(index * hidden, (index + 1) * hidden, 1);
+}
+} // namespace
+
+class SLSTMStepOpx : public popart::popx::Opx {
+public:
+  SLSTMStepOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<SLSTMStepOp>(op, {CustomOperators::SLSTMStepId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+
+    auto op = getOp<SLSTMStepOp>();
+
+    poplar::Tensor input = getInTensor(0);
+    poplar::Tensor syn = getInTensor(1);
+    poplar::Tensor mem = getInTensor(2);
+    auto type = mem.elementType();
+    poplar::Tensor threshold =
+        ns::broadcastParam(graph(), getInTensor(5), type, mem.shape(), prog,
+                           debugContext("threshold"));
+    std::vector<poplar::Tensor> biases;
+    if (hasInput(6)) {
+      biases = {getInTensor(6), getInTensor(7)};
+    }
+
+    auto gates = gatePreactivations(graph(), input, mem, getInTensor(3),
+                                    getInTensor(4), biases, prog,
+                                    debugContext("SLSTMStepGates"));
+
+    // _1: syn, _2: i, _3: f, _4: g
+    auto synNext = popops::map(
+        graph(),
+        pe::Add(pe::Mul(pe::Sigmoid(pe::_3), pe::_1),
+                pe::Mul(pe::Sigmoid(pe::_2), pe::Tanh(pe::_4))),
+        {syn, gate(gates, 0), gate(gates, 1), gate(gates, 2)}, prog,
+        debugContext("SLSTMStepSyn"));
+
+    // _1: mem, _2: syn_next, _3: o, _4: threshold
+    auto h = pe::Mul(pe::Sigmoid(pe::_3), pe::Tanh(pe::_2));
+    auto memNextExpr =
+        ns::applyReset(op.getResetMechanism(), h, pe::_1, pe::_4);
+    auto memNext = popops::map(graph(), *memNextExpr,
+                               {mem, synNext, gate(gates, 3), threshold},
+                               prog, debugContext("SLSTMStepMem"));
+
+    auto spkExpr =
+        ns::spikeOutput(ns::spike(pe::_1, pe::_2), op.getSpikeDtype());
+    auto spk = popops::map(graph(), *spkExpr, {memNext, threshold}, prog,
+                           debugContext("SLSTMStepSpike"));
+
+    setOutTensor(0, spk);
+    setOutTensor(1, synNext);
+    setOutTensor(2, memNext);
+  }
+};
+
+class SLSTMStepGradOpx : public popart::popx::Opx {
+public:
+  SLSTMStepGradOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<SLSTMStepGradOp>(op, {CustomGradOperators::SLSTMStepGradId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+
+    auto op = getOp<SLSTMStepGradOp>();
+
+    poplar::Tensor input = getInTensor(3);
+    poplar::Tensor syn = getInTensor(4);
+    poplar::Tensor mem = getInTensor(5);
+    poplar::Tensor weightIh = getInTensor(6);
+    poplar::Tensor weightHh = getInTensor(7);
+    poplar::Tensor thresholdIn = getInTensor(8);
+    poplar::Tensor synNext = getInTensor(9);
+    poplar::Tensor memNext = getInTensor(10);
+    // A loss on the states alone leaves no gradient for spk
+    poplar::Tensor gradSpk =
+        hasInput(0) ? getInTensor(0)
+                    : ns::zerosLike(graph(), memNext, prog,
+                                    debugContext("gradSpk"));
+    std::vector<poplar::Tensor> biases;
+    if (op.getHasBias()) {
+      biases = {getInTensor(11), getInTensor(12)};
+    }
+
+    auto type = gradSpk.elementType();
+    auto shape = gradSpk.shape();
+    poplar::Tensor threshold = ns::broadcastParam(
+        graph(), thresholdIn, type, shape, prog, debugContext("threshold"));
+
+    auto gates = gatePreactivations(graph(), input, mem, weightIh, weightHh,
+                                    biases, prog,
+                                    debugContext("SLSTMStepGradGates"));
+    auto gateI = gate(gates, 0);
+    auto gateF = gate(gates, 1);
+    auto gateG = gate(gates, 2);
+    auto gateO = gate(gates, 3);
+
+    // Gradient reaching mem_next through the spike: gradSpk * dS/dU
+    auto surrogate =
+        ns::surrogateGrad(op.getSurrogate(), pe::Sub(pe::_2, pe::_3));
+    auto gradSpkU =
+        popops::map(graph(), pe::Mul(pe::_1, *surrogate),
+                    {gradSpk, memNext, threshold}, prog,
+                    debugContext("SLSTMStepGradSurrogate"));
+
+    // Total gradient w.r.t. mem_next
+    poplar::Tensor gradU = gradSpkU;
+    if (hasInput(2)) {
+      gradU = popops::map(graph(), pe::Add(pe::_1, pe::_2),
+                          {getInTensor(2), gradSpkU}, prog,
+                          debugContext("SLSTMStepGradMemNext"));
+    }
+
+    // Gradient w.r.t. h, masked by reset-to-zero
+    poplar::Tensor gradH = gradU;
+    if (op.getResetMechanism() == ns::Zero) {
+      // _1: gradU, _2: mem, _3: threshold
+      gradH = popops::map(graph(),
+                          pe::Select(pe::Const(0.0f), pe::_1,
+                                     pe::Gte(pe::_2, pe::_3)),
+                          {gradU, mem, threshold}, prog,
+                          debugContext("SLSTMStepGradH"));
+    }
+
+    // Total gradient w.r.t. syn_next: through h, and from the next step
+    // _1: gradH, _2: o, _3: syn_next
+    auto tanhSynNext = pe::Tanh(pe::_3);
+    auto gradSynNextExpr = pe::Mul(
+        pe::Mul(pe::_1, pe::Sigmoid(pe::_2)),
+        pe::Sub(pe::Const(1.0f), pe::Square(tanhSynNext)));
+    std::vector<poplar::Tensor> synNextIns = {gradH, gateO, synNext};
+    std::unique_ptr<pe::Expr> gradCExpr = gradSynNextExpr.clone();
+    if (hasInput(1)) {
+      synNextIns.push_back(getInTensor(1));
+      gradCExpr = pe::Add(gradSynNextExpr, pe::_4).clone();
+    }
+    auto gradC = popops::map(graph(), *gradCExpr, synNextIns, prog,
+                             debugContext("SLSTMStepGradSynNext"));
+
+    auto gradSyn = popops::map(graph(), pe::Mul(pe::_1, pe::Sigmoid(pe::_2)),
+                               {gradC, gateF}, prog,
+                               debugContext("SLSTMStepGradSyn"));
+
+    // Gradients of the pre-activations, s' = s (1 - s), tanh' = 1 - tanh^2
+    auto sigmoidGrad = [](const pe::Expr &x) {
+      return pe::Mul(pe::Sigmoid(x), pe::Sub(pe::Const(1.0f), pe::Sigmoid(x)));
+    };
+    // _1: gradC, _2: i, _3: g
+    auto gradI = popops::map(
+        graph(),
+        pe::Mul(pe::Mul(pe::_1, pe::Tanh(pe::_3)), sigmoidGrad(pe::_2)),
+        {gradC, gateI, gateG}, prog, debugContext("SLSTMStepGradI"));
+    auto gradG = popops::map(
+        graph(),
+        pe::Mul(pe::Mul(pe::_1, pe::Sigmoid(pe::_2)),
+                pe::Sub(pe::Const(1.0f), pe::Square(pe::Tanh(pe::_3)))),
+        {gradC, gateI, gateG}, prog, debugContext("SLSTMStepGradG"));
+    // _1: gradC, _2: f, _3: syn
+    auto gradF = popops::map(
+        graph(), pe::Mul(pe::Mul(pe::_1, pe::_3), sigmoidGrad(pe::_2)),
+        {gradC, gateF, syn}, prog, debugContext("SLSTMStepGradF"));
+    // _1: gradH, _2: o, _3: syn_next
+    auto gradO = popops::map(
+        graph(), pe::Mul(pe::Mul(pe::_1, tanhSynNext), sigmoidGrad(pe::_2)),
+        {gradH, gateO, synNext}, prog, debugContext("SLSTMStepGradO"));
+    auto gradGates = poplar::concat({gradI, gradF, gradG, gradO}, 1);
+
+    // Back through the gate matmul: [input, mem] and both weights at once.
+    // The reset is detached, so mem only gets the recurrent gradient.
+    const std::size_t numInputs = input.dim(1);
+    auto gradX = poplin::matMul(graph(), gradGates,
+                                poplar::concat(weightIh, weightHh, 1), prog,
+                                type, debugContext("SLSTMStepGradInput"));
+    auto gradW = poplin::matMul(graph(), gradGates.transpose(),
+                                poplar::concat(input, mem, 1), prog, type,
+                                debugContext("SLSTMStepGradWeight"));
+
+    // The spike always sees -threshold; reset-by-subtraction adds -reset
+    std::unique_ptr<pe::Expr> gradThresholdExpr;
+    if (op.getResetMechanism() == ns::Subtract) {
+      // _1: gradSpkU, _2: gradU, _3: mem, _4: threshold
+      gradThresholdExpr =
+          pe::Neg(pe::Add(pe::_1, pe::Select(pe::_2, pe::Const(0.0f),
+                                             pe::Gte(pe::_3, pe::_4))))
+              .clone();
+    } else {
+      gradThresholdExpr = pe::Neg(pe::_1).clone();
+    }
+    auto gradThreshold =
+        popops::map(graph(), *gradThresholdExpr,
+                    {gradSpkU, gradU, mem, threshold}, prog,
+                    debugContext("SLSTMStepGradThreshold"));
+    gradThreshold = ns::reduceToShape(
+        graph(), gradThreshold, thresholdIn.shape(),
+        thresholdIn.elementType(), prog,
+        debugContext("SLSTMStepGradThresholdReduce"));
+
+    setOutTensor(0, gradX.slice(0, numInputs, 1));
+    setOutTensor(1, gradSyn);
+    setOutTensor(2, gradX.slice(numInputs, gradX.dim(1), 1));
+    setOutTensor(3, gradW.slice(0, numInputs, 1));
+    setOutTensor(4, gradW.slice(numInputs, gradW.dim(1), 1));
+    setOutTensor(5, gradThreshold);
+
+    // Both biases are added to the same pre-activations
+    if (op.getHasBias()) {
+      auto gradBias = ns::reduceToShape(
+          graph(), gradGates, biases[0].shape(), biases[0].elementType(),
+          prog, debugContext("SLSTMStepGradBias"));
+      auto gradBiasHh =
+          graph().clone(gradBias, debugContext("SLSTMStepGradBiasHh"));
+      prog.add(poplar::program::Copy(gradBias, gradBiasHh, false,
+                                     debugContext("SLSTMStepGradBiasHh")));
+      setOutTensor(6, gradBias);
+      setOutTensor(7, gradBiasHh);
+    }
+  }
+};
+
+SLSTMStepGradOp::SLSTMStepGradOp(const SLSTMStepOp &fwdOp)
+    : popart::Op(CustomGradOperators::SLSTMStepGradId, fwdOp.settings),
+      resetMechanism(fwdOp.getResetMechanism()),
+      surrogate(fwdOp.getSurrogate()) {
+  const int numInputs = fwdOp.input->hasIndex(6) ? 8 : 6;
+  for (int i = 0; i < numInputs; ++i) {
+    fwdInInfo.push_back(fwdOp.inInfo(i));
+  }
+}
+
+const std::vector<popart::GradInOutMapper> &
+SLSTMStepGradOp::gradInputInfo() const {
+  static const std::vector<popart::GradInOutMapper> inInfo = {
+      {0, 0, popart::GradOpInType::GradOut},
+      {1, 1, popart::GradOpInType::GradOut},
+      {2, 2, popart::GradOpInType::GradOut},
+      {3, 0, popart::GradOpInType::In},
+      {4, 1, popart::GradOpInType::In},
+      {5, 2, popart::GradOpInType::In},
+      {6, 3, popart::GradOpInType::In},
+      {7, 4, popart::GradOpInType::In},
+      {8, 5, popart::GradOpInType::In},
+      {9, 1, popart::GradOpInType::Out},
+      {10, 2, popart::GradOpInType::Out}};
+  static const std::vector<popart::GradInOutMapper> inInfoWithBias = {
+      {0, 0, popart::GradOpInType::GradOut},
+      {1, 1, popart::GradOpInType::GradOut},
+      {2, 2, popart::GradOpInType::GradOut},
+      {3, 0, popart::GradOpInType::In},
+      {4, 1, popart::GradOpInType::In},
+      {5, 2, popart::GradOpInType::In},
+      {6, 3, popart::GradOpInType::In},
+      {7, 4, popart::GradOpInType::In},
+      {8, 5, popart::GradOpInType::In},
+      {9, 1, popart::GradOpInType::Out},
+      {10, 2, popart::GradOpInType::Out},
+      {11, 6, popart::GradOpInType::In},
+      {12, 7, popart::GradOpInType::In}};
+  return getHasBias() ? inInfoWithBias : inInfo;
+}
+
+// The Grad Op has one output per forward input
+const std::map<int, int> &SLSTMStepGradOp::gradOutToNonGradIn() const {
+  static const std::map<int, int> outInfo = {{0, 0}, {1, 1}, {2, 2},
+                                             {3, 3}, {4, 4}, {5, 5}};
+  static const std::map<int, int> outInfoWithBias = {
+      {0, 0}, {1, 1}, {2, 2}, {3, 3}, {4, 4}, {5, 5}, {6, 6}, {7, 7}};
+  return getHasBias() ? outInfoWithBias : outInfo;
+}
+
+void SLSTMStepGradOp::appendAttributes(popart::OpSerialiserBase &os) const {
+  Op::appendAttributes(os);
+  os.appendAttribute("reset_mechanism", getResetMechanism());
+  neuron_step::appendSurrogate(os, getSurrogate());
+}
+
+void SLSTMStepGradOp::appendOutlineAttributes(
+    popart::OpSerialiserBase &os) const {
+  Op::appendOutlineAttributes(os);
+  os.appendAttribute("reset_mechanism", getResetMechanism());
+  neuron_step::appendSurrogate(os, getSurrogate());
+}
+
+static popart::popx::OpxCreator<SLSTMStepOpx>
+    SLSTMStepOpxCreator({CustomOperators::SLSTMStepId});
+static popart::popx::OpxCreator<SLSTMStepGradOpx>
+    SLSTMStepGradOpxCreator({CustomGradOperators::SLSTMStepGradId});
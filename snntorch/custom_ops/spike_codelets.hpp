@@ -0,0 +1,369 @@
+// Host side of the vertices in codelets/spike_codelets.cpp. The compiled
+// codelets (spike_codelets.gp) are installed next to the custom op shared
+// objects; ops fall back to their popops expressions when it is missing.
+#ifndef SNNTORCH_CUSTOM_OPS_SPIKE_CODELETS_HPP
+#define SNNTORCH_CUSTOM_OPS_SPIKE_CODELETS_HPP
+
+#include <poplar/Graph.hpp>
+#include <poplar/Program.hpp>
+#include <popops/Cast.hpp>
+#include <poputil/Broadcast.hpp>
+#include <poputil/VertexTemplates.hpp>
+
+#include <dlfcn.h>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace spike_codelets {
+
+// spike_codelets.gp in the directory of the shared object holding this code
+inline std::string codeletsPath() {
+  Dl_info info;
+  if (dladdr(reinterpret_cast<void *>(&codeletsPath), &info) == 0 ||
+      info.dli_fname == nullptr) {
+    return "spike_codelets.gp";
+  }
+  std::string so(info.dli_fname);
+  auto slash = so.find_last_of('/');
+  std::string dir = slash == std::string::npos ? "" : so.substr(0, slash + 1);
+  return dir + "spike_codelets.gp";
+}
+
+// Add the spike codelets to `graph` once. Returns false if they could not be
+// found, in which case the caller should use its popops path.
+inline bool addCodelets(poplar::Graph &graph,
+                        const std::string &path = codeletsPath()) {
+  if (graph.hasCodelet(poputil::templateVertex("Spike", poplar::FLOAT))) {
+    return true;
+  }
+  if (!std::ifstream(path).good()) {
+    return false;
+  }
+  graph.addCodelets(path);
+  return true;
+}
+
+// Cast `threshold` to `type`. A single-element threshold is kept as one
+// element and broadcast inside the vertices; anything else is broadcast
+// against `shape`. The other parameters of the neuron vertices (beta, rho,
+// beta_a) are prepared the same way.
+inline poplar::Tensor prepareThreshold(poplar::Graph &graph,
+                                       poplar::Tensor threshold,
+                                       const poplar::Type &type,
+                                       const std::vector<std::size_t> &shape,
+                                       poplar::program::Sequence &prog,
+                                       const poplar::DebugContext &dc) {
+  if (threshold.elementType() != type) {
+    threshold = popops::cast(graph, threshold, type, prog, dc);
+  }
+  if (threshold.numElements() == 1) {
+    return threshold.flatten();
+  }
+  poputil::broadcastToMatch(threshold, shape);
+  return threshold;
+}
+
+// The threshold used when the op is given none
+inline poplar::Tensor zeroThreshold(poplar::Graph &graph,
+                                    const poplar::Type &type,
+                                    const poplar::DebugContext &dc) {
+  auto zero = graph.addConstant(type, {1}, 0.0f, dc);
+  graph.setTileMapping(zero, 0);
+  return zero;
+}
+
+// The threshold operand for the vertices: `threshold` prepared against
+// `like` when the op has one, zero otherwise
+inline poplar::Tensor thresholdOrZero(poplar::Graph &graph, bool hasThreshold,
+                                      const poplar::Tensor &threshold,
+                                      const poplar::Tensor &like,
+                                      poplar::program::Sequence &prog,
+                                      const poplar::DebugContext &dc) {
+  if (!hasThreshold) {
+    return zeroThreshold(graph, like.elementType(), dc);
+  }
+  return prepareThreshold(graph, threshold, like.elementType(), like.shape(),
+                          prog, dc);
+}
+
+// Perf estimates, which the IPUModel takes as the cycles of each vertex.
+//
+// A worker issues one instruction per worker cycle, so one 64-bit chunk of
+// the vectorised loops in codelets/spike_codelets.cpp costs, per
+// instruction:
+//
+//   loop control    3  index add, bounds compare, branch
+//   operands        1  ld64 per per-element field (in, grad, a threshold
+//                      that is not shared)
+//   outputs         1  st64 per output field
+//   compute            Spike: compare, and with 1.0 = 2
+//                      HeavisideGrad: compare, and with grad = 2
+//                      FastSigmoidGrad: sub, abs, mul, add, mul = 5, plus a
+//                      divide, which has no vector instruction and costs
+//                      each lane a reciprocal estimate, a Newton step (mul,
+//                      sub, mul) and the final mul = 5 per lane
+//                      LeakyStep: clamp beta (min, max), mul, add = 4,
+//                      then the spike = 2, plus for a reset the compare and
+//                      a masked sub (and, sub) or a mask (not, and) = 3
+//                      AdaptiveLeakyStep: the adapted threshold (mul, add)
+//                      and the leaky step with its compare = 7, a reset = 2,
+//                      the adaptation (min, max, mul, and, add) = 5, the
+//                      spike against the new threshold (mul, add, compare,
+//                      and) = 4
+//
+// The scalar tail on worker 0 is charged a chunk per element.
+
+// Worker cycles of one chunk that loads `operands` fields, spends
+// `compute` instructions on them and stores `outputs` fields
+constexpr unsigned chunkCycles(unsigned operands, unsigned compute,
+                               unsigned outputs = 1) {
+  return 3 + operands + outputs + compute;
+}
+
+inline unsigned lanes(const poplar::Type &type) {
+  return type == poplar::HALF ? 4 : 2;
+}
+
+// The operands a vertex loads per chunk: `perElement` fields plus each of
+// `params` that is not shared
+inline unsigned loadedOperands(unsigned perElement,
+                               const std::vector<poplar::Tensor> &params) {
+  unsigned operands = perElement;
+  for (const auto &param : params) {
+    operands += param.numElements() == 1 ? 0 : 1;
+  }
+  return operands;
+}
+
+// Cycles for one MultiVertex over `n` elements, `cyclesPerChunk` being the
+// cost of one 64-bit chunk on one worker (chunkCycles). The vertex runs
+// for as long as its busiest worker, plus about 20 cycles to read the field
+// pointers and sizes and set up the loop. The workers issue in turn, so a
+// worker cycle takes as many tile cycles as there are workers.
+inline std::uint64_t estimateCycles(const poplar::Target &target,
+                                    const poplar::Type &type, std::size_t n,
+                                    unsigned cyclesPerChunk) {
+  const unsigned width = lanes(type);
+  const unsigned workers = target.getNumWorkerContexts();
+  const std::size_t chunks = n / width;
+  const std::size_t perWorker = (chunks + workers - 1) / workers;
+  return (20 + perWorker * cyclesPerChunk + (n % width) * cyclesPerChunk) *
+         workers;
+}
+
+// One `vertex` per contiguous region of the first of `outs` on each tile,
+// `outs` being the fields the vertex writes and their tensors, which are
+// mapped alike: "out" for a new tensor, or the InOut field of an in-place
+// vertex. Each other field is connected to the same region of its tensor,
+// except a single-element tensor (a shared threshold or parameter), which
+// every vertex reads whole.
+//
+// The vertices work in 64-bit chunks, so their fields need 8-byte alignment
+// and no two of them may write the same 32-bit word. A tile mapping interval
+// can start at any element, but a region that is contiguous in memory
+// starts an allocation, which poplar can align; and the chunks of each
+// vertex then never straddle into another's region.
+inline void addVertices(poplar::Graph &graph, const std::string &vertex,
+                        const std::vector<std::pair<std::string,
+                                                    poplar::Tensor>> &inputs,
+                        const std::vector<std::pair<std::string,
+                                                    poplar::Tensor>> &outs,
+                        unsigned cyclesPerChunk,
+                        poplar::program::Sequence &prog,
+                        const poplar::DebugContext &dc,
+                        const std::vector<std::pair<std::string, float>>
+                            &fields = {}) {
+  auto cs = graph.addComputeSet(dc);
+  const auto type = outs.front().second.elementType();
+  std::vector<std::pair<std::string, poplar::Tensor>> flatIns, flatOuts;
+  for (const auto &input : inputs) {
+    flatIns.emplace_back(input.first, input.second.flatten());
+  }
+  for (const auto &out : outs) {
+    flatOuts.emplace_back(out.first, out.second.flatten());
+  }
+
+  const auto mapping = graph.getTileMapping(flatOuts.front().second);
+  for (unsigned tile = 0; tile < mapping.size(); ++tile) {
+    const auto regions = graph.getSortedContiguousRegions(
+        flatOuts.front().second, mapping[tile]);
+    for (const auto &region : regions) {
+      auto v = graph.addVertex(cs, vertex);
+      for (const auto &input : flatIns) {
+        const bool whole = input.second.numElements() == 1;
+        graph.connect(v[input.first],
+                      whole ? input.second
+                            : poplar::concat(input.second.slices(region)));
+      }
+      std::size_t n = 0;
+      for (const auto &out : flatOuts) {
+        auto outRegion = poplar::concat(out.second.slices(region));
+        graph.connect(v[out.first], outRegion);
+        n = outRegion.numElements();
+      }
+      for (const auto &field : fields) {
+        graph.setInitialValue(v[field.first], field.second);
+      }
+      graph.setTileMapping(v, tile);
+      graph.setPerfEstimate(
+          v, estimateCycles(graph.getTarget(), type, n, cyclesPerChunk));
+    }
+  }
+  prog.add(poplar::program::Execute(cs, dc));
+}
+
+// in < threshold ? 0 : 1
+inline poplar::Tensor spike(poplar::Graph &graph, const poplar::Tensor &in,
+                            const poplar::Tensor &threshold,
+                            poplar::program::Sequence &prog,
+                            const poplar::DebugContext &dc) {
+  auto out = graph.clone(in, dc);
+  addVertices(graph, poputil::templateVertex("Spike", in.elementType()),
+              {{"in", in}, {"threshold", threshold}}, {{"out", out}},
+              chunkCycles(loadedOperands(1, {threshold}), 2), prog, dc);
+  return out;
+}
+
+// spike, writing the spikes over `in`
+inline void spikeInPlace(poplar::Graph &graph, const poplar::Tensor &in,
+                         const poplar::Tensor &threshold,
+                         poplar::program::Sequence &prog,
+                         const poplar::DebugContext &dc) {
+  addVertices(graph, poputil::templateVertex("SpikeInPlace", in.elementType()),
+              {{"threshold", threshold}}, {{"in", in}},
+              chunkCycles(loadedOperands(1, {threshold}), 2), prog, dc);
+}
+
+// in < threshold ? 0 : grad
+inline poplar::Tensor heavisideGrad(poplar::Graph &graph,
+                                    const poplar::Tensor &grad,
+                                    const poplar::Tensor &in,
+                                    const poplar::Tensor &threshold,
+                                    poplar::program::Sequence &prog,
+                                    const poplar::DebugContext &dc) {
+  // mapped like `in`, as in the forward pass, so `in` is read on-tile
+  auto out = graph.clone(grad.elementType(), in, dc);
+  addVertices(graph,
+              poputil::templateVertex("HeavisideGrad", grad.elementType()),
+              {{"grad", grad}, {"in", in}, {"threshold", threshold}},
+              {{"out", out}}, chunkCycles(loadedOperands(2, {threshold}), 2),
+              prog, dc);
+  return out;
+}
+
+// heavisideGrad, writing the gradient over `grad`
+inline void heavisideGradInPlace(poplar::Graph &graph,
+                                 const poplar::Tensor &grad,
+                                 const poplar::Tensor &in,
+                                 const poplar::Tensor &threshold,
+                                 poplar::program::Sequence &prog,
+                                 const poplar::DebugContext &dc) {
+  addVertices(graph,
+              poputil::templateVertex("HeavisideGradInPlace",
+                                      grad.elementType()),
+              {{"in", in}, {"threshold", threshold}}, {{"grad", grad}},
+              chunkCycles(loadedOperands(2, {threshold}), 2), prog, dc);
+}
+
+// The worker cycles of one FastSigmoidGrad chunk of `type`
+inline unsigned fastSigmoidGradCycles(const poplar::Type &type,
+                                      const poplar::Tensor &threshold) {
+  return chunkCycles(loadedOperands(2, {threshold}), 5 + 5 * lanes(type));
+}
+
+// grad / (slope * |in - threshold| + 1)^2
+inline poplar::Tensor fastSigmoidGrad(poplar::Graph &graph,
+                                      const poplar::Tensor &grad,
+                                      const poplar::Tensor &in,
+                                      const poplar::Tensor &threshold,
+                                      float slope,
+                                      poplar::program::Sequence &prog,
+                                      const poplar::DebugContext &dc) {
+  // mapped like `in`, as in the forward pass, so `in` is read on-tile
+  auto out = graph.clone(grad.elementType(), in, dc);
+  addVertices(graph,
+              poputil::templateVertex("FastSigmoidGrad", grad.elementType()),
+              {{"grad", grad}, {"in", in}, {"threshold", threshold}},
+              {{"out", out}},
+              fastSigmoidGradCycles(grad.elementType(), threshold), prog, dc,
+              {{"slope", slope}});
+  return out;
+}
+
+// fastSigmoidGrad, writing the gradient over `grad`
+inline void fastSigmoidGradInPlace(poplar::Graph &graph,
+                                   const poplar::Tensor &grad,
+                                   const poplar::Tensor &in,
+                                   const poplar::Tensor &threshold,
+                                   float slope,
+                                   poplar::program::Sequence &prog,
+                                   const poplar::DebugContext &dc) {
+  addVertices(graph,
+              poputil::templateVertex("FastSigmoidGradInPlace",
+                                      grad.elementType()),
+              {{"in", in}, {"threshold", threshold}}, {{"grad", grad}},
+              fastSigmoidGradCycles(grad.elementType(), threshold), prog, dc,
+              {{"slope", slope}});
+}
+
+// spk and mem_next of LeakyStep in one pass, both mapped like `input`.
+// beta and threshold are prepared with prepareThreshold.
+inline std::pair<poplar::Tensor, poplar::Tensor>
+leakyStep(poplar::Graph &graph, const poplar::Tensor &input,
+          const poplar::Tensor &mem, const poplar::Tensor &beta,
+          const poplar::Tensor &threshold, unsigned resetMechanism,
+          poplar::program::Sequence &prog, const poplar::DebugContext &dc) {
+  auto spk = graph.clone(input, dc);
+  auto memNext = graph.clone(input, dc);
+  // neuron_step::None leaves out the reset
+  const unsigned compute = 6 + (resetMechanism == 2 ? 0 : 3);
+  addVertices(graph,
+              poputil::templateVertex("LeakyStep", input.elementType(),
+                                      resetMechanism),
+              {{"in", input},
+               {"mem", mem},
+               {"beta", beta},
+               {"threshold", threshold}},
+              {{"spk", spk}, {"memNext", memNext}},
+              chunkCycles(loadedOperands(2, {beta, threshold}), compute, 2),
+              prog, dc);
+  return {spk, memNext};
+}
+
+// spk, mem_next and a_next of AdaptiveLeakyStep in one pass, all mapped like
+// `input`. beta, rho, threshold and beta_a are prepared with
+// prepareThreshold.
+inline std::vector<poplar::Tensor>
+adaptiveLeakyStep(poplar::Graph &graph, const poplar::Tensor &input,
+                  const poplar::Tensor &mem, const poplar::Tensor &a,
+                  const poplar::Tensor &beta, const poplar::Tensor &rho,
+                  const poplar::Tensor &threshold, const poplar::Tensor &betaA,
+                  unsigned resetMechanism, poplar::program::Sequence &prog,
+                  const poplar::DebugContext &dc) {
+  auto spk = graph.clone(input, dc);
+  auto memNext = graph.clone(input, dc);
+  auto aNext = graph.clone(input, dc);
+  // neuron_step::None leaves out the reset
+  const unsigned compute = 16 + (resetMechanism == 2 ? 0 : 2);
+  addVertices(graph,
+              poputil::templateVertex("AdaptiveLeakyStep", input.elementType(),
+                                      resetMechanism),
+              {{"in", input},
+               {"mem", mem},
+               {"a", a},
+               {"beta", beta},
+               {"rho", rho},
+               {"threshold", threshold},
+               {"betaA", betaA}},
+              {{"spk", spk}, {"memNext", memNext}, {"aNext", aNext}},
+              chunkCycles(loadedOperands(3, {beta, rho, threshold, betaA}),
+                          compute, 3),
+              prog, dc);
+  return {spk, memNext, aNext};
+}
+
+} // namespace spike_codelets
+
+#endif // SNNTORCH_CUSTOM_OPS_SPIKE_CODELETS_HPP
@@ -0,0 +1,509 @@
+// Event-driven spike x weight matmul, the layer after a spiking one.
+//
+// Takes (spikes, weight) and returns spikes @ weight, where spikes is either
+// dense 0 / 1 [..., N] FLOAT / FLOAT16, compact [..., N] BOOL / UINT8 (the
+// `spike_dtype` of the spike ops) or packed [..., ceil(N / 32)] INT32 (see
+// spike_pack.hpp), and weight is [N, M], one row per input neuron; an
+// nn.Linear weight goes in transposed. The output is [..., M].
+//
+// Every tile takes a slab of the M output columns and adds the slab of the
+// weight row of each neuron that fired (codelets/spike_linear.cpp), so the
+// cost scales with the spike count rather than N. Dense spikes are first
+// turned into one list of the neurons that fired per row, on the tiles that
+// own the rows, so that no slab scans the dense row itself. The op lays the
+// weight out by those slabs when it creates it, so every tile reads its own
+// weights and only the spikes, packed or as index lists, are exchanged. The
+// weight gradient is accumulated the same way, into the same layout. Both
+// sums are accumulated in float. FLOAT / FLOAT16 spikes also get a gradient,
+// grad @ weight^T, as if the product were dense; compact and packed spikes
+// get none.
+//
+// Without spike_codelets.gp the op falls back to poplin matmuls.
+#include <popart/error.hpp>
+#include <popart/opmanager.hpp>
+#include <popart/opserialiser.hpp>
+#include <popart/popx/opx.hpp>
+#include <popart/popx/opxmanager.hpp>
+
+#include <poplin/MatMul.hpp>
+#include <popops/Cast.hpp>
+#include <poputil/VertexTemplates.hpp>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "spike_codelets.hpp"
+#include "spike_pack.hpp"
+
+namespace CustomOperators {
+const popart::OperatorIdentifier SpikeLinearId = {"custom.ops", "SpikeLinear",
+                                                  1};
+} // namespace CustomOperators
+namespace CustomGradOperators {
+const popart::OperatorIdentifier SpikeLinearGradId = {"custom.ops",
+                                                      "SpikeLinearGrad", 1};
+} // namespace CustomGradOperators
+
+class SpikeLinearOp;
+class SpikeLinearOpx;
+class SpikeLinearGradOpx;
+
+class SpikeLinearGradOp : public popart::Op {
+public:
+  SpikeLinearGradOp(const SpikeLinearOp &fwdOp);
+
+  std::unique_ptr<popart::Op> clone() const final {
+    return std::make_unique<SpikeLinearGradOp>(*this);
+  }
+
+  // The weight gradient, then the spike gradient when spikes are dense
+  void setup() final {
+    outInfo(0) = weightInfo;
+    if (spikeGrad) {
+      outInfo(1) = spikesInfo;
+    }
+  };
+
+  const std::vector<popart::GradInOutMapper> &gradInputInfo() const;
+
+  const std::map<int, int> &gradOutToNonGradIn() const;
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // an estimate of how valuable sub-graph matching will be
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  bool getPacked() const { return packed; }
+  bool getSpikeGrad() const { return spikeGrad; }
+
+private:
+  bool packed;
+  bool spikeGrad;
+  popart::TensorInfo spikesInfo;
+  popart::TensorInfo weightInfo;
+};
+
+class SpikeLinearOp : public popart::Op {
+public:
+  SpikeLinearOp(const popart::OperatorIdentifier &_opid,
+                const popart::Op::Settings &settings_)
+      : popart::Op(_opid, settings_) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<SpikeLinearOp>(*this);
+  }
+
+  void setup() final {
+    const auto &spikes = inInfo(0);
+    const auto &weight = inInfo(1);
+    if (spikes.rank() < 1 || weight.rank() != 2) {
+      throw popart::error("SpikeLinear: expected spikes of rank >= 1 and a "
+                          "[N, M] weight");
+    }
+    const int64_t n = weight.dim(0);
+    const int64_t expected = isPacked() ? spike_pack::numWords(n) : n;
+    if (spikes.shape().back() != expected) {
+      throw popart::error("SpikeLinear: spikes end in {}, but a weight with {} "
+                          "rows needs {}",
+                          spikes.shape().back(), n, expected);
+    }
+    popart::Shape shape = spikes.shape();
+    shape.back() = weight.dim(1);
+    outInfo(0) = {weight.dataType(), shape};
+  }
+
+  std::vector<std::unique_ptr<popart::Op>> getGradOps() {
+    std::vector<std::unique_ptr<Op>> upops;
+    upops.emplace_back(new SpikeLinearGradOp(*this));
+    return upops;
+  }
+
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  bool requiresRandomSeed() const override { return false; }
+
+  bool isPacked() const {
+    return inInfo(0).dataType() == popart::DataType::INT32;
+  }
+
+  // Only FLOAT / FLOAT16 spikes can take a gradient
+  bool hasSpikeGrad() const {
+    const auto type = inInfo(0).dataType();
+    return type == popart::DataType::FLOAT ||
+           type == popart::DataType::FLOAT16;
+  }
+};
+
+namespace {
+using popart::DataType;
+using popart::OpDefinition;
+
+static OpDefinition::DataTypes T = {DataType::FLOAT16, DataType::FLOAT};
+static OpDefinition::DataTypes TOrWords = {DataType::FLOAT16, DataType::FLOAT,
+                                           DataType::INT32, DataType::BOOL,
+                                           DataType::UINT8};
+
+static OpDefinition
+    SpikeLinearOpDef({OpDefinition::Inputs({{"spikes", TOrWords},
+                                            {"weight", T}}),
+                      OpDefinition::Outputs({{"output", T}}),
+                      OpDefinition::Attributes()});
+
+static popart::OpCreator<SpikeLinearOp> SpikeLinearOpCreator(
+    popart::OpDefinitions({{CustomOperators::SpikeLinearId,
+                            SpikeLinearOpDef}}),
+    [](const popart::OpCreatorInfo &info) {
+      return std::make_unique<SpikeLinearOp>(info.opid, info.settings);
+    },
+    true);
+
+// Column slabs [begin, end) of `m` output columns, one per tile. Slabs are
+// a multiple of 8 columns wide, bar the last.
+std::vector<std::pair<std::size_t, std::size_t>>
+columnSlabs(const poplar::Target &target, std::size_t m) {
+  const std::size_t grain = 8;
+  const std::size_t count =
+      std::max<std::size_t>(1, std::min<std::size_t>(target.getNumTiles(),
+                                                     (m + grain - 1) / grain));
+  const std::size_t width =
+      ((m + count - 1) / count + grain - 1) / grain * grain;
+  std::vector<std::pair<std::size_t, std::size_t>> slabs;
+  for (std::size_t begin = 0; begin < m; begin += width) {
+    slabs.emplace_back(begin, std::min(begin + width, m));
+  }
+  return slabs;
+}
+
+// Rows of a slab are padded to an even length, so that the rows of a half
+// slab never share a 32-bit word between workers
+std::size_t slabStride(std::size_t width) { return width + width % 2; }
+
+// An [n, m] tensor laid out by column slabs: slab t is [n, slabStride]
+// on tile t, of which the first `width` columns are used
+poplar::Tensor createSlabbed(poplar::Graph &graph, const poplar::Type &type,
+                             std::size_t n, std::size_t m,
+                             const poplar::DebugContext &dc) {
+  std::vector<poplar::Tensor> slabs;
+  const auto columns = columnSlabs(graph.getTarget(), m);
+  for (unsigned tile = 0; tile < columns.size(); ++tile) {
+    const std::size_t width = columns[tile].second - columns[tile].first;
+    auto slab = graph.addVariable(type, {n, slabStride(width)}, dc);
+    graph.setTileMapping(slab, tile);
+    slabs.push_back(slab.slice(0, width, 1));
+  }
+  return poplar::concat(slabs, 1);
+}
+
+// The rows of one column slab of an [n, m] tensor
+std::vector<poplar::Tensor> slabRows(const poplar::Tensor &t,
+                                     std::size_t begin, std::size_t end) {
+  std::vector<poplar::Tensor> rows;
+  for (std::size_t j = 0; j < t.dim(0); ++j) {
+    rows.push_back(t[j].slice(begin, end));
+  }
+  return rows;
+}
+
+// The type of the index lists of a layer of `n` neurons
+poplar::Type indexType(std::size_t n) {
+  return n < 65536 ? poplar::UNSIGNED_SHORT : poplar::UNSIGNED_INT;
+}
+
+// Elements per index list: the count and up to n indices, padded to whole
+// 32-bit words, as rowLength in codelets/spike_linear.cpp
+std::size_t indexStride(std::size_t n, const poplar::Type &type) {
+  const std::size_t perWord = type == poplar::UNSIGNED_SHORT ? 2 : 1;
+  return (n + perWord) / perWord * perWord;
+}
+
+// The estimates below assume that one neuron in 8 fires. Walking the fired
+// neurons of a row costs a pass over the words of a packed row, or reading
+// the count of an index list, plus about 4 cycles per neuron.
+std::size_t walkCycles(std::size_t n, bool packed) {
+  return (packed ? spike_pack::numWords(n) * 4 : 2) + n / 8 * 4;
+}
+
+// Cycles for one SpikeIndices vertex over `rows` rows
+std::uint64_t indexCycles(const poplar::Target &target, std::size_t rows,
+                          std::size_t n) {
+  const unsigned workers = target.getNumWorkerContexts();
+  const std::size_t perRow = n * 2 + n / 8 * 2;
+  return (20 + (rows + workers - 1) / workers * perRow) * workers;
+}
+
+// Cycles for one SpikeLinear vertex: every run of 16 columns walks the
+// spikes of the row and adds a weight per neuron, then rounds the sums
+std::uint64_t estimateCycles(const poplar::Target &target, std::size_t rows,
+                             std::size_t n, std::size_t width, bool packed) {
+  const unsigned workers = target.getNumWorkerContexts();
+  const std::size_t runs = (width + 15) / 16;
+  const std::size_t perRow =
+      runs * walkCycles(n, packed) + n / 8 * width + width;
+  return (20 + (rows + workers - 1) / workers * perRow) * workers;
+}
+
+// Cycles for one SpikeLinearWeightGrad vertex, whose workers split the
+// columns: zero the sums, add a gradient row per spike of every row, then
+// round the sums of a half gradient
+std::uint64_t gradCycles(const poplar::Target &target, std::size_t rows,
+                         std::size_t n, std::size_t width, bool packed,
+                         bool half) {
+  const unsigned workers = target.getNumWorkerContexts();
+  const std::size_t columns = (width + workers - 1) / workers;
+  const std::size_t sums = n * columns * (half ? 2 : 1);
+  return (20 + sums + rows * (walkCycles(n, packed) + n / 8 * columns)) *
+         workers;
+}
+
+// The spikes operand of the vertices: packed words as they are, or for each
+// row of dense spikes the list of the neurons that fired (SpikeIndices),
+// built once on the tile that owns the row and exchanged to every slab
+poplar::Tensor vertexSpikes(poplar::Graph &graph, const poplar::Tensor &spikes,
+                            std::size_t rows, std::size_t n,
+                            poplar::program::Sequence &prog,
+                            const poplar::DebugContext &dc) {
+  if (spikes.elementType() == poplar::INT) {
+    return spikes.flatten();
+  }
+  const auto type = indexType(n);
+  auto dense = spikes.reshape({rows, n});
+  auto indices = graph.addVariable(type, {rows, indexStride(n, type)}, dc);
+
+  auto cs = graph.addComputeSet(dc);
+  auto vertex =
+      poputil::templateVertex("SpikeIndices", spikes.elementType(), type);
+  const std::size_t tiles = graph.getTarget().getNumTiles();
+  const std::size_t perTile = (rows + tiles - 1) / tiles;
+  unsigned tile = 0;
+  for (std::size_t begin = 0; begin < rows; begin += perTile, ++tile) {
+    const std::size_t end = std::min(begin + perTile, rows);
+    auto lists = indices.slice(begin, end);
+    graph.setTileMapping(lists, tile);
+
+    auto v = graph.addVertex(cs, vertex);
+    graph.connect(v["spikes"], dense.slice(begin, end).flatten());
+    graph.connect(v["indices"], lists.flatten());
+    graph.setInitialValue(v["rows"], unsigned(end - begin));
+    graph.setInitialValue(v["n"], unsigned(n));
+    graph.setTileMapping(v, tile);
+    graph.setPerfEstimate(v, indexCycles(graph.getTarget(), end - begin, n));
+  }
+  prog.add(poplar::program::Execute(cs, dc));
+  return indices.flatten();
+}
+
+// `spikes` as [rows, N] dense values of `type`
+poplar::Tensor denseSpikes(poplar::Graph &graph, const poplar::Tensor &spikes,
+                           std::size_t rows, std::size_t n,
+                           const poplar::Type &type,
+                           poplar::program::Sequence &prog,
+                           const poplar::DebugContext &dc) {
+  if (spikes.elementType() == poplar::INT) {
+    auto words = spikes.reshape({rows, spike_pack::numWords(n)});
+    return spike_pack::unpack(graph, words, n, type, prog, dc);
+  }
+  auto s = spikes.reshape({rows, n});
+  if (s.elementType() != type) {
+    s = popops::cast(graph, s, type, prog, dc);
+  }
+  return s;
+}
+} // namespace
+
+class SpikeLinearOpx : public popart::popx::Opx {
+public:
+  SpikeLinearOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<SpikeLinearOp>(op, {CustomOperators::SpikeLinearId});
+  }
+
+  // The weight is laid out by the column slabs of the vertices, or for the
+  // matmul when the codelets are missing
+  popart::popx::InputCreatorType
+  getInputCreatorType(popart::InIndex index) const final {
+    return index == 1 ? popart::popx::InputCreatorType::CanCreate
+                      : Opx::getInputCreatorType(index);
+  }
+
+  poplar::Tensor createInput(popart::InIndex index,
+                             const poplar::DebugNameAndId &dnai) const final {
+    if (index != 1) {
+      throw popart::error("SpikeLinear: cannot create input {}", index);
+    }
+    const auto &spikes = inInfo(0);
+    const auto &weight = inInfo(1);
+    const auto type = popType(weight);
+    const std::size_t n = weight.dim(0);
+    const std::size_t m = weight.dim(1);
+    if (!spike_codelets::addCodelets(graph())) {
+      const std::size_t rows = spikes.nelms() / spikes.shape().back();
+      return poplin::createMatMulInputRHS(graph(), type, {rows, n}, {n, m},
+                                          dnai);
+    }
+    return createSlabbed(graph(), type, n, m, dnai);
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+    poplar::Tensor spikes = getInTensor(0);
+    poplar::Tensor weight = getInTensor(1);
+    const auto type = weight.elementType();
+    const bool packed = spikes.elementType() == poplar::INT;
+    const std::size_t n = weight.dim(0);
+    const std::size_t m = weight.dim(1);
+    const std::size_t rows =
+        spikes.numElements() / spikes.dim(spikes.rank() - 1);
+    auto shape = spikes.shape();
+    shape.back() = m;
+
+    if (!spike_codelets::addCodelets(graph())) {
+      auto s = denseSpikes(graph(), spikes, rows, n, type, prog,
+                           debugContext("spikes"));
+      auto out = poplin::matMul(graph(), s, weight, prog, type,
+                                debugContext("SpikeLinear"));
+      setOutTensor(0, out.reshape(shape));
+      return;
+    }
+
+    auto flatSpikes = vertexSpikes(graph(), spikes, rows, n, prog,
+                                   debugContext("SpikeLinearIndices"));
+
+    auto cs = graph().addComputeSet(debugContext("SpikeLinear"));
+    auto vertex = poputil::templateVertex("SpikeLinear", type,
+                                          flatSpikes.elementType());
+    std::vector<poplar::Tensor> outs;
+    const auto slabs = columnSlabs(graph().getTarget(), m);
+    for (unsigned tile = 0; tile < slabs.size(); ++tile) {
+      const std::size_t begin = slabs[tile].first;
+      const std::size_t width = slabs[tile].second - begin;
+      const std::size_t stride = slabStride(width);
+      auto out = graph().addVariable(type, {rows, stride},
+                                     debugContext("SpikeLinear"));
+      graph().setTileMapping(out, tile);
+
+      // Every output column depends on every spike, so the spikes (packed
+      // or as index lists) are the only operand read off-tile
+      auto v = graph().addVertex(cs, vertex);
+      graph().connect(v["spikes"], flatSpikes);
+      graph().connect(v["weights"], slabRows(weight, begin, begin + width));
+      graph().connect(v["out"], out.flatten());
+      graph().setInitialValue(v["rows"], unsigned(rows));
+      graph().setInitialValue(v["width"], unsigned(width));
+      graph().setInitialValue(v["stride"], unsigned(stride));
+      graph().setTileMapping(v, tile);
+      graph().setPerfEstimate(v, estimateCycles(graph().getTarget(), rows, n,
+                                                width, packed));
+      outs.push_back(out.slice(0, width, 1));
+    }
+    prog.add(poplar::program::Execute(cs, debugContext("SpikeLinear")));
+
+    setOutTensor(0, poplar::concat(outs, 1).reshape(shape));
+  }
+};
+
+class SpikeLinearGradOpx : public popart::popx::Opx {
+public:
+  SpikeLinearGradOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<SpikeLinearGradOp>(op, {CustomGradOperators::SpikeLinearGradId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+    auto op = getOp<SpikeLinearGradOp>();
+
+    poplar::Tensor grad = getInTensor(0);
+    poplar::Tensor spikes = getInTensor(1);
+    poplar::Tensor weight = getInTensor(2);
+    const auto type = weight.elementType();
+    const bool packed = op.getPacked();
+    const std::size_t n = weight.dim(0);
+    const std::size_t m = weight.dim(1);
+    const std::size_t rows = grad.numElements() / m;
+    grad = grad.reshape({rows, m});
+
+    // d(spikes @ weight)/dspikes, as for a dense matmul, in the type of
+    // the spikes
+    if (op.getSpikeGrad()) {
+      auto gradSpikes =
+          poplin::matMul(graph(), grad, weight.transpose(), prog, type,
+                         debugContext("SpikeLinearGradSpikes"));
+      if (gradSpikes.elementType() != spikes.elementType()) {
+        gradSpikes = popops::cast(graph(), gradSpikes, spikes.elementType(),
+                                  prog, debugContext("SpikeLinearGradSpikes"));
+      }
+      setOutTensor(1, gradSpikes.reshape(spikes.shape()));
+    }
+
+    if (!spike_codelets::addCodelets(graph())) {
+      auto s = denseSpikes(graph(), spikes, rows, n, type, prog,
+                           debugContext("spikes"));
+      setOutTensor(0, poplin::matMul(graph(), s.transpose(), grad, prog, type,
+                                     debugContext("SpikeLinearGradWeight")));
+      return;
+    }
+
+    auto flatSpikes = vertexSpikes(graph(), spikes, rows, n, prog,
+                                   debugContext("SpikeLinearIndices"));
+
+    auto cs = graph().addComputeSet(debugContext("SpikeLinearGradWeight"));
+    auto vertex = poputil::templateVertex("SpikeLinearWeightGrad", type,
+                                          flatSpikes.elementType());
+    // The gradient takes the layout the op gives the weight
+    auto out = createSlabbed(graph(), type, n, m,
+                             debugContext("SpikeLinearGradWeight"));
+    const auto slabs = columnSlabs(graph().getTarget(), m);
+    for (unsigned tile = 0; tile < slabs.size(); ++tile) {
+      const std::size_t begin = slabs[tile].first;
+      const std::size_t width = slabs[tile].second - begin;
+
+      auto v = graph().addVertex(cs, vertex);
+      graph().connect(v["spikes"], flatSpikes);
+      graph().connect(v["grad"], grad.slice(begin, begin + width, 1).flatten());
+      graph().connect(v["out"], slabRows(out, begin, begin + width));
+      if (type == poplar::HALF) {
+        // The float sums, rounded into `out` once
+        auto acc = graph().addVariable(poplar::FLOAT, {n * width},
+                                       debugContext("SpikeLinearGradAcc"));
+        graph().setTileMapping(acc, tile);
+        graph().connect(v["acc"], acc);
+      }
+      graph().setInitialValue(v["rows"], unsigned(rows));
+      graph().setInitialValue(v["width"], unsigned(width));
+      graph().setTileMapping(v, tile);
+      graph().setPerfEstimate(v, gradCycles(graph().getTarget(), rows, n,
+                                            width, packed,
+                                            type == poplar::HALF));
+    }
+    prog.add(
+        poplar::program::Execute(cs, debugContext("SpikeLinearGradWeight")));
+
+    setOutTensor(0, out);
+  }
+};
+
+SpikeLinearGradOp::SpikeLinearGradOp(const SpikeLinearOp &fwdOp)
+    : popart::Op(CustomGradOperators::SpikeLinearGradId, fwdOp.settings),
+      packed(fwdOp.isPacked()), spikeGrad(fwdOp.hasSpikeGrad()),
+      spikesInfo(fwdOp.inInfo(0)),
+      weightInfo(fwdOp.inInfo(1)) {}
+
+const std::vector<popart::GradInOutMapper> &
+SpikeLinearGradOp::gradInputInfo() const {
+  static const std::vector<popart::GradInOutMapper> inInfo = {
+      {0, 0, popart::GradOpInType::GradOut},
+      {1, 0, popart::GradOpInType::In},
+      {2, 1, popart::GradOpInType::In}};
+  return inInfo;
+}
+
+// The weight gradient, and the spike gradient when spikes are dense
+const std::map<int, int> &SpikeLinearGradOp::gradOutToNonGradIn() const {
+  static const std::map<int, int> outInfoWeight = {{0, 1}};
+  static const std::map<int, int> outInfoDense = {{0, 1}, {1, 0}};
+  return spikeGrad ? outInfoDense : outInfoWeight;
+}
+
+static popart::popx::OpxCreator<SpikeLinearOpx>
+    SpikeLinearOpxCreator({CustomOperators::SpikeLinearId});
+static popart::popx::OpxCreator<SpikeLinearGradOpx>
+    SpikeLinearGradOpxCreator({CustomGradOperators::SpikeLinearGradId});
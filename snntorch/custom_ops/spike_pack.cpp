@@ -0,0 +1,184 @@
+// Conversion between dense 0 / 1 spikes and the packed format of
+// spike_pack.hpp.
+//
+//   SpikePack:   [..., N] FLOAT / FLOAT16 spikes -> [..., ceil(N / 32)] INT32
+//   SpikeUnpack: [..., W] INT32 words -> [..., size] FLOAT / FLOAT16
+//
+// SpikeUnpack takes the number of neurons per row as `size` (default 32 * W)
+// and the output type as `to`, an ONNX TensorProto data type (1: FLOAT,
+// 10: FLOAT16), as for the ONNX Cast op. Neither op has a gradient: packed
+// spikes are meant for records and consumers that do not backpropagate.
+#include <popart/error.hpp>
+#include <popart/opmanager.hpp>
+#include <popart/opserialiser.hpp>
+#include <popart/popx/opx.hpp>
+#include <popart/popx/opxmanager.hpp>
+
+#include "spike_pack.hpp"
+
+namespace CustomOperators {
+const popart::OperatorIdentifier SpikePackId = {"custom.ops", "SpikePack", 1};
+const popart::OperatorIdentifier SpikeUnpackId = {"custom.ops", "SpikeUnpack",
+                                                  1};
+} // namespace CustomOperators
+
+class SpikePackOp : public popart::Op {
+public:
+  SpikePackOp(const popart::OperatorIdentifier &_opid,
+              const popart::Op::Settings &settings_)
+      : popart::Op(_opid, settings_) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<SpikePackOp>(*this);
+  }
+
+  void setup() final {
+    outInfo(0) = {popart::DataType::INT32,
+                  spike_pack::packedShape(inInfo(0).shape())};
+  }
+
+  float getSubgraphValue() const final { return getLowSubgraphValue(); }
+
+  bool requiresRandomSeed() const override { return false; }
+};
+
+class SpikeUnpackOp : public popart::Op {
+public:
+  SpikeUnpackOp(const popart::OperatorIdentifier &_opid, int64_t _size,
+                popart::DataType _to, const popart::Op::Settings &settings_)
+      : popart::Op(_opid, settings_), size(_size), to(_to) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<SpikeUnpackOp>(*this);
+  }
+
+  void setup() final {
+    popart::Shape shape = inInfo(0).shape();
+    if (shape.empty()) {
+      throw popart::error("SpikeUnpack: expected packed words of rank >= 1");
+    }
+    const int64_t words = shape.back();
+    if (size < 0) {
+      size = words * 32;
+    }
+    if (static_cast<int64_t>(spike_pack::numWords(size)) != words) {
+      throw popart::error("SpikeUnpack: {} neurons do not pack into {} words",
+                          size, words);
+    }
+    shape.back() = size;
+    outInfo(0) = {to, shape};
+  }
+
+  void appendAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendAttributes(os);
+    os.appendAttribute("size", getSize());
+    os.appendAttribute("to", getTo());
+  }
+
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendOutlineAttributes(os);
+    os.appendAttribute("size", getSize());
+    os.appendAttribute("to", getTo());
+  }
+
+  float getSubgraphValue() const final { return getLowSubgraphValue(); }
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // Attributes
+  int64_t getSize() const { return size; }
+  // the ONNX TensorProto type `to` was given as
+  int64_t getTo() const { return to == popart::DataType::FLOAT16 ? 10 : 1; }
+
+private:
+  int64_t size;
+  popart::DataType to;
+};
+
+namespace {
+using popart::DataType;
+using popart::OpDefinition;
+
+static OpDefinition::DataTypes T = {DataType::FLOAT16, DataType::FLOAT};
+static OpDefinition::DataTypes Words = {DataType::INT32};
+
+static OpDefinition
+    SpikePackOpDef({OpDefinition::Inputs({{"input", T}}),
+                    OpDefinition::Outputs({{"output", Words}}),
+                    OpDefinition::Attributes()});
+
+static OpDefinition
+    SpikeUnpackOpDef({OpDefinition::Inputs({{"input", Words}}),
+                      OpDefinition::Outputs({{"output", T}}),
+                      OpDefinition::Attributes({{"size", {"*"}},
+                                                {"to", {"*"}}})});
+
+static popart::OpCreator<SpikePackOp> SpikePackOpCreator(
+    popart::OpDefinitions({{CustomOperators::SpikePackId, SpikePackOpDef}}),
+    [](const popart::OpCreatorInfo &info) {
+      return std::make_unique<SpikePackOp>(info.opid, info.settings);
+    },
+    true);
+
+static popart::OpCreator<SpikeUnpackOp> SpikeUnpackOpCreator(
+    popart::OpDefinitions({{CustomOperators::SpikeUnpackId,
+                            SpikeUnpackOpDef}}),
+    [](const popart::OpCreatorInfo &info) {
+      // by default every bit of the words is a neuron
+      int64_t size =
+          info.attributes.getAttribute<popart::Attributes::Int>("size", -1);
+      // ONNX TensorProto: 1 is FLOAT, 10 is FLOAT16
+      int64_t to =
+          info.attributes.getAttribute<popart::Attributes::Int>("to", 1);
+      if (to != 1 && to != 10) {
+        throw popart::error("SpikeUnpack: `to` must be 1 (FLOAT) or 10 "
+                            "(FLOAT16), got {}",
+                            to);
+      }
+      return std::make_unique<SpikeUnpackOp>(
+          info.opid, size, to == 10 ? DataType::FLOAT16 : DataType::FLOAT,
+          info.settings);
+    },
+    true);
+} // namespace
+
+class SpikePackOpx : public popart::popx::Opx {
+public:
+  SpikePackOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<SpikePackOp>(op, {CustomOperators::SpikePackId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+    poplar::Tensor input = getInTensor(0);
+
+    auto threshold = spike_pack::spikeThreshold(
+        graph(), input.elementType(), debugContext("threshold"));
+    setOutTensor(0, spike_pack::pack(graph(), input, threshold, prog,
+                                     debugContext("SpikePack")));
+  }
+};
+
+class SpikeUnpackOpx : public popart::popx::Opx {
+public:
+  SpikeUnpackOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<SpikeUnpackOp>(op, {CustomOperators::SpikeUnpackId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+    auto op = getOp<SpikeUnpackOp>();
+    const poplar::Type type =
+        op.outInfo(0).dataType() == popart::DataType::FLOAT16 ? poplar::HALF
+                                                              : poplar::FLOAT;
+
+    setOutTensor(0, spike_pack::unpack(graph(), getInTensor(0), op.getSize(),
+                                       type, prog,
+                                       debugContext("SpikeUnpack")));
+  }
+};
+
+static popart::popx::OpxCreator<SpikePackOpx>
+    SpikePackOpxCreator({CustomOperators::SpikePackId});
+static popart::popx::OpxCreator<SpikeUnpackOpx>
+    SpikeUnpackOpxCreator({CustomOperators::SpikeUnpackId});
@@ -0,0 +1,251 @@
+// Bit-packed spikes. The last dimension of a [..., N] spike tensor is stored
+// as ceil(N / 32) INT32 words, neuron n in bit n % 32 of word n / 32, and
+// the high bits of a row's last word are zero. The words are INT32 rather
+// than UINT32 since PyTorch has no unsigned 32-bit type to hand them back
+// as; only the bit pattern matters.
+//
+// Packing and unpacking use the SpikePack / SpikeUnpack vertices in
+// codelets/spike_codelets.cpp when they are available, popops otherwise.
+#ifndef SNNTORCH_CUSTOM_OPS_SPIKE_PACK_HPP
+#define SNNTORCH_CUSTOM_OPS_SPIKE_PACK_HPP
+
+#include <popart/names.hpp>
+
+#include <poplar/Graph.hpp>
+#include <poplar/Program.hpp>
+#include <popops/ElementWise.hpp>
+#include <popops/Reduce.hpp>
+#include <poputil/Broadcast.hpp>
+#include <poputil/VertexTemplates.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "spike_codelets.hpp"
+
+namespace spike_pack {
+
+namespace pe = popops::expr;
+
+inline std::size_t numWords(std::size_t n) { return (n + 31) / 32; }
+
+// Shape of the packed form of a tensor of shape `shape`
+inline popart::Shape packedShape(popart::Shape shape) {
+  if (shape.empty()) {
+    shape.push_back(1);
+  }
+  shape.back() = numWords(shape.back());
+  return shape;
+}
+
+// A run of words [begin, end) within one row of a [rows, words] tensor,
+// all on `tile`
+struct WordRun {
+  unsigned tile;
+  std::size_t row;
+  std::size_t begin;
+  std::size_t end;
+};
+
+inline std::vector<WordRun> wordRuns(const poplar::Graph &graph,
+                                     const poplar::Tensor &words) {
+  const std::size_t perRow = words.dim(1);
+  std::vector<WordRun> runs;
+  const auto mapping = graph.getTileMapping(words.flatten());
+  for (unsigned tile = 0; tile < mapping.size(); ++tile) {
+    for (const auto &interval : mapping[tile]) {
+      for (std::size_t i = interval.begin(); i < interval.end();) {
+        const std::size_t row = i / perRow;
+        const std::size_t end = std::min(interval.end(), (row + 1) * perRow);
+        runs.push_back({tile, row, i - row * perRow, end - row * perRow});
+        i = end;
+      }
+    }
+  }
+  return runs;
+}
+
+// Map each word of `words` ([rows, W]) to the tile holding the first neuron
+// it packs from `in` ([rows, N]), so that packing reads locally
+inline void mapWordsLike(poplar::Graph &graph, const poplar::Tensor &words,
+                         const poplar::Tensor &in) {
+  const std::size_t n = in.dim(1);
+  const std::size_t perRow = words.dim(1);
+  std::vector<unsigned> tileOf(words.numElements(), 0);
+  const auto mapping = graph.getTileMapping(in.flatten());
+  for (unsigned tile = 0; tile < mapping.size(); ++tile) {
+    for (const auto &interval : mapping[tile]) {
+      for (std::size_t row = interval.begin() / n;
+           row * n < interval.end(); ++row) {
+        const std::size_t lo = std::max(interval.begin(), row * n) - row * n;
+        const std::size_t hi =
+            std::min(interval.end(), (row + 1) * n) - row * n;
+        for (std::size_t w = (lo + 31) / 32; w < (hi + 31) / 32; ++w) {
+          tileOf[row * perRow + w] = tile;
+        }
+      }
+    }
+  }
+
+  auto flat = words.flatten();
+  for (std::size_t begin = 0; begin < tileOf.size();) {
+    std::size_t end = begin + 1;
+    while (end < tileOf.size() && tileOf[end] == tileOf[begin]) {
+      ++end;
+    }
+    graph.setTileMapping(flat.slice(begin, end), tileOf[begin]);
+    begin = end;
+  }
+}
+
+// Cycles for a SpikePack / SpikeUnpack vertex over `words` words
+inline std::uint64_t estimateCycles(const poplar::Target &target,
+                                    std::size_t words) {
+  const unsigned workers = target.getNumWorkerContexts();
+  return (20 + (words + workers - 1) / workers * (32 * 3 + 4)) * workers;
+}
+
+// 0, 1, ..., 31 as INT, the bit of each neuron within its word
+inline poplar::Tensor lanes(poplar::Graph &graph,
+                            const poplar::DebugContext &dc) {
+  std::vector<int> values(32);
+  for (int i = 0; i < 32; ++i) {
+    values[i] = i;
+  }
+  auto t = graph.addConstant(poplar::INT, {32}, values.data(), dc);
+  graph.setTileMapping(t, 0);
+  return t;
+}
+
+// A threshold of 0.5, which packs dense 0 / 1 spikes as they are
+inline poplar::Tensor spikeThreshold(poplar::Graph &graph,
+                                     const poplar::Type &type,
+                                     const poplar::DebugContext &dc) {
+  auto t = graph.addConstant(type, {1}, 0.5f, dc);
+  graph.setTileMapping(t, 0);
+  return t;
+}
+
+// Pack `in >= threshold` along the last dimension of `in`. `threshold` is a
+// single element or has the shape of `in`, as from
+// spike_codelets::thresholdOrZero.
+inline poplar::Tensor pack(poplar::Graph &graph, const poplar::Tensor &in,
+                           const poplar::Tensor &threshold,
+                           poplar::program::Sequence &prog,
+                           const poplar::DebugContext &dc) {
+  auto shape = in.shape();
+  if (shape.empty()) {
+    shape.push_back(1);
+  }
+  const std::size_t n = shape.back();
+  const std::size_t rows = in.numElements() / n;
+  const std::size_t perRow = numWords(n);
+  auto outShape = shape;
+  outShape.back() = perRow;
+
+  const bool shared = threshold.numElements() == 1;
+  auto x = in.reshape({rows, n});
+  auto thr = shared ? threshold.flatten() : threshold.reshape({rows, n});
+
+  if (spike_codelets::addCodelets(graph)) {
+    auto words = graph.addVariable(poplar::INT, {rows, perRow}, dc);
+    mapWordsLike(graph, words, x);
+
+    auto cs = graph.addComputeSet(dc);
+    auto vertex = poputil::templateVertex("SpikePack", in.elementType());
+    for (const auto &run : wordRuns(graph, words)) {
+      const std::size_t begin = run.begin * 32;
+      const std::size_t end = std::min(run.end * 32, n);
+      auto v = graph.addVertex(cs, vertex);
+      graph.connect(v["in"], x[run.row].slice(begin, end));
+      graph.connect(v["threshold"],
+                    shared ? thr : thr[run.row].slice(begin, end));
+      graph.connect(v["out"], words[run.row].slice(run.begin, run.end));
+      graph.setTileMapping(v, run.tile);
+      graph.setPerfEstimate(
+          v, estimateCycles(graph.getTarget(), run.end - run.begin));
+    }
+    prog.add(poplar::program::Execute(cs, dc));
+    return words.reshape(outShape);
+  }
+
+  // Pad each row to whole words with a value below any threshold, then
+  // shift every spike into its bit and sum the bits of each word
+  const std::size_t pad = perRow * 32 - n;
+  if (pad != 0) {
+    const float lowest = in.elementType() == poplar::HALF
+                             ? -65504.0f
+                             : std::numeric_limits<float>::lowest();
+    auto padding = graph.addConstant(in.elementType(), {1, 1}, lowest, dc);
+    graph.setTileMapping(padding, 0);
+    x = poplar::concat(x, padding.broadcast(rows, 0).broadcast(pad, 1), 1);
+    if (!shared) {
+      auto zero = graph.addConstant(in.elementType(), {1, 1}, 0.0f, dc);
+      graph.setTileMapping(zero, 0);
+      thr = poplar::concat(thr, zero.broadcast(rows, 0).broadcast(pad, 1), 1);
+    }
+  }
+  const std::vector<std::size_t> bitShape = {rows, perRow, 32};
+  x = x.reshape(bitShape);
+  thr = shared ? thr : thr.reshape(bitShape);
+  poputil::broadcastToMatch(thr, bitShape);
+  auto shifts = lanes(graph, dc);
+  poputil::broadcastToMatch(shifts, bitShape);
+
+  auto bits = popops::map(
+      graph, pe::Shl(pe::Cast(pe::Gte(pe::_1, pe::_2), poplar::INT), pe::_3),
+      {x, thr, shifts}, prog, dc);
+  auto words = popops::reduce(graph, bits, {2},
+                              {popops::Operation::ADD}, prog, dc);
+  return words.reshape(outShape);
+}
+
+// Unpack `words` ([..., numWords(n)]) to 0 / 1 values of `type`, [..., n]
+inline poplar::Tensor unpack(poplar::Graph &graph, const poplar::Tensor &words,
+                             std::size_t n, const poplar::Type &type,
+                             poplar::program::Sequence &prog,
+                             const poplar::DebugContext &dc) {
+  auto shape = words.shape();
+  const std::size_t perRow = shape.back();
+  const std::size_t rows = words.numElements() / perRow;
+  shape.back() = n;
+  auto w = words.reshape({rows, perRow});
+
+  if (spike_codelets::addCodelets(graph)) {
+    auto out = graph.addVariable(type, {rows, n}, dc);
+    const auto runs = wordRuns(graph, w);
+    for (const auto &run : runs) {
+      graph.setTileMapping(
+          out[run.row].slice(run.begin * 32, std::min(run.end * 32, n)),
+          run.tile);
+    }
+
+    auto cs = graph.addComputeSet(dc);
+    auto vertex = poputil::templateVertex("SpikeUnpack", type);
+    for (const auto &run : runs) {
+      auto v = graph.addVertex(cs, vertex);
+      graph.connect(v["in"], w[run.row].slice(run.begin, run.end));
+      graph.connect(v["out"], out[run.row].slice(
+                                  run.begin * 32, std::min(run.end * 32, n)));
+      graph.setTileMapping(v, run.tile);
+      graph.setPerfEstimate(
+          v, estimateCycles(graph.getTarget(), run.end - run.begin));
+    }
+    prog.add(poplar::program::Execute(cs, dc));
+    return out.reshape(shape);
+  }
+
+  auto shifts = lanes(graph, dc);
+  auto wide = w.reshape({rows, perRow, 1}).broadcast(32, 2);
+  poputil::broadcastToMatch(shifts, wide.shape());
+  auto bits = popops::map(
+      graph,
+      pe::Cast(pe::BitwiseAnd(pe::Shr(pe::_1, pe::_2), pe::Const(1)), type),
+      {wide, shifts}, prog, dc);
+  return bits.reshape({rows, perRow * 32}).slice(0, n, 1).reshape(shape);
+}
+
+} // namespace spike_pack
+
+#endif // SNNTORCH_CUSTOM_OPS_SPIKE_PACK_HPP
@@ -0,0 +1,156 @@
+// FuseSpikeThreshold, a PopART pattern that folds the threshold subtraction
+// of stock snntorch models into the spike op that follows it.
+//
+// snntorch fires with spike_grad(mem - threshold), which reaches PopART as
+//
+//   u   = Sub(mem, threshold)     or Add(mem, c) with a constant c = -threshold
+//   spk = Heaviside / StraightThroughEstimator / FastSigmoid /
+//         SurrogateSpike(u)
+//
+// Each of these ops compares against an optional threshold input inside its
+// own map, so the pair is rewritten into spk = Op(mem, threshold) and u is
+// never materialised. The gradient of the threshold then comes from the
+// spike's grad op, which subtracts it the same way.
+//
+// Only a u read by nothing but the spike op is fused: once autodiff has run,
+// the spike's grad op reads u too, so the pattern applies to the forward
+// graph only. It is enabled by default, and turned off with
+// `opts._Popart.setPatterns({"FuseSpikeThreshold": False})`.
+#include <popart/graph.hpp>
+#include <popart/ir.hpp>
+#include <popart/op.hpp>
+#include <popart/op/add.hpp>
+#include <popart/op/subtract.hpp>
+#include <popart/patterns/pattern.hpp>
+#include <popart/patterns/patterns.hpp>
+#include <popart/tensor.hpp>
+#include <popart/tensordata.hpp>
+#include <popart/tensors.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+// The custom spike ops that take (input, [threshold])
+bool isSpikeOp(const popart::Op *op) {
+  static const std::vector<std::string> types = {
+      "Heaviside", "StraightThroughEstimator", "FastSigmoid",
+      "SurrogateSpike"};
+  return op->opid.domain == "custom.ops" &&
+         std::find(types.begin(), types.end(), op->opid.type) != types.end();
+}
+
+bool isConstant(const popart::Tensor *t) {
+  return t->tensorType() == popart::TensorType::Const;
+}
+
+// The (mem, threshold) operands of the Sub or Add producing u, the
+// threshold of an Add being the constant it negates. nullptr when u is
+// neither, or when the threshold would have to broadcast mem.
+struct Shift {
+  popart::Tensor *mem = nullptr;
+  popart::Tensor *threshold = nullptr;
+  bool negate = false;
+};
+
+Shift shiftOperands(const popart::Tensor *u) {
+  Shift shift;
+  if (!u->hasProducer()) {
+    return shift;
+  }
+  popart::Op *producer = u->getProducer();
+  if (producer->isConvertibleTo<popart::SubtractOp>()) {
+    shift.mem = producer->inTensor(popart::SubtractOp::getArg0InIndex());
+    shift.threshold = producer->inTensor(popart::SubtractOp::getArg1InIndex());
+  } else if (producer->isConvertibleTo<popart::AddOp>()) {
+    popart::Tensor *lhs = producer->inTensor(popart::AddOp::getArg0InIndex());
+    popart::Tensor *rhs = producer->inTensor(popart::AddOp::getArg1InIndex());
+    shift.mem = isConstant(rhs) ? lhs : rhs;
+    shift.threshold = isConstant(rhs) ? rhs : lhs;
+    shift.negate = true;
+    if (!isConstant(shift.threshold)) {
+      return Shift();
+    }
+  } else {
+    return shift;
+  }
+  if (shift.mem->info.shape() != u->info.shape() ||
+      shift.mem->info.dataType() != u->info.dataType()) {
+    return Shift();
+  }
+  return shift;
+}
+
+// A new constant holding -c. Flipping the sign bit negates both float and
+// half data.
+popart::TensorId negatedConstant(popart::Graph &graph, popart::Tensor *c) {
+  std::vector<char> data(c->info.nbytes());
+  std::memcpy(data.data(), c->tensorData()->data(), data.size());
+  const std::size_t size = c->info.getDataTypeInfo()->nbytes();
+  for (std::size_t i = size - 1; i < data.size(); i += size) {
+    data[i] = static_cast<char>(data[i] ^ 0x80);
+  }
+  popart::TensorId id = graph.getIr().createIntermediateTensorId(c->id);
+  graph.getTensors().addConstInit(id, c->info, data.data());
+  return id;
+}
+} // namespace
+
+class FuseSpikeThreshold : public popart::PreAliasPattern {
+public:
+  bool matches(popart::Op *op) const final {
+    if (!isSpikeOp(op) || op->hasInput(1) || !op->hasInput(0)) {
+      return false;
+    }
+    popart::Tensor *u = op->inTensor(0);
+    if (u->consumers.getTotal() != 1 || op->getIr().isAnchored(u->id)) {
+      return false;
+    }
+    const auto &outputs = op->getGraph().getOutputIds();
+    if (std::find(outputs.begin(), outputs.end(), u->id) != outputs.end()) {
+      return false;
+    }
+    return shiftOperands(u).mem != nullptr;
+  }
+
+  // u is removed
+  std::vector<const popart::Tensor *> touches(popart::Op *op) const final {
+    return {op->inTensor(0)};
+  }
+
+  bool apply(popart::Op *op) const final {
+    popart::Graph &graph = op->getGraph();
+    popart::Tensor *u = op->inTensor(0);
+    popart::Op *producer = u->getProducer();
+    const Shift shift = shiftOperands(u);
+
+    const popart::TensorId mem = shift.mem->id;
+    const popart::TensorId threshold =
+        shift.negate ? negatedConstant(graph, shift.threshold)
+                     : shift.threshold->id;
+    popart::Tensor *constant = shift.negate ? shift.threshold : nullptr;
+
+    // Drop the Sub / Add and u
+    op->disconnectInTensor(0);
+    producer->disconnectAllInputs();
+    producer->disconnectAllOutputs();
+    graph.getTensors().remove(u->id);
+    graph.eraseOp(producer->id);
+    if (constant && constant->consumers.getTotal() == 0) {
+      graph.getTensors().remove(constant->id);
+    }
+
+    op->connectInTensor(0, mem);
+    op->connectInTensor(1, threshold);
+    op->setup();
+    return true;
+  }
+};
+
+namespace {
+static popart::PatternCreator<FuseSpikeThreshold>
+    FuseSpikeThresholdCreator("FuseSpikeThreshold", true);
+} // namespace
@@ -8,16 +8,23 @@
 #include <popart/opmanager.hpp>
 #include <popart/opserialiser.hpp>
 #include <popart/popx/opxmanager.hpp>
+#include <popart/region.hpp>
 
 #include <popart/popx/opx.hpp>
 #include <popops/ElementWise.hpp>
 
+#include "neuron_step.hpp"
+
 namespace CustomOperators {
 const popart::OperatorIdentifier StraightThroughEstimatorId = {"custom.ops", "StraightThroughEstimator", 1};
+const popart::OperatorIdentifier StraightThroughEstimatorInplaceId = {
+    "custom.ops", "StraightThroughEstimatorInplace", 1};
 } // namespace CustomOperators
 namespace CustomGradOperators {
 const popart::OperatorIdentifier StraightThroughEstimatorGradId = {"custom.ops", "StraightThroughEstimatorGrad",
                                                     1};
+const popart::OperatorIdentifier StraightThroughEstimatorGradInplaceId = {
+    "custom.ops", "StraightThroughEstimatorGradInplace", 1};
 } // namespace CustomGradOperators
 
 class StraightThroughEstimatorOp;
@@ -28,14 +35,20 @@ class StraightThroughEstimatorGradOp : public popart::Op {
 public:
   StraightThroughEstimatorGradOp(const StraightThroughEstimatorOp &fwdOp);
 
-  std::unique_ptr<popart::Op> clone() const final {
+  std::unique_ptr<popart::Op> clone() const override {
     return std::make_unique<StraightThroughEstimatorGradOp>(*this);
   }
-  void setup() final { outInfo(0) = inInfo(0); };
+  void setup() final {
+    outInfo(0) = inInfo(0);
+    if (hasThreshold) {
+      outInfo(1) = thresholdInfo;
+    }
+  };
 
   const std::vector<popart::GradInOutMapper> &gradInputInfo() const;
 
-  // The Grad Op has 1 output, which is the gradient of the only input
+  // The Grad Op has 1 output per forward input: the gradient of the input
+  // and, when the threshold is passed in, of the threshold
   const std::map<int, int> &gradOutToNonGradIn() const;
 
   bool requiresRandomSeed() const override { return false; }
@@ -43,7 +56,18 @@ public:
   // an estimate of how valuable sub-graph matching will be
   float getSubgraphValue() const final { return getHighSubgraphValue(); }
 
+  // The gradient of the input is the incoming gradient itself
+  std::vector<std::tuple<popart::OperatorIdentifier, float>>
+  inplacePriorityDefault() const override {
+    return {{CustomGradOperators::StraightThroughEstimatorGradInplaceId, 10}};
+  }
+
+  // Implementation defined below
+  std::unique_ptr<popart::Op>
+  getInplaceVariant(const popart::OperatorIdentifier &id) const override;
+
   float getAlpha() const { return alpha; }
+  bool getHasThreshold() const { return hasThreshold; }
 
   // Implementation defined below
   void appendAttributes(popart::OpSerialiserBase &os) const override;
@@ -51,37 +75,59 @@ public:
   // Implementation defined below
   void appendOutlineAttributes(popart::OpSerialiserBase &os) const override;
 
+protected:
+  StraightThroughEstimatorGradOp(const popart::OperatorIdentifier &_opid,
+                                 const StraightThroughEstimatorGradOp &other)
+      : popart::Op(_opid, other.settings), alpha(other.alpha),
+        hasThreshold(other.hasThreshold), thresholdInfo(other.thresholdInfo) {}
+
 private:
   float alpha;
+  bool hasThreshold;
+  popart::TensorInfo thresholdInfo;
 };
 
 class StraightThroughEstimatorOp : public popart::Op {
 public:
   StraightThroughEstimatorOp(const popart::OperatorIdentifier &_opid, float _alpha,
+              const std::string &_spikeDtype,
               const popart::Op::Settings &settings_)
-      : popart::Op(_opid, settings_), alpha(_alpha) {}
+      : popart::Op(_opid, settings_), alpha(_alpha), spikeDtype(_spikeDtype) {}
   StraightThroughEstimatorOp(const popart::OperatorIdentifier &_opid,
               const popart::Op::Settings &settings_)
       : popart::Op(_opid, settings_) {}
 
-  std::unique_ptr<Op> clone() const final {
+  std::unique_ptr<Op> clone() const override {
     return std::make_unique<StraightThroughEstimatorOp>(*this);
   }
 
-  void setup() final { outInfo(0) = inInfo(0); }
+  // The optional second output is the detached reset mask. spike_dtype =
+  // "bool" / "uint8" emits the spikes at one byte each.
+  void setup() final {
+    outInfo(0) = neuron_step::spikeInfo(inInfo(0), getSpikeDtype());
+    if (output->hasIndex(1)) {
+      outInfo(1) = inInfo(0);
+    }
+  }
 
   void appendAttributes(popart::OpSerialiserBase &os) const override {
     Op::appendAttributes(os);
     os.appendAttribute("alpha", getAlpha());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
   }
 
   void appendOutlineAttributes(popart::OpSerialiserBase &os) const override {
     Op::appendOutlineAttributes(os);
     os.appendAttribute("alpha", getAlpha());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
   }
 
+  // Compact spikes carry no gradient
   std::vector<std::unique_ptr<popart::Op>> getGradOps() {
     std::vector<std::unique_ptr<Op>> upops;
+    if (neuron_step::compactSpikes(getSpikeDtype())) {
+      return upops;
+    }
     upops.emplace_back(new StraightThroughEstimatorGradOp(*this));
     return upops;
   }
@@ -90,22 +136,105 @@ public:
 
   bool requiresRandomSeed() const override { return false; }
 
+  // The spikes may overwrite the input, unless they are compact
+  std::vector<std::tuple<popart::OperatorIdentifier, float>>
+  inplacePriorityDefault() const override {
+    if (neuron_step::compactSpikes(getSpikeDtype())) {
+      return {};
+    }
+    return {{CustomOperators::StraightThroughEstimatorInplaceId, 10}};
+  }
+
+  // Implementation defined below
+  std::unique_ptr<popart::Op>
+  getInplaceVariant(const popart::OperatorIdentifier &id) const override;
+
   // Attributes
   float getAlpha() const { return alpha; }
+  const std::string &getSpikeDtype() const { return spikeDtype; }
 
 private:
   float alpha;
+  std::string spikeDtype = "input";
+};
+
+// Writes the spikes over the input, which output 0 then aliases
+class StraightThroughEstimatorInplaceOp : public StraightThroughEstimatorOp {
+public:
+  StraightThroughEstimatorInplaceOp(const StraightThroughEstimatorOp &op)
+      : StraightThroughEstimatorOp(
+            CustomOperators::StraightThroughEstimatorInplaceId, op.getAlpha(),
+            op.getSpikeDtype(), op.settings) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<StraightThroughEstimatorInplaceOp>(*this);
+  }
+
+  popart::view::Regions aliases(popart::InIndex in,
+                                popart::OutIndex out) const final {
+    if (in == 0 && out == 0) {
+      return {popart::view::Region::getFull(inShape(0))};
+    }
+    return Op::aliases(in, out);
+  }
+
+  popart::view::Regions modifies(popart::InIndex in) const final {
+    return aliases(in, 0);
+  }
 };
 
+std::unique_ptr<popart::Op> StraightThroughEstimatorOp::getInplaceVariant(
+    const popart::OperatorIdentifier &id) const {
+  if (id == CustomOperators::StraightThroughEstimatorInplaceId) {
+    return std::make_unique<StraightThroughEstimatorInplaceOp>(*this);
+  }
+  return Op::getInplaceVariant(id);
+}
+
+// Output 0 is the incoming gradient itself: an alias that modifies nothing,
+// so the identity costs neither a copy nor a tensor
+class StraightThroughEstimatorGradInplaceOp
+    : public StraightThroughEstimatorGradOp {
+public:
+  StraightThroughEstimatorGradInplaceOp(
+      const StraightThroughEstimatorGradOp &op)
+      : StraightThroughEstimatorGradOp(
+            CustomGradOperators::StraightThroughEstimatorGradInplaceId, op) {}
+
+  std::unique_ptr<popart::Op> clone() const final {
+    return std::make_unique<StraightThroughEstimatorGradInplaceOp>(*this);
+  }
+
+  popart::view::Regions aliases(popart::InIndex in,
+                                popart::OutIndex out) const final {
+    if (in == 0 && out == 0) {
+      return {popart::view::Region::getFull(inShape(0))};
+    }
+    return Op::aliases(in, out);
+  }
+
+  bool isInplaceViewChange() const final { return true; }
+};
+
+std::unique_ptr<popart::Op> StraightThroughEstimatorGradOp::getInplaceVariant(
+    const popart::OperatorIdentifier &id) const {
+  if (id == CustomGradOperators::StraightThroughEstimatorGradInplaceId) {
+    return std::make_unique<StraightThroughEstimatorGradInplaceOp>(*this);
+  }
+  return Op::getInplaceVariant(id);
+}
+
 namespace {
 using popart::OpDefinition;
 using popart::DataType;
 
 static OpDefinition::DataTypes T = {DataType::FLOAT16, DataType::FLOAT};
+static OpDefinition::DataTypes Spikes = {DataType::FLOAT16, DataType::FLOAT,
+                                         DataType::BOOL, DataType::UINT8};
 
 static OpDefinition
-      StraightThroughEstimatorOpDef({OpDefinition::Inputs({{"input", T}}),
-                      OpDefinition::Outputs({{"output", T}}),
+      StraightThroughEstimatorOpDef({OpDefinition::Inputs({{"input", T}, {"threshold", T}}),
+                      OpDefinition::Outputs({{"output", Spikes}, {"reset", T}}),
                       OpDefinition::Attributes()});
 
 static popart::OpCreator<StraightThroughEstimatorOp> StraightThroughEstimatorOpCreator(
@@ -114,7 +243,15 @@ static popart::OpCreator<StraightThroughEstimatorOp> StraightThroughEstimatorOpC
         // default alpha is 10**(-2)
         float alpha = info.attributes.getAttribute<popart::Attributes::Float>(
             "alpha", 1e-2f);
-        return std::make_unique<StraightThroughEstimatorOp>(info.opid, alpha, info.settings);
+        // spike_dtype = "bool" / "uint8" emits one-byte spikes
+        std::string spikeDtype = neuron_step::spikeDtypeAttribute(
+            "StraightThroughEstimator", info.attributes);
+        int64_t recompute =
+            info.attributes.getAttribute<popart::Attributes::Int>("recompute",
+                                                                  0);
+        return std::make_unique<StraightThroughEstimatorOp>(
+            info.opid, alpha, spikeDtype,
+            neuron_step::recomputeSettings(info.settings, recompute));
         return std::make_unique<StraightThroughEstimatorOp>(info.opid, info.settings);
       },
       true);
@@ -127,7 +264,8 @@ public:
   StraightThroughEstimatorOpx(popart::Op *op, popart::popx::Devicex *devicex)
       : popart::popx::Opx(op, devicex) {
     verifyOp<StraightThroughEstimatorOp>(
-        op, {CustomOperators::StraightThroughEstimatorId});
+        op, {CustomOperators::StraightThroughEstimatorId,
+             CustomOperators::StraightThroughEstimatorInplaceId});
   }
 
   void grow(poplar::program::Sequence &prog) const final {
@@ -139,14 +277,46 @@ public:
     float alpha = op.getAlpha();
 
     // x > 0.0f ? 1:0
-    auto expression = pe::Select(pe::Const(1.0f), pe::Const(0.0f),
-                                 pe::Gt(pe::_1, pe::Const(0.0f)));
-
-
-    popops::mapInPlace(graph(), expression, {input}, prog,
-                       debugContext("StraightThroughEstimator"), poplar::OptionFlags());
-
-    setOutTensor(0, input);
+    std::vector<poplar::Tensor> ins = {input};
+    std::unique_ptr<pe::Expr> expression =
+        pe::Select(pe::Const(1.0f), pe::Const(0.0f),
+                   pe::Gt(pe::_1, pe::Const(0.0f)))
+            .clone();
+    if (hasInput(1)) {
+      // Compare against the threshold inside the map, so that
+      // mem - threshold is never materialised
+      ins.push_back(neuron_step::broadcastParam(
+          graph(), getInTensor(1), input.elementType(), input.shape(), prog,
+          debugContext("threshold")));
+      expression =
+          pe::Select(pe::Const(1.0f), pe::Const(0.0f), pe::Gt(pe::_1, pe::_2))
+              .clone();
+    }
+
+    // The inplace variant writes the spikes over the input
+    poplar::Tensor output = input;
+    if (op.opid == CustomOperators::StraightThroughEstimatorInplaceId) {
+      popops::mapInPlace(graph(), *expression, ins, prog,
+                         debugContext("StraightThroughEstimator"),
+                         poplar::OptionFlags());
+    } else {
+      output = popops::map(graph(), *expression, ins, prog,
+                           debugContext("StraightThroughEstimator"),
+                           poplar::OptionFlags());
+    }
+
+    // The reset takes the same value as the spike, but is a separate tensor
+    // that the grad op never reads, so it carries no gradient.
+    if (hasOutput(1)) {
+      auto reset = graph().clone(output, debugContext("StraightThroughEstimatorReset"));
+      prog.add(poplar::program::Copy(output, reset, false,
+                                     debugContext("StraightThroughEstimatorReset")));
+      setOutTensor(1, reset);
+    }
+
+    setOutTensor(0, neuron_step::castSpikes(
+                        graph(), output, op.getSpikeDtype(), prog,
+                        debugContext("StraightThroughEstimatorSpikes")));
   }
 };
 
@@ -154,7 +324,9 @@ class StraightThroughEstimatorGradOpx : public popart::popx::Opx {
 public:
   StraightThroughEstimatorGradOpx(popart::Op *op, popart::popx::Devicex *devicex)
       : popart::popx::Opx(op, devicex) {
-    verifyOp<StraightThroughEstimatorGradOp>(op, {CustomGradOperators::StraightThroughEstimatorGradId});
+    verifyOp<StraightThroughEstimatorGradOp>(
+        op, {CustomGradOperators::StraightThroughEstimatorGradId,
+             CustomGradOperators::StraightThroughEstimatorGradInplaceId});
   }
 
   void grow(poplar::program::Sequence &prog) const final {
@@ -162,36 +334,61 @@ public:
     auto op = getOp<StraightThroughEstimatorGradOp>();
 
     poplar::Tensor grad = getInTensor(0);
-    poplar::Tensor input = getInTensor(1);
 
     float alpha = op.getAlpha();
 
-    // (grad * (x < 0.0f ? alpha : 1))
-    auto expression = pe::_1;
-
-    auto output =
-        popops::map(graph(), expression, {grad, input}, prog,
-                    debugContext("StraightThroughEstimatorGrad"), poplar::OptionFlags());
+    // The gradient passes straight through, so the forward input is never
+    // saved for the backward pass. The inplace variant hands the incoming
+    // gradient on as is, the outplace one copies it.
+    const bool inplace =
+        op.opid == CustomGradOperators::StraightThroughEstimatorGradInplaceId;
+    poplar::Tensor output = grad;
+    if (!inplace) {
+      output = graph().clone(grad, debugContext("StraightThroughEstimatorGrad"));
+      prog.add(poplar::program::Copy(
+          grad, output, false, debugContext("StraightThroughEstimatorGrad")));
+    }
 
     setOutTensor(0, output);
+
+    // d(mem - threshold)/dthreshold = -1
+    if (op.getHasThreshold()) {
+      poplar::Tensor threshold = getInTensor(1);
+      auto gradThreshold = neuron_step::reduceToShape(
+          graph(), output, threshold.shape(), threshold.elementType(), prog,
+          debugContext("StraightThroughEstimatorGradThresholdReduce"));
+      gradThreshold = popops::map(graph(), pe::Neg(pe::_1), {gradThreshold},
+                                  prog, debugContext("StraightThroughEstimatorGradThreshold"));
+      setOutTensor(1, gradThreshold);
+    }
   }
 };
 
 StraightThroughEstimatorGradOp::StraightThroughEstimatorGradOp(const StraightThroughEstimatorOp &fwdOp)
     : popart::Op(CustomGradOperators::StraightThroughEstimatorGradId, fwdOp.settings),
-      alpha(fwdOp.getAlpha()) {}
+      alpha(fwdOp.getAlpha()), hasThreshold(fwdOp.input->hasIndex(1)) {
+  if (hasThreshold) {
+    thresholdInfo = fwdOp.inInfo(1);
+  }
+}
 
 const std::vector<popart::GradInOutMapper> &
 StraightThroughEstimatorGradOp::gradInputInfo() const {
+  // Only the threshold is read, for the shape of its gradient
   static const std::vector<popart::GradInOutMapper> inInfo = {
-      {0, 0, popart::GradOpInType::GradOut}, {1, 0, popart::GradOpInType::In}};
-  return inInfo;
+      {0, 0, popart::GradOpInType::GradOut}};
+  static const std::vector<popart::GradInOutMapper> inInfoWithThreshold = {
+      {0, 0, popart::GradOpInType::GradOut},
+      {1, 1, popart::GradOpInType::In}};
+  return hasThreshold ? inInfoWithThreshold : inInfo;
 }
 
-// The Grad Op has 1 output, which is the gradient of the only input
+// The Grad Op has 1 output per forward input: the gradient of the input
+// and, when the threshold is passed in, of the threshold
 const std::map<int, int> &StraightThroughEstimatorGradOp::gradOutToNonGradIn() const {
   static const std::map<int, int> outInfo = {{0, 0}};
-  return outInfo;
+  static const std::map<int, int> outInfoWithThreshold = {{0, 0}, {1, 1}};
+  return hasThreshold ? outInfoWithThreshold : outInfo;
 }
 
 void StraightThroughEstimatorGradOp::appendAttributes(popart::OpSerialiserBase &os) const {
@@ -206,6 +403,9 @@ void StraightThroughEstimatorGradOp::appendOutlineAttributes(
 }
 
 static popart::popx::OpxCreator<StraightThroughEstimatorOpx> StraightThroughEstimatorOpxCreator(
-    {CustomOperators::StraightThroughEstimatorId});
+    {CustomOperators::StraightThroughEstimatorId,
+     CustomOperators::StraightThroughEstimatorInplaceId});
 static popart::popx::OpxCreator<StraightThroughEstimatorGradOpx>
-    StraightThroughEstimatorGradOpxCreator({CustomGradOperators::StraightThroughEstimatorGradId});
+    StraightThroughEstimatorGradOpxCreator(
+        {CustomGradOperators::StraightThroughEstimatorGradId,
+         CustomGradOperators::StraightThroughEstimatorGradInplaceId});
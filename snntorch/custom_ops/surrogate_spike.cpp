@@ -0,0 +1,300 @@
+// Heaviside spike with a selectable surrogate gradient.
+//
+// Takes (input, [threshold]) and returns (spk, [reset]), where
+//
+//   spk   = input >= threshold                  (threshold defaults to 0)
+//   reset = spk, detached
+//
+// and the backward pass is grad * dS/dU at u = input - threshold, with dS/dU
+// chosen by `surrogate` ("fast_sigmoid", "sigmoid", "atan", "triangular" or
+// "spike_rate_escape", as well as "heaviside" and
+// "straight_through_estimator"). `slope` and `beta` are op attributes, so
+// they are constants of the compiled expression; see
+// neuron_step::surrogateGrad for the formulas.
+#include <popart/opmanager.hpp>
+#include <popart/opserialiser.hpp>
+#include <popart/popx/opx.hpp>
+#include <popart/popx/opxmanager.hpp>
+
+#include <popops/ElementWise.hpp>
+
+#include "neuron_step.hpp"
+#include "spike_codelets.hpp"
+
+namespace CustomOperators {
+const popart::OperatorIdentifier SurrogateSpikeId = {"custom.ops",
+                                                     "SurrogateSpike", 1};
+} // namespace CustomOperators
+namespace CustomGradOperators {
+const popart::OperatorIdentifier SurrogateSpikeGradId = {
+    "custom.ops", "SurrogateSpikeGrad", 1};
+} // namespace CustomGradOperators
+
+class SurrogateSpikeOp;
+class SurrogateSpikeOpx;
+class SurrogateSpikeGradOpx;
+
+class SurrogateSpikeGradOp : public popart::Op {
+public:
+  SurrogateSpikeGradOp(const SurrogateSpikeOp &fwdOp);
+
+  std::unique_ptr<popart::Op> clone() const final {
+    return std::make_unique<SurrogateSpikeGradOp>(*this);
+  }
+  void setup() final {
+    outInfo(0) = inInfo(0);
+    if (hasThreshold) {
+      outInfo(1) = thresholdInfo;
+    }
+  };
+
+  const std::vector<popart::GradInOutMapper> &gradInputInfo() const;
+
+  // The Grad Op has 1 output per forward input: the gradient of the input
+  // and, when the threshold is passed in, of the threshold
+  const std::map<int, int> &gradOutToNonGradIn() const;
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // an estimate of how valuable sub-graph matching will be
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+  bool getHasThreshold() const { return hasThreshold; }
+
+  // Implementation defined below
+  void appendAttributes(popart::OpSerialiserBase &os) const override;
+
+  // Implementation defined below
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override;
+
+private:
+  neuron_step::Surrogate surrogate;
+  bool hasThreshold;
+  popart::TensorInfo thresholdInfo;
+};
+
+class SurrogateSpikeOp : public popart::Op {
+public:
+  SurrogateSpikeOp(const popart::OperatorIdentifier &_opid,
+                   const neuron_step::Surrogate &_surrogate,
+                   const std::string &_spikeDtype,
+                   const popart::Op::Settings &settings_)
+      : popart::Op(_opid, settings_), surrogate(_surrogate),
+        spikeDtype(_spikeDtype) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<SurrogateSpikeOp>(*this);
+  }
+
+  // The optional second output is the detached reset mask. spike_dtype =
+  // "bool" / "uint8" emits the spikes at one byte each.
+  void setup() final {
+    outInfo(0) = neuron_step::spikeInfo(inInfo(0), getSpikeDtype());
+    if (output->hasIndex(1)) {
+      outInfo(1) = inInfo(0);
+    }
+  }
+
+  void appendAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendAttributes(os);
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendOutlineAttributes(os);
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  // Compact spikes carry no gradient
+  std::vector<std::unique_ptr<popart::Op>> getGradOps() {
+    std::vector<std::unique_ptr<Op>> upops;
+    if (neuron_step::compactSpikes(getSpikeDtype())) {
+      return upops;
+    }
+    upops.emplace_back(new SurrogateSpikeGradOp(*this));
+    return upops;
+  }
+
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // Attributes
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+  const std::string &getSpikeDtype() const { return spikeDtype; }
+
+private:
+  neuron_step::Surrogate surrogate;
+  std::string spikeDtype;
+};
+
+namespace {
+using popart::DataType;
+using popart::OpDefinition;
+
+static OpDefinition::DataTypes T = {DataType::FLOAT16, DataType::FLOAT};
+static OpDefinition::DataTypes Spikes = {DataType::FLOAT16, DataType::FLOAT,
+                                         DataType::BOOL, DataType::UINT8};
+
+static OpDefinition SurrogateSpikeOpDef(
+    {OpDefinition::Inputs({{"input", T}, {"threshold", T}}),
+     OpDefinition::Outputs({{"output", Spikes}, {"reset", T}}),
+     OpDefinition::Attributes({{"surrogate", {"*"}},
+                               {"slope", {"*"}},
+                               {"beta", {"*"}},
+                               {"spike_dtype", {"*"}}})});
+
+static popart::OpCreator<SurrogateSpikeOp> SurrogateSpikeOpCreator(
+    popart::OpDefinitions({{CustomOperators::SurrogateSpikeId,
+                            SurrogateSpikeOpDef}}),
+    [](const popart::OpCreatorInfo &info) {
+      neuron_step::Surrogate surrogate = neuron_step::surrogateAttributes(
+          "SurrogateSpike", info.attributes, "fast_sigmoid");
+      std::string spikeDtype = neuron_step::spikeDtypeAttribute(
+          "SurrogateSpike", info.attributes);
+      return std::make_unique<SurrogateSpikeOp>(info.opid, surrogate,
+                                                spikeDtype, info.settings);
+    },
+    true);
+} // namespace
+
+namespace pe = popops::expr;
+namespace ns = neuron_step;
+
+class SurrogateSpikeOpx : public popart::popx::Opx {
+public:
+  SurrogateSpikeOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<SurrogateSpikeOp>(op, {CustomOperators::SurrogateSpikeId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+    auto op = getOp<SurrogateSpikeOp>();
+
+    poplar::Tensor input = getInTensor(0);
+
+    poplar::Tensor output;
+    if (spike_codelets::addCodelets(graph())) {
+      // Vectorised vertices, see codelets/spike_codelets.cpp
+      poplar::Tensor threshold = spike_codelets::thresholdOrZero(
+          graph(), hasInput(1), hasInput(1) ? getInTensor(1) : input, input,
+          prog, debugContext("threshold"));
+      output = spike_codelets::spike(graph(), input, threshold, prog,
+                                     debugContext("SurrogateSpike"));
+    } else if (hasInput(1)) {
+      poplar::Tensor threshold = ns::broadcastParam(
+          graph(), getInTensor(1), input.elementType(), input.shape(), prog,
+          debugContext("threshold"));
+      output = popops::map(graph(), ns::spike(pe::_1, pe::_2),
+                           {input, threshold}, prog,
+                           debugContext("SurrogateSpike"));
+    } else {
+      output = popops::map(graph(), ns::spike(pe::_1, pe::Const(0.0f)),
+                           {input}, prog, debugContext("SurrogateSpike"));
+    }
+
+    // The reset takes the same value as the spike, but is a separate tensor
+    // that the grad op never reads, so it carries no gradient.
+    if (hasOutput(1)) {
+      auto reset = graph().clone(output, debugContext("SurrogateSpikeReset"));
+      prog.add(poplar::program::Copy(output, reset, false,
+                                     debugContext("SurrogateSpikeReset")));
+      setOutTensor(1, reset);
+    }
+
+    setOutTensor(0, ns::castSpikes(graph(), output, op.getSpikeDtype(), prog,
+                                   debugContext("SurrogateSpikeSpikes")));
+  }
+};
+
+class SurrogateSpikeGradOpx : public popart::popx::Opx {
+public:
+  SurrogateSpikeGradOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<SurrogateSpikeGradOp>(
+        op, {CustomGradOperators::SurrogateSpikeGradId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+    auto op = getOp<SurrogateSpikeGradOp>();
+
+    poplar::Tensor grad = getInTensor(0);
+    poplar::Tensor input = getInTensor(1);
+
+    // grad * dS/dU, with u = input - threshold evaluated inside the map
+    std::vector<poplar::Tensor> ins = {grad, input};
+    std::unique_ptr<pe::Expr> u = pe::_2.clone();
+    if (op.getHasThreshold()) {
+      ins.push_back(ns::broadcastParam(graph(), getInTensor(2),
+                                       input.elementType(), input.shape(),
+                                       prog, debugContext("threshold")));
+      u = pe::Sub(pe::_2, pe::_3).clone();
+    }
+    auto surrogate = ns::surrogateGrad(op.getSurrogate(), *u);
+    poplar::Tensor output =
+        popops::map(graph(), pe::Mul(pe::_1, *surrogate), ins, prog,
+                    debugContext("SurrogateSpikeGrad"));
+
+    setOutTensor(0, output);
+
+    // d(input - threshold)/dthreshold = -1
+    if (op.getHasThreshold()) {
+      poplar::Tensor threshold = getInTensor(2);
+      auto gradThreshold = ns::reduceToShape(
+          graph(), output, threshold.shape(), threshold.elementType(), prog,
+          debugContext("SurrogateSpikeGradThresholdReduce"));
+      popops::mapInPlace(graph(), pe::Neg(pe::_1), {gradThreshold}, prog,
+                         debugContext("SurrogateSpikeGradThreshold"));
+      setOutTensor(1, gradThreshold);
+    }
+  }
+};
+
+SurrogateSpikeGradOp::SurrogateSpikeGradOp(const SurrogateSpikeOp &fwdOp)
+    : popart::Op(CustomGradOperators::SurrogateSpikeGradId, fwdOp.settings),
+      surrogate(fwdOp.getSurrogate()),
+      hasThreshold(fwdOp.input->hasIndex(1)) {
+  if (hasThreshold) {
+    thresholdInfo = fwdOp.inInfo(1);
+  }
+}
+
+const std::vector<popart::GradInOutMapper> &
+SurrogateSpikeGradOp::gradInputInfo() const {
+  static const std::vector<popart::GradInOutMapper> inInfo = {
+      {0, 0, popart::GradOpInType::GradOut}, {1, 0, popart::GradOpInType::In}};
+  static const std::vector<popart::GradInOutMapper> inInfoWithThreshold = {
+      {0, 0, popart::GradOpInType::GradOut},
+      {1, 0, popart::GradOpInType::In},
+      {2, 1, popart::GradOpInType::In}};
+  return hasThreshold ? inInfoWithThreshold : inInfo;
+}
+
+// The Grad Op has 1 output per forward input: the gradient of the input
+// and, when the threshold is passed in, of the threshold
+const std::map<int, int> &SurrogateSpikeGradOp::gradOutToNonGradIn() const {
+  static const std::map<int, int> outInfo = {{0, 0}};
+  static const std::map<int, int> outInfoWithThreshold = {{0, 0}, {1, 1}};
+  return hasThreshold ? outInfoWithThreshold : outInfo;
+}
+
+void SurrogateSpikeGradOp::appendAttributes(
+    popart::OpSerialiserBase &os) const {
+  Op::appendAttributes(os);
+  ns::appendSurrogate(os, getSurrogate());
+}
+
+void SurrogateSpikeGradOp::appendOutlineAttributes(
+    popart::OpSerialiserBase &os) const {
+  Op::appendOutlineAttributes(os);
+  ns::appendSurrogate(os, getSurrogate());
+}
+
+static popart::popx::OpxCreator<SurrogateSpikeOpx>
+    SurrogateSpikeOpxCreator({CustomOperators::SurrogateSpikeId});
+static popart::popx::OpxCreator<SurrogateSpikeGradOpx>
+    SurrogateSpikeGradOpxCreator(
+        {CustomGradOperators::SurrogateSpikeGradId});
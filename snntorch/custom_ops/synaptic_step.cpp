@@ -0,0 +1,403 @@
+// Fused single-timestep Synaptic (2nd order) integrate-and-fire neuron.
+//
+// Takes (input, syn, mem, alpha, beta, threshold) and returns
+// (spk, syn_next, mem_next), where
+//
+//   reset    = mem >= threshold                          (detached)
+//   syn_next = clamp(alpha, 0, 1) * syn + input
+//   mem_next = clamp(beta, 0, 1) * mem + syn_next - reset * threshold
+//   spk      = mem_next >= threshold
+//
+// for the default reset-by-subtraction. Reset-to-zero zeroes mem_next and
+// leaves syn_next untouched. `reset_mechanism` follows
+// `SpikingNeuron.reset_dict` (0: subtract, 1: zero, 2: none) and `surrogate`
+// selects the gradient used for dS/dU in the backward pass.
+// `spike_dtype` = "bool" / "uint8" emits spk at one byte per neuron while
+// the states keep the type of the input; the op then has no grad op.
+#include <popart/opmanager.hpp>
+#include <popart/opserialiser.hpp>
+#include <popart/popx/opx.hpp>
+#include <popart/popx/opxmanager.hpp>
+
+#include <popops/ElementWise.hpp>
+
+#include "neuron_step.hpp"
+
+namespace CustomOperators {
+const popart::OperatorIdentifier SynapticStepId = {"custom.ops",
+                                                   "SynapticStep", 1};
+} // namespace CustomOperators
+namespace CustomGradOperators {
+const popart::OperatorIdentifier SynapticStepGradId = {"custom.ops",
+                                                       "SynapticStepGrad", 1};
+} // namespace CustomGradOperators
+
+class SynapticStepOp;
+class SynapticStepOpx;
+class SynapticStepGradOpx;
+
+class SynapticStepGradOp : public popart::Op {
+public:
+  SynapticStepGradOp(const SynapticStepOp &fwdOp);
+
+  std::unique_ptr<popart::Op> clone() const final {
+    return std::make_unique<SynapticStepGradOp>(*this);
+  }
+
+  // One gradient per forward input: input, syn, mem, alpha, beta, threshold
+  void setup() final {
+    for (int i = 0; i < static_cast<int>(fwdInInfo.size()); ++i) {
+      outInfo(i) = fwdInInfo[i];
+    }
+  };
+
+  const std::vector<popart::GradInOutMapper> &gradInputInfo() const;
+
+  const std::map<int, int> &gradOutToNonGradIn() const;
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // an estimate of how valuable sub-graph matching will be
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  int64_t getResetMechanism() const { return resetMechanism; }
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+
+  // Implementation defined below
+  void appendAttributes(popart::OpSerialiserBase &os) const override;
+
+  // Implementation defined below
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override;
+
+private:
+  int64_t resetMechanism;
+  neuron_step::Surrogate surrogate;
+  std::vector<popart::TensorInfo> fwdInInfo;
+};
+
+class SynapticStepOp : public popart::Op {
+public:
+  SynapticStepOp(const popart::OperatorIdentifier &_opid,
+                 int64_t _resetMechanism,
+                 const neuron_step::Surrogate &_surrogate,
+                 const std::string &_spikeDtype,
+                 const popart::Op::Settings &settings_)
+      : popart::Op(_opid, settings_), resetMechanism(_resetMechanism),
+        surrogate(_surrogate), spikeDtype(_spikeDtype) {}
+
+  std::unique_ptr<Op> clone() const final {
+    return std::make_unique<SynapticStepOp>(*this);
+  }
+
+  // spk, syn_next and mem_next all take the shape and type of the input,
+  // unless spk is emitted as a compact spike_dtype
+  void setup() final {
+    outInfo(0) = neuron_step::spikeInfo(inInfo(0), getSpikeDtype());
+    outInfo(1) = inInfo(0);
+    outInfo(2) = inInfo(0);
+  }
+
+  void appendAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendAttributes(os);
+    os.appendAttribute("reset_mechanism", getResetMechanism());
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  void appendOutlineAttributes(popart::OpSerialiserBase &os) const override {
+    Op::appendOutlineAttributes(os);
+    os.appendAttribute("reset_mechanism", getResetMechanism());
+    neuron_step::appendSurrogate(os, getSurrogate());
+    os.appendAttribute("spike_dtype", getSpikeDtype());
+  }
+
+  // Compact spikes carry no gradient
+  std::vector<std::unique_ptr<popart::Op>> getGradOps() {
+    std::vector<std::unique_ptr<Op>> upops;
+    if (neuron_step::compactSpikes(getSpikeDtype())) {
+      return upops;
+    }
+    upops.emplace_back(new SynapticStepGradOp(*this));
+    return upops;
+  }
+
+  float getSubgraphValue() const final { return getHighSubgraphValue(); }
+
+  bool requiresRandomSeed() const override { return false; }
+
+  // Attributes
+  int64_t getResetMechanism() const { return resetMechanism; }
+  const neuron_step::Surrogate &getSurrogate() const { return surrogate; }
+  const std::string &getSpikeDtype() const { return spikeDtype; }
+
+private:
+  int64_t resetMechanism;
+  neuron_step::Surrogate surrogate;
+  std::string spikeDtype;
+};
+
+namespace {
+using popart::DataType;
+using popart::OpDefinition;
+
+static OpDefinition::DataTypes T = {DataType::FLOAT16, DataType::FLOAT};
+static OpDefinition::DataTypes Spikes = {DataType::FLOAT16, DataType::FLOAT,
+                                         DataType::BOOL, DataType::UINT8};
+
+static OpDefinition SynapticStepOpDef(
+    {OpDefinition::Inputs({{"input", T},
+                           {"syn", T},
+                           {"mem", T},
+                           {"alpha", T},
+                           {"beta", T},
+                           {"threshold", T}}),
+     OpDefinition::Outputs(
+         {{"spk", Spikes}, {"syn_next", T}, {"mem_next", T}}),
+     OpDefinition::Attributes(
+         {{"reset_mechanism", {"*"}},
+          {"surrogate", {"*"}},
+          {"slope", {"*"}},
+          {"beta", {"*"}},
+          {"spike_dtype", {"*"}}})});
+
+static popart::OpCreator<SynapticStepOp> SynapticStepOpCreator(
+    popart::OpDefinitions(
+        {{CustomOperators::SynapticStepId, SynapticStepOpDef}}),
+    [](const popart::OpCreatorInfo &info) {
+      // default reset mechanism is subtraction, see SpikingNeuron.reset_dict
+      int64_t resetMechanism =
+          info.attributes.getAttribute<popart::Attributes::Int>(
+              "reset_mechanism", 0);
+      neuron_step::checkResetMechanism("SynapticStep", resetMechanism);
+      neuron_step::Surrogate surrogate = neuron_step::surrogateAttributes(
+          "SynapticStep", info.attributes, "fast_sigmoid");
+      std::string spikeDtype =
+          neuron_step::spikeDtypeAttribute("SynapticStep", info.attributes);
+      return std::make_unique<SynapticStepOp>(info.opid, resetMechanism,
+                                              surrogate, spikeDtype,
+                                              info.settings);
+    },
+    true);
+} // namespace
+
+namespace pe = popops::expr;
+namespace ns = neuron_step;
+
+class SynapticStepOpx : public popart::popx::Opx {
+public:
+  SynapticStepOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<SynapticStepOp>(op, {CustomOperators::SynapticStepId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+
+    auto op = getOp<SynapticStepOp>();
+
+    poplar::Tensor input = getInTensor(0);
+    poplar::Tensor syn = getInTensor(1);
+    poplar::Tensor mem = getInTensor(2);
+    auto type = input.elementType();
+    auto shape = input.shape();
+    poplar::Tensor alpha = ns::broadcastParam(
+        graph(), getInTensor(3), type, shape, prog, debugContext("alpha"));
+    poplar::Tensor beta = ns::broadcastParam(graph(), getInTensor(4), type,
+                                             shape, prog, debugContext("beta"));
+    poplar::Tensor threshold =
+        ns::broadcastParam(graph(), getInTensor(5), type, shape, prog,
+                           debugContext("threshold"));
+
+    // _1: input, _2: syn, _3: alpha
+    auto synNext = popops::map(
+        graph(), pe::Add(pe::Mul(ns::clampUnit(pe::_3), pe::_2), pe::_1),
+        {input, syn, alpha}, prog, debugContext("SynapticStepSyn"));
+
+    // _1: syn_next, _2: mem, _3: beta, _4: threshold
+    auto memNextExpr = ns::leakyMemNext(op.getResetMechanism(), pe::_1,
+                                        pe::_2, pe::_3, pe::_4);
+    auto memNext =
+        popops::map(graph(), *memNextExpr, {synNext, mem, beta, threshold},
+                    prog, debugContext("SynapticStepMem"));
+
+    auto spkExpr =
+        ns::spikeOutput(ns::spike(pe::_1, pe::_2), op.getSpikeDtype());
+    auto spk = popops::map(graph(), *spkExpr, {memNext, threshold}, prog,
+                           debugContext("SynapticStepSpike"));
+
+    setOutTensor(0, spk);
+    setOutTensor(1, synNext);
+    setOutTensor(2, memNext);
+  }
+};
+
+class SynapticStepGradOpx : public popart::popx::Opx {
+public:
+  SynapticStepGradOpx(popart::Op *op, popart::popx::Devicex *devicex)
+      : popart::popx::Opx(op, devicex) {
+    verifyOp<SynapticStepGradOp>(op, {CustomGradOperators::SynapticStepGradId});
+  }
+
+  void grow(poplar::program::Sequence &prog) const final {
+
+    auto op = getOp<SynapticStepGradOp>();
+
+    poplar::Tensor syn = getInTensor(3);
+    poplar::Tensor mem = getInTensor(4);
+    poplar::Tensor alphaIn = getInTensor(5);
+    poplar::Tensor betaIn = getInTensor(6);
+    poplar::Tensor thresholdIn = getInTensor(7);
+    poplar::Tensor memNext = getInTensor(8);
+    // A loss on the states alone leaves no gradient for spk
+    poplar::Tensor gradSpk =
+        hasInput(0) ? getInTensor(0)
+                    : ns::zerosLike(graph(), memNext, prog,
+                                    debugContext("gradSpk"));
+
+    auto type = gradSpk.elementType();
+    auto shape = gradSpk.shape();
+    poplar::Tensor alpha = ns::broadcastParam(graph(), alphaIn, type, shape,
+                                              prog, debugContext("alpha"));
+    poplar::Tensor beta = ns::broadcastParam(graph(), betaIn, type, shape, prog,
+                                             debugContext("beta"));
+    poplar::Tensor threshold = ns::broadcastParam(
+        graph(), thresholdIn, type, shape, prog, debugContext("threshold"));
+
+    // Gradient reaching mem_next through the spike: gradSpk * dS/dU
+    auto surrogate =
+        ns::surrogateGrad(op.getSurrogate(), pe::Sub(pe::_2, pe::_3));
+    auto gradSpkU =
+        popops::map(graph(), pe::Mul(pe::_1, *surrogate),
+                    {gradSpk, memNext, threshold}, prog,
+                    debugContext("SynapticStepGradSurrogate"));
+
+    // Total gradient w.r.t. mem_next
+    poplar::Tensor gradU = gradSpkU;
+    if (hasInput(2)) {
+      gradU = popops::map(graph(), pe::Add(pe::_1, pe::_2),
+                          {getInTensor(2), gradSpkU}, prog,
+                          debugContext("SynapticStepGradMemNext"));
+    }
+
+    // Gradient through the integration, masked by reset-to-zero
+    poplar::Tensor gradIntegrate = gradU;
+    if (op.getResetMechanism() == ns::Zero) {
+      // _1: gradU, _2: mem, _3: threshold
+      gradIntegrate = popops::map(graph(),
+                                  pe::Select(pe::Const(0.0f), pe::_1,
+                                             pe::Gte(pe::_2, pe::_3)),
+                                  {gradU, mem, threshold}, prog,
+                                  debugContext("SynapticStepGradIntegrate"));
+    }
+
+    // Total gradient w.r.t. syn_next, which is also dL/dinput
+    poplar::Tensor gradSynNext = gradIntegrate;
+    if (hasInput(1)) {
+      gradSynNext = popops::map(graph(), pe::Add(pe::_1, pe::_2),
+                                {getInTensor(1), gradIntegrate}, prog,
+                                debugContext("SynapticStepGradSynNext"));
+    }
+
+    auto gradSyn =
+        popops::map(graph(), pe::Mul(pe::_1, ns::clampUnit(pe::_2)),
+                    {gradSynNext, alpha}, prog,
+                    debugContext("SynapticStepGradSyn"));
+    auto gradMem =
+        popops::map(graph(), pe::Mul(pe::_1, ns::clampUnit(pe::_2)),
+                    {gradIntegrate, beta}, prog,
+                    debugContext("SynapticStepGradMem"));
+
+    auto gradAlpha = popops::map(graph(), pe::Mul(pe::_1, pe::_2),
+                                 {gradSynNext, syn}, prog,
+                                 debugContext("SynapticStepGradAlpha"));
+    gradAlpha = ns::reduceToShape(graph(), gradAlpha, alphaIn.shape(),
+                                  alphaIn.elementType(), prog,
+                                  debugContext("SynapticStepGradAlphaReduce"));
+    ns::maskClampedGrad(graph(), gradAlpha, alphaIn, prog,
+                        debugContext("SynapticStepGradAlphaClamp"));
+
+    auto gradBeta = popops::map(graph(), pe::Mul(pe::_1, pe::_2),
+                                {gradIntegrate, mem}, prog,
+                                debugContext("SynapticStepGradBeta"));
+    gradBeta = ns::reduceToShape(graph(), gradBeta, betaIn.shape(),
+                                 betaIn.elementType(), prog,
+                                 debugContext("SynapticStepGradBetaReduce"));
+    ns::maskClampedGrad(graph(), gradBeta, betaIn, prog,
+                        debugContext("SynapticStepGradBetaClamp"));
+
+    // The spike always sees -threshold; reset-by-subtraction adds -reset
+    std::unique_ptr<pe::Expr> gradThresholdExpr;
+    if (op.getResetMechanism() == ns::Subtract) {
+      // _1: gradSpkU, _2: gradU, _3: mem, _4: threshold
+      gradThresholdExpr =
+          pe::Neg(pe::Add(pe::_1, pe::Select(pe::_2, pe::Const(0.0f),
+                                             pe::Gte(pe::_3, pe::_4))))
+              .clone();
+    } else {
+      gradThresholdExpr = pe::Neg(pe::_1).clone();
+    }
+    auto gradThreshold =
+        popops::map(graph(), *gradThresholdExpr,
+                    {gradSpkU, gradU, mem, threshold}, prog,
+                    debugContext("SynapticStepGradThreshold"));
+    gradThreshold = ns::reduceToShape(
+        graph(), gradThreshold, thresholdIn.shape(),
+        thresholdIn.elementType(), prog,
+        debugContext("SynapticStepGradThresholdReduce"));
+
+    setOutTensor(0, gradSynNext);
+    setOutTensor(1, gradSyn);
+    setOutTensor(2, gradMem);
+    setOutTensor(3, gradAlpha);
+    setOutTensor(4, gradBeta);
+    setOutTensor(5, gradThreshold);
+  }
+};
+
+SynapticStepGradOp::SynapticStepGradOp(const SynapticStepOp &fwdOp)
+    : popart::Op(CustomGradOperators::SynapticStepGradId, fwdOp.settings),
+      resetMechanism(fwdOp.getResetMechanism()),
+      surrogate(fwdOp.getSurrogate()) {
+  for (int i = 0; i < 6; ++i) {
+    fwdInInfo.push_back(fwdOp.inInfo(i));
+  }
+}
+
+const std::vector<popart::GradInOutMapper> &
+SynapticStepGradOp::gradInputInfo() const {
+  static const std::vector<popart::GradInOutMapper> inInfo = {
+      {0, 0, popart::GradOpInType::GradOut},
+      {1, 1, popart::GradOpInType::GradOut},
+      {2, 2, popart::GradOpInType::GradOut},
+      {3, 1, popart::GradOpInType::In},
+      {4, 2, popart::GradOpInType::In},
+      {5, 3, popart::GradOpInType::In},
+      {6, 4, popart::GradOpInType::In},
+      {7, 5, popart::GradOpInType::In},
+      {8, 2, popart::GradOpInType::Out}};
+  return inInfo;
+}
+
+// The Grad Op has 6 outputs, one per forward input
+const std::map<int, int> &SynapticStepGradOp::gradOutToNonGradIn() const {
+  static const std::map<int, int> outInfo = {{0, 0}, {1, 1}, {2, 2},
+                                             {3, 3}, {4, 4}, {5, 5}};
+  return outInfo;
+}
+
+void SynapticStepGradOp::appendAttributes(popart::OpSerialiserBase &os) const {
+  Op::appendAttributes(os);
+  os.appendAttribute("reset_mechanism", getResetMechanism());
+  neuron_step::appendSurrogate(os, getSurrogate());
+}
+
+void SynapticStepGradOp::appendOutlineAttributes(
+    popart::OpSerialiserBase &os) const {
+  Op::appendOutlineAttributes(os);
+  os.appendAttribute("reset_mechanism", getResetMechanism());
+  neuron_step::appendSurrogate(os, getSurrogate());
+}
+
+static popart::popx::OpxCreator<SynapticStepOpx>
+    SynapticStepOpxCreator({CustomOperators::SynapticStepId});
+static popart::popx::OpxCreator<SynapticStepGradOpx>
+    SynapticStepGradOpxCreator({CustomGradOperators::SynapticStepGradId});
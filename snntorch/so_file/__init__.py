@@ -0,0 +1,30 @@
+import ctypes
+import os
+
+# Every custom op, and the FuseSpikeThreshold pattern, is registered by one
+# library, built by `make -C snntorch/custom_ops` and shipped in the wheel
+# next to this file together with the codelets it loads (spike_codelets.gp).
+
+LIBRARY = os.path.join(os.path.dirname(__file__), "libsnntorch_ipu_ops.so")
+
+_library = None
+
+
+def load_custom_ops():
+    """Load the custom op library, registering every op with PopART.
+
+    Only the first call in a process opens the library; later calls return
+    the same handle.
+
+    :return: The loaded library
+    :rtype: ctypes.CDLL
+    """
+    global _library
+    if _library is None:
+        if not os.path.isfile(LIBRARY):
+            raise RuntimeError(
+                "Missing snntorch-ipu custom op library {}; build it with "
+                "`make -C snntorch/custom_ops`".format(LIBRARY)
+            )
+        _library = ctypes.cdll.LoadLibrary(LIBRARY)
+    return _library
@@ -1,4 +1,7 @@
 import torch
+from .so_file import load_custom_ops
+from . import cpu
+import poptorch
 
 dtype = torch.float
 
@@ -13,6 +16,8 @@ def rate(
 
     If data is time-varying, tensor dimensions use time first.
 
+    Inside a poptorch model, time-static data is encoded on the IPU by the `RateEncode` custom op: only ``data`` is sent to the device, and the spikes of every step are drawn there.
+
     Example::
 
         # 100% chance of spike generation
@@ -105,6 +110,11 @@ def rate(
             )
 
     # intended for time-static input data
+    elif not cpu.use_cpu():
+        # inside a poptorch model the spikes are drawn on device, so only
+        # data crosses the host link
+        spike_data = _rate_encode(data, num_steps, gain, offset, first_spike_time)
+
     else:
 
         # Generate a tuple: (num_steps, 1..., 1) where the number of 1's = number of dimensions in the original data.
@@ -145,6 +155,8 @@ def latency(
 
     Assume a LIF neuron model that charges up with time constant tau. Tensor dimensions use time first.
 
+    Inside a poptorch model, the spike train is built on the IPU by the `LatencyEncode` custom op when ``num_steps`` is given and ``interpolate=False``. The checks on the values of ``data`` are then skipped, and spikes past ``num_steps`` are dropped as with ``bypass=True``.
+
     Example::
 
         a = torch.Tensor([0.02, 0.5, 1])
@@ -198,6 +210,21 @@ def latency(
     :rtype: torch.Tensor
     """
 
+    if num_steps and not interpolate and not cpu.use_cpu():
+        return _latency_encode(
+            data,
+            num_steps,
+            threshold=threshold,
+            tau=tau,
+            first_spike_time=first_spike_time,
+            on_target=on_target,
+            off_target=off_target,
+            clip=clip,
+            normalize=normalize,
+            linear=linear,
+            epsilon=epsilon,
+        )
+
     if torch.min(data) < 0 or torch.max(data) > 1:
         raise Exception(
             f"Elements of ``data`` must be between [0, 1], but input is [{torch.min(data)}, {torch.max(data)}]"
@@ -279,6 +306,8 @@ def delta(
     """Generate spike only when the difference between two subsequent time steps meets a threshold.
     Optionally include off_spikes for negative changes.
 
+    Inside a poptorch model, the spikes are computed on the IPU by the `DeltaEncode` custom op.
+
     Example::
 
         a = torch.Tensor([1, 2, 2.9, 3, 3.9])
@@ -309,6 +338,9 @@ def delta(
     :type off_spike: bool, optional
     """
 
+    if not cpu.use_cpu():
+        return _delta_encode(data, threshold, padding, off_spike)
+
     if padding:
         data_offset = torch.cat((data[0].unsqueeze(0), data))[
             :-1
@@ -327,6 +359,81 @@ def delta(
         return on_spk + off_spk
 
 
+def _rate_encode(data, num_steps, gain, offset, first_spike_time):
+    """:mod:`snntorch.spikegen.rate` of time-static data as the on-device
+    `RateEncode` op, seeded by the poptorch random seed."""
+    load_custom_ops()
+    y = poptorch.custom_op(
+            [data],
+            "RateEncode",
+            "custom.ops",
+            1,
+            example_outputs=[
+                torch.zeros((num_steps,) + tuple(data.shape), dtype=data.dtype)
+            ],
+            attributes={
+                "num_steps": int(num_steps),
+                "gain": float(gain),
+                "offset": float(offset),
+                "first_spike_time": int(first_spike_time),
+            },
+    )
+    return y[0]
+
+
+def _latency_encode(data, num_steps, **code):
+    """:mod:`snntorch.spikegen.latency` as the on-device `LatencyEncode` op."""
+    if code["threshold"] <= 0 or code["threshold"] >= 1:
+        raise Exception("Threshold must be between 0 and 1.")
+    if code["tau"] <= 0:
+        raise Exception("``tau`` must be greater than 0.")
+    if code["first_spike_time"] < 0 or code["first_spike_time"] > num_steps - 1:
+        raise Exception(
+            f"first_spike_time ({code['first_spike_time']}) must be equal to or less than num_steps-1 ({num_steps-1})."
+        )
+    load_custom_ops()
+    y = poptorch.custom_op(
+            [data],
+            "LatencyEncode",
+            "custom.ops",
+            1,
+            example_outputs=[
+                torch.zeros((num_steps,) + tuple(data.shape), dtype=data.dtype)
+            ],
+            attributes={
+                "num_steps": int(num_steps),
+                "threshold": float(code["threshold"]),
+                "tau": float(code["tau"]),
+                "first_spike_time": int(code["first_spike_time"]),
+                "linear": int(bool(code["linear"])),
+                "normalize": int(bool(code["normalize"])),
+                "clip": int(bool(code["clip"])),
+                "on_target": float(code["on_target"]),
+                "off_target": float(code["off_target"]),
+                "epsilon": float(code["epsilon"]),
+            },
+    )
+    return y[0]
+
+
+def _delta_encode(data, threshold, padding, off_spike):
+    """:mod:`snntorch.spikegen.delta` as the on-device `DeltaEncode` op."""
+    load_custom_ops()
+    y = poptorch.custom_op(
+            [data],
+            "DeltaEncode",
+            "custom.ops",
+            1,
+            example_outputs=[data],
+            attributes={
+                "threshold": float(threshold),
+                "padding": int(bool(padding)),
+                "off_spike": int(bool(off_spike)),
+            },
+    )
+    return y[0]
+
+
 def rate_conv(data):
     """Convert tensor into Poisson spike trains using the features as the mean of a binomial distribution.
     Values outside the range of [0, 1] are clipped so they can be treated as probabilities.
@@ -0,0 +1,59 @@
+import torch
+import torch.nn as nn
+from .so_file import load_custom_ops
+import poptorch
+
+
+def spike_linear(spk, weight, bias=None):
+    """Event-driven ``spk @ weight.t() + bias`` for 0/1 spikes.
+
+    Only the weight columns of neurons that fired are accumulated, so the
+    cost follows the number of spikes rather than ``in_features``.
+
+    :param spk: Dense 0/1 spikes of shape [..., in_features], bool or
+        uint8 spikes from the ``spike_dtype`` of the fused neuron steps, or
+        spikes packed by :mod:`snntorch.spikepack` of shape
+        [..., ceil(in_features / 32)]. Only float spikes receive a gradient
+    :type spk: torch.Tensor
+
+    :param weight: Weight of shape [out_features, in_features], as in
+        ``nn.Linear``
+    :type weight: torch.Tensor
+
+    :param bias: Bias of shape [out_features], defaults to ``None``
+    :type bias: torch.Tensor, optional
+
+    :return: Output of shape [..., out_features]
+    :rtype: torch.Tensor
+    """
+    shape = tuple(spk.shape[:-1]) + (weight.size(0),)
+    load_custom_ops()
+    y = poptorch.custom_op(
+            [spk, weight.t()],
+            "SpikeLinear",
+            "custom.ops",
+            1,
+            example_outputs=[torch.zeros(shape, dtype=weight.dtype)],
+    )
+    out = y[0]
+    if bias is not None:
+        out = out + bias
+    return out
+
+
+class SpikeLinear(nn.Linear):
+    """Drop-in replacement for ``nn.Linear`` after a spiking layer, see
+    :mod:`snntorch.spikelinear.spike_linear`. Accepts dense or packed
+    spikes.
+
+    Example::
+
+        import snntorch as snn
+        from snntorch.spikelinear import SpikeLinear
+
+        fc2 = SpikeLinear(num_hidden, num_outputs)
+        cur2 = fc2(spk1)
+    """
+
+    def forward(self, spk):
+        return spike_linear(spk, self.weight, self.bias)
@@ -0,0 +1,106 @@
+import torch
+from .so_file import load_custom_ops
+import poptorch
+
+# Bit-packed spikes: the last dimension of a [..., N] spike tensor stored as
+# ceil(N / 32) int32 words, neuron n in bit n % 32 of word n / 32.
+
+
+def num_words(num_neurons):
+    """Number of int32 words holding ``num_neurons`` packed spikes."""
+    return (num_neurons + 31) // 32
+
+
+def _packed_like(data):
+    shape = tuple(data.shape[:-1]) + (num_words(data.shape[-1]),)
+    return torch.zeros(shape, dtype=torch.int32)
+
+
+def pack(spk):
+    """Pack dense 0/1 spikes along their last dimension.
+
+    Example::
+
+        import snntorch.spikepack as spikepack
+
+        # [T, B, N] spike record, 32x smaller than float32
+        spk_packed = spikepack.pack(spk_rec)
+
+    :param spk: Spikes of shape [..., N]
+    :type spk: torch.Tensor
+
+    :return: Packed spikes of shape [..., ceil(N / 32)]
+    :rtype: torch.Tensor of int32
+    """
+    load_custom_ops()
+    y = poptorch.custom_op(
+            [spk],
+            "SpikePack",
+            "custom.ops",
+            1,
+            example_outputs=[_packed_like(spk)],
+    )
+    return y[0]
+
+
+def unpack(spk_packed, num_neurons, dtype=torch.float):
+    """Unpack spikes packed by :mod:`snntorch.spikepack.pack` or
+    :mod:`snntorch.spikepack.fire` back to dense 0/1 values.
+
+    :param spk_packed: Packed spikes of shape [..., ceil(N / 32)]
+    :type spk_packed: torch.Tensor of int32
+
+    :param num_neurons: Number of neurons N per row
+    :type num_neurons: int
+
+    :param dtype: Output type, ``torch.float`` or ``torch.half``, defaults to
+        ``torch.float``
+    :type dtype: torch.dtype, optional
+
+    :return: Spikes of shape [..., N]
+    :rtype: torch.Tensor
+    """
+    if dtype not in (torch.float, torch.half):
+        raise ValueError("unpack: dtype must be torch.float or torch.half.")
+    shape = tuple(spk_packed.shape[:-1]) + (num_neurons,)
+    load_custom_ops()
+    y = poptorch.custom_op(
+            [spk_packed],
+            "SpikeUnpack",
+            "custom.ops",
+            1,
+            example_outputs=[torch.zeros(shape, dtype=dtype)],
+            attributes={
+                "size": num_neurons,
+                # ONNX TensorProto data types
+                "to": 10 if dtype == torch.half else 1,
+            },
+    )
+    return y[0]
+
+
+def fire(mem, threshold=None):
+    """Spike where ``mem >= threshold`` and emit the spikes packed, without
+    materialising them as dense floats. The packed spikes carry no gradient.
+
+    :param mem: Membrane potential of shape [..., N]
+    :type mem: torch.Tensor
+
+    :param threshold: Firing threshold, broadcast against ``mem``. Compares
+        against 0 if ``None``, defaults to ``None``
+    :type threshold: torch.Tensor, optional
+
+    :return: Packed spikes of shape [..., ceil(N / 32)]
+    :rtype: torch.Tensor of int32
+    """
+    inputs = [mem] if threshold is None else [mem, threshold]
+    load_custom_ops()
+    y = poptorch.custom_op(
+            inputs,
+            "Heaviside",
+            "custom.ops",
+            1,
+            example_outputs=[_packed_like(mem)],
+            attributes={"packed": 1},
+    )
+    return y[0]
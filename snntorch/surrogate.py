@@ -1,28 +1,61 @@
 import torch
-import ctypes
-import os
+from .so_file import load_custom_ops
+from . import cpu
 import popart
 import poptorch
 
 # Spike-gradient functions
 
 
-#so_path_sigmoid = "./so_file/sigmoid_custom_ops.so"
-#if not os.path.isfile(so_path_sigmoid):
-#    print("Missing Sigmoid Custom Operation File")
-#    exit(1)
-#ctypes.cdll.LoadLibrary(so_path_sigmoid)
+def _spike_op(op_type, surrogate, slope=None, beta=None):
+    """Build the spike function of a surrogate, running ``op_type`` with the
+    surrogate's attributes. ``with_reset`` also returns the detached reset,
+    and the attributes are kept on the function so that the fused neuron
+    ops (``LeakyStep``, ...) can use the same surrogate."""
+    attributes = {}
+    if op_type == "SurrogateSpike":
+        attributes["surrogate"] = surrogate
+    if slope is not None:
+        attributes["slope"] = float(slope)
+    if beta is not None:
+        attributes["beta"] = float(beta)
+
+    def spike_fn(input_data, run_on_ipu=True):
+        if cpu.use_cpu(run_on_ipu):
+            return cpu.spike(input_data, None, surrogate, slope,
+                             1.0 if beta is None else beta)
+        y = poptorch.custom_op(
+                [input_data],
+                op_type,
+                "custom.ops",
+                1,
+                example_outputs=[input_data],
+                attributes=attributes,
+        )
+        return y[0]
 
+    def spike_fn_with_reset(input_data, run_on_ipu=True, threshold=None):
+        if cpu.use_cpu(run_on_ipu):
+            return cpu.spike(input_data, threshold, surrogate, slope,
+                             1.0 if beta is None else beta, with_reset=True)
+        # input_data is compared against threshold inside the op when given
+        inputs = [input_data] if threshold is None else [input_data, threshold]
+        y = poptorch.custom_op(
+                inputs,
+                op_type,
+                "custom.ops",
+                1,
+                example_outputs=[input_data, input_data],
+                attributes=attributes,
+        )
+        return y[0], y[1]
 
-#def build_and_run_sigmoid(input_data, run_on_ipu=True):
-#    y = poptorch.custom_op(
-#            [input_data],
-#            "Sigmoid",
-#            "custom.ops",
-#            1,
-#            example_outputs=[input_data],
-#    )
-#    return y[0]
+    spike_fn.with_reset = spike_fn_with_reset
+    spike_fn.surrogate = surrogate
+    spike_fn.surrogate_attributes = {
+        k: v for k, v in attributes.items() if k in ("slope", "beta")
+    }
+    return spike_fn
 
 
 class StraightThroughEstimator:
@@ -46,16 +79,11 @@ class StraightThroughEstimator:
 
     """
 
-    cwd = os.path.dirname(__file__)
-    so_path_ste = os.path.join(cwd, "so_file/straight_through_estimator_custom_ops.so")
-    #so_path_ste = "./so_file/straight_through_estimator_custom_ops.so"
-    if not os.path.isfile(so_path_ste):
-        print("Missing Straight Through Estimator Custom Operation file!")
-        print(so_path_ste)
-        exit(1)
-    ctypes.cdll.LoadLibrary(so_path_ste)
+    load_custom_ops()
 
     def build_and_run_ste(input_data, run_on_ipu=True):
+        if cpu.use_cpu(run_on_ipu):
+            return cpu.spike(input_data, surrogate="straight_through_estimator")
         y = poptorch.custom_op(
                 [input_data],
                 "StraightThroughEstimator",
@@ -65,11 +93,105 @@ class StraightThroughEstimator:
         )
         return y[0]
 
+    def build_and_run_ste_with_reset(input_data, run_on_ipu=True, threshold=None):
+        if cpu.use_cpu(run_on_ipu):
+            return cpu.spike(input_data, threshold, "straight_through_estimator", with_reset=True)
+        # input_data is compared against threshold inside the op when given
+        inputs = [input_data] if threshold is None else [input_data, threshold]
+        y = poptorch.custom_op(
+                inputs,
+                "StraightThroughEstimator",
+                "custom.ops",
+                1,
+                example_outputs=[input_data, input_data],
+        )
+        return y[0], y[1]
+
+    build_and_run_ste.with_reset = build_and_run_ste_with_reset
+    build_and_run_ste.surrogate = "straight_through_estimator"
+    build_and_run_ste.surrogate_attributes = {}
+
 def straight_through_estimator():
     """Straight Through Estimator surrogate gradient enclosed with a parameterized slope."""
     return StraightThroughEstimator.build_and_run_ste
 
 
+class Heaviside:
+    """
+    Heaviside step function, used as its own gradient.
+
+    **Forward pass:** Heaviside step function shifted.
+
+        .. math::
+
+            S=\\begin{cases} 1 & \\text{if U ≥ U$_{\\rm thr}$} \\\\
+            0 & \\text{if U < U$_{\\rm thr}$}
+            \\end{cases}
+
+    **Backward pass:** Heaviside step function shifted.
+
+        .. math::
+
+                \\frac{∂S}{∂U}=\\begin{cases} 1 & \\text{if U ≥ U$_{\\rm thr}$} \\\\
+                0 & \\text{if U < U$_{\\rm thr}$}
+                \\end{cases}
+
+    """
+
+    load_custom_ops()
+
+    def build_and_run_heaviside(input_data, run_on_ipu=True):
+        if cpu.use_cpu(run_on_ipu):
+            return cpu.spike(input_data, surrogate="heaviside")
+        y = poptorch.custom_op(
+                [input_data],
+                "Heaviside",
+                "custom.ops",
+                1,
+                example_outputs=[input_data],
+        )
+        return y[0]
+
+    def build_and_run_heaviside_with_reset(input_data, run_on_ipu=True, threshold=None):
+        if cpu.use_cpu(run_on_ipu):
+            return cpu.spike(input_data, threshold, "heaviside", with_reset=True)
+        # input_data is compared against threshold inside the op when given
+        inputs = [input_data] if threshold is None else [input_data, threshold]
+        if input_data.dim() == 0:
+            # a scalar has no last dimension to pack, so keep the input
+            y = poptorch.custom_op(
+                    inputs,
+                    "Heaviside",
+                    "custom.ops",
+                    1,
+                    example_outputs=[input_data, input_data],
+                    attributes={"saved": "input"},
+            )
+            return y[0], y[1]
+        # the backward pass keeps the spikes packed to one bit per neuron
+        # (see snntorch.spikepack) rather than the membrane
+        saved_shape = tuple(input_data.shape[:-1]) + (
+            (input_data.shape[-1] + 31) // 32,)
+        y = poptorch.custom_op(
+                inputs,
+                "Heaviside",
+                "custom.ops",
+                1,
+                example_outputs=[input_data, input_data,
+                                 torch.zeros(saved_shape, dtype=torch.int32)],
+                attributes={"saved": "compact"},
+        )
+        return y[0], y[1]
+
+    build_and_run_heaviside.with_reset = build_and_run_heaviside_with_reset
+    build_and_run_heaviside.surrogate = "heaviside"
+    build_and_run_heaviside.surrogate_attributes = {}
+
+def heaviside():
+    """Heaviside surrogate gradient."""
+    return Heaviside.build_and_run_heaviside
+
+
 class FastSigmoid:
     """
     Surrogate gradient of the Heaviside step function.
@@ -95,25 +217,160 @@ class FastSigmoid:
 
     *F. Zenke, S. Ganguli (2018) SuperSpike: Supervised Learning in Multilayer Spiking Neural Networks. Neural Computation, pp. 1514-1541.*"""
 
-    cwd = os.path.dirname(__file__)
-    so_path_fast_sigmoid = os.path.join(cwd, "so_file/fast_sigmoid_custom_ops.so")
-    #so_path_fast_sigmoid = "./so_file/fast_sigmoid_custom_ops.so"
-    if not os.path.isfile(so_path_fast_sigmoid):
-        print("Missing Fast Sigmoid  Custom Operation File")
-        exit(1)
-    ctypes.cdll.LoadLibrary(so_path_fast_sigmoid)
+    load_custom_ops()
 
 
     def build_and_run_fast_sigmoid(input_data, run_on_ipu=True):
+        if cpu.use_cpu(run_on_ipu):
+            return cpu.spike(input_data, surrogate="fast_sigmoid", slope=25)
         y = poptorch.custom_op(
                 [input_data],
                 "FastSigmoid",
                 "custom.ops",
                 1,
                 example_outputs=[input_data],
+                attributes={"slope": 25.0},
         )
         return y[0]
 
-def fast_sigmoid():
-    """FastSigmoid surrogate gradient."""
-    return FastSigmoid.build_and_run_fast_sigmoid
+    def build_and_run_fast_sigmoid_with_reset(input_data, run_on_ipu=True, threshold=None):
+        if cpu.use_cpu(run_on_ipu):
+            return cpu.spike(input_data, threshold, "fast_sigmoid", slope=25,
+                             with_reset=True)
+        # input_data is compared against threshold inside the op when given
+        inputs = [input_data] if threshold is None else [input_data, threshold]
+        y = poptorch.custom_op(
+                inputs,
+                "FastSigmoid",
+                "custom.ops",
+                1,
+                example_outputs=[input_data, input_data],
+                attributes={"slope": 25.0},
+        )
+        return y[0], y[1]
+
+    build_and_run_fast_sigmoid.with_reset = build_and_run_fast_sigmoid_with_reset
+    build_and_run_fast_sigmoid.surrogate = "fast_sigmoid"
+    build_and_run_fast_sigmoid.surrogate_attributes = {"slope": 25.0}
+
+def fast_sigmoid(slope=25):
+    """FastSigmoid surrogate gradient enclosed with a parameterized slope."""
+    return _spike_op("FastSigmoid", "fast_sigmoid", slope=slope)
+
+
+class Sigmoid:
+    """
+    Surrogate gradient of the Heaviside step function.
+
+    **Forward pass:** Heaviside step function shifted.
+
+        .. math::
+
+            S=\\begin{cases} 1 & \\text{if U ≥ U$_{\\rm thr}$} \\\\
+            0 & \\text{if U < U$_{\\rm thr}$}
+            \\end{cases}
+
+    **Backward pass:** Gradient of sigmoid function.
+
+        .. math::
+
+                S&≈\\frac{1}{1 + {\\rm exp}(-kU)} \\\\
+                \\frac{∂S}{∂U}&=\\frac{k{\\rm exp}(-kU)}{[{\\rm exp}(-kU)+1]^2}
+
+    :math:`k` defaults to 25, and can be modified by calling ``surrogate.sigmoid(slope=25)``.
+
+    Adapted from:
+
+    *F. Zenke, S. Ganguli (2018) SuperSpike: Supervised Learning in Multilayer Spiking Neural Networks. Neural Computation, pp. 1514-1541.*"""
+
+
+def sigmoid(slope=25):
+    """Sigmoid surrogate gradient enclosed with a parameterized slope."""
+    return _spike_op("SurrogateSpike", "sigmoid", slope=slope)
+
+
+class ATan:
+    """
+    Surrogate gradient of the Heaviside step function.
+
+    **Forward pass:** Heaviside step function shifted.
+
+        .. math::
+
+            S=\\begin{cases} 1 & \\text{if U ≥ U$_{\\rm thr}$} \\\\
+            0 & \\text{if U < U$_{\\rm thr}$}
+            \\end{cases}
+
+    **Backward pass:** Gradient of shifted arc-tan function.
+
+        .. math::
+
+                S&≈\\frac{1}{π}\\arctan(πU \\frac{α}{2}) \\\\
+                \\frac{∂S}{∂U}&=\\frac{α}{2}\\frac{1}{(1+(πU\\frac{α}{2})^2)}
+
+    :math:`α` defaults to 2, and can be modified by calling ``surrogate.atan(alpha=2)``.
+
+    Adapted from:
+
+    *W. Fang, Z. Yu, Y. Chen, T. Masquelier, T. Huang, Y. Tian (2021) Incorporating Learnable Membrane Time Constants to Enhance Learning of Spiking Neural Networks. Proc. IEEE/CVF Int. Conf. Computer Vision (ICCV), pp. 2661-2671.*"""
+
+
+def atan(alpha=2.0):
+    """ArcTan surrogate gradient enclosed with a parameterized slope."""
+    return _spike_op("SurrogateSpike", "atan", slope=alpha)
+
+
+class Triangular:
+    """
+    Triangular surrogate gradient.
+
+    **Forward pass:** Heaviside step function shifted.
+
+        .. math::
+
+            S=\\begin{cases} 1 & \\text{if U ≥ U$_{\\rm thr}$} \\\\
+            0 & \\text{if U < U$_{\\rm thr}$}
+            \\end{cases}
+
+    **Backward pass:** Triangle of height :math:`k` and width :math:`2/k` centred on the threshold.
+
+        .. math::
+
+                \\frac{∂S}{∂U}=k\\,{\\rm max}(0, 1 - k|U|)
+
+    :math:`k` defaults to 1, and can be modified by calling ``surrogate.triangular(slope=1)``."""
+
+
+def triangular(slope=1):
+    """Triangular surrogate gradient enclosed with a parameterized slope."""
+    return _spike_op("SurrogateSpike", "triangular", slope=slope)
+
+
+class SpikeRateEscape:
+    """
+    Spike rate escape surrogate gradient.
+
+    **Forward pass:** Heaviside step function shifted.
+
+        .. math::
+
+            S=\\begin{cases} 1 & \\text{if U ≥ U$_{\\rm thr}$} \\\\
+            0 & \\text{if U < U$_{\\rm thr}$}
+            \\end{cases}
+
+    **Backward pass:** Exponential escape noise.
+
+        .. math::
+
+                \\frac{∂S}{∂U}=k{\\rm exp}(-β|U|)
+
+    :math:`β` defaults to 1 and :math:`k` to 25, and can be modified by calling ``surrogate.spike_rate_escape(beta=1, slope=25)``.
+
+    Adapted from:
+
+    *Wulfram Gerstner and Werner M. Kistler, Spiking neuron models: Single neurons, populations, plasticity. Cambridge University Press, 2002.*"""
+
+
+def spike_rate_escape(beta=1, slope=25):
+    """SpikeRateEscape surrogate gradient enclosed with a parameterized slope."""
+    return _spike_op("SurrogateSpike", "spike_rate_escape", slope=slope, beta=beta)
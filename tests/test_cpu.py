@@ -0,0 +1,237 @@
+#!/usr/bin/env python
+
+"""Tests for the CPU kernels of snntorch.cpu against plain torch."""
+
+import math
+import os
+
+import pytest
+
+torch = pytest.importorskip("torch")
+
+from snntorch import cpu
+
+pytestmark = pytest.mark.skipif(
+    not os.path.isfile(cpu.LIBRARY),
+    reason="CPU op library not built (make -C snntorch/custom_ops cpu_ops)",
+)
+
+# Surrogates without a transcendental, which the kernels compute with the
+# same float32 operations as the reference
+EXACT = ["heaviside", "straight_through_estimator", "fast_sigmoid",
+         "triangular"]
+ALL = EXACT + ["sigmoid", "atan", "spike_rate_escape"]
+SLOPES = {"fast_sigmoid": 25.0, "sigmoid": 25.0, "atan": 2.0,
+          "triangular": 1.0, "spike_rate_escape": 25.0}
+
+# 37 leaves a tail after the 8-wide AVX2 loop, 1000 does not
+SIZES = [37, 1000]
+
+
+@pytest.fixture(autouse=True)
+def seed():
+    torch.manual_seed(0)
+
+
+@pytest.fixture(scope="module")
+def ops():
+    return cpu.load_cpu_ops()
+
+
+def surrogate_grad_ref(u, surrogate, k, beta=1.0):
+    """dS/dU of `surrogate` at u, as neuron_step::surrogateGrad."""
+    if surrogate == "heaviside":
+        return (u >= 0).to(u.dtype)
+    if surrogate == "straight_through_estimator":
+        return torch.ones_like(u)
+    if surrogate == "fast_sigmoid":
+        d = k * u.abs() + 1
+        return 1 / (d * d)
+    if surrogate == "sigmoid":
+        s = 1 / (1 + torch.exp(-(k * u)))
+        return k * (s * (1 - s))
+    if surrogate == "atan":
+        a = math.pi / 2 * k * u
+        return (k / 2) / (1 + a * a)
+    if surrogate == "triangular":
+        return k * (1 - k * u.abs()).clamp(min=0)
+    return k * torch.exp(-beta * u.abs())
+
+
+class _SpikeRef(torch.autograd.Function):
+    @staticmethod
+    def forward(ctx, x, threshold, surrogate, k):
+        ctx.save_for_backward(x, threshold)
+        ctx.surrogate = (surrogate, k)
+        return (x >= threshold).to(x.dtype)
+
+    @staticmethod
+    def backward(ctx, grad):
+        x, threshold = ctx.saved_tensors
+        g = grad * surrogate_grad_ref(x - threshold, *ctx.surrogate)
+        return g, -g, None, None
+
+
+def leaky_step_ref(input_, mem, beta, threshold, reset_mechanism,
+                   surrogate, k):
+    """LeakyStep in plain torch, differentiable through autograd."""
+    base = beta.clamp(0, 1) * mem + input_
+    fired = mem >= threshold
+    if reset_mechanism == cpu._RESET_SUBTRACT:
+        mem_next = base - fired.to(base.dtype) * threshold
+    elif reset_mechanism == cpu._RESET_ZERO:
+        mem_next = torch.where(fired, torch.zeros_like(base), base)
+    else:
+        mem_next = base
+    return _SpikeRef.apply(mem_next, threshold, surrogate, k), mem_next
+
+
+def neuron_inputs(n, dtype=torch.float32):
+    """input, mem, beta, threshold with per-neuron parameters, some mem
+    exactly at threshold and some beta outside [0, 1]."""
+    input_ = torch.randn(2, n)
+    mem = torch.randn(2, n)
+    beta = torch.rand(2, n) * 1.4 - 0.2
+    threshold = torch.rand(2, n) + 0.5
+    mem[:, ::5] = threshold[:, ::5]
+    return [t.to(dtype) for t in (input_, mem, beta, threshold)]
+
+
+@pytest.mark.parametrize("n", SIZES)
+def test_spike(ops, n):
+    x = torch.randn(3, n)
+    threshold = torch.rand(n)
+    x[:, ::4] = threshold[::4]
+    assert torch.equal(ops.spike(x, threshold), (x >= threshold).float())
+    assert torch.equal(ops.spike(x, torch.tensor(0.5)), (x >= 0.5).float())
+
+
+@pytest.mark.parametrize("n", SIZES)
+@pytest.mark.parametrize("surrogate", ALL)
+def test_surrogate_grad(ops, n, surrogate):
+    grad = torch.randn(3, n)
+    x = torch.randn(3, n)
+    threshold = torch.rand(n)
+    k = SLOPES.get(surrogate, 1.0)
+    out = ops.surrogate_grad(grad, x, threshold, surrogate, k, 1.0)
+    ref = grad * surrogate_grad_ref(x - threshold, surrogate, k)
+    if surrogate in EXACT:
+        assert torch.equal(out, ref)
+    else:
+        torch.testing.assert_close(out, ref)
+
+
+@pytest.mark.parametrize("surrogate", ["heaviside", "fast_sigmoid", "atan"])
+def test_spike_function(surrogate):
+    x = torch.randn(4, 37, requires_grad=True)
+    threshold = torch.tensor(0.25, requires_grad=True)
+    k = SLOPES.get(surrogate, 1.0)
+    spk = cpu.spike(x, threshold, surrogate, k)
+    ref = _SpikeRef.apply(x, threshold, surrogate, k)
+    assert torch.equal(spk, ref)
+
+    grad = torch.randn_like(spk)
+    out = torch.autograd.grad(spk, (x, threshold), grad)
+    expected = torch.autograd.grad(ref, (x, threshold), grad)
+    torch.testing.assert_close(out, expected)
+
+
+@pytest.mark.parametrize("n", SIZES)
+@pytest.mark.parametrize("reset_mechanism", [0, 1, 2])
+def test_leaky_step(ops, n, reset_mechanism):
+    input_, mem, beta, threshold = neuron_inputs(n)
+    spk, mem_next = ops.leaky_step(input_, mem, beta, threshold,
+                                   reset_mechanism)
+    spk_ref, mem_ref = leaky_step_ref(input_, mem, beta, threshold,
+                                      reset_mechanism, "fast_sigmoid", 1.0)
+    assert torch.equal(mem_next, mem_ref)
+    assert torch.equal(spk, spk_ref)
+
+
+@pytest.mark.parametrize("n", SIZES)
+@pytest.mark.parametrize("reset_mechanism", [0, 1, 2])
+@pytest.mark.parametrize("surrogate", EXACT)
+def test_leaky_step_backward(n, reset_mechanism, surrogate):
+    inputs = [t.requires_grad_() for t in neuron_inputs(n)]
+    k = SLOPES.get(surrogate, 1.0)
+    spk, mem_next = cpu.leaky_step(*inputs, reset_mechanism, surrogate, k)
+    spk_ref, mem_ref = leaky_step_ref(*inputs, reset_mechanism, surrogate, k)
+
+    grad_spk = torch.randn_like(spk)
+    grad_mem = torch.randn_like(mem_next)
+    out = torch.autograd.grad((spk, mem_next), inputs, (grad_spk, grad_mem))
+    expected = torch.autograd.grad((spk_ref, mem_ref), inputs,
+                                   (grad_spk, grad_mem))
+    for a, b in zip(out, expected):
+        assert torch.equal(a, b)
+
+
+def test_leaky_step_backward_without_mem_grad(ops):
+    # No grad_mem_next: the loss is on the spikes alone
+    input_, mem, beta, threshold = neuron_inputs(37)
+    _, mem_next = ops.leaky_step(input_, mem, beta, threshold, 0)
+    grad_spk = torch.randn_like(mem_next)
+    out = ops.leaky_step_backward(grad_spk, None, mem, beta, threshold,
+                                  mem_next, 0, "fast_sigmoid", 25.0, 1.0)
+    expected = ops.leaky_step_backward(
+        grad_spk, torch.zeros_like(mem_next), mem, beta, threshold,
+        mem_next, 0, "fast_sigmoid", 25.0, 1.0)
+    for a, b in zip(out, expected):
+        assert torch.equal(a, b)
+
+
+def test_leaky_step_shared_parameters():
+    # One beta and threshold for every neuron, summed back in the backward
+    input_ = torch.randn(4, 37, requires_grad=True)
+    mem = torch.randn(4, 37, requires_grad=True)
+    beta = torch.tensor(0.9, requires_grad=True)
+    threshold = torch.tensor(1.0, requires_grad=True)
+    inputs = (input_, mem, beta, threshold)
+    spk, mem_next = cpu.leaky_step(*inputs, 0, "fast_sigmoid", 25.0)
+    spk_ref, mem_ref = leaky_step_ref(*inputs, 0, "fast_sigmoid", 25.0)
+    assert torch.equal(spk, spk_ref)
+    assert torch.equal(mem_next, mem_ref)
+
+    grad_spk = torch.randn_like(spk)
+    grad_mem = torch.randn_like(mem_next)
+    out = torch.autograd.grad((spk, mem_next), inputs, (grad_spk, grad_mem))
+    expected = torch.autograd.grad((spk_ref, mem_ref), inputs,
+                                   (grad_spk, grad_mem))
+    torch.testing.assert_close(out, expected)
+
+
+# Half tensors are computed in float32 and rounded once, so they match the
+# float32 reference rounded to half
+@pytest.mark.parametrize("reset_mechanism", [0, 1, 2])
+def test_half(ops, reset_mechanism):
+    half = neuron_inputs(37, torch.float16)
+    input_, mem, beta, threshold = half
+    single = [t.float() for t in half]
+
+    spk, mem_next = ops.leaky_step(input_, mem, beta, threshold,
+                                   reset_mechanism)
+    spk_ref, mem_ref = leaky_step_ref(*single, reset_mechanism,
+                                      "fast_sigmoid", 25.0)
+    assert spk.dtype == torch.float16
+    assert torch.equal(spk, spk_ref.half())
+    assert torch.equal(mem_next, mem_ref.half())
+    assert torch.equal(ops.spike(mem, threshold),
+                       (single[1] >= single[3]).half())
+
+    grad_spk = torch.randn(2, 37).half()
+    out = ops.surrogate_grad(grad_spk, mem, threshold, "fast_sigmoid", 25.0,
+                             1.0)
+    ref = grad_spk.float() * surrogate_grad_ref(single[1] - single[3],
+                                                "fast_sigmoid", 25.0)
+    assert torch.equal(out, ref.half())
+
+    grad_mem = torch.randn(2, 37).half()
+    out = ops.leaky_step_backward(grad_spk, grad_mem, mem, beta, threshold,
+                                  mem_next, reset_mechanism, "fast_sigmoid",
+                                  25.0, 1.0)
+    expected = ops.leaky_step_backward(
+        grad_spk.float(), grad_mem.float(), single[1], single[2], single[3],
+        mem_next.float(), reset_mechanism, "fast_sigmoid", 25.0, 1.0)
+    for a, b in zip(out, expected):
+        assert a.dtype == torch.float16
+        assert torch.equal(a, b.half())
@@ -0,0 +1,48 @@
+#!/usr/bin/env python
+
+"""Tests for the on-device encodings of snntorch.spikegen against their host
+versions, on the IPU Model."""
+
+import os
+
+import pytest
+
+torch = pytest.importorskip("torch")
+poptorch = pytest.importorskip("poptorch")
+
+from snntorch import so_file, spikegen
+
+pytestmark = pytest.mark.skipif(
+    not os.path.isfile(so_file.LIBRARY),
+    reason="custom op library not built (make -C snntorch/custom_ops)",
+)
+
+
+class Delta(torch.nn.Module):
+    def __init__(self, **kwargs):
+        super().__init__()
+        self.kwargs = kwargs
+
+    def forward(self, data):
+        return spikegen.delta(data, **self.kwargs)
+
+
+def on_device(model, *inputs):
+    options = poptorch.Options()
+    options.useIpuModel(True)
+    return poptorch.inferenceModel(model, options)(*inputs)
+
+
+# Odd and even step counts split differently between the two in-place
+# passes; a threshold <= 0 lets a change be both an on and an off spike
+@pytest.mark.parametrize("num_steps", [1, 2, 5, 6])
+@pytest.mark.parametrize("threshold", [1.0, 0.0, -1.0])
+@pytest.mark.parametrize("padding", [False, True])
+@pytest.mark.parametrize("off_spike", [False, True])
+def test_delta(num_steps, threshold, padding, off_spike):
+    torch.manual_seed(0)
+    # Small integers, so that some changes are exactly 0 or +-threshold
+    data = torch.randint(-2, 3, (num_steps, 4, 9)).float()
+    kwargs = dict(threshold=threshold, padding=padding, off_spike=off_spike)
+    expected = spikegen.delta(data, **kwargs)
+    assert torch.equal(on_device(Delta(**kwargs), data), expected)